@@ -0,0 +1,189 @@
+/*
+ * Thread placement shared by the benchmarks; see affinity.h.
+ */
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "affinity.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static int thread_num(void)
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+static int num_threads(void)
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+/* Parse "0,2,4-7" into cfg->cpus */
+static int parse_list(const char *spec, affinity_config *cfg)
+{
+    const char *p = spec;
+
+    cfg->ncpus = 0;
+    while (*p != '\0') {
+        char *end;
+        long lo, hi;
+
+        lo = strtol(p, &end, 10);
+        if (end == p || lo < 0)
+            return -1;
+        hi = lo;
+        if (*end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+            if (end == p || hi < lo)
+                return -1;
+        }
+        for (; lo <= hi; lo++) {
+            if (cfg->ncpus == AFFINITY_MAX_CPUS || lo >= CPU_SETSIZE)
+                return -1;
+            cfg->cpus[cfg->ncpus++] = (int) lo;
+        }
+        if (*end == ',')
+            end++;
+        else if (*end != '\0')
+            return -1;
+        p = end;
+    }
+    return cfg->ncpus > 0 ? 0 : -1;
+}
+
+int affinity_parse(const char *spec, affinity_config *cfg)
+{
+    cfg->ncpus = 0;
+    if (strcmp(spec, "none") == 0)
+        cfg->policy = BIND_NONE;
+    else if (strcmp(spec, "compact") == 0)
+        cfg->policy = BIND_COMPACT;
+    else if (strcmp(spec, "spread") == 0)
+        cfg->policy = BIND_SPREAD;
+    else {
+        cfg->policy = BIND_LIST;
+        return parse_list(spec, cfg);
+    }
+    return 0;
+}
+
+const char *affinity_name(const affinity_config *cfg)
+{
+    switch (cfg->policy) {
+    case BIND_COMPACT: return "compact";
+    case BIND_SPREAD:  return "spread";
+    case BIND_LIST:    return "explicit list";
+    default:           return "none";
+    }
+}
+
+/*
+ * Work out the CPU for each of nthreads threads.  Returns 0 on success,
+ * -1 if the process has no CPUs to run on.
+ */
+static int build_map(const affinity_config *cfg, int nthreads, int *map)
+{
+    cpu_set_t allowed;
+    int avail[CPU_SETSIZE];
+    int navail = 0, cpu, t;
+
+    if (cfg->policy == BIND_LIST) {
+        for (t = 0; t < nthreads; t++)
+            map[t] = cfg->cpus[t % cfg->ncpus];
+        return 0;
+    }
+
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        fprintf(stderr, "sched_getaffinity failed: %s\n", strerror(errno));
+        return -1;
+    }
+    for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed))
+            avail[navail++] = cpu;
+    }
+    if (navail == 0)
+        return -1;
+
+    for (t = 0; t < nthreads; t++) {
+        if (cfg->policy == BIND_SPREAD && nthreads < navail)
+            map[t] = avail[(int) ((long) t * navail / nthreads)];
+        else
+            map[t] = avail[t % navail];
+    }
+    return 0;
+}
+
+int affinity_apply(const affinity_config *cfg)
+{
+    int nthreads = num_threads();
+    int *map;
+    int failed = 0;
+
+    if (cfg->policy == BIND_NONE)
+        return 0;
+
+    map = malloc(nthreads * sizeof(int));
+    if (map == NULL || build_map(cfg, nthreads, map) != 0) {
+        free(map);
+        return -1;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel reduction(+:failed)
+#endif
+    {
+        cpu_set_t set;
+        int cpu = map[thread_num()];
+
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            fprintf(stderr, "Cannot bind thread %d to CPU %d: %s\n",
+                    thread_num(), cpu, strerror(errno));
+            failed++;
+        }
+    }
+
+    free(map);
+    return failed ? -1 : 0;
+}
+
+void affinity_report(FILE *out)
+{
+    int nthreads = num_threads();
+    int *cpus = malloc(nthreads * sizeof(int));
+    int t;
+
+    if (cpus == NULL)
+        return;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    cpus[thread_num()] = sched_getcpu();
+
+    fprintf(out, "Thread -> CPU:");
+    for (t = 0; t < nthreads; t++) {
+        if (t > 0 && t % 8 == 0)
+            fprintf(out, "\n              ");
+        fprintf(out, " %d->%d", t, cpus[t]);
+    }
+    fprintf(out, "\n");
+    free(cpus);
+}
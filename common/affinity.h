@@ -0,0 +1,52 @@
+/*
+ * Thread placement shared by the benchmarks.
+ *
+ * The --bind option takes one of
+ *   none           leave placement to the OS (the default)
+ *   compact        thread i on the i-th CPU the process may run on
+ *   spread         threads evenly strided across those CPUs
+ *   <cpu list>     thread i on the i-th entry of e.g. "0,2,4-7"
+ *                  (wrapping if there are more threads than entries)
+ *
+ * CPUs are numbered as in the process's initial affinity mask, so
+ * compact/spread respect taskset and cgroup restrictions.
+ */
+
+#ifndef BENCH_AFFINITY_H
+#define BENCH_AFFINITY_H
+
+#include <stdio.h>
+
+#define AFFINITY_MAX_CPUS 1024
+
+typedef enum {
+    BIND_NONE,
+    BIND_COMPACT,
+    BIND_SPREAD,
+    BIND_LIST
+} bind_policy;
+
+typedef struct {
+    bind_policy policy;
+    int ncpus;                      /* entries used in cpus[] (BIND_LIST) */
+    int cpus[AFFINITY_MAX_CPUS];
+} affinity_config;
+
+/* Returns 0 on success, -1 if spec is not a valid --bind argument */
+int affinity_parse(const char *spec, affinity_config *cfg);
+
+/* Human-readable form of cfg->policy, e.g. "spread" */
+const char *affinity_name(const affinity_config *cfg);
+
+/*
+ * Pin every OpenMP thread (or the calling thread in a serial build) to its
+ * CPU.  Call outside a parallel region, with the thread count the timed
+ * regions will use.  Returns 0 on success; on failure prints the reason
+ * to stderr and returns -1.
+ */
+int affinity_apply(const affinity_config *cfg);
+
+/* Print the CPU each thread is currently running on (sched_getcpu) */
+void affinity_report(FILE *out);
+
+#endif
@@ -0,0 +1,373 @@
+/*
+ * Hardware performance counters shared by the benchmarks; see counters.h.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "counters.h"
+#include "report.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+typedef struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+} event_desc;
+
+#define HW_CACHE(cache, op, result) \
+    ((cache) | ((uint64_t) (op) << 8) | ((uint64_t) (result) << 16))
+
+static const event_desc known[] = {
+    {"cycles",           PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cache-references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {"cache-misses",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch-misses",    PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"llc-load-misses",  PERF_TYPE_HW_CACHE,
+     HW_CACHE(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"llc-store-misses", PERF_TYPE_HW_CACHE,
+     HW_CACHE(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_WRITE, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"dtlb-load-misses", PERF_TYPE_HW_CACHE,
+     HW_CACHE(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"page-faults",      PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    {"task-clock",       PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+};
+
+#define NKNOWN ((int) (sizeof(known) / sizeof(known[0])))
+
+static const char *default_spec = "cycles,instructions,cache-references,cache-misses,llc-load-misses";
+
+/* Events asked for, then the subset that could be opened */
+static event_desc selected[COUNTERS_MAX_EVENTS];
+static char raw_names[COUNTERS_MAX_EVENTS][24];
+static int nselected;
+static event_desc events[COUNTERS_MAX_EVENTS];
+static int nevents;
+
+static int enabled;
+static int nthreads;
+static int *fds;                /* nthreads x COUNTERS_MAX_EVENTS, leader first */
+
+/* PERF_FORMAT_GROUP | TOTAL_TIME_ENABLED | TOTAL_TIME_RUNNING layout */
+typedef struct {
+    uint64_t nr;
+    uint64_t time_enabled;
+    uint64_t time_running;
+    uint64_t values[COUNTERS_MAX_EVENTS];
+} group_read;
+
+typedef struct {
+    char name[48];
+    group_read *start;          /* per thread, from counters_begin() */
+    double *count;              /* nthreads x COUNTERS_MAX_EVENTS, scaled */
+    long unscheduled;           /* thread executions the group never ran in */
+} region;
+
+static region regions[COUNTERS_MAX_REGIONS];
+static int nregions;
+
+int counters_parse(const char *spec)
+{
+    char buf[256], *tok, *save;
+    int i;
+
+    if (strcmp(spec, "default") == 0)
+        spec = default_spec;
+    if (strlen(spec) >= sizeof(buf))
+        return -1;
+    strcpy(buf, spec);
+
+    nselected = 0;
+    for (tok = strtok_r(buf, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+        event_desc *e;
+
+        if (nselected == COUNTERS_MAX_EVENTS)
+            return -1;
+        e = &selected[nselected];
+        if (strncmp(tok, "raw:", 4) == 0) {
+            char *end;
+            e->config = strtoull(tok + 4, &end, 16);
+            if (end == tok + 4 || *end != '\0')
+                return -1;
+            e->type = PERF_TYPE_RAW;
+            snprintf(raw_names[nselected], sizeof(raw_names[0]), "%s", tok);
+            e->name = raw_names[nselected];
+        } else {
+            for (i = 0; i < NKNOWN; i++)
+                if (strcmp(tok, known[i].name) == 0)
+                    break;
+            if (i == NKNOWN)
+                return -1;
+            *e = known[i];
+        }
+        nselected++;
+    }
+    if (nselected == 0)
+        return -1;
+    enabled = 1;
+    return 0;
+}
+
+int counters_enabled(void)
+{
+    return enabled;
+}
+
+static int open_event(const event_desc *e, int group_fd)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = e->type;
+    attr.config = e->config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED
+                     | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    /* user space only, which perf_event_paranoid=2 still allows */
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+int counters_open(void)
+{
+    int i, failed = 0;
+
+    if (!enabled)
+        return 0;
+
+    /* Probe each event on this thread and keep the ones that open */
+    nevents = 0;
+    for (i = 0; i < nselected; i++) {
+        int fd = open_event(&selected[i], -1);
+        if (fd < 0) {
+            fprintf(stderr, "Counter %s not available: %s\n", selected[i].name, strerror(errno));
+            continue;
+        }
+        close(fd);
+        events[nevents++] = selected[i];
+    }
+    if (nevents == 0) {
+        fprintf(stderr, "No hardware counters could be opened "
+                        "(check /proc/sys/kernel/perf_event_paranoid)\n");
+        return -1;
+    }
+
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+#else
+    nthreads = 1;
+#endif
+    fds = malloc(nthreads * COUNTERS_MAX_EVENTS * sizeof(int));
+    if (fds == NULL) {
+        fprintf(stderr, "Out of memory opening counters\n");
+        return -1;
+    }
+    /* A thread's group is open iff its first fd is not -1 */
+    for (i = 0; i < nthreads; i++)
+        fds[i * COUNTERS_MAX_EVENTS] = -1;
+
+    /* Each thread opens its own group, counting only itself */
+#ifdef _OPENMP
+#pragma omp parallel reduction(+:failed)
+#endif
+    {
+        int t = 0, k, *fd;
+#ifdef _OPENMP
+        t = omp_get_thread_num();
+#endif
+        fd = &fds[t * COUNTERS_MAX_EVENTS];
+        for (k = 0; k < nevents; k++) {
+            fd[k] = open_event(&events[k], k == 0 ? -1 : fd[0]);
+            if (fd[k] < 0) {
+                /* the group may not fit in the PMU; drop the thread's group */
+                while (--k >= 0)
+                    close(fd[k]);
+                fd[0] = -1;
+                failed++;
+                break;
+            }
+        }
+    }
+    if (failed) {
+        fprintf(stderr, "Could not open the counter group on %d of %d threads "
+                        "(try fewer events)\n", failed, nthreads);
+        /* Close the groups that did open */
+        for (i = 0; i < nthreads; i++) {
+            int k, *fd = &fds[i * COUNTERS_MAX_EVENTS];
+
+            if (fd[0] < 0)
+                continue;
+            for (k = 0; k < nevents; k++)
+                close(fd[k]);
+        }
+        free(fds);
+        fds = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int counters_region(const char *name)
+{
+    region *r;
+    int i;
+
+    if (!enabled || fds == NULL)
+        return -1;
+    for (i = 0; i < nregions; i++)
+        if (strcmp(regions[i].name, name) == 0)
+            return i;
+    if (nregions == COUNTERS_MAX_REGIONS)
+        return -1;
+    r = &regions[nregions];
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->start = calloc(nthreads, sizeof(group_read));
+    r->count = calloc(nthreads * COUNTERS_MAX_EVENTS, sizeof(double));
+    if (r->start == NULL || r->count == NULL) {
+        free(r->start);
+        free(r->count);
+        return -1;
+    }
+    return nregions++;
+}
+
+static void read_group(int t, group_read *g)
+{
+    if (read(fds[t * COUNTERS_MAX_EVENTS], g, sizeof(*g)) < 0)
+        memset(g, 0, sizeof(*g));
+}
+
+void counters_begin(int id)
+{
+    int t;
+
+    if (id < 0)
+        return;
+    for (t = 0; t < nthreads; t++)
+        read_group(t, &regions[id].start[t]);
+}
+
+void counters_end(int id)
+{
+    region *r;
+    group_read now;
+    int t, k;
+
+    if (id < 0)
+        return;
+    r = &regions[id];
+    for (t = 0; t < nthreads; t++) {
+        uint64_t en, run;
+
+        read_group(t, &now);
+        en = now.time_enabled - r->start[t].time_enabled;
+        run = now.time_running - r->start[t].time_running;
+        if (run == 0) {
+            r->unscheduled++;
+            continue;
+        }
+        for (k = 0; k < nevents; k++)
+            r->count[t * COUNTERS_MAX_EVENTS + k] +=
+                (double) (now.values[k] - r->start[t].values[k]) * en / run;
+    }
+}
+
+static int event_index(const char *name)
+{
+    int k;
+
+    for (k = 0; k < nevents; k++)
+        if (strcmp(events[k].name, name) == 0)
+            return k;
+    return -1;
+}
+
+static void print_row(FILE *out, const char *name, const char *who, const double *c)
+{
+    int k, cyc = event_index("cycles"), ins = event_index("instructions");
+    int ref = event_index("cache-references"), miss = event_index("cache-misses");
+
+    fprintf(out, "%-22s %-7s", name, who);
+    for (k = 0; k < nevents; k++)
+        fprintf(out, " %16.0f", c[k]);
+    if (cyc >= 0 && ins >= 0)
+        fprintf(out, " %6.2f", c[cyc] > 0 ? c[ins] / c[cyc] : 0.0);
+    if (ref >= 0 && miss >= 0)
+        fprintf(out, " %6.1f%%", c[ref] > 0 ? 100.0 * c[miss] / c[ref] : 0.0);
+    fprintf(out, "\n");
+}
+
+void counters_report(FILE *out)
+{
+    double total[COUNTERS_MAX_EVENTS];
+    char key[96];
+    int i, t, k;
+
+    if (!enabled || fds == NULL || nregions == 0)
+        return;
+
+    fprintf(out, "Hardware counters (user space, summed over all executions):\n");
+    fprintf(out, "%-22s %-7s", "Region", "Thread");
+    for (k = 0; k < nevents; k++)
+        fprintf(out, " %16s", events[k].name);
+    if (event_index("cycles") >= 0 && event_index("instructions") >= 0)
+        fprintf(out, " %6s", "IPC");
+    if (event_index("cache-references") >= 0 && event_index("cache-misses") >= 0)
+        fprintf(out, " %7s", "Miss");
+    fprintf(out, "\n");
+
+    for (i = 0; i < nregions; i++) {
+        region *r = &regions[i];
+
+        for (k = 0; k < nevents; k++) {
+            total[k] = 0.0;
+            for (t = 0; t < nthreads; t++)
+                total[k] += r->count[t * COUNTERS_MAX_EVENTS + k];
+        }
+        print_row(out, r->name, "all", total);
+        if (nthreads > 1) {
+            for (t = 0; t < nthreads; t++) {
+                char who[16];
+                snprintf(who, sizeof(who), "%d", t);
+                print_row(out, "", who, &r->count[t * COUNTERS_MAX_EVENTS]);
+            }
+        }
+        if (r->unscheduled > 0)
+            fprintf(out, "%-22s (group not scheduled in %ld thread executions)\n",
+                    "", r->unscheduled);
+
+        for (k = 0; k < nevents; k++) {
+            snprintf(key, sizeof(key), "counters.%.47s.%.31s", r->name, events[k].name);
+            report_param_num(key, total[k]);
+        }
+    }
+}
+
+void counters_close(void)
+{
+    int i, t, k;
+
+    if (fds != NULL) {
+        for (t = 0; t < nthreads; t++)
+            for (k = 0; k < nevents; k++)
+                close(fds[t * COUNTERS_MAX_EVENTS + k]);
+        free(fds);
+        fds = NULL;
+    }
+    for (i = 0; i < nregions; i++) {
+        free(regions[i].start);
+        free(regions[i].count);
+    }
+    nregions = 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * Hardware performance counters shared by the benchmarks.
+ *
+ * --counters LIST opens a perf_event_open group on every OpenMP thread
+ * and counts user-space events around each timed kernel.  LIST is
+ * "default" or a comma-separated list of
+ *   cycles, instructions, cache-references, cache-misses,
+ *   branch-misses, llc-load-misses, llc-store-misses,
+ *   dtlb-load-misses, page-faults, task-clock (ns), raw:0xCODE
+ * where raw events are passed to the core PMU unchanged (on RISC-V these
+ * are the SBI PMU event codes of the platform, e.g. for DRAM traffic).
+ * "default" is cycles, instructions, cache-references, cache-misses and
+ * llc-load-misses; events the kernel or PMU does not offer are skipped
+ * with a warning.
+ *
+ * Counts are accumulated per named region and per thread and scaled for
+ * multiplexing.  The threads keep their groups across parallel regions,
+ * which holds because the OpenMP runtime reuses the same pool of threads.
+ */
+
+#ifndef BENCH_COUNTERS_H
+#define BENCH_COUNTERS_H
+
+#include <stdio.h>
+
+#define COUNTERS_MAX_EVENTS 8
+#define COUNTERS_MAX_REGIONS 32
+
+/* Returns 0 on success, -1 if spec is not a valid --counters argument */
+int counters_parse(const char *spec);
+
+/* 1 if --counters was given */
+int counters_enabled(void);
+
+/*
+ * Open the groups on the current OpenMP threads; call after
+ * affinity_apply().  Returns 0 on success or when counters are disabled;
+ * on failure prints the reason and returns -1.
+ */
+int counters_open(void);
+
+/* Id of the named region, created on first use; -1 if disabled */
+int counters_region(const char *name);
+
+/* Bracket one execution of a region; called outside parallel regions */
+void counters_begin(int id);
+void counters_end(int id);
+
+/*
+ * Print totals and per-thread counts with IPC and cache miss rate for
+ * every region, and add the totals to the --format record.
+ */
+void counters_report(FILE *out);
+
+void counters_close(void);
+
+#endif
@@ -0,0 +1,517 @@
+/*
+ * Energy and power measurement shared by the benchmarks; see energy.h.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include "energy.h"
+#include "report.h"
+
+#define POWERCAP_DIR "/sys/class/powercap"
+#define HWMON_DIR "/sys/class/hwmon"
+
+typedef struct {
+    char name[48];              /* e.g. "rapl:package-0", "hwmon:ina226:power1" */
+    int fd;
+    int counter;                /* reads microjoules (1) or microwatts (0) */
+    int summed;                 /* part of the total */
+    double range;               /* wrap-around of a counter in microjoules; 0 if unknown */
+    double last;                /* previous reading */
+    double joules;              /* since energy_open() */
+} source;
+
+typedef struct {
+    char name[48];
+    double work;                /* rate_unit seconds per execution; 0 if none */
+    char unit[16];
+    double start[ENERGY_MAX_SOURCES];   /* source joules at energy_begin() */
+    double joules[ENERGY_MAX_SOURCES];
+    double t0, seconds;
+    long runs;
+} region;
+
+/* --energy */
+static int enabled;
+static int want_auto, want_rapl, want_hwmon;
+static char paths[ENERGY_MAX_SOURCES][256];
+static int npaths;
+static long interval_ms = 10;
+
+static source sources[ENERGY_MAX_SOURCES];
+static int nsources;
+static int denied;              /* RAPL zones without read permission */
+
+static region regions[ENERGY_MAX_REGIONS];
+static int nregions;
+
+/* The sensors and sample time below are shared with the sampling thread */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake;
+static pthread_t sampler;
+static int running, stopping, active;
+static double last_time;
+
+int energy_parse(const char *spec)
+{
+    char buf[1024], *tok, *save;
+
+    if (strlen(spec) >= sizeof(buf))
+        return -1;
+    strcpy(buf, spec);
+
+    want_auto = want_rapl = want_hwmon = npaths = 0;
+    for (tok = strtok_r(buf, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+        if (strcmp(tok, "auto") == 0) {
+            want_auto = 1;
+        } else if (strcmp(tok, "rapl") == 0) {
+            want_rapl = 1;
+        } else if (strcmp(tok, "hwmon") == 0) {
+            want_hwmon = 1;
+        } else if (strncmp(tok, "interval=", 9) == 0) {
+            char *end;
+            interval_ms = strtol(tok + 9, &end, 10);
+            if (end == tok + 9 || *end != '\0' || interval_ms < 1)
+                return -1;
+        } else if (tok[0] == '/' && npaths < ENERGY_MAX_SOURCES) {
+            snprintf(paths[npaths++], sizeof(paths[0]), "%s", tok);
+        } else {
+            return -1;
+        }
+    }
+    /* "interval=MS" alone keeps the automatic choice */
+    if (!want_rapl && !want_hwmon && npaths == 0)
+        want_auto = 1;
+    enabled = 1;
+    return 0;
+}
+
+int energy_enabled(void)
+{
+    return enabled;
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+}
+
+/* sysfs attributes are re-read from offset 0 of the open file */
+static int read_value(int fd, double *v)
+{
+    char buf[64];
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+
+    if (n <= 0)
+        return -1;
+    buf[n] = '\0';
+    *v = strtod(buf, NULL);
+    return 0;
+}
+
+/* First line of a small text file without its newline, or "" */
+static void read_text(const char *path, char *buf, size_t len)
+{
+    FILE *f = fopen(path, "r");
+
+    buf[0] = '\0';
+    if (f == NULL)
+        return;
+    if (fgets(buf, (int) len, f) == NULL)
+        buf[0] = '\0';
+    buf[strcspn(buf, "\n")] = '\0';
+    fclose(f);
+}
+
+/* Returns 0, or -1 with errno set if path cannot be read */
+static int add_source(const char *path, const char *name, int counter, int summed,
+                      double range)
+{
+    source *s = &sources[nsources];
+    int fd;
+
+    if (nsources == ENERGY_MAX_SOURCES) {
+        errno = ENOSPC;
+        return -1;
+    }
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return -1;
+    if (read_value(fd, &s->last) != 0) {
+        if (errno == 0)
+            errno = EIO;
+        close(fd);
+        return -1;
+    }
+    snprintf(s->name, sizeof(s->name), "%s", name);
+    s->fd = fd;
+    s->counter = counter;
+    s->summed = summed;
+    s->range = range;
+    s->joules = 0.0;
+    nsources++;
+    return 0;
+}
+
+/*
+ * Zones intel-rapl:N (packages, psys) and subzones intel-rapl:N:M (core,
+ * uncore, dram).  The cores and uncore are part of their package and
+ * psys covers the whole SoC, so only package and dram zones are summed.
+ * intel-rapl-mmio repeats the package zones and is left out.
+ */
+static int find_rapl(void)
+{
+    struct dirent **list;
+    char path[512], zone[32], text[32], name[64];
+    int n, i, found = 0;
+
+    if ((n = scandir(POWERCAP_DIR, &list, NULL, alphasort)) < 0)
+        return 0;
+    for (i = 0; i < n; i++) {
+        const char *d = list[i]->d_name, *sub;
+
+        if (strncmp(d, "intel-rapl:", 11) != 0)
+            continue;
+        snprintf(path, sizeof(path), "%s/%s/name", POWERCAP_DIR, d);
+        read_text(path, zone, sizeof(zone));
+        snprintf(path, sizeof(path), "%s/%s/max_energy_range_uj", POWERCAP_DIR, d);
+        read_text(path, text, sizeof(text));
+        /* Subzone names repeat across packages: "core-0" for intel-rapl:0:0 */
+        sub = strchr(d + 11, ':');
+        if (sub != NULL)
+            snprintf(name, sizeof(name), "rapl:%.31s-%.*s", zone[0] ? zone : d,
+                     (int) (sub - d - 11), d + 11);
+        else
+            snprintf(name, sizeof(name), "rapl:%.31s", zone[0] ? zone : d);
+        snprintf(path, sizeof(path), "%s/%s/energy_uj", POWERCAP_DIR, d);
+        if (add_source(path, name, 1, strncmp(zone, "package", 7) == 0 ||
+                       strcmp(zone, "dram") == 0, strtod(text, NULL)) == 0)
+            found++;
+        else if (errno == EACCES || errno == EPERM)
+            denied++;
+    }
+    for (i = 0; i < n; i++)
+        free(list[i]);
+    free(list);
+    return found;
+}
+
+/* 1 if file is PREFIX<channel>SUFFIX, e.g. power1_input */
+static int sensor_file(const char *file, const char *prefix, const char *suffix)
+{
+    size_t len = strlen(prefix);
+    char *end;
+
+    if (strncmp(file, prefix, len) != 0 || !isdigit((unsigned char) file[len]))
+        return 0;
+    strtol(file + len, &end, 10);
+    return strcmp(end, suffix) == 0;
+}
+
+/*
+ * Every hwmon chip with energy inputs, or failing that power inputs or
+ * averages.  All of them are summed: select the sensors by path when a
+ * chip monitors overlapping rails.
+ */
+static int find_hwmon(void)
+{
+    static const char *kinds[3][2] = {
+        {"energy", "_input"}, {"power", "_input"}, {"power", "_average"}
+    };
+    struct dirent **dev, **file;
+    char dir[300], path[600], chip[32], label[32], name[64];
+    int ndev, nfile, i, j, k, found = 0;
+
+    if ((ndev = scandir(HWMON_DIR, &dev, NULL, alphasort)) < 0)
+        return 0;
+    for (i = 0; i < ndev; i++) {
+        if (strncmp(dev[i]->d_name, "hwmon", 5) != 0)
+            continue;
+        snprintf(dir, sizeof(dir), "%s/%s", HWMON_DIR, dev[i]->d_name);
+        snprintf(path, sizeof(path), "%s/name", dir);
+        read_text(path, chip, sizeof(chip));
+        if ((nfile = scandir(dir, &file, NULL, alphasort)) < 0)
+            continue;
+        for (k = 0; k < 3; k++) {
+            int kind_found = 0;
+
+            for (j = 0; j < nfile; j++) {
+                const char *f = file[j]->d_name;
+                size_t stem = strlen(f) - strlen(kinds[k][1]);
+
+                if (!sensor_file(f, kinds[k][0], kinds[k][1]))
+                    continue;
+                /* power1_input is labelled by power1_label */
+                snprintf(path, sizeof(path), "%s/%.*s_label", dir, (int) stem, f);
+                read_text(path, label, sizeof(label));
+                if (label[0] == '\0')
+                    snprintf(label, sizeof(label), "%.*s", (int) stem, f);
+                snprintf(name, sizeof(name), "hwmon:%.20s:%.20s", chip[0] ? chip : dev[i]->d_name,
+                         label);
+                snprintf(path, sizeof(path), "%s/%s", dir, f);
+                if (add_source(path, name, k == 0, 1, 0.0) == 0)
+                    kind_found++;
+            }
+            found += kind_found;
+            if (kind_found > 0)
+                break;
+        }
+        for (j = 0; j < nfile; j++)
+            free(file[j]);
+        free(file);
+    }
+    for (i = 0; i < ndev; i++)
+        free(dev[i]);
+    free(dev);
+    return found;
+}
+
+/* Read every sensor and add the energy since the previous reading */
+static void sample_locked(void)
+{
+    double now = now_seconds(), v, d;
+    int s;
+
+    for (s = 0; s < nsources; s++) {
+        source *src = &sources[s];
+
+        if (read_value(src->fd, &v) != 0)
+            continue;
+        if (src->counter) {
+            d = v - src->last;
+            if (d < 0)
+                d = src->range > 0 ? d + src->range : 0.0;
+            src->joules += 1.0e-6 * d;
+        } else {
+            /* Trapezoid between two power readings */
+            src->joules += 1.0e-6 * 0.5 * (v + src->last) * (now - last_time);
+        }
+        src->last = v;
+    }
+    last_time = now;
+}
+
+/* Sleeps on wake between regions and samples every interval inside them */
+static void *sample_loop(void *arg)
+{
+    struct timespec next;
+
+    (void) arg;
+    pthread_mutex_lock(&lock);
+    while (!stopping) {
+        if (active == 0) {
+            pthread_cond_wait(&wake, &lock);
+            continue;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &next);
+        next.tv_nsec += (interval_ms % 1000) * 1000000L;
+        next.tv_sec += interval_ms / 1000 + next.tv_nsec / 1000000000L;
+        next.tv_nsec %= 1000000000L;
+        if (pthread_cond_timedwait(&wake, &lock, &next) == ETIMEDOUT && active > 0)
+            sample_locked();
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+int energy_open(void)
+{
+    pthread_condattr_t attr;
+    int k, nrapl = 0;
+
+    if (!enabled)
+        return 0;
+    if (want_rapl || want_auto)
+        nrapl = find_rapl();
+    if (want_hwmon || (want_auto && nrapl == 0))
+        find_hwmon();
+    for (k = 0; k < npaths; k++) {
+        const char *base = strrchr(paths[k], '/') + 1;
+        char name[64];
+
+        snprintf(name, sizeof(name), "file:%.40s", base);
+        if (add_source(paths[k], name, strncmp(base, "energy", 6) == 0, 1, 0.0) != 0) {
+            fprintf(stderr, "Cannot read energy sensor %s: %s\n", paths[k], strerror(errno));
+            return -1;
+        }
+    }
+    if (nsources == 0) {
+        fprintf(stderr, "No energy sensors found%s\n",
+                denied ? "; the RAPL zones are only readable by root" : "");
+        return -1;
+    }
+    if (denied)
+        fprintf(stderr, "Skipped %d RAPL zones that are only readable by root\n", denied);
+    /* Without package or dram zones, e.g. psys alone, the total is what there is */
+    for (k = 0; k < nsources && !sources[k].summed; k++)
+        ;
+    if (k == nsources)
+        for (k = 0; k < nsources; k++)
+            sources[k].summed = 1;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&wake, &attr);
+    pthread_condattr_destroy(&attr);
+    last_time = now_seconds();
+    if (pthread_create(&sampler, NULL, sample_loop, NULL) != 0) {
+        fprintf(stderr, "Cannot start the energy sampling thread\n");
+        return -1;
+    }
+    running = 1;
+    return 0;
+}
+
+int energy_region(const char *name)
+{
+    int i;
+
+    if (!enabled || nsources == 0)
+        return -1;
+    for (i = 0; i < nregions; i++)
+        if (strcmp(regions[i].name, name) == 0)
+            return i;
+    if (nregions == ENERGY_MAX_REGIONS)
+        return -1;
+    memset(&regions[nregions], 0, sizeof(region));
+    snprintf(regions[nregions].name, sizeof(regions[0].name), "%s", name);
+    return nregions++;
+}
+
+void energy_work(int id, double amount, const char *rate_unit)
+{
+    if (id < 0)
+        return;
+    regions[id].work = amount;
+    snprintf(regions[id].unit, sizeof(regions[id].unit), "%s", rate_unit);
+}
+
+void energy_begin(int id)
+{
+    region *r;
+    int s;
+
+    if (id < 0)
+        return;
+    r = &regions[id];
+    pthread_mutex_lock(&lock);
+    sample_locked();
+    for (s = 0; s < nsources; s++)
+        r->start[s] = sources[s].joules;
+    r->t0 = last_time;
+    active++;
+    pthread_cond_signal(&wake);
+    pthread_mutex_unlock(&lock);
+}
+
+void energy_end(int id)
+{
+    region *r;
+    int s;
+
+    if (id < 0)
+        return;
+    r = &regions[id];
+    pthread_mutex_lock(&lock);
+    sample_locked();
+    for (s = 0; s < nsources; s++)
+        r->joules[s] += sources[s].joules - r->start[s];
+    r->seconds += last_time - r->t0;
+    r->runs++;
+    active--;
+    pthread_mutex_unlock(&lock);
+}
+
+static void print_row(FILE *out, const char *name, const char *who, const region *r,
+                      double joules)
+{
+    double watts = r->seconds > 0 ? joules / r->seconds : 0.0;
+
+    fprintf(out, "%-22s %-26s %12.3f %9.2f %12.5f", name, who, joules, watts,
+            r->runs > 0 ? joules / r->runs : 0.0);
+    /* (work / time) / (joules / time) */
+    if (r->work > 0 && joules > 0)
+        fprintf(out, " %12.3f %s/W", r->work * r->runs / joules, r->unit);
+    fprintf(out, "\n");
+}
+
+void energy_report(FILE *out)
+{
+    char key[128];
+    int i, s;
+
+    if (!enabled || nsources == 0 || nregions == 0)
+        return;
+
+    fprintf(out, "Energy (sensors sampled every %ld ms, summed over all executions):\n",
+            interval_ms);
+    fprintf(out, "%-22s %-26s %12s %9s %12s %12s\n", "Region", "Sensor", "Joules", "Watts",
+            "J/run", "Efficiency");
+    for (i = 0; i < nregions; i++) {
+        region *r = &regions[i];
+        double total = 0.0;
+
+        if (r->runs == 0)
+            continue;
+        for (s = 0; s < nsources; s++)
+            if (sources[s].summed)
+                total += r->joules[s];
+        /* Per sensor when there are several */
+        if (nsources == 1) {
+            print_row(out, r->name, sources[0].name, r, total);
+        } else {
+            print_row(out, r->name, "total", r, total);
+            for (s = 0; s < nsources; s++) {
+                char who[64];
+
+                snprintf(who, sizeof(who), "%.47s%s", sources[s].name,
+                         sources[s].summed ? "" : " (not summed)");
+                print_row(out, "", who, r, r->joules[s]);
+            }
+        }
+
+        snprintf(key, sizeof(key), "energy.%.47s.joules", r->name);
+        report_param_num(key, total);
+        snprintf(key, sizeof(key), "energy.%.47s.seconds", r->name);
+        report_param_num(key, r->seconds);
+        snprintf(key, sizeof(key), "energy.%.47s.watts", r->name);
+        report_param_num(key, r->seconds > 0 ? total / r->seconds : 0.0);
+        if (r->work > 0 && total > 0) {
+            snprintf(key, sizeof(key), "energy.%.47s.%.15s/W", r->name, r->unit);
+            report_param_num(key, r->work * r->runs / total);
+        }
+        for (s = 0; s < nsources; s++) {
+            snprintf(key, sizeof(key), "energy.%.47s.%.47s.joules", r->name, sources[s].name);
+            report_param_num(key, r->joules[s]);
+        }
+    }
+}
+
+void energy_close(void)
+{
+    int s;
+
+    if (running) {
+        pthread_mutex_lock(&lock);
+        stopping = 1;
+        pthread_cond_signal(&wake);
+        pthread_mutex_unlock(&lock);
+        pthread_join(sampler, NULL);
+        pthread_cond_destroy(&wake);
+        running = 0;
+    }
+    for (s = 0; s < nsources; s++)
+        close(sources[s].fd);
+    nsources = 0;
+    nregions = 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * Energy and power measurement shared by the benchmarks.
+ *
+ * --energy LIST reads power sensors around each timed kernel.  LIST is
+ * "auto" or a comma-separated list of
+ *   rapl          powercap zones (/sys/class/powercap/intel-rapl:*), in
+ *                 microjoules; package and dram zones add up to the total
+ *   hwmon         hwmon energy*_input (microjoules) or, for chips without
+ *                 them, power*_input / power*_average (microwatts), as
+ *                 exported by the board power monitors of RISC-V boards
+ *   PATH          any other sysfs file: energy in microjoules if its name
+ *                 starts with "energy", otherwise power in microwatts
+ *   interval=MS   sampling period in milliseconds (default 10)
+ * where "auto" is rapl if any zone can be read and hwmon otherwise.
+ * energy_uj is only readable by root on most kernels.
+ *
+ * The sensors are read at both ends of a region, outside its timer, and
+ * by a background thread every interval while a region runs: energy
+ * counters need it only to catch wrap-around, power readings are
+ * integrated over its samples.  Between regions the thread sleeps, so it
+ * costs one sysfs read per sensor and interval while the kernels run.
+ * RAPL updates about once a millisecond and board monitors are often
+ * slower, so a region should run well beyond the sampling period; the
+ * totals are summed over all executions to average that out.
+ */
+
+#ifndef BENCH_ENERGY_H
+#define BENCH_ENERGY_H
+
+#include <stdio.h>
+
+#define ENERGY_MAX_SOURCES 16
+#define ENERGY_MAX_REGIONS 32
+
+/* Returns 0 on success, -1 if spec is not a valid --energy argument */
+int energy_parse(const char *spec);
+
+/* 1 if --energy was given */
+int energy_enabled(void);
+
+/*
+ * Find and open the sensors and start the sampling thread.  Returns 0 on
+ * success or when energy is disabled; on failure prints the reason and
+ * returns -1.
+ */
+int energy_open(void);
+
+/* Id of the named region, created on first use; -1 if disabled */
+int energy_region(const char *name);
+
+/*
+ * Work of one execution of the region for the efficiency column: amount
+ * is in rate_unit seconds, e.g. bytes / 1e6 with "MB/s", and efficiency
+ * is reported in rate_unit per watt.
+ */
+void energy_work(int id, double amount, const char *rate_unit);
+
+/* Bracket one execution of a region; called outside its timed interval */
+void energy_begin(int id);
+void energy_end(int id);
+
+/*
+ * Print joules, average watts and efficiency of every region, per sensor
+ * too when there are several, and add them to the --format record.
+ */
+void energy_report(FILE *out);
+
+void energy_close(void);
+
+#endif
@@ -0,0 +1,214 @@
+/*
+ * Page-size control for the benchmark arrays; see pages.h.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "pages.h"
+
+#define PAGES_1G_SIZE (1UL << 30)
+#define PAGES_BASE 4096UL
+
+/* MAP_HUGE_1GB is log2(1 GiB) << MAP_HUGE_SHIFT, not in every libc */
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << 26)
+#endif
+
+/* Live mappings and their lengths, for pages_free() */
+#define PAGES_MAX_MAPS 64
+
+static struct {
+    void *addr;
+    size_t len;
+} maps[PAGES_MAX_MAPS];
+
+static const char *mode_names[] = { "default", "4k", "2m", "1g" };
+
+/* The 1 GiB fallback is reported once, not once per array */
+static int warned_1g;
+
+int pages_parse(const char *spec, page_mode *mode)
+{
+    int k;
+
+    for (k = 0; k < 4; k++) {
+        if (strcmp(spec, mode_names[k]) == 0) {
+            *mode = (page_mode) k;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *pages_name(page_mode mode)
+{
+    return mode_names[mode];
+}
+
+static size_t round_up(size_t len, size_t align)
+{
+    return (len + align - 1) / align * align;
+}
+
+static void *remember(void *addr, size_t len)
+{
+    int k;
+
+    for (k = 0; k < PAGES_MAX_MAPS; k++) {
+        if (maps[k].addr == NULL) {
+            maps[k].addr = addr;
+            maps[k].len = len;
+            return addr;
+        }
+    }
+    fprintf(stderr, "More than %d page allocations\n", PAGES_MAX_MAPS);
+    munmap(addr, len);
+    return NULL;
+}
+
+void *pages_alloc(size_t len, page_mode mode)
+{
+    size_t map_len;
+    char *p, *q;
+
+    if (len == 0)
+        len = 1;
+#ifdef MAP_HUGETLB
+    if (mode == PAGES_1G) {
+        map_len = round_up(len, PAGES_1G_SIZE);
+        p = mmap(NULL, map_len, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_1GB, -1, 0);
+        if (p != MAP_FAILED)
+            return remember(p, map_len);
+        if (!warned_1g)
+            fprintf(stderr, "Cannot map %zu GiB of hugetlbfs pages (%s); using 2m instead\n",
+                    map_len / PAGES_1G_SIZE, strerror(errno));
+        warned_1g = 1;
+    }
+#endif
+    if (mode == PAGES_1G)
+        mode = PAGES_2M;
+
+    /* Over-allocate by one alignment unit and trim both ends */
+    map_len = round_up(len, PAGES_ALIGN);
+    p = mmap(NULL, map_len + PAGES_ALIGN, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "Failed to map %zu bytes: %s\n", map_len, strerror(errno));
+        return NULL;
+    }
+    q = (char *) round_up((size_t) p, PAGES_ALIGN);
+    if (q > p)
+        munmap(p, q - p);
+    if (p + PAGES_ALIGN > q)
+        munmap(q + map_len, p + PAGES_ALIGN - q);
+
+#ifdef MADV_HUGEPAGE
+    if (mode == PAGES_2M && madvise(q, map_len, MADV_HUGEPAGE) != 0)
+        fprintf(stderr, "madvise(MADV_HUGEPAGE) failed: %s\n", strerror(errno));
+#endif
+#ifdef MADV_NOHUGEPAGE
+    if (mode == PAGES_4K && madvise(q, map_len, MADV_NOHUGEPAGE) != 0)
+        fprintf(stderr, "madvise(MADV_NOHUGEPAGE) failed: %s\n", strerror(errno));
+#endif
+    return remember(q, map_len);
+}
+
+void pages_free(void *p)
+{
+    int k;
+
+    if (p == NULL)
+        return;
+    for (k = 0; k < PAGES_MAX_MAPS; k++) {
+        if (maps[k].addr == p) {
+            munmap(p, maps[k].len);
+            maps[k].addr = NULL;
+            return;
+        }
+    }
+}
+
+void pages_prefault(void *p, size_t len)
+{
+    long i, n = (long) ((len + PAGES_BASE - 1) / PAGES_BASE);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (i = 0; i < n; i++)
+        ((volatile char *) p)[i * PAGES_BASE] = 0;
+}
+
+/* PMD-sized transparent hugepage in KiB, 2 MiB if sysfs does not say */
+static long thp_kib(void)
+{
+    FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+    long bytes = 0;
+
+    if (f != NULL) {
+        if (fscanf(f, "%ld", &bytes) != 1)
+            bytes = 0;
+        fclose(f);
+    }
+    return bytes > 0 ? bytes / 1024 : 2048;
+}
+
+static void format_kib(long kib, char *buf, size_t len)
+{
+    if (kib >= 1024L * 1024 && kib % (1024L * 1024) == 0)
+        snprintf(buf, len, "%ld GiB", kib / (1024L * 1024));
+    else if (kib >= 1024 && kib % 1024 == 0)
+        snprintf(buf, len, "%ld MiB", kib / 1024);
+    else
+        snprintf(buf, len, "%ld KiB", kib);
+}
+
+void pages_describe(const void *p, char *buf, size_t len)
+{
+    FILE *f = fopen("/proc/self/smaps", "r");
+    unsigned long lo, hi, addr = (unsigned long) p;
+    long page = 0, rss = 0, thp = 0, v;
+    char line[512], size[32], huge[32];
+    int in = 0;
+
+    snprintf(buf, len, "unknown");
+    if (f == NULL)
+        return;
+    /* The mapping's header line, then "Field: value kB" lines */
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (sscanf(line, "%lx-%lx ", &lo, &hi) == 2) {
+            if (in)
+                break;
+            in = addr >= lo && addr < hi;
+        } else if (in) {
+            if (sscanf(line, "KernelPageSize: %ld kB", &v) == 1)
+                page = v;
+            else if (sscanf(line, "Rss: %ld kB", &v) == 1)
+                rss = v;
+            else if (sscanf(line, "AnonHugePages: %ld kB", &v) == 1)
+                thp = v;
+        }
+    }
+    fclose(f);
+    if (!in || page == 0)
+        return;
+    format_kib(page, size, sizeof(size));
+    if (page > sysconf(_SC_PAGESIZE) / 1024) {
+        snprintf(buf, len, "%s (hugetlbfs)", size);
+    } else if (thp > 0 && rss > 0) {
+        format_kib(thp_kib(), huge, sizeof(huge));
+        if (thp >= rss)
+            snprintf(buf, len, "%s THP", huge);
+        else
+            snprintf(buf, len, "%s THP for %.0f%%, %s for the rest", huge,
+                     100.0 * thp / rss, size);
+    } else {
+        snprintf(buf, len, "%s", size);
+    }
+}
@@ -0,0 +1,63 @@
+/*
+ * Page-size control for the benchmark arrays.
+ *
+ * The --pages option takes one of
+ *   default   whatever the system's transparent hugepage policy gives
+ *   4k        base pages only (MADV_NOHUGEPAGE)
+ *   2m        transparent hugepages (MADV_HUGEPAGE): 2 MiB megapages on
+ *             Sv39/Sv48 and x86-64.  --hugepages is the same.
+ *   1g        1 GiB hugetlbfs pages (MAP_HUGETLB), which must be reserved
+ *             first, e.g.
+ *               echo 4 > /sys/kernel/mm/hugepages/hugepages-1048576kB/nr_hugepages
+ *             Falls back to 2m with a warning if there are not enough.
+ *
+ * TLB reach depends on the pages actually obtained, not the ones asked
+ * for: THP can be disabled or fragmented memory can leave part of an
+ * array on base pages.  pages_describe() reads the page size and the THP
+ * share back from /proc/self/smaps after the arrays are first touched.
+ *
+ * Allocations are not touched, so the benchmark's own initialisation picks
+ * the NUMA node of every page; pages_prefault() touches them for those
+ * whose initialisation does not run in parallel before the timed region.
+ */
+
+#ifndef BENCH_PAGES_H
+#define BENCH_PAGES_H
+
+#include <stddef.h>
+
+/* Alignment of every allocation: a 2 MiB hugepage */
+#define PAGES_ALIGN (2UL * 1024 * 1024)
+
+typedef enum {
+    PAGES_DEFAULT,
+    PAGES_4K,
+    PAGES_2M,
+    PAGES_1G
+} page_mode;
+
+/* Returns 0 on success, -1 if spec is not a valid --pages argument */
+int pages_parse(const char *spec, page_mode *mode);
+
+/* "default", "4k", "2m" or "1g" */
+const char *pages_name(page_mode mode);
+
+/*
+ * len bytes aligned to at least PAGES_ALIGN and backed by mode pages
+ * where the system allows.  Returns NULL on failure after printing the
+ * reason to stderr.  Release with pages_free().
+ */
+void *pages_alloc(size_t len, page_mode mode);
+void pages_free(void *p);
+
+/* Fault in every page of [p, p + len) under the loop schedule of the kernels */
+void pages_prefault(void *p, size_t len);
+
+/*
+ * The pages backing the mapping that holds p, e.g. "1 GiB (hugetlbfs)",
+ * "2 MiB THP for 98%, 4 KiB for the rest" or "4 KiB", or "unknown"
+ * without /proc/self/smaps.  Only touched pages count.
+ */
+void pages_describe(const void *p, char *buf, size_t len);
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * Element types shared by the benchmarks; see precision.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "precision.h"
+
+static const char *names[] = { "fp64", "fp32", "fp16", "bf16" };
+static const size_t sizes[] = { 8, 4, 2, 2 };
+static const int mantissa_bits[] = { 53, 24, 11, 8 };
+
+int precision_parse(const char *name, precision *p)
+{
+    int i;
+
+    for (i = 0; i < (int) (sizeof(names) / sizeof(names[0])); i++) {
+        if (strcmp(name, names[i]) == 0)
+            break;
+    }
+    switch (i) {
+    case PREC_FP64:
+    case PREC_FP32:
+    case PREC_BF16:
+        break;
+    case PREC_FP16:
+#ifndef PRECISION_HAVE_FP16
+        fprintf(stderr, "Type fp16 needs a compiler with _Float16 support\n");
+        return -1;
+#endif
+        break;
+    default:
+        fprintf(stderr, "Unknown type: %s\n", name);
+        return -1;
+    }
+    *p = (precision) i;
+    return 0;
+}
+
+const char *precision_name(precision p)
+{
+    return names[p];
+}
+
+size_t precision_size(precision p)
+{
+    return sizes[p];
+}
+
+double precision_epsilon(precision p)
+{
+    return 1.0 / (double) (1ULL << mantissa_bits[p]);
+}
+
+const char *precision_list(void)
+{
+#ifdef PRECISION_HAVE_FP16
+    return "fp64, fp32, fp16 or bf16";
+#else
+    return "fp64, fp32 or bf16";
+#endif
+}
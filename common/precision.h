@@ -0,0 +1,90 @@
+/*
+ * Element types shared by the benchmarks.
+ *
+ * The --type option selects one of
+ *   fp64   IEEE binary64 (double), the default
+ *   fp32   IEEE binary32 (float)
+ *   fp16   IEEE binary16 (_Float16); native arithmetic with Zfh/Zvfh,
+ *          emulated through fp32 by the compiler elsewhere.  Only in
+ *          builds whose compiler provides _Float16.
+ *   bf16   bfloat16, stored in 16 bits and converted to fp32 for each
+ *          operation.  RISC-V has no bf16 arithmetic, only conversions
+ *          (Zfbfmin/Zvfbfmin) and a widening FMA into fp32 (Zvfbfwma).
+ *
+ * Kernels are generated once per type with PRECISION_FOR_EACH(X), which
+ * expands X(tag, id, storage type, arithmetic type, load, store) for every
+ * type built in: load converts a stored element to the arithmetic type and
+ * store rounds a result back.
+ */
+
+#ifndef BENCH_PRECISION_H
+#define BENCH_PRECISION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef enum {
+    PREC_FP64,
+    PREC_FP32,
+    PREC_FP16,
+    PREC_BF16
+} precision;
+
+#ifdef __FLT16_MAX__
+#define PRECISION_HAVE_FP16 1
+#endif
+
+/*
+ * Returns 0 and sets *p, or -1 if name is not a type or fp16 is not
+ * available in this build (printing the reason to stderr in that case).
+ */
+int precision_parse(const char *name, precision *p);
+
+/* "fp64", "fp32", "fp16" or "bf16" */
+const char *precision_name(precision p);
+
+/* Bytes per stored element */
+size_t precision_size(precision p);
+
+/* Unit roundoff of a stored element: 2^-53, 2^-24, 2^-11 or 2^-8 */
+double precision_epsilon(precision p);
+
+/* Comma-separated list of the types built in, for usage messages */
+const char *precision_list(void);
+
+static inline float bf16_to_float(uint16_t h)
+{
+    uint32_t u = (uint32_t) h << 16;
+    float f;
+
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+/* Round to nearest even; NaNs are not preserved */
+static inline uint16_t bf16_from_float(float f)
+{
+    uint32_t u;
+
+    memcpy(&u, &f, sizeof(u));
+    u += 0x7fffu + ((u >> 16) & 1u);
+    return (uint16_t) (u >> 16);
+}
+
+#define PRECISION_IDENTITY(x) (x)
+
+#ifdef PRECISION_HAVE_FP16
+#define PRECISION_FP16_ENTRY(X) \
+    X(fp16, PREC_FP16, _Float16, _Float16, PRECISION_IDENTITY, PRECISION_IDENTITY)
+#else
+#define PRECISION_FP16_ENTRY(X)
+#endif
+
+#define PRECISION_FOR_EACH(X)                                                  \
+    X(fp64, PREC_FP64, double, double, PRECISION_IDENTITY, PRECISION_IDENTITY) \
+    X(fp32, PREC_FP32, float, float, PRECISION_IDENTITY, PRECISION_IDENTITY)   \
+    PRECISION_FP16_ENTRY(X)                                                    \
+    X(bf16, PREC_BF16, uint16_t, float, bf16_to_float, bf16_from_float)
+
+#endif
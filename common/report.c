@@ -0,0 +1,481 @@
+/*
+ * Machine-readable results shared by the benchmarks; see report.h.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+#include "report.h"
+#include "stats.h"
+#include "timer.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Set by the Makefiles to the flags the benchmark was built with */
+#ifndef BENCH_CFLAGS
+#   define BENCH_CFLAGS "unknown"
+#endif
+
+#if defined(__clang__)
+#   define BENCH_COMPILER "clang " __clang_version__
+#elif defined(__GNUC__)
+#   define BENCH_COMPILER "gcc " __VERSION__
+#else
+#   define BENCH_COMPILER "unknown"
+#endif
+
+typedef struct {
+    char *key;
+    char *value;        /* already formatted as a JSON value */
+} param;
+
+typedef struct {
+    report_result r;
+    char *kernel;
+    char *variant;
+    char *unit;
+    double *times;
+    stats_summary st;
+} entry;
+
+static report_format format = REPORT_TEXT;
+static FILE *out;
+static const char *bench_name;
+static param *params;
+static int nparams;
+static entry *entries;
+static int nentries;
+
+/* report_set_origin(); NULL or 0 for this program's own */
+static const char *origin_compiler, *origin_flags, *origin_timer;
+static int origin_threads;
+
+int report_parse_format(const char *name, report_format *fmt)
+{
+    if (strcmp(name, "text") == 0)
+        *fmt = REPORT_TEXT;
+    else if (strcmp(name, "json") == 0)
+        *fmt = REPORT_JSON;
+    else if (strcmp(name, "csv") == 0)
+        *fmt = REPORT_CSV;
+    else
+        return -1;
+    return 0;
+}
+
+int report_open(const char *benchmark, report_format fmt, const char *path)
+{
+    format = fmt;
+    bench_name = benchmark;
+    if (format == REPORT_TEXT)
+        return 0;
+
+    if (path != NULL) {
+        out = fopen(path, "w");
+        if (out == NULL) {
+            perror(path);
+            return -1;
+        }
+        return 0;
+    }
+
+    /* Keep the real stdout for the record and send everything else the
+     * benchmark prints to stderr */
+    fflush(stdout);
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    if (out == NULL || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        perror("report");
+        return -1;
+    }
+    return 0;
+}
+
+/* Quote and escape s as a JSON string; the caller frees the result */
+static char *json_string(const char *s)
+{
+    size_t len = strlen(s);
+    char *buf = malloc(2 * len + 3), *p = buf;
+
+    if (buf == NULL)
+        return NULL;
+    *p++ = '"';
+    for (; *s != '\0'; s++) {
+        if (*s == '"' || *s == '\\') {
+            *p++ = '\\';
+            *p++ = *s;
+        } else if ((unsigned char) *s < 0x20) {
+            *p++ = ' ';
+        } else {
+            *p++ = *s;
+        }
+    }
+    *p++ = '"';
+    *p = '\0';
+    return buf;
+}
+
+static void add_param(const char *key, char *value)
+{
+    param *grown;
+
+    if (format == REPORT_TEXT || value == NULL) {
+        free(value);
+        return;
+    }
+    grown = realloc(params, (nparams + 1) * sizeof(param));
+    if (grown == NULL) {
+        free(value);
+        return;
+    }
+    params = grown;
+    params[nparams].key = strdup(key);
+    params[nparams].value = value;
+    nparams++;
+}
+
+void report_param_str(const char *key, const char *value)
+{
+    if (format != REPORT_TEXT)
+        add_param(key, json_string(value));
+}
+
+void report_param_int(const char *key, long long value)
+{
+    char buf[32];
+
+    snprintf(buf, sizeof(buf), "%lld", value);
+    if (format != REPORT_TEXT)
+        add_param(key, strdup(buf));
+}
+
+void report_param_num(const char *key, double value)
+{
+    char buf[32];
+
+    /* JSON has no inf or nan; write_csv() leaves null fields empty */
+    if (isfinite(value))
+        snprintf(buf, sizeof(buf), "%.9g", value);
+    else
+        snprintf(buf, sizeof(buf), "null");
+    if (format != REPORT_TEXT)
+        add_param(key, strdup(buf));
+}
+
+void report_add(const report_result *r)
+{
+    entry *grown, *e;
+    int i;
+
+    if (format == REPORT_TEXT)
+        return;
+    grown = realloc(entries, (nentries + 1) * sizeof(entry));
+    if (grown == NULL)
+        return;
+    entries = grown;
+    e = &entries[nentries++];
+    e->r = *r;
+    e->kernel = strdup(r->kernel);
+    e->variant = r->variant ? strdup(r->variant) : NULL;
+    e->unit = strdup(r->unit);
+    e->times = malloc((r->ntimes > 0 ? r->ntimes : 1) * sizeof(double));
+    for (i = 0; i < r->ntimes; i++)
+        e->times[i] = r->times[i];
+    stats_summarize(e->times, r->ntimes, &e->st);
+}
+
+static int num_threads(void)
+{
+    if (origin_threads > 0)
+        return origin_threads;
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+static const char *compiler_name(void)
+{
+    return origin_compiler ? origin_compiler : BENCH_COMPILER;
+}
+
+static const char *build_flags(void)
+{
+    return origin_flags ? origin_flags : BENCH_CFLAGS;
+}
+
+static const char *timer_used(void)
+{
+    return origin_timer ? origin_timer : timer_name();
+}
+
+void report_set_origin(const char *compiler, const char *flags, int threads,
+                       const char *timer)
+{
+    origin_compiler = compiler;
+    origin_flags = flags;
+    origin_threads = threads;
+    origin_timer = timer;
+}
+
+/* First value of a /proc/cpuinfo field, or "" */
+static void cpuinfo_field(const char *field, char *buf, size_t len)
+{
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    char line[512];
+    size_t flen = strlen(field);
+
+    buf[0] = '\0';
+    if (f == NULL)
+        return;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char *colon = strchr(line, ':');
+        if (strncmp(line, field, flen) == 0 && colon != NULL
+            && strspn(line + flen, " \t") == (size_t) (colon - line - flen)) {
+            colon++;
+            colon += strspn(colon, " \t");
+            colon[strcspn(colon, "\n")] = '\0';
+            snprintf(buf, len, "%s", colon);
+            break;
+        }
+    }
+    fclose(f);
+}
+
+void report_cpu_name(char *buf, size_t len)
+{
+    cpuinfo_field("model name", buf, len);
+    if (buf[0] == '\0')
+        cpuinfo_field("uarch", buf, len);
+}
+
+static void host_info(char *cpu, size_t cpulen, char *isa, size_t isalen)
+{
+    report_cpu_name(cpu, cpulen);
+    cpuinfo_field("isa", isa, isalen);
+}
+
+static void write_time(char *buf, size_t len)
+{
+    time_t now = time(NULL);
+    struct tm tm;
+
+    gmtime_r(&now, &tm);
+    strftime(buf, len, "%Y-%m-%dT%H:%M:%SZ", &tm);
+}
+
+/* Summary fields of a result, in record order */
+#define NSTATS 11
+
+static const char *stat_names[NSTATS] = {
+    "min_time", "avg_time", "max_time", "median_time", "p5_time", "p95_time",
+    "stddev_time", "ci_low_time", "ci_high_time", "mad_time", "outliers"
+};
+
+static double stat_value(const stats_summary *st, int k)
+{
+    const double v[NSTATS] = {
+        st->min, st->mean, st->max, st->median, st->p5, st->p95,
+        st->stddev, st->ci_lo, st->ci_hi, st->mad, st->outliers
+    };
+
+    return v[k];
+}
+
+/*
+ * A number in fmt, or where it is not finite (the rate of a zero best
+ * time, for instance) null in JSON and an empty field in CSV
+ */
+static void put_num(const char *fmt, double v)
+{
+    if (isfinite(v))
+        fprintf(out, fmt, v);
+    else if (format == REPORT_JSON)
+        fputs("null", out);
+}
+
+static void put_json_str(const char *key, const char *value, int last)
+{
+    char *q = json_string(value);
+    fprintf(out, "    \"%s\": %s%s\n", key, q ? q : "\"\"", last ? "" : ",");
+    free(q);
+}
+
+static void write_json(const struct utsname *u, const char *cpu, const char *isa,
+                       const char *stamp)
+{
+    int i, k;
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"%s\",\n", bench_name);
+    fprintf(out, "  \"timestamp\": \"%s\",\n", stamp);
+    fprintf(out, "  \"host\": {\n");
+    put_json_str("hostname", u->nodename, 0);
+    put_json_str("kernel", u->release, 0);
+    put_json_str("machine", u->machine, 0);
+    put_json_str("cpu", cpu, 0);
+    put_json_str("isa", isa, 0);
+    fprintf(out, "    \"online_cpus\": %ld\n", sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"build\": {\n");
+    put_json_str("compiler", compiler_name(), 0);
+    put_json_str("flags", build_flags(), 1);
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"config\": {\n");
+    fprintf(out, "    \"threads\": %d,\n", num_threads());
+    fprintf(out, "    \"timer\": \"%s\"%s\n", timer_used(), nparams ? "," : "");
+    for (i = 0; i < nparams; i++)
+        fprintf(out, "    \"%s\": %s%s\n", params[i].key, params[i].value,
+                i + 1 < nparams ? "," : "");
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"results\": [\n");
+    for (i = 0; i < nentries; i++) {
+        entry *e = &entries[i];
+        char *kq = json_string(e->kernel);
+
+        fprintf(out, "    {\"kernel\": %s", kq);
+        free(kq);
+        if (e->variant) {
+            char *vq = json_string(e->variant);
+            fprintf(out, ", \"variant\": %s", vq);
+            free(vq);
+        }
+        if (e->r.working_set > 0)
+            fprintf(out, ", \"working_set_bytes\": %.0f", e->r.working_set);
+        if (e->r.bytes > 0)
+            fprintf(out, ", \"bytes\": %.0f", e->r.bytes);
+        if (e->r.actual_bytes > 0)
+            fprintf(out, ", \"actual_bytes\": %.0f", e->r.actual_bytes);
+        if (e->r.flops > 0)
+            fprintf(out, ", \"flops\": %.0f", e->r.flops);
+        fprintf(out, ",\n     \"rate\": ");
+        put_num("%.6g", e->r.rate);
+        fprintf(out, ", \"unit\": \"%s\"", e->unit);
+        for (k = 0; k < NSTATS; k++) {
+            fprintf(out, "%s\"%s\": ", k == 3 ? ",\n     " : ", ", stat_names[k]);
+            put_num("%.9g", stat_value(&e->st, k));
+        }
+        fprintf(out, ",\n     \"times\": [");
+        for (k = 0; k < e->r.ntimes; k++) {
+            fprintf(out, "%s", k ? ", " : "");
+            put_num("%.9g", e->times[k]);
+        }
+        fprintf(out, "]}%s\n", i + 1 < nentries ? "," : "");
+    }
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+}
+
+/* CSV strings are always quoted, with embedded quotes doubled */
+static void put_csv_str(const char *s)
+{
+    fputc('"', out);
+    for (; *s != '\0'; s++) {
+        if (*s == '"')
+            fputc('"', out);
+        fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+/*
+ * One row per result.  The benchmark-specific configuration goes in a
+ * single "config" column as key=value pairs separated by ';', and the
+ * per-iteration times likewise in "times".
+ */
+static void write_csv(const struct utsname *u, const char *cpu, const char *stamp)
+{
+    int i, k;
+
+    fprintf(out, "benchmark,timestamp,host,cpu,compiler,flags,threads,timer,config,"
+                 "kernel,variant,working_set_bytes,bytes,actual_bytes,flops,"
+                 "rate,unit,min_time,avg_time,max_time,median_time,p5_time,p95_time,"
+                 "stddev_time,ci_low_time,ci_high_time,mad_time,outliers,times\n");
+    for (i = 0; i < nentries; i++) {
+        entry *e = &entries[i];
+
+        fprintf(out, "%s,%s,", bench_name, stamp);
+        put_csv_str(u->nodename);
+        fputc(',', out);
+        put_csv_str(cpu);
+        fputc(',', out);
+        put_csv_str(compiler_name());
+        fputc(',', out);
+        put_csv_str(build_flags());
+        fprintf(out, ",%d,%s,\"", num_threads(), timer_used());
+        for (k = 0; k < nparams; k++) {
+            const char *v = params[k].value;
+            size_t len = strlen(v);
+            /* drop the JSON quotes; values never contain ';' or '"' in practice */
+            if (len >= 2 && v[0] == '"')
+                fprintf(out, "%s%s=%.*s", k ? ";" : "", params[k].key, (int) len - 2, v + 1);
+            else if (strcmp(v, "null") == 0)
+                fprintf(out, "%s%s=", k ? ";" : "", params[k].key);
+            else
+                fprintf(out, "%s%s=%s", k ? ";" : "", params[k].key, v);
+        }
+        fprintf(out, "\",");
+        put_csv_str(e->kernel);
+        fputc(',', out);
+        put_csv_str(e->variant ? e->variant : "");
+        fprintf(out, ",%.0f,%.0f,%.0f,%.0f,", e->r.working_set, e->r.bytes,
+                e->r.actual_bytes, e->r.flops);
+        put_num("%.6g", e->r.rate);
+        fprintf(out, ",%s", e->unit);
+        for (k = 0; k < NSTATS; k++) {
+            fputc(',', out);
+            put_num("%.9g", stat_value(&e->st, k));
+        }
+        fprintf(out, ",\"");
+        for (k = 0; k < e->r.ntimes; k++) {
+            fprintf(out, "%s", k ? ";" : "");
+            put_num("%.9g", e->times[k]);
+        }
+        fprintf(out, "\"\n");
+    }
+}
+
+void report_end(void)
+{
+    struct utsname u;
+    char cpu[256], isa[256], stamp[32];
+    int i;
+
+    if (format == REPORT_TEXT || out == NULL)
+        return;
+
+    if (uname(&u) != 0)
+        memset(&u, 0, sizeof(u));
+    host_info(cpu, sizeof(cpu), isa, sizeof(isa));
+    write_time(stamp, sizeof(stamp));
+
+    if (format == REPORT_JSON)
+        write_json(&u, cpu, isa, stamp);
+    else
+        write_csv(&u, cpu, stamp);
+    fclose(out);
+    out = NULL;
+
+    for (i = 0; i < nparams; i++) {
+        free(params[i].key);
+        free(params[i].value);
+    }
+    for (i = 0; i < nentries; i++) {
+        free(entries[i].kernel);
+        free(entries[i].variant);
+        free(entries[i].unit);
+        free(entries[i].times);
+    }
+    free(params);
+    free(entries);
+    params = NULL;
+    entries = NULL;
+    nparams = nentries = 0;
+}
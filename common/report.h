@@ -0,0 +1,70 @@
+/*
+ * Machine-readable results shared by the benchmarks.
+ *
+ * --format text|json|csv selects the output; text (the default) disables
+ * this layer and the benchmarks print only their usual tables.  With json
+ * or csv the record goes to --output FILE, or to stdout if no file is
+ * given, in which case the human-readable text is moved to stderr so that
+ * stdout can be piped straight into a parser.
+ *
+ * A record holds host and build information, the configuration set with
+ * report_param_*() and one entry per timed kernel from report_add(), with
+ * its samples summarized by stats.h.  It is written by report_end().
+ */
+
+#ifndef BENCH_REPORT_H
+#define BENCH_REPORT_H
+
+#include <stddef.h>
+
+typedef enum {
+    REPORT_TEXT,
+    REPORT_JSON,
+    REPORT_CSV
+} report_format;
+
+typedef struct {
+    const char *kernel;         /* e.g. "Triad", "blocked" */
+    const char *variant;        /* kernel implementation, e.g. "rvv-m4"; NULL if none */
+    double working_set;         /* bytes of data the kernel touches; 0 if not meaningful */
+    double bytes;               /* bytes moved per iteration by the traffic model; 0 if none */
+    double actual_bytes;        /* bytes including write-allocate reads; 0 if same as bytes */
+    double flops;               /* floating-point operations per iteration; 0 if none */
+    double rate;                /* rate from the best time, in unit */
+    const char *unit;           /* "MB/s", "GB/s" or "GFLOPS" */
+    const double *times;        /* per-iteration times in seconds */
+    int ntimes;
+} report_result;
+
+/* Returns 0 on success, -1 if name is not text, json or csv */
+int report_parse_format(const char *name, report_format *fmt);
+
+/*
+ * Start a record for the named benchmark.  path may be NULL for stdout.
+ * Returns 0 on success; on failure prints the reason and returns -1.
+ */
+int report_open(const char *benchmark, report_format fmt, const char *path);
+
+/*
+ * For records of runs this process did not make itself, such as the NPB
+ * results ingested by nas-benchmarks/npb_ingest: the compiler, flags,
+ * thread count and timer of the measured program replace those of this
+ * one.  NULL or a thread count below 1 keeps the default.
+ */
+void report_set_origin(const char *compiler, const char *flags, int threads,
+                       const char *timer);
+
+/* CPU model as recorded: "model name" or "uarch" of /proc/cpuinfo, or "" */
+void report_cpu_name(char *buf, size_t len);
+
+void report_param_str(const char *key, const char *value);
+void report_param_int(const char *key, long long value);
+void report_param_num(const char *key, double value);
+
+/* Add one result; the times are copied */
+void report_add(const report_result *r);
+
+/* Write the record and close the output */
+void report_end(void);
+
+#endif
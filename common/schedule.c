@@ -0,0 +1,99 @@
+/*
+ * Loop schedules shared by the OpenMP benchmarks; see schedule.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "schedule.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static const char *kind_names[] = { "static", "dynamic", "guided", "auto" };
+
+int schedule_parse(const char *spec, schedule_config *cfg)
+{
+    const char *comma = strchr(spec, ',');
+    size_t len = comma ? (size_t) (comma - spec) : strlen(spec);
+    int k;
+
+    for (k = 0; k < 4; k++) {
+        if (strlen(kind_names[k]) == len && strncmp(spec, kind_names[k], len) == 0)
+            break;
+    }
+    if (k == 4)
+        return -1;
+    cfg->kind = (schedule_kind) k;
+    cfg->chunk = 0;
+    if (comma) {
+        char *end;
+        long v = strtol(comma + 1, &end, 10);
+
+        if (cfg->kind == SCHED_AUTO || end == comma + 1 || *end != '\0' || v <= 0 ||
+            v > 1 << 30)
+            return -1;
+        cfg->chunk = (int) v;
+    }
+    cfg->set = 1;
+    return 0;
+}
+
+void schedule_apply(const schedule_config *cfg)
+{
+#ifdef _OPENMP
+    static const omp_sched_t kinds[] = {
+        omp_sched_static, omp_sched_dynamic, omp_sched_guided, omp_sched_auto
+    };
+
+    if (cfg->set)
+        omp_set_schedule(kinds[cfg->kind], cfg->chunk);
+    else if (getenv("OMP_SCHEDULE") == NULL)
+        omp_set_schedule(omp_sched_static, 0);
+#else
+    (void) cfg;
+#endif
+}
+
+void schedule_name(char *buf, size_t len)
+{
+#ifdef _OPENMP
+    omp_sched_t kind;
+    int chunk, k;
+
+    omp_get_schedule(&kind, &chunk);
+    /* Strip the monotonic modifier (OpenMP 4.5) before naming the kind */
+    switch ((int) kind & 0xff) {
+    case omp_sched_static:  k = 0; break;
+    case omp_sched_dynamic: k = 1; break;
+    case omp_sched_guided:  k = 2; break;
+    default:                k = 3; break;
+    }
+    /* static reports chunk 0 for equal blocks; auto has no chunk */
+    if (chunk > 0 && k != 3)
+        snprintf(buf, len, "%s,%d", kind_names[k], chunk);
+    else
+        snprintf(buf, len, "%s", kind_names[k]);
+#else
+    snprintf(buf, len, "serial");
+#endif
+}
+
+void schedule_slice(size_t n, size_t *lo, size_t *hi)
+{
+    size_t q, r, t = 0, nt = 1;
+
+#ifdef _OPENMP
+    t = omp_get_thread_num();
+    nt = omp_get_num_threads();
+#endif
+    q = n / nt;
+    r = n % nt;
+    if (t < r) {
+        q++;
+        r = 0;
+    }
+    *lo = q * t + r;
+    *hi = *lo + q;
+}
@@ -0,0 +1,57 @@
+/*
+ * Loop schedules shared by the OpenMP benchmarks.
+ *
+ * The parallel loops use schedule(runtime), and --schedule sets it:
+ *   static[,CHUNK]    equal blocks (the default), or round-robin chunks
+ *   dynamic[,CHUNK]   chunks handed out on demand (default chunk 1)
+ *   guided[,CHUNK]    decreasing chunks, never below CHUNK
+ *   auto              left to the runtime
+ * Without --schedule, OMP_SCHEDULE is honoured if it is set.  Otherwise
+ * the loops are plain static, as they were before schedule(runtime) (the
+ * runtime's own default run-sched-var would be dynamic,1 in libgomp).
+ *
+ * --grainsize N sets the iterations per task of the taskloop variants;
+ * 0 leaves the number of tasks to the runtime.
+ */
+
+#ifndef BENCH_SCHEDULE_H
+#define BENCH_SCHEDULE_H
+
+#include <stddef.h>
+
+typedef enum {
+    SCHED_STATIC,
+    SCHED_DYNAMIC,
+    SCHED_GUIDED,
+    SCHED_AUTO
+} schedule_kind;
+
+typedef struct {
+    int set;                        /* 1 once --schedule was parsed */
+    schedule_kind kind;
+    int chunk;                      /* 0 for the kind's default */
+} schedule_config;
+
+/* Returns 0 on success, -1 if spec is not a valid --schedule argument */
+int schedule_parse(const char *spec, schedule_config *cfg);
+
+/*
+ * Make cfg the run-sched-var of the calling thread, or, if --schedule was
+ * not given, OMP_SCHEDULE or static.  Call before the first parallel
+ * region.  Without OpenMP this does nothing.
+ */
+void schedule_apply(const schedule_config *cfg);
+
+/* The schedule in effect, e.g. "dynamic,16" or "static" */
+void schedule_name(char *buf, size_t len);
+
+/*
+ * Elements [lo, hi) of n for the calling thread of a parallel region: one
+ * contiguous slice per thread, split as plain schedule(static).  Kernels
+ * that first-touch and then stream through their data with it keep each
+ * thread on its own pages.  Outside a parallel region, or without OpenMP,
+ * the slice is all of n.
+ */
+void schedule_slice(size_t n, size_t *lo, size_t *hi);
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Sample statistics shared by the benchmarks; see stats.h.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stats.h"
+
+static int cmp_double(const void *pa, const void *pb)
+{
+    double a = *(const double *) pa, b = *(const double *) pb;
+    return (a > b) - (a < b);
+}
+
+double stats_percentile(const double *sorted, int n, double p)
+{
+    double pos, frac;
+    int i;
+
+    if (n <= 0)
+        return 0.0;
+    pos = p / 100.0 * (n - 1);
+    i = (int) pos;
+    if (i >= n - 1)
+        return sorted[n - 1];
+    frac = pos - i;
+    return sorted[i] + frac * (sorted[i + 1] - sorted[i]);
+}
+
+/* xorshift64*: plenty for resampling and reproducible across runs */
+static uint64_t next_random(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/*
+ * Percentile bootstrap of the median: resample the n values with
+ * replacement STATS_BOOTSTRAP times and take the central STATS_CONFIDENCE
+ * fraction of the resampled medians.
+ */
+static void bootstrap_median(const double *x, int n, double *lo, double *hi)
+{
+    double *sample = malloc(n * sizeof(double));
+    double *medians = malloc(STATS_BOOTSTRAP * sizeof(double));
+    double tail = (1.0 - STATS_CONFIDENCE) / 2.0 * 100.0;
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    int b, i;
+
+    if (sample == NULL || medians == NULL) {
+        *lo = *hi = stats_percentile(x, n, 50.0);
+        free(sample);
+        free(medians);
+        return;
+    }
+    for (b = 0; b < STATS_BOOTSTRAP; b++) {
+        for (i = 0; i < n; i++)
+            sample[i] = x[next_random(&state) % n];
+        qsort(sample, n, sizeof(double), cmp_double);
+        medians[b] = stats_percentile(sample, n, 50.0);
+    }
+    qsort(medians, STATS_BOOTSTRAP, sizeof(double), cmp_double);
+    *lo = stats_percentile(medians, STATS_BOOTSTRAP, tail);
+    *hi = stats_percentile(medians, STATS_BOOTSTRAP, 100.0 - tail);
+    free(sample);
+    free(medians);
+}
+
+void stats_summarize(const double *x, int n, stats_summary *s)
+{
+    double *sorted, sum = 0.0, sq = 0.0;
+    int i;
+
+    memset(s, 0, sizeof(*s));
+    s->n = n;
+    if (n <= 0)
+        return;
+    sorted = malloc(n * sizeof(double));
+    if (sorted == NULL)
+        return;
+    memcpy(sorted, x, n * sizeof(double));
+    qsort(sorted, n, sizeof(double), cmp_double);
+
+    for (i = 0; i < n; i++)
+        sum += sorted[i];
+    s->mean = sum / n;
+    for (i = 0; i < n; i++)
+        sq += (sorted[i] - s->mean) * (sorted[i] - s->mean);
+    s->stddev = n > 1 ? sqrt(sq / (n - 1)) : 0.0;
+
+    s->min = sorted[0];
+    s->max = sorted[n - 1];
+    s->median = stats_percentile(sorted, n, 50.0);
+    s->p5 = stats_percentile(sorted, n, 5.0);
+    s->p95 = stats_percentile(sorted, n, 95.0);
+    if (n > 1) {
+        bootstrap_median(sorted, n, &s->ci_lo, &s->ci_hi);
+    } else {
+        s->ci_lo = s->ci_hi = s->median;
+    }
+
+    /* The deviations reuse the sorted copy once its order is no longer needed */
+    for (i = 0; i < n; i++)
+        sorted[i] = fabs(sorted[i] - s->median);
+    qsort(sorted, n, sizeof(double), cmp_double);
+    s->mad = stats_percentile(sorted, n, 50.0);
+    /* With a zero MAD (most samples equal, e.g. at timer resolution) nothing is flagged */
+    if (s->mad > 0)
+        for (i = 0; i < n; i++)
+            s->outliers += sorted[i] > STATS_OUTLIER_K * 1.4826 * s->mad;
+    free(sorted);
+}
+
+int stats_converged(const stats_summary *s, double rel)
+{
+    return s->n > 1 && (s->ci_hi - s->ci_lo) / 2.0 <= rel * s->median;
+}
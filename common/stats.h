@@ -0,0 +1,49 @@
+/*
+ * Sample statistics shared by the benchmarks.
+ *
+ * The best time hides jitter from OS noise and frequency changes, so the
+ * benchmarks keep every per-iteration sample and summarize them here:
+ * median, 5th/95th percentiles, standard deviation and a bootstrap
+ * confidence interval of the median.  The bootstrap uses a fixed seed, so
+ * the same samples always give the same interval.
+ *
+ * Outliers are counted with the median absolute deviation: a sample is
+ * one if it lies more than STATS_OUTLIER_K scaled MADs from the median
+ * (the modified z-score test of Iglewicz and Hoaglin).  Unlike a stddev
+ * test, the MAD is not inflated by the outliers themselves, so a few
+ * preempted iterations are flagged rather than hidden.  They are only
+ * flagged; every statistic above still includes them.
+ *
+ * stats_converged() supports adaptive repetition: a benchmark keeps
+ * iterating until the interval is within a given fraction of the median.
+ */
+
+#ifndef BENCH_STATS_H
+#define BENCH_STATS_H
+
+/* Bootstrap resamples and confidence level of the median interval */
+#define STATS_BOOTSTRAP 1000
+#define STATS_CONFIDENCE 0.95
+
+/* Outlier threshold in MADs scaled by 1.4826 to the stddev of a normal */
+#define STATS_OUTLIER_K 3.5
+
+typedef struct {
+    int n;
+    double min, max, mean, stddev;
+    double median, p5, p95;
+    double ci_lo, ci_hi;        /* STATS_CONFIDENCE interval of the median */
+    double mad;                 /* median absolute deviation from the median */
+    int outliers;               /* samples beyond STATS_OUTLIER_K scaled MADs */
+} stats_summary;
+
+/* Summarize n samples (n >= 1); x is not modified */
+void stats_summarize(const double *x, int n, stats_summary *s);
+
+/* Percentile p (0-100) of n sorted samples, interpolating linearly */
+double stats_percentile(const double *sorted, int n, double p);
+
+/* 1 if the half-width of the interval is at most rel times the median */
+int stats_converged(const stats_summary *s, double rel);
+
+#endif
@@ -0,0 +1,212 @@
+/*
+ * Wall-clock timers shared by the benchmarks; see timer.h.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/time.h>
+#include "timer.h"
+
+typedef enum {
+    TIMER_MONOTONIC_RAW,
+    TIMER_MONOTONIC,
+    TIMER_GETTIMEOFDAY,
+    TIMER_RDTIME,
+    TIMER_RDCYCLE
+} timer_kind;
+
+static const char *names[] = {
+    "monotonic-raw", "monotonic", "gettimeofday", "rdtime", "rdcycle"
+};
+
+#ifdef CLOCK_MONOTONIC_RAW
+static timer_kind active = TIMER_MONOTONIC_RAW;
+#else
+static timer_kind active = TIMER_MONOTONIC;
+#endif
+
+/* Tick rate of the CSR timers (0 for the clock-based ones) */
+static double tick_hz;
+
+#if defined(__riscv) && __riscv_xlen == 64
+#define HAVE_RISCV_CSR 1
+
+/* Set by calibrate(); ticks are counted from tick_base so the conversion
+ * to double keeps full precision.  The difference is signed: another
+ * hart's counter may be behind tick_base. */
+static double tick_seconds;
+static uint64_t tick_base;
+
+static inline uint64_t read_time_csr(void)
+{
+    uint64_t t;
+    __asm__ volatile ("rdtime %0" : "=r" (t));
+    return t;
+}
+
+static inline uint64_t read_cycle_csr(void)
+{
+    uint64_t c;
+    __asm__ volatile ("rdcycle %0" : "=r" (c));
+    return c;
+}
+#endif
+
+static double clock_seconds(clockid_t id)
+{
+    struct timespec ts;
+
+    clock_gettime(id, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1.e-9;
+}
+
+#ifdef HAVE_RISCV_CSR
+static double reference_seconds(void)
+{
+#ifdef CLOCK_MONOTONIC_RAW
+    return clock_seconds(CLOCK_MONOTONIC_RAW);
+#else
+    return clock_seconds(CLOCK_MONOTONIC);
+#endif
+}
+
+static sigjmp_buf probe_env;
+
+static void probe_sigill(int sig)
+{
+    (void) sig;
+    siglongjmp(probe_env, 1);
+}
+
+/* 1 if read() works in user mode; the kernel raises SIGILL if not */
+static int csr_readable(uint64_t (*read)(void))
+{
+    struct sigaction sa, old;
+    volatile int ok = 0;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = probe_sigill;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGILL, &sa, &old);
+    if (sigsetjmp(probe_env, 1) == 0) {
+        (void) read();
+        ok = 1;
+    }
+    sigaction(SIGILL, &old, NULL);
+    return ok;
+}
+
+/* Count ticks of read() over ~50 ms of the reference clock */
+static void calibrate(uint64_t (*read)(void))
+{
+    double t0, t1;
+    uint64_t c0, c1;
+
+    t0 = reference_seconds();
+    c0 = read();
+    do {
+        t1 = reference_seconds();
+    } while (t1 - t0 < 0.05);
+    c1 = read();
+
+    tick_hz = (double) (c1 - c0) / (t1 - t0);
+    tick_seconds = 1.0 / tick_hz;
+    tick_base = c0;
+}
+#endif
+
+int timer_select(const char *name)
+{
+    int i;
+
+    for (i = 0; i < (int) (sizeof(names) / sizeof(names[0])); i++) {
+        if (strcmp(name, names[i]) == 0)
+            break;
+    }
+    switch (i) {
+    case TIMER_MONOTONIC_RAW:
+#ifndef CLOCK_MONOTONIC_RAW
+        fprintf(stderr, "CLOCK_MONOTONIC_RAW is not available on this system\n");
+        return -1;
+#endif
+        /* fall through */
+    case TIMER_MONOTONIC:
+    case TIMER_GETTIMEOFDAY:
+        tick_hz = 0.0;
+        break;
+#ifdef HAVE_RISCV_CSR
+    case TIMER_RDTIME:
+    case TIMER_RDCYCLE:
+        if (!csr_readable(i == TIMER_RDTIME ? read_time_csr : read_cycle_csr)) {
+            fprintf(stderr, "Timer %s is not readable in user mode%s\n", names[i],
+                    i == TIMER_RDCYCLE ? " (Linux 6.6+ needs sysctl kernel.perf_user_access=2)" : "");
+            return -1;
+        }
+        calibrate(i == TIMER_RDTIME ? read_time_csr : read_cycle_csr);
+        break;
+#else
+    case TIMER_RDTIME:
+    case TIMER_RDCYCLE:
+        fprintf(stderr, "Timer %s needs a 64-bit RISC-V target\n", names[i]);
+        return -1;
+#endif
+    default:
+        fprintf(stderr, "Unknown timer: %s\n", name);
+        return -1;
+    }
+    active = (timer_kind) i;
+    return 0;
+}
+
+const char *timer_name(void)
+{
+    return names[active];
+}
+
+double timer_seconds(void)
+{
+    struct timeval tp;
+
+    switch (active) {
+#ifdef CLOCK_MONOTONIC_RAW
+    case TIMER_MONOTONIC_RAW:
+        return clock_seconds(CLOCK_MONOTONIC_RAW);
+#endif
+    case TIMER_GETTIMEOFDAY:
+        gettimeofday(&tp, NULL);
+        return (double) tp.tv_sec + (double) tp.tv_usec * 1.e-6;
+#ifdef HAVE_RISCV_CSR
+    case TIMER_RDTIME:
+        return (double) ((int64_t) read_time_csr() - (int64_t) tick_base) * tick_seconds;
+    case TIMER_RDCYCLE:
+        return (double) ((int64_t) read_cycle_csr() - (int64_t) tick_base) * tick_seconds;
+#endif
+    default:
+        return clock_seconds(CLOCK_MONOTONIC);
+    }
+}
+
+double timer_resolution(void)
+{
+    double t1, t2, best = 1.0;
+    int i;
+
+    for (i = 0; i < 20; i++) {
+        t1 = timer_seconds();
+        while ((t2 = timer_seconds()) == t1)
+            ;
+        if (t2 - t1 < best)
+            best = t2 - t1;
+    }
+    return best;
+}
+
+double timer_frequency(void)
+{
+    return tick_hz;
+}
@@ -0,0 +1,40 @@
+/*
+ * Wall-clock timers shared by the benchmarks.
+ *
+ * The --timer option selects one of
+ *   monotonic-raw  clock_gettime(CLOCK_MONOTONIC_RAW), not slewed by NTP
+ *                  (the default)
+ *   monotonic      clock_gettime(CLOCK_MONOTONIC)
+ *   gettimeofday   the original STREAM timer, microsecond resolution
+ *   rdtime         RISC-V time CSR (constant-rate platform timer)
+ *   rdcycle        RISC-V cycle CSR (core clock; follows DVFS, and Linux
+ *                  6.6+ only allows user reads when perf_user_access=2)
+ *
+ * The CSR timers are converted to seconds with a tick rate calibrated
+ * against CLOCK_MONOTONIC_RAW when they are selected, after one trial read
+ * (selection fails instead of the process dying of SIGILL when user reads
+ * are not allowed).  All timed regions start and stop on the same thread,
+ * but an unpinned thread can migrate in between.  The time CSR is one
+ * platform clock on every hart; the cycle counters are per hart and not
+ * synchronized, so rdcycle needs --bind to keep each thread on one hart.
+ */
+
+#ifndef BENCH_TIMER_H
+#define BENCH_TIMER_H
+
+/* Returns 0 on success, -1 if name is unknown or unavailable here */
+int timer_select(const char *name);
+
+/* Name of the active timer */
+const char *timer_name(void);
+
+/* Current time in seconds from the active timer */
+double timer_seconds(void);
+
+/* Smallest observed non-zero step of the active timer, in seconds */
+double timer_resolution(void);
+
+/* Tick rate of the active timer in Hz (0 for the clock-based timers) */
+double timer_frequency(void);
+
+#endif
@@ -0,0 +1,226 @@
+/*
+ * Autotuning and the per-host tuning profile; see tune.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "tune.h"
+#include "report.h"
+
+#ifdef __riscv_vector
+#include <riscv_vector.h>
+#endif
+
+#define TUNE_LINE 1024
+
+static const char *strategy_names[] = { "grid", "halving" };
+
+/* --profile; NULL for the default, "" for none */
+static const char *profile_arg;
+static char profile_path[TUNE_LINE];
+static char host_key[320];
+
+int tune_parse_strategy(const char *name, tune_strategy *s)
+{
+    int k;
+
+    for (k = 0; k < 2; k++) {
+        if (strcmp(name, strategy_names[k]) == 0) {
+            *s = (tune_strategy) k;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *tune_strategy_name(tune_strategy s)
+{
+    return strategy_names[s];
+}
+
+void tune_set_profile(const char *path)
+{
+    profile_arg = strcmp(path, "none") == 0 ? "" : path;
+}
+
+const char *tune_profile(void)
+{
+    const char *env = getenv("BENCH_TUNE_PROFILE"), *home = getenv("HOME");
+
+    if (profile_arg != NULL)
+        return profile_arg[0] ? profile_arg : NULL;
+    if (env != NULL && env[0] != '\0')
+        return env;
+    if (home == NULL)
+        return NULL;
+    snprintf(profile_path, sizeof(profile_path), "%s/.config/riscv-hpc-bench/tune.profile",
+             home);
+    return profile_path;
+}
+
+const char *tune_host(void)
+{
+    char cpu[256], *p;
+    int vlen = 0;
+
+    if (host_key[0] != '\0')
+        return host_key;
+    report_cpu_name(cpu, sizeof(cpu));
+#ifdef __riscv_vector
+    vlen = (int) __riscv_vsetvlmax_e8m1() * 8;
+#endif
+    /* The key is one tab-separated field */
+    snprintf(host_key, sizeof(host_key), "%s|vlen=%d", cpu[0] ? cpu : "unknown", vlen);
+    for (p = host_key; *p; p++)
+        if (*p == '\t')
+            *p = ' ';
+    return host_key;
+}
+
+/* Split "HOST\tPARAM\tVALUE\n" in place; returns -1 for other lines */
+static int split_entry(char *line, char **host, char **param, char **value)
+{
+    char *t1 = strchr(line, '\t'), *t2 = t1 ? strchr(t1 + 1, '\t') : NULL;
+
+    if (line[0] == '#' || t2 == NULL)
+        return -1;
+    *t1 = *t2 = '\0';
+    t2[1 + strcspn(t2 + 1, "\n")] = '\0';
+    *host = line;
+    *param = t1 + 1;
+    *value = t2 + 1;
+    return 0;
+}
+
+int tune_get(const char *param, char *value, size_t len)
+{
+    const char *path = tune_profile();
+    char line[TUNE_LINE], *h, *p, *v;
+    int found = -1;
+    FILE *f;
+
+    if (path == NULL || (f = fopen(path, "r")) == NULL)
+        return -1;
+    /* The last entry wins, as tune_put() keeps only one */
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (split_entry(line, &h, &p, &v) == 0 && strcmp(h, tune_host()) == 0 &&
+            strcmp(p, param) == 0) {
+            snprintf(value, len, "%s", v);
+            found = 0;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+/* mkdir -p of the directory holding path */
+static void make_parent(const char *path)
+{
+    char dir[TUNE_LINE];
+    char *slash, *p;
+
+    snprintf(dir, sizeof(dir), "%s", path);
+    slash = strrchr(dir, '/');
+    if (slash == NULL || slash == dir)
+        return;
+    *slash = '\0';
+    for (p = dir + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(dir, 0755);
+            *p = '/';
+        }
+    }
+    mkdir(dir, 0755);
+}
+
+int tune_put(const char *param, const char *value)
+{
+    const char *path = tune_profile();
+    char tmp[TUNE_LINE + 8], line[TUNE_LINE], copy[TUNE_LINE], *h, *p, *v;
+    FILE *in, *out;
+
+    if (path == NULL)
+        return 0;
+    make_parent(path);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    out = fopen(tmp, "w");
+    if (out == NULL) {
+        fprintf(stderr, "Cannot write tuning profile %s: %s\n", tmp, strerror(errno));
+        return -1;
+    }
+    in = fopen(path, "r");
+    if (in == NULL)
+        fprintf(out, "# Tuning profile written by --autotune: host, parameter, value\n");
+    while (in != NULL && fgets(line, sizeof(line), in) != NULL) {
+        strcpy(copy, line);
+        if (split_entry(copy, &h, &p, &v) == 0 && strcmp(h, tune_host()) == 0 &&
+            strcmp(p, param) == 0)
+            continue;
+        fputs(line, out);
+    }
+    if (in != NULL)
+        fclose(in);
+    fprintf(out, "%s\t%s\t%s\n", tune_host(), param, value);
+    if (fclose(out) != 0 || rename(tmp, path) != 0) {
+        fprintf(stderr, "Cannot write tuning profile %s: %s\n", path, strerror(errno));
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+static void measure_once(int i, tune_measure measure, void *ctx, double *best, int *runs)
+{
+    double t = measure(i, ctx);
+
+    if (runs[i] == 0 || t < best[i])
+        best[i] = t;
+    runs[i]++;
+}
+
+int tune_search(tune_strategy s, int ncand, tune_measure measure, void *ctx,
+                double *best, int *runs)
+{
+    int *alive, nalive = ncand, i, j, r, winner;
+
+    if (ncand < 1)
+        return -1;
+    alive = malloc(ncand * sizeof(*alive));
+    if (alive == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < ncand; i++) {
+        alive[i] = i;
+        runs[i] = 0;
+    }
+    if (s == TUNE_HALVING) {
+        for (i = 0; i < ncand; i++)
+            measure_once(i, measure, ctx, best, runs);
+        while (nalive > 2) {
+            /* Keep the faster half and time it once more */
+            for (i = 1; i < nalive; i++)
+                for (j = i; j > 0 && best[alive[j - 1]] > best[alive[j]]; j--) {
+                    int t = alive[j];
+                    alive[j] = alive[j - 1];
+                    alive[j - 1] = t;
+                }
+            nalive = (nalive + 1) / 2;
+            for (i = 0; i < nalive; i++)
+                measure_once(alive[i], measure, ctx, best, runs);
+        }
+    }
+    for (i = 0; i < nalive; i++)
+        for (r = runs[alive[i]]; r < TUNE_RUNS; r++)
+            measure_once(alive[i], measure, ctx, best, runs);
+    winner = alive[0];
+    for (i = 1; i < nalive; i++)
+        if (best[alive[i]] < best[winner])
+            winner = alive[i];
+    free(alive);
+    return winner;
+}
@@ -0,0 +1,72 @@
+/*
+ * Autotuning and the per-host tuning profile shared by the benchmarks.
+ *
+ * --autotune[=grid|halving] searches a benchmark's tunable parameters
+ * (the matmul block sizes, the STREAM tile and RVV LMUL) and stores the
+ * winner in a small text profile.  Later runs load it at startup, so a
+ * board is tuned once rather than by hand on every run; parameters given
+ * on the command line still take precedence, and --profile none ignores
+ * the profile.
+ *
+ * Entries are keyed by host: the CPU model of the results record and the
+ * vector length the build runs with (0 without the V extension), so one
+ * profile serves several boards and both scalar and RVV builds.  The
+ * benchmarks name their parameters per element type and size class, as
+ * the searches only try blocks up to the problem size.  The
+ * profile is --profile FILE, $BENCH_TUNE_PROFILE, or
+ * ~/.config/riscv-hpc-bench/tune.profile, with one entry per line:
+ *   CPU|vlen=BITS <tab> PARAMETER <tab> VALUE
+ *
+ * The searches:
+ *   grid      every candidate TUNE_RUNS times, best time wins
+ *   halving   successive halving: every candidate once, then the faster
+ *             half once more, and so on until two remain, which then get
+ *             TUNE_RUNS runs; about two runs per candidate in all
+ */
+
+#ifndef BENCH_TUNE_H
+#define BENCH_TUNE_H
+
+#include <stddef.h>
+
+#define TUNE_RUNS 3
+
+typedef enum {
+    TUNE_GRID,
+    TUNE_HALVING
+} tune_strategy;
+
+/* Returns 0 on success, -1 if name is not grid or halving */
+int tune_parse_strategy(const char *name, tune_strategy *s);
+const char *tune_strategy_name(tune_strategy s);
+
+/* --profile: a file, or "none" to neither load nor store entries */
+void tune_set_profile(const char *path);
+
+/* The profile in use, or NULL with --profile none */
+const char *tune_profile(void);
+
+/* This host's key, e.g. "SiFive X280|vlen=512" */
+const char *tune_host(void);
+
+/* Copy this host's value of param to value; returns -1 if there is none */
+int tune_get(const char *param, char *value, size_t len);
+
+/*
+ * Set this host's value of param, replacing any earlier one.  Returns 0
+ * on success; on failure prints the reason and returns -1.
+ */
+int tune_put(const char *param, const char *value);
+
+/* One timed run of a candidate, in seconds */
+typedef double (*tune_measure)(int candidate, void *ctx);
+
+/*
+ * Search candidates 0 .. ncand-1 and return the fastest, or -1 if ncand
+ * is 0.  best[i] is the best time of candidate i and runs[i] its number of
+ * runs (candidates eliminated early have fewer).
+ */
+int tune_search(tune_strategy s, int ncand, tune_measure measure, void *ctx,
+                double *best, int *runs);
+
+#endif
@@ -0,0 +1,354 @@
+/*
+ * NAS Parallel Benchmarks results ingester.
+ *
+ * Reads the standard output of NPB-OMP runs (one run per file, as saved
+ * by run_npb.sh) and writes the same json/csv record as the STREAM and
+ * matmul benchmarks (common/report.h).  Each benchmark and class becomes
+ * one entry: the repeated runs are its samples, the wall times from
+ * "Time in seconds" are its times and the best "Mop/s total" is its rate.
+ *
+ * A record describes a single build and thread count, so the compiler,
+ * flags and threads are taken from the NPB output (or --flags/--threads)
+ * rather than from this program.  The verification status of every
+ * benchmark is kept in the configuration; the exit status is 2 if any run
+ * was not SUCCESSFUL.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <getopt.h>
+#include "report.h"
+
+#define NPB_LINE 512
+#define NPB_FIELD 128
+
+/* One NPB run, from the summary block printed by print_results() */
+typedef struct {
+    char name[NPB_FIELD];       /* "EP", "CG" ... */
+    char cls[NPB_FIELD];
+    char size[NPB_FIELD];
+    char iterations[NPB_FIELD];
+    char verification[NPB_FIELD];
+    char version[NPB_FIELD];
+    char compiler[NPB_FIELD];   /* CC or FC */
+    char compiler_ver[NPB_FIELD];
+    char flags[NPB_LINE];       /* CFLAGS or FFLAGS */
+    double time;
+    double mops;
+    int threads;
+} npb_run;
+
+/* The runs of one benchmark and class */
+typedef struct {
+    npb_run first;
+    double *times;
+    int ntimes;
+    double best_mops;
+    int failed;                 /* runs not SUCCESSFUL */
+} npb_group;
+
+static const char *flag_set = NULL;
+static const char *flags_arg = NULL;
+static const char *binding = NULL;
+static int threads_arg = 0;
+static report_format out_format = REPORT_CSV;
+static const char *out_path = NULL;
+
+static npb_group *groups;
+static int ngroups;
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [options] LOG...\n", prog);
+    fprintf(stderr, "  -s, --flag-set NAME    name of the flag set the logs were built with\n");
+    fprintf(stderr, "      --flags FLAGS      build flags to record (default: CFLAGS/FFLAGS\n");
+    fprintf(stderr, "                         from the NPB output)\n");
+    fprintf(stderr, "  -b, --binding SPEC     thread binding the runs used, e.g. close\n");
+    fprintf(stderr, "  -t, --threads N        thread count to record (default: Total threads\n");
+    fprintf(stderr, "                         from the NPB output)\n");
+    fprintf(stderr, "  -f, --format FMT       json or csv (default csv)\n");
+    fprintf(stderr, "      --output FILE      write the record to FILE instead of stdout\n");
+    fprintf(stderr, "  -h, --help             show this message\n");
+}
+
+static void parse_args(int argc, char *argv[])
+{
+    static struct option long_options[] = {
+        {"flag-set", required_argument, 0, 's'},
+        {"flags", required_argument, 0, 'F'},
+        {"binding", required_argument, 0, 'b'},
+        {"threads", required_argument, 0, 't'},
+        {"format", required_argument, 0, 'f'},
+        {"output", required_argument, 0, 'o'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+    char *end;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "s:b:t:f:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 's':
+            flag_set = optarg;
+            break;
+        case 'F':
+            flags_arg = optarg;
+            break;
+        case 'b':
+            binding = optarg;
+            break;
+        case 't':
+            threads_arg = (int) strtol(optarg, &end, 10);
+            if (end == optarg || *end != '\0' || threads_arg < 1) {
+                fprintf(stderr, "Invalid thread count: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'f':
+            if (report_parse_format(optarg, &out_format) != 0 || out_format == REPORT_TEXT) {
+                fprintf(stderr, "Invalid format: %s (expected json or csv)\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+    if (optind == argc) {
+        usage(argv[0]);
+        exit(1);
+    }
+}
+
+/* Copy s to dst without leading and trailing white space */
+static void copy_trimmed(char *dst, size_t len, const char *s)
+{
+    size_t n;
+
+    while (isspace((unsigned char) *s))
+        s++;
+    n = strlen(s);
+    while (n > 0 && isspace((unsigned char) s[n - 1]))
+        n--;
+    if (n >= len)
+        n = len - 1;
+    memcpy(dst, s, n);
+    dst[n] = '\0';
+}
+
+/*
+ * Parse one log.  The summary lines have the form " Key = value"; the
+ * benchmark name comes from " XX Benchmark Completed.".  Returns 0 if the
+ * log holds a complete summary.
+ */
+static int parse_log(const char *path, npb_run *run)
+{
+    char line[NPB_LINE], key[NPB_FIELD], value[NPB_LINE];
+    int have_time = 0, have_mops = 0;
+    FILE *f = fopen(path, "r");
+
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    memset(run, 0, sizeof(*run));
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char *eq = strchr(line, '=');
+        char *done = strstr(line, " Benchmark Completed");
+
+        if (done != NULL) {
+            *done = '\0';
+            copy_trimmed(run->name, sizeof(run->name), line);
+            continue;
+        }
+        if (eq == NULL || run->name[0] == '\0')
+            continue;
+        *eq = '\0';
+        copy_trimmed(key, sizeof(key), line);
+        copy_trimmed(value, sizeof(value), eq + 1);
+        if (strcmp(key, "Class") == 0)
+            copy_trimmed(run->cls, sizeof(run->cls), value);
+        else if (strcmp(key, "Size") == 0)
+            copy_trimmed(run->size, sizeof(run->size), value);
+        else if (strcmp(key, "Iterations") == 0)
+            copy_trimmed(run->iterations, sizeof(run->iterations), value);
+        else if (strcmp(key, "Verification") == 0)
+            copy_trimmed(run->verification, sizeof(run->verification), value);
+        else if (strcmp(key, "Version") == 0)
+            copy_trimmed(run->version, sizeof(run->version), value);
+        else if (strcmp(key, "Compiler ver") == 0)
+            copy_trimmed(run->compiler_ver, sizeof(run->compiler_ver), value);
+        else if (strcmp(key, "CC") == 0 || strcmp(key, "FC") == 0)
+            copy_trimmed(run->compiler, sizeof(run->compiler), value);
+        else if (strcmp(key, "CFLAGS") == 0 || strcmp(key, "FFLAGS") == 0)
+            copy_trimmed(run->flags, sizeof(run->flags), value);
+        else if (strcmp(key, "Time in seconds") == 0)
+            have_time = sscanf(value, "%lf", &run->time) == 1;
+        else if (strcmp(key, "Mop/s total") == 0)
+            have_mops = sscanf(value, "%lf", &run->mops) == 1;
+        else if (strcmp(key, "Total threads") == 0)
+            run->threads = atoi(value);
+    }
+    fclose(f);
+    if (run->name[0] == '\0' || run->cls[0] == '\0' || !have_time || !have_mops) {
+        fprintf(stderr, "%s: no NPB results summary (run failed or incomplete?)\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+static void add_run(const npb_run *run)
+{
+    npb_group *g = NULL;
+    int i;
+
+    for (i = 0; i < ngroups; i++) {
+        if (strcmp(groups[i].first.name, run->name) == 0 &&
+            strcmp(groups[i].first.cls, run->cls) == 0) {
+            g = &groups[i];
+            break;
+        }
+    }
+    if (g == NULL) {
+        groups = realloc(groups, (ngroups + 1) * sizeof(*groups));
+        if (groups == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+        g = &groups[ngroups++];
+        memset(g, 0, sizeof(*g));
+        g->first = *run;
+    }
+    g->times = realloc(g->times, (g->ntimes + 1) * sizeof(*g->times));
+    if (g->times == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    g->times[g->ntimes++] = run->time;
+    if (run->mops > g->best_mops)
+        g->best_mops = run->mops;
+    if (strcmp(run->verification, "SUCCESSFUL") != 0)
+        g->failed++;
+}
+
+/* "SUCCESSFUL" to "successful", "NOT PERFORMED" to "not performed" */
+static void lower(char *dst, size_t len, const char *s)
+{
+    size_t i;
+
+    for (i = 0; i + 1 < len && s[i] != '\0'; i++)
+        dst[i] = (char) tolower((unsigned char) s[i]);
+    dst[i] = '\0';
+}
+
+int main(int argc, char *argv[])
+{
+    char compiler[2 * NPB_FIELD + 1], key[2 * NPB_FIELD + 32], status[NPB_FIELD];
+    npb_run run, origin;
+    int i, threads, failed = 0;
+
+    parse_args(argc, argv);
+    for (i = optind; i < argc; i++) {
+        if (parse_log(argv[i], &run) != 0)
+            exit(1);
+        if (i == optind) {
+            origin = run;
+        } else if (threads_arg == 0 && run.threads != origin.threads) {
+            fprintf(stderr, "%s: %d threads, %s: %d; a record holds one thread count\n",
+                    argv[optind], origin.threads, argv[i], run.threads);
+            exit(1);
+        } else if (flags_arg == NULL && strcmp(run.flags, origin.flags) != 0) {
+            fprintf(stderr, "%s and %s were built with different flags\n",
+                    argv[optind], argv[i]);
+            exit(1);
+        }
+        add_run(&run);
+    }
+
+    if (report_open("npb", out_format, out_path) != 0)
+        exit(1);
+    threads = threads_arg ? threads_arg : origin.threads;
+    if (origin.compiler_ver[0] != '\0')
+        snprintf(compiler, sizeof(compiler), "%s %s", origin.compiler, origin.compiler_ver);
+    else
+        snprintf(compiler, sizeof(compiler), "%s", origin.compiler);
+    /* NPB times itself with wtime.c (gettimeofday or the OpenMP clock) */
+    report_set_origin(compiler[0] ? compiler : NULL, flags_arg ? flags_arg : origin.flags,
+                      threads, "npb-wtime");
+
+    if (origin.version[0] != '\0')
+        report_param_str("npb_version", origin.version);
+    if (flag_set != NULL)
+        report_param_str("flag_set", flag_set);
+    if (binding != NULL)
+        report_param_str("binding", binding);
+
+    printf("-------------------------------------------------------------\n");
+    printf("NAS Parallel Benchmarks, %d thread%s%s%s\n", threads, threads > 1 ? "s" : "",
+           flag_set ? ", flag set " : "", flag_set ? flag_set : "");
+    printf("-------------------------------------------------------------\n");
+    printf("Benchmark  Class  Runs   Best time     Mop/s  Verification\n");
+    for (i = 0; i < ngroups; i++) {
+        npb_group *g = &groups[i];
+        report_result r;
+        char name[NPB_FIELD];
+        double best = g->times[0];
+        int k;
+
+        for (k = 1; k < g->ntimes; k++)
+            if (g->times[k] < best)
+                best = g->times[k];
+        lower(name, sizeof(name), g->first.name);
+        if (g->failed)
+            snprintf(status, sizeof(status), "%d of %d runs not successful",
+                     g->failed, g->ntimes);
+        else
+            snprintf(status, sizeof(status), "successful");
+        printf("%-9s  %-5s  %4d  %10.2f  %8.2f  %s\n", g->first.name, g->first.cls,
+               g->ntimes, best, g->best_mops, status);
+
+        /* successful, unsuccessful, not performed, or mixed across the runs */
+        if (g->failed == 0)
+            snprintf(status, sizeof(status), "successful");
+        else if (g->failed < g->ntimes)
+            snprintf(status, sizeof(status), "mixed");
+        else if (g->first.verification[0] != '\0')
+            lower(status, sizeof(status), g->first.verification);
+        else
+            snprintf(status, sizeof(status), "missing");
+        snprintf(key, sizeof(key), "%s_%s_verification", name, g->first.cls);
+        report_param_str(key, status);
+        snprintf(key, sizeof(key), "%s_%s_size", name, g->first.cls);
+        report_param_str(key, g->first.size);
+        snprintf(key, sizeof(key), "%s_%s_iterations", name, g->first.cls);
+        report_param_str(key, g->first.iterations);
+
+        memset(&r, 0, sizeof(r));
+        r.kernel = name;
+        r.variant = g->first.cls;
+        r.rate = g->best_mops;
+        r.unit = "Mop/s";
+        r.times = g->times;
+        r.ntimes = g->ntimes;
+        report_add(&r);
+        failed += g->failed;
+    }
+    printf("-------------------------------------------------------------\n");
+    if (failed)
+        printf("WARNING: %d run%s did not verify\n", failed, failed > 1 ? "s" : "");
+
+    report_end();
+    for (i = 0; i < ngroups; i++)
+        free(groups[i].times);
+    free(groups);
+    return failed ? 2 : 0;
+}
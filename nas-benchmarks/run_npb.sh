@@ -0,0 +1,236 @@
+#!/bin/bash
+
+# NAS Parallel Benchmarks runner
+#
+# Builds the selected NPB-OMP kernels and classes once per flag set,
+# runs each build across a list of thread counts with OpenMP affinity
+# control, and turns the output into the same json/csv records as the
+# STREAM and matmul benchmarks (see npb_ingest.c and common/report.h).
+#
+# The flag sets are the recommended combinations of
+# tools/compiler_flags.md; more can be added with --define NAME=FLAGS.
+# Each build gets its own config/make.def (the original is restored
+# afterwards) with the flags in both FFLAGS and CFLAGS.
+#
+# Writes into the output directory:
+#   bin/SET/         the binaries of every flag set
+#   logs/SET/tN/     the output of every run, one file per run
+#   records/         one record per flag set and thread count
+#   npb.csv          all records in one CSV (with --format csv)
+#   build-SET.log    compiler output
+#
+# Example:
+#   nas-benchmarks/run_npb.sh --npb ~/NPB3.4.2/NPB3.4-OMP -k ep,cg -c A,B \
+#       -t 1,2,4 -f conservative,aggressive --bind close
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+NPB=
+KERNELS=ep,cg,ft,mg,is
+CLASSES=A
+THREADS=
+FLAG_SETS=conservative,aggressive
+BIND=close
+REPS=3
+FORMAT=csv
+OUT=npb-results
+BUILD=1
+
+# Recommended Flag Combinations in tools/compiler_flags.md (-fopenmp is
+# always added)
+declare -A FLAGS=(
+    [conservative]="-O2 -march=rv64gc"
+    [aggressive]="-O3 -march=native -mtune=native -funroll-loops"
+    [rvv]="-O3 -march=rv64gcv -mtune=native -funroll-loops"
+    [lto]="-O3 -march=native -mtune=native -flto"
+    [fast]="-Ofast -march=native -mtune=native -funroll-loops -flto"
+)
+
+usage() {
+    echo "Usage: $0 --npb DIR [options]"
+    echo "  -p, --npb DIR          NPB-OMP directory (the one holding config/ and bin/)"
+    echo "  -k, --kernels LIST     benchmarks from ep,cg,ft,mg,is (default $KERNELS)"
+    echo "  -c, --classes LIST     problem classes, e.g. S,W,A (default $CLASSES)"
+    echo "  -t, --threads LIST     thread counts (default 1, 2, 4 ... up to nproc)"
+    echo "  -f, --flag-sets LIST   flag sets from ${!FLAGS[*]}"
+    echo "                         (default $FLAG_SETS)"
+    echo "  -D, --define NAME=FLAGS"
+    echo "                         add a flag set, e.g. -D 'o3=-O3 -march=rv64gc'"
+    echo "  -b, --bind SPEC        OMP_PROC_BIND: none, close or spread; OMP_PLACES=cores"
+    echo "                         unless none (default $BIND)"
+    echo "  -r, --reps N           runs per benchmark and configuration (default $REPS)"
+    echo "  -o, --output DIR       output directory (default $OUT)"
+    echo "      --format FMT       json or csv records (default $FORMAT)"
+    echo "      --no-build         run the binaries already in the output directory"
+    echo "  -h, --help             show this message"
+}
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        -p|--npb) NPB=$2; shift ;;
+        -k|--kernels) KERNELS=$2; shift ;;
+        -c|--classes) CLASSES=$2; shift ;;
+        -t|--threads) THREADS=$2; shift ;;
+        -f|--flag-sets) FLAG_SETS=$2; shift ;;
+        -D|--define)
+            case "$2" in
+                ?*=*) FLAGS[${2%%=*}]=${2#*=} ;;
+                *) echo "Invalid flag set: $2 (expected NAME=FLAGS)" >&2; exit 1 ;;
+            esac
+            shift ;;
+        -b|--bind) BIND=$2; shift ;;
+        -r|--reps) REPS=$2; shift ;;
+        -o|--output) OUT=$2; shift ;;
+        --format) FORMAT=$2; shift ;;
+        --no-build) BUILD=0 ;;
+        -h|--help) usage; exit 0 ;;
+        *) usage >&2; exit 1 ;;
+    esac
+    shift
+done
+
+if [ -z "$NPB" ] || [ ! -d "$NPB/config" ]; then
+    echo "Need --npb DIR pointing at an NPB-OMP tree (with config/)" >&2
+    exit 1
+fi
+NPB=$(cd "$NPB" && pwd)
+case "$BIND" in
+    none|close|spread) ;;
+    *) echo "Invalid binding: $BIND (expected none, close or spread)" >&2; exit 1 ;;
+esac
+case "$FORMAT" in
+    json|csv) ;;
+    *) echo "Invalid format: $FORMAT (expected json or csv)" >&2; exit 1 ;;
+esac
+for k in ${KERNELS//,/ }; do
+    case "$k" in
+        ep|cg|ft|mg|is) ;;
+        *) echo "Unknown benchmark: $k (expected ep, cg, ft, mg or is)" >&2; exit 1 ;;
+    esac
+done
+for set in ${FLAG_SETS//,/ }; do
+    if [ -z "${FLAGS[$set]+x}" ]; then
+        echo "Unknown flag set: $set (define it with --define $set=FLAGS)" >&2
+        exit 1
+    fi
+done
+if [ -z "$THREADS" ]; then
+    n=1
+    THREADS=1
+    while [ $((n * 2)) -le "$(nproc)" ]; do
+        n=$((n * 2))
+        THREADS="$THREADS,$n"
+    done
+fi
+
+mkdir -p "$OUT/records"
+OUT=$(cd "$OUT" && pwd)
+rm -f "$OUT"/records/npb-*."$FORMAT"
+
+make -C "$ROOT/nas-benchmarks" npb_ingest > /dev/null
+INGEST=$ROOT/nas-benchmarks/npb_ingest
+
+# Restore the user's make.def however the script ends
+if [ "$BUILD" = 1 ]; then
+    if [ -f "$NPB/config/make.def" ]; then
+        cp "$NPB/config/make.def" "$OUT/make.def.orig"
+        trap 'mv "$OUT/make.def.orig" "$NPB/config/make.def"' EXIT
+    else
+        trap 'rm -f "$NPB/config/make.def"' EXIT
+    fi
+fi
+
+write_make_def() {
+    cat > "$NPB/config/make.def" <<EOF
+# Written by run_npb.sh, flag set $1
+FC = gfortran
+FLINK = \$(FC)
+F_LIB =
+F_INC =
+FFLAGS = $2 -fopenmp
+FLINKFLAGS = $2 -fopenmp
+
+CC = gcc
+CLINK = \$(CC)
+C_LIB = -lm
+C_INC =
+CFLAGS = $2 -fopenmp
+CLINKFLAGS = $2 -fopenmp
+
+UCC = gcc
+BINDIR = ../bin
+RAND = randi8
+WTIME = wtime.c
+EOF
+}
+
+status=0
+if [ "$BUILD" = 1 ]; then
+    for set in ${FLAG_SETS//,/ }; do
+        echo "Building flag set $set (${FLAGS[$set]})..."
+        write_make_def "$set" "${FLAGS[$set]}"
+        mkdir -p "$OUT/bin/$set"
+        : > "$OUT/build-$set.log"
+        for k in ${KERNELS//,/ }; do
+            for c in ${CLASSES//,/ }; do
+                # Objects are shared between classes and flag sets
+                make -C "$NPB" clean >> "$OUT/build-$set.log" 2>&1
+                if ! make -C "$NPB" "$k" CLASS="$c" >> "$OUT/build-$set.log" 2>&1 ||
+                   [ ! -x "$NPB/bin/$k.$c.x" ]; then
+                    echo "  $k.$c failed to build, see $OUT/build-$set.log" >&2
+                    status=1
+                    continue
+                fi
+                mv "$NPB/bin/$k.$c.x" "$OUT/bin/$set/"
+            done
+        done
+    done
+fi
+
+if [ "$BIND" = none ]; then
+    unset OMP_PROC_BIND OMP_PLACES
+else
+    export OMP_PROC_BIND=$BIND OMP_PLACES=cores
+fi
+
+for set in ${FLAG_SETS//,/ }; do
+    for t in ${THREADS//,/ }; do
+        echo "Running flag set $set with $t threads (binding $BIND)..."
+        logs="$OUT/logs/$set/t$t"
+        rm -rf "$logs"
+        mkdir -p "$logs"
+        for k in ${KERNELS//,/ }; do
+            for c in ${CLASSES//,/ }; do
+                bin="$OUT/bin/$set/$k.$c.x"
+                [ -x "$bin" ] || continue
+                for r in $(seq 1 "$REPS"); do
+                    # Kept for inspection but left out of the record
+                    if ! OMP_NUM_THREADS=$t "$bin" > "$logs/$k.$c.$r.log" 2>&1; then
+                        mv "$logs/$k.$c.$r.log" "$logs/$k.$c.$r.failed"
+                        echo "  $k.$c run $r failed, see $logs/$k.$c.$r.failed" >&2
+                        status=1
+                    fi
+                done
+            done
+        done
+        ls "$logs"/*.log > /dev/null 2>&1 || continue
+        # Exit status 2: written, but some runs did not verify
+        rc=0
+        "$INGEST" --flag-set "$set" --flags "${FLAGS[$set]} -fopenmp" --binding "$BIND" \
+            --threads "$t" --format "$FORMAT" \
+            --output "$OUT/records/npb-$set-t$t.$FORMAT" "$logs"/*.log || rc=$?
+        case $rc in
+            0) ;;
+            2) status=1 ;;
+            *) echo "  could not ingest $logs" >&2; status=1 ;;
+        esac
+    done
+done
+
+if [ "$FORMAT" = csv ] && ls "$OUT"/records/npb-*.csv > /dev/null 2>&1; then
+    awk 'FNR > 1 || NR == 1' "$OUT"/records/npb-*.csv > "$OUT/npb.csv"
+    echo "Combined CSV: $OUT/npb.csv"
+fi
+[ "$status" = 0 ] || echo "Some runs failed or did not verify; see the logs" >&2
+exit $status
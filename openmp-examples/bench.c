@@ -0,0 +1,651 @@
+/*
+ * Benchmark driver
+ *
+ * Runs the STREAM, vector addition and matrix multiplication kernels from
+ * one process. Each kernel is an entry in a registry (name, setup, run,
+ * verify and its bytes/FLOPs model), and the command line selects the
+ * kernels and sweeps sizes and thread counts. The buffers are allocated
+ * once, for the largest configuration, and reused by every run, so a sweep
+ * pays for page faults once instead of once per process. Each kernel's
+ * setup writes all three buffers with the threads bound and in the slices
+ * its kernel uses, so every page is first touched, and placed, in the
+ * split of the first kernel that reaches it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <omp.h>
+#include "affinity.h"
+#include "timer.h"
+#include "report.h"
+#include "stats.h"
+#include "precision.h"
+#include "schedule.h"
+#include "pages.h"
+#include "stream_kernels.h"
+#include "vector_kernels.h"
+#include "gemm_kernels.h"
+
+#define MAX_LIST 32
+
+// Defaults, as in stream/Makefile and matmul.c
+#define DEFAULT_ARRAY_SIZE 10000000
+#define DEFAULT_MATRIX_SIZE 1024
+#define DEFAULT_REPS 10
+
+// Entries of C checked against the fp64 reference, besides the corners
+#define MATMUL_SAMPLES 256
+
+// STREAM scalar; with a = 1, b = 2 and c = 0.5 every kernel's result is
+// the same after any number of runs, and exact in every element type
+#define SCALAR 3.0
+
+// Everything a kernel sees: the element type's kernel sets and the three
+// shared buffers, each of buf_bytes
+typedef struct {
+    precision type;
+    size_t elem_size;
+    const stream_type_kernels *sk;
+    const vector_kernels *vk;
+    const gemm_type *gt;
+    block_params bp;
+    recursive_params rp;
+    void *buf[3];
+    size_t buf_bytes;
+    gemm_sample sample;
+} bench_state;
+
+// One registry entry. n is the number of elements per array, or the matrix
+// dimension if matrix is set. setup initializes the buffers for n with all
+// threads, each writing the part of all three that it works on in run;
+// run is one timed execution; verify returns the number of wrong elements
+// after any number of runs.
+typedef struct {
+    const char *name;
+    int matrix;
+    size_t (*buffer_bytes)(const bench_state *s, size_t n);
+    int (*setup)(bench_state *s, size_t n);
+    void (*run)(bench_state *s, size_t n);
+    size_t (*verify)(bench_state *s, size_t n);
+    double (*bytes)(const bench_state *s, size_t n);
+    double (*flops)(size_t n);
+} bench_kernel;
+
+static char *elem(const bench_state *s, int i, size_t j) {
+    return (char *)s->buf[i] + j * s->elem_size;
+}
+
+// ---- STREAM: Copy, Scale, Add and Triad on a, b, c ----
+
+static size_t stream_buffer_bytes(const bench_state *s, size_t n) {
+    return n * s->elem_size;
+}
+
+static int stream_setup(bench_state *s, size_t n) {
+    #pragma omp parallel
+    {
+        size_t lo, hi;
+        schedule_slice(n, &lo, &hi);
+        s->sk->fill(elem(s, 0, lo), 1.0, hi - lo);
+        s->sk->fill(elem(s, 1, lo), 2.0, hi - lo);
+        s->sk->fill(elem(s, 2, lo), 0.5, hi - lo);
+    }
+    return 0;
+}
+
+static void run_copy(bench_state *s, size_t n) {
+    #pragma omp parallel
+    {
+        size_t lo, hi;
+        schedule_slice(n, &lo, &hi);
+        s->sk->copy(elem(s, 2, lo), elem(s, 0, lo), hi - lo);
+    }
+}
+
+static void run_scale(bench_state *s, size_t n) {
+    #pragma omp parallel
+    {
+        size_t lo, hi;
+        schedule_slice(n, &lo, &hi);
+        s->sk->scale(elem(s, 1, lo), elem(s, 2, lo), SCALAR, hi - lo);
+    }
+}
+
+static void run_add(bench_state *s, size_t n) {
+    #pragma omp parallel
+    {
+        size_t lo, hi;
+        schedule_slice(n, &lo, &hi);
+        s->sk->add(elem(s, 2, lo), elem(s, 0, lo), elem(s, 1, lo), hi - lo);
+    }
+}
+
+static void run_triad(bench_state *s, size_t n) {
+    #pragma omp parallel
+    {
+        size_t lo, hi;
+        schedule_slice(n, &lo, &hi);
+        s->sk->triad(elem(s, 0, lo), elem(s, 1, lo), elem(s, 2, lo), SCALAR, hi - lo);
+    }
+}
+
+static size_t check_array(bench_state *s, int i, double expected, size_t n) {
+    double sum_err;
+    size_t nerr;
+
+    s->sk->check(s->buf[i], expected, 2.0 * precision_epsilon(s->type), n, &sum_err, &nerr);
+    return nerr;
+}
+
+static size_t verify_copy(bench_state *s, size_t n) {
+    return check_array(s, 2, 1.0, n);
+}
+
+static size_t verify_scale(bench_state *s, size_t n) {
+    return check_array(s, 1, SCALAR * 0.5, n);
+}
+
+static size_t verify_add(bench_state *s, size_t n) {
+    return check_array(s, 2, 3.0, n);
+}
+
+static size_t verify_triad(bench_state *s, size_t n) {
+    return check_array(s, 0, 2.0 + SCALAR * 0.5, n);
+}
+
+static double two_arrays(const bench_state *s, size_t n) {
+    return 2.0 * n * s->elem_size;
+}
+
+static double three_arrays(const bench_state *s, size_t n) {
+    return 3.0 * n * s->elem_size;
+}
+
+static double no_flops(size_t n) {
+    (void)n;
+    return 0.0;
+}
+
+static double one_flop(size_t n) {
+    return (double)n;
+}
+
+static double two_flops(size_t n) {
+    return 2.0 * n;
+}
+
+// ---- vector_add: c = a + b with vector_add's own kernels ----
+
+// init and the kernel's schedule(runtime) loop split n as schedule_slice()
+// does with the default static schedule
+static int vector_setup(bench_state *s, size_t n) {
+    s->vk->init(s->buf[0], s->buf[1], n);
+    #pragma omp parallel
+    {
+        size_t lo, hi;
+        schedule_slice(n, &lo, &hi);
+        s->sk->fill(elem(s, 2, lo), 0.0, hi - lo);
+    }
+    return 0;
+}
+
+static void run_vector_add(bench_state *s, size_t n) {
+    s->vk->parallel(s->buf[0], s->buf[1], s->buf[2], n);
+}
+
+// a[i] + b[i] is 256 for every i (see vector_kernels.c)
+static size_t verify_vector_add(bench_state *s, size_t n) {
+    return check_array(s, 2, 256.0, n);
+}
+
+// ---- matmul: A, B and C of n x n ----
+
+static size_t matmul_buffer_bytes(const bench_state *s, size_t n) {
+    size_t in = precision_size(s->gt->input), acc = precision_size(s->gt->accumulate);
+    return n * n * (in > acc ? in : acc);
+}
+
+// The kernels split C by rows; the serial init then only writes pages
+// already placed in slices of rows
+static int matmul_setup(bench_state *s, size_t n) {
+    size_t in = n * precision_size(s->gt->input), acc = n * precision_size(s->gt->accumulate);
+
+    free(s->sample.index);
+    free(s->sample.value);
+    #pragma omp parallel
+    {
+        size_t lo, hi;
+        schedule_slice(n, &lo, &hi);
+        memset((char *)s->buf[0] + lo * in, 0, (hi - lo) * in);
+        memset((char *)s->buf[1] + lo * in, 0, (hi - lo) * in);
+        memset((char *)s->buf[2] + lo * acc, 0, (hi - lo) * acc);
+    }
+    s->gt->init(s->buf[0], (int)n, 1);
+    s->gt->init(s->buf[1], (int)n, 2);
+    return gemm_sample_reference(s->gt, s->buf[0], s->buf[1], (int)n, MATMUL_SAMPLES + 4,
+                                 &s->sample);
+}
+
+static void run_matmul_blocked(bench_state *s, size_t n) {
+    s->gt->blocked(s->buf[0], s->buf[1], s->buf[2], (int)n, &s->bp);
+}
+
+static void run_matmul_recursive(bench_state *s, size_t n) {
+    s->gt->recursive(s->buf[0], s->buf[1], s->buf[2], (int)n, &s->rp);
+}
+
+// The sampled entries against their fp64 dot products, relative to
+// gemm_tolerance() of the accumulation type as in matmul.c
+static size_t verify_matmul(bench_state *s, size_t n) {
+    double tolerance = gemm_tolerance(s->gt->accumulate, (int)n);
+    size_t errors = 0;
+    static int warned;
+
+    if (tolerance >= GEMM_WEAK_TOL && !warned) {
+        fprintf(stderr, "Warning: from n = %zu the matmul check (tolerance %.2g) cannot tell "
+                "wrong results from %s rounding\n", n, tolerance,
+                precision_name(s->gt->accumulate));
+        warned = 1;
+    }
+
+    for (size_t k = 0; k < s->sample.count; k++) {
+        double ref = s->sample.value[k], v = s->gt->get(s->buf[2], s->sample.index[k]);
+        errors += !isfinite(v) || fabs(ref - v) > tolerance * fmax(fabs(ref), 1.0);
+    }
+    return errors;
+}
+
+// Compulsory traffic, as in matmul.c: A and B read once, C read and written
+static double matmul_bytes(const bench_state *s, size_t n) {
+    double in = precision_size(s->gt->input), acc = precision_size(s->gt->accumulate);
+    return (2.0 * in + 2.0 * acc) * n * n;
+}
+
+static double matmul_flops(size_t n) {
+    return 2.0 * n * n * n;
+}
+
+static const bench_kernel registry[] = {
+    { "copy", 0, stream_buffer_bytes, stream_setup, run_copy, verify_copy,
+      two_arrays, no_flops },
+    { "scale", 0, stream_buffer_bytes, stream_setup, run_scale, verify_scale,
+      two_arrays, one_flop },
+    { "add", 0, stream_buffer_bytes, stream_setup, run_add, verify_add,
+      three_arrays, one_flop },
+    { "triad", 0, stream_buffer_bytes, stream_setup, run_triad, verify_triad,
+      three_arrays, two_flops },
+    { "vector_add", 0, stream_buffer_bytes, vector_setup, run_vector_add, verify_vector_add,
+      three_arrays, one_flop },
+    { "matmul", 1, matmul_buffer_bytes, matmul_setup, run_matmul_blocked, verify_matmul,
+      matmul_bytes, matmul_flops },
+    { "matmul_recursive", 1, matmul_buffer_bytes, matmul_setup, run_matmul_recursive,
+      verify_matmul, matmul_bytes, matmul_flops },
+};
+
+#define NUM_KERNELS (int)(sizeof(registry) / sizeof(registry[0]))
+
+typedef struct {
+    int enabled[NUM_KERNELS];
+    size_t sizes[MAX_LIST];
+    int nsizes;
+    size_t matrix_sizes[MAX_LIST];
+    int nmatrix_sizes;
+    int threads[MAX_LIST];
+    int nthreads;
+    int reps;
+    page_mode pages;
+} bench_options;
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  --kernels LIST         kernels to run, from");
+    for (int k = 0; k < NUM_KERNELS; k++) {
+        fprintf(stderr, "%s%s", k ? "," : "\n                         ", registry[k].name);
+    }
+    fprintf(stderr, "\n                         (default all)\n");
+    fprintf(stderr, "  --sizes LIST           elements per array for the STREAM kernels and\n");
+    fprintf(stderr, "                         vector_add (default %d)\n", DEFAULT_ARRAY_SIZE);
+    fprintf(stderr, "  --matrix-sizes LIST    matrix dimensions for matmul (default %d)\n",
+            DEFAULT_MATRIX_SIZE);
+    fprintf(stderr, "  --threads LIST         thread counts to sweep (default OMP_NUM_THREADS\n");
+    fprintf(stderr, "                         or all CPUs)\n");
+    fprintf(stderr, "  --reps N               timed runs per configuration (default %d)\n",
+            DEFAULT_REPS);
+    fprintf(stderr, "  --schedule KIND[,N]    schedule of vector_add's loop (default static or\n");
+    fprintf(stderr, "                         OMP_SCHEDULE)\n");
+    fprintf(stderr, "  --type TYPE            element type: %s\n", precision_list());
+    fprintf(stderr, "                         (default fp64; matmul accumulates bf16 in fp32)\n");
+    fprintf(stderr, "  --pages MODE           pages of the buffers: default, 4k, 2m (THP) or 1g\n");
+    fprintf(stderr, "                         (hugetlbfs); see common/pages.h (default default)\n");
+    fprintf(stderr, "  --bind SPEC            pin threads: none, compact, spread or a CPU list\n");
+    fprintf(stderr, "                         such as 0,2,4-7 (default none)\n");
+    fprintf(stderr, "  --timer NAME           monotonic-raw, monotonic, gettimeofday, rdtime\n");
+    fprintf(stderr, "                         or rdcycle (default monotonic-raw)\n");
+    fprintf(stderr, "  --format FMT           also write a text, json or csv record (default text)\n");
+    fprintf(stderr, "  --output FILE          write the record to FILE instead of stdout\n");
+    fprintf(stderr, "  --help                 show this message\n");
+}
+
+// Parse a comma-separated list of positive integers up to max
+static int parse_list(const char *arg, size_t *values, int *count, size_t max) {
+    const char *p = arg;
+    *count = 0;
+
+    while (*p) {
+        char *end;
+        unsigned long long v = strtoull(p, &end, 10);
+        if (end == p || v == 0 || v > max || *count == MAX_LIST || (*end && *end != ',')) {
+            return -1;
+        }
+        values[(*count)++] = (size_t)v;
+        p = *end ? end + 1 : end;
+    }
+    return *count > 0 ? 0 : -1;
+}
+
+static int parse_kernels(const char *arg, int *enabled) {
+    char buf[256];
+    int any = 0;
+
+    if (strlen(arg) >= sizeof(buf)) {
+        return -1;
+    }
+    strcpy(buf, arg);
+    for (int k = 0; k < NUM_KERNELS; k++) {
+        enabled[k] = 0;
+    }
+    for (char *tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+        int k = 0;
+        while (k < NUM_KERNELS && strcmp(tok, registry[k].name) != 0) {
+            k++;
+        }
+        if (k == NUM_KERNELS) {
+            return -1;
+        }
+        enabled[k] = 1;
+        any = 1;
+    }
+    return any ? 0 : -1;
+}
+
+static void parse_args(int argc, char *argv[], bench_options *o, precision *type,
+                       schedule_config *sched, affinity_config *bind, report_format *fmt, const char **out_path) {
+    static const struct option long_options[] = {
+        {"kernels",      required_argument, NULL, 'k'},
+        {"sizes",        required_argument, NULL, 'n'},
+        {"matrix-sizes", required_argument, NULL, 'm'},
+        {"threads",      required_argument, NULL, 'T'},
+        {"reps",         required_argument, NULL, 'r'},
+        {"schedule",     required_argument, NULL, 'S'},
+        {"type",         required_argument, NULL, 'y'},
+        {"pages",        required_argument, NULL, 'G'},
+        {"bind",         required_argument, NULL, 'b'},
+        {"timer",        required_argument, NULL, 't'},
+        {"format",       required_argument, NULL, 'F'},
+        {"output",       required_argument, NULL, 'o'},
+        {"help",         no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    size_t list[MAX_LIST];
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'k':
+            if (parse_kernels(optarg, o->enabled) != 0) {
+                fprintf(stderr, "Invalid kernel list: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'n':
+            if (parse_list(optarg, o->sizes, &o->nsizes, (size_t)1 << 40) != 0) {
+                fprintf(stderr, "Invalid size list: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'm':
+            // i * n + j indexing in the matmul kernels stays within int
+            if (parse_list(optarg, o->matrix_sizes, &o->nmatrix_sizes, 32768) != 0) {
+                fprintf(stderr, "Invalid matrix size list: %s (1 to 32768)\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'T':
+            if (parse_list(optarg, list, &o->nthreads, 4096) != 0) {
+                fprintf(stderr, "Invalid thread list: %s\n", optarg);
+                exit(1);
+            }
+            for (int i = 0; i < o->nthreads; i++) {
+                o->threads[i] = (int)list[i];
+            }
+            break;
+        case 'r': {
+            char *end;
+            long v = strtol(optarg, &end, 10);
+            if (end == optarg || *end != '\0' || v < 1 || v > 100000) {
+                fprintf(stderr, "Invalid repetition count: %s\n", optarg);
+                exit(1);
+            }
+            o->reps = (int)v;
+            break;
+        }
+        case 'S':
+            if (schedule_parse(optarg, sched) != 0) {
+                fprintf(stderr, "Invalid schedule: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'y':
+            if (precision_parse(optarg, type) != 0) {
+                exit(1);
+            }
+            break;
+        case 'G':
+            if (pages_parse(optarg, &o->pages) != 0) {
+                fprintf(stderr, "Invalid pages: %s (default, 4k, 2m or 1g)\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'b':
+            if (affinity_parse(optarg, bind) != 0) {
+                fprintf(stderr, "Invalid binding: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 't':
+            if (timer_select(optarg) != 0) {
+                exit(1);
+            }
+            break;
+        case 'F':
+            if (report_parse_format(optarg, fmt) != 0) {
+                fprintf(stderr, "Unknown format: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'o':
+            *out_path = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+}
+
+// Time one kernel at one size and thread count: a warm-up run, then reps
+// timed runs, then a check of the result
+static int run_config(bench_state *s, const bench_kernel *bk, size_t n, int threads,
+                      int reps, double *times) {
+    char variant[64];
+    stats_summary st;
+    report_result r;
+
+    bk->run(s, n);
+    for (int i = 0; i < reps; i++) {
+        double start = timer_seconds();
+        bk->run(s, n);
+        times[i] = timer_seconds() - start;
+    }
+    size_t errors = bk->verify(s, n);
+
+    stats_summarize(times, reps, &st);
+    double bytes = bk->bytes(s, n), flops = bk->flops(n);
+    int bandwidth = !bk->matrix;
+    double rate = bandwidth ? bytes / st.min / 1e6 : flops / st.min / 1e9;
+    printf("%-17s %12zu %7d %12.6f %12.6f %12.2f %-6s  %s\n", bk->name, n, threads, st.min,
+           st.median, rate, bandwidth ? "MB/s" : "GFLOPS", errors ? "FAILED" : "ok");
+
+    snprintf(variant, sizeof(variant), "%d threads", threads);
+    memset(&r, 0, sizeof(r));
+    r.kernel = bk->name;
+    r.variant = variant;
+    r.working_set = bk->matrix ? 3.0 * bk->buffer_bytes(s, n) : bytes;
+    r.bytes = bytes;
+    r.flops = flops;
+    r.rate = rate;
+    r.unit = bandwidth ? "MB/s" : "GFLOPS";
+    r.times = times;
+    r.ntimes = reps;
+    report_add(&r);
+    return errors > 0;
+}
+
+int main(int argc, char *argv[]) {
+    bench_options o;
+    bench_state s;
+    precision type = PREC_FP64;
+    schedule_config sched = { 0, SCHED_STATIC, 0 };
+    char sched_name[32];
+    affinity_config bind = { BIND_NONE };
+    report_format out_format = REPORT_TEXT;
+    const char *out_path = NULL;
+    int failures = 0;
+
+    memset(&o, 0, sizeof(o));
+    memset(&s, 0, sizeof(s));
+    for (int k = 0; k < NUM_KERNELS; k++) {
+        o.enabled[k] = 1;
+    }
+    o.reps = DEFAULT_REPS;
+    parse_args(argc, argv, &o, &type, &sched, &bind, &out_format, &out_path);
+    schedule_apply(&sched);
+    schedule_name(sched_name, sizeof(sched_name));
+    if (o.nsizes == 0) {
+        o.sizes[o.nsizes++] = DEFAULT_ARRAY_SIZE;
+    }
+    if (o.nmatrix_sizes == 0) {
+        o.matrix_sizes[o.nmatrix_sizes++] = DEFAULT_MATRIX_SIZE;
+    }
+    if (o.nthreads == 0) {
+        o.threads[o.nthreads++] = omp_get_max_threads();
+    }
+
+    s.type = type;
+    s.elem_size = precision_size(type);
+    s.sk = stream_type_select(type);
+    s.vk = vector_kernels_select(type);
+    s.gt = gemm_type_select(type == PREC_BF16 ? "bf16" : precision_name(type));
+    if (!s.sk || !s.vk || !s.gt) {
+        fprintf(stderr, "Type %s is not built in\n", precision_name(type));
+        return 1;
+    }
+    s.bp = (block_params){ BLOCK_MC, BLOCK_KC, BLOCK_NC };
+    s.rp = (recursive_params){ RECURSIVE_BASE, 0 };
+    if (report_open("bench", out_format, out_path) != 0) {
+        return 1;
+    }
+
+    // One allocation for the largest buffer any configuration needs
+    int max_threads = 1;
+    for (int t = 0; t < o.nthreads; t++) {
+        max_threads = o.threads[t] > max_threads ? o.threads[t] : max_threads;
+    }
+    for (int k = 0; k < NUM_KERNELS; k++) {
+        size_t *sizes = registry[k].matrix ? o.matrix_sizes : o.sizes;
+        int count = registry[k].matrix ? o.nmatrix_sizes : o.nsizes;
+        for (int i = 0; o.enabled[k] && i < count; i++) {
+            size_t need = registry[k].buffer_bytes(&s, sizes[i]);
+            s.buf_bytes = need > s.buf_bytes ? need : s.buf_bytes;
+        }
+    }
+    // Not touched here: each setup() places the pages (see the top)
+    for (int i = 0; i < 3; i++) {
+        if ((s.buf[i] = pages_alloc(s.buf_bytes, o.pages)) == NULL) {
+            return 1;
+        }
+    }
+
+    printf("========================================\n");
+    printf("Benchmark Driver\n");
+    printf("========================================\n\n");
+    printf("Element type: %s (%zu bytes)\n", precision_name(type), s.elem_size);
+    printf("Buffers: 3 x %.2f MB, allocated once\n", s.buf_bytes / (1024.0 * 1024.0));
+    printf("Thread binding: %s\n", affinity_name(&bind));
+    printf("Schedule: %s\n", sched_name);
+    printf("Timer: %s (resolution %.1f ns)\n", timer_name(), timer_resolution() * 1e9);
+    printf("Repetitions: %d per configuration, after one warm-up run\n", o.reps);
+    printf("Rates from the best time; bandwidth in MB/s (10^6 bytes)\n\n");
+
+    report_param_str("type", precision_name(type));
+    report_param_int("reps", o.reps);
+    report_param_str("schedule", sched_name);
+    report_param_str("binding", affinity_name(&bind));
+    report_param_str("pages", pages_name(o.pages));
+
+    double *times = malloc(o.reps * sizeof(double));
+    if (!times) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return 1;
+    }
+    printf("Kernel                    Size Threads     Best (s)   Median (s)         Rate         Check\n");
+    for (int k = 0; k < NUM_KERNELS; k++) {
+        const bench_kernel *bk = &registry[k];
+        size_t *sizes = bk->matrix ? o.matrix_sizes : o.sizes;
+        int count = bk->matrix ? o.nmatrix_sizes : o.nsizes;
+
+        for (int i = 0; o.enabled[k] && i < count; i++) {
+            // Bind, then initialize (and first-touch) with all threads, then
+            // sweep the thread counts
+            omp_set_num_threads(max_threads);
+            if (affinity_apply(&bind) != 0) {
+                return 1;
+            }
+            if (bk->setup(&s, sizes[i]) != 0) {
+                fprintf(stderr, "Memory allocation failed\n");
+                return 1;
+            }
+            for (int t = 0; t < o.nthreads; t++) {
+                omp_set_num_threads(o.threads[t]);
+                if (affinity_apply(&bind) != 0) {
+                    return 1;
+                }
+                failures += run_config(&s, bk, sizes[i], o.threads[t], o.reps, times);
+            }
+        }
+    }
+
+    // Once the setups have touched the buffers
+    char page_text[96];
+    pages_describe(s.buf[0], page_text, sizeof(page_text));
+    printf("\nPages: %s requested, %s obtained\n", pages_name(o.pages), page_text);
+    report_param_str("pages_obtained", page_text);
+
+    printf("\n%s\n", failures ? "Verification: FAILED" : "Verification: PASSED");
+    report_param_str("verification", failures ? "failed" : "passed");
+    report_end();
+
+    free(times);
+    for (int i = 0; i < 3; i++) {
+        pages_free(s.buf[i]);
+    }
+    free(s.sample.index);
+    free(s.sample.value);
+    return failures ? 1 : 0;
+}
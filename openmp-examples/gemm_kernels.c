@@ -0,0 +1,643 @@
+/*
+ * Matrix multiplication kernels for every --type; see gemm_kernels.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <omp.h>
+#include "gemm_kernels.h"
+
+
+// Portable MR x NR micro-kernel. The accumulators are a fixed-size local
+// array so the compiler keeps them in (vector) registers; only the valid
+// mr x nr corner is written back.
+#define GEMM_MICRO_KERNEL(ACC, T)                                               \
+static void micro_kernel_##ACC(int kc, const T *restrict Ap, const T *restrict Bp, \
+                               T *restrict C, int ldc, int mr, int nr,          \
+                               int accumulate) {                                \
+    T acc[MR][NR] = {{0}};                                                      \
+                                                                                \
+    for (int p = 0; p < kc; p++) {                                              \
+        for (int i = 0; i < MR; i++) {                                          \
+            T a = Ap[p * MR + i];                                               \
+            for (int j = 0; j < NR; j++) {                                      \
+                acc[i][j] += a * Bp[p * NR + j];                                \
+            }                                                                   \
+        }                                                                       \
+    }                                                                           \
+                                                                                \
+    for (int i = 0; i < mr; i++) {                                              \
+        for (int j = 0; j < nr; j++) {                                          \
+            C[i * ldc + j] = accumulate ? C[i * ldc + j] + acc[i][j] : acc[i][j]; \
+        }                                                                       \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+static const gemm_kernel_##ACC portable_kernel_##ACC = {                        \
+    GEMM_PORTABLE_NAME, MR, NR, micro_kernel_##ACC                                  \
+};
+
+GEMM_MICRO_KERNEL(f64, double)
+GEMM_MICRO_KERNEL(f32, float)
+#ifdef PRECISION_HAVE_FP16
+GEMM_MICRO_KERNEL(f16, _Float16)
+#endif
+
+const gemm_kernel_f64 *gemm_portable_kernel(void) {
+    return &portable_kernel_f64;
+}
+
+#ifdef __riscv_vector
+#include <riscv_vector.h>
+
+// RVV fp64 micro-kernel: 8 rows x one LMUL=2 register group of columns. Each
+// step loads a row of the B sliver and broadcasts 8 elements of A into
+// vfmacc.vf, so the tile width follows VLEN (4 doubles at VLEN=128, 16 at
+// VLEN=512) with 16 accumulator registers and 2 for B.
+#define RVV_MR 8
+
+static void micro_kernel_rvv(int kc, const double *restrict Ap, const double *restrict Bp,
+                             double *restrict C, int ldc, int mr, int nr, int accumulate) {
+    size_t vlmax = __riscv_vsetvlmax_e64m2();
+    vfloat64m2_t c0 = __riscv_vfmv_v_f_f64m2(0.0, vlmax);
+    vfloat64m2_t c1 = c0, c2 = c0, c3 = c0, c4 = c0, c5 = c0, c6 = c0, c7 = c0;
+
+    for (int p = 0; p < kc; p++) {
+        vfloat64m2_t b = __riscv_vle64_v_f64m2(Bp + (size_t)p * vlmax, vlmax);
+        const double *a = Ap + p * RVV_MR;
+        c0 = __riscv_vfmacc_vf_f64m2(c0, a[0], b, vlmax);
+        c1 = __riscv_vfmacc_vf_f64m2(c1, a[1], b, vlmax);
+        c2 = __riscv_vfmacc_vf_f64m2(c2, a[2], b, vlmax);
+        c3 = __riscv_vfmacc_vf_f64m2(c3, a[3], b, vlmax);
+        c4 = __riscv_vfmacc_vf_f64m2(c4, a[4], b, vlmax);
+        c5 = __riscv_vfmacc_vf_f64m2(c5, a[5], b, vlmax);
+        c6 = __riscv_vfmacc_vf_f64m2(c6, a[6], b, vlmax);
+        c7 = __riscv_vfmacc_vf_f64m2(c7, a[7], b, vlmax);
+    }
+
+    // Vector types are sizeless and cannot live in an array, so the
+    // write-back is unrolled by hand
+    size_t vl = __riscv_vsetvl_e64m2(nr);
+#define RVV_STORE_ROW(i, acc)                                                        \
+    if (i < mr) {                                                                    \
+        vfloat64m2_t r = accumulate                                                  \
+            ? __riscv_vfadd_vv_f64m2(acc, __riscv_vle64_v_f64m2(C + i * ldc, vl), vl) \
+            : acc;                                                                   \
+        __riscv_vse64_v_f64m2(C + i * ldc, r, vl);                                   \
+    }
+    RVV_STORE_ROW(0, c0)
+    RVV_STORE_ROW(1, c1)
+    RVV_STORE_ROW(2, c2)
+    RVV_STORE_ROW(3, c3)
+    RVV_STORE_ROW(4, c4)
+    RVV_STORE_ROW(5, c5)
+    RVV_STORE_ROW(6, c6)
+    RVV_STORE_ROW(7, c7)
+#undef RVV_STORE_ROW
+}
+
+static gemm_kernel_f64 rvv_kernel = { "RVV 8xVL", RVV_MR, 0, micro_kernel_rvv };
+
+const gemm_kernel_f64 *gemm_rvv_kernel(void) {
+    rvv_kernel.tile_n = (int)__riscv_vsetvlmax_e64m2();
+    return &rvv_kernel;
+}
+#endif
+
+// Recursive cache-oblivious multiplication (matmul_recursive): C is split
+// in Z-order by halving the largest of m, n and k until every dimension is
+// at most base, and each leaf is packed and swept by the micro-kernel.
+// Halves of m or n are independent OpenMP tasks; halves of k run one after
+// the other into the same C. With strassen > 0, an even n of at least that
+// size first takes one Strassen step: seven half-size products instead of
+// eight, at the price of extra additions and a looser error bound.
+
+#define GEMM_RECURSIVE(ACC, T)                                                  \
+                                                                                \
+/* Per-thread packing buffers and the micro-kernel shared by the leaves */      \
+typedef struct {                                                                \
+    const gemm_kernel_##ACC *uk;                                                \
+    int base;                                                                   \
+    size_t a_size, b_size;                                                      \
+    T *Ap, *Bp;                                                                 \
+} recursion_##ACC;                                                              \
+                                                                                \
+/* One leaf, C[0:m, 0:n] (+)= A[0:m, 0:k] * B[0:k, 0:n] with m, n, k <= */      \
+/* base. A leaf has no task scheduling point, so the buffers of the thread */   \
+/* running it are free. */                                                      \
+static void recursive_leaf_##ACC(const recursion_##ACC *r, int m, int n, int k, \
+                                 const T *A, int lda, const T *B, int ldb,      \
+                                 T *C, int ldc, int accumulate) {               \
+    int tm = r->uk->tile_m, tn = r->uk->tile_n;                                 \
+    T *Ap = r->Ap + r->a_size * omp_get_thread_num();                           \
+    T *Bp = r->Bp + r->b_size * omp_get_thread_num();                           \
+    T *dst = Ap;                                                                \
+                                                                                \
+    for (int i = 0; i < m; i += tm) {                                           \
+        int rows = (m - i < tm) ? m - i : tm;                                   \
+        for (int p = 0; p < k; p++) {                                           \
+            for (int s = 0; s < tm; s++) {                                      \
+                *dst++ = (s < rows) ? A[(size_t)(i + s) * lda + p] : 0;         \
+            }                                                                   \
+        }                                                                       \
+    }                                                                           \
+    dst = Bp;                                                                   \
+    for (int j = 0; j < n; j += tn) {                                           \
+        int cols = (n - j < tn) ? n - j : tn;                                   \
+        for (int p = 0; p < k; p++) {                                           \
+            for (int c = 0; c < tn; c++) {                                      \
+                *dst++ = (c < cols) ? B[(size_t)p * ldb + j + c] : 0;           \
+            }                                                                   \
+        }                                                                       \
+    }                                                                           \
+                                                                                \
+    for (int jr = 0; jr < n; jr += tn) {                                        \
+        int nr = (n - jr < tn) ? n - jr : tn;                                   \
+        for (int ir = 0; ir < m; ir += tm) {                                    \
+            int mr = (m - ir < tm) ? m - ir : tm;                               \
+            r->uk->run(k, &Ap[(size_t)ir * k], &Bp[(size_t)jr * k],             \
+                       &C[(size_t)ir * ldc + jr], ldc, mr, nr, accumulate);     \
+        }                                                                       \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+/* C[0:m, 0:n] (+)= A[0:m, 0:k] * B[0:k, 0:n]; call from inside a single */     \
+static void recursive_gemm_##ACC(const recursion_##ACC *r, int m, int n, int k, \
+                                 const T *A, int lda, const T *B, int ldb,      \
+                                 T *C, int ldc, int accumulate) {               \
+    if (m <= r->base && n <= r->base && k <= r->base) {                         \
+        recursive_leaf_##ACC(r, m, n, k, A, lda, B, ldb, C, ldc, accumulate);   \
+    } else if (m >= n && m >= k) {                                              \
+        int h = m / 2;                                                          \
+        _Pragma("omp task")                                                     \
+        recursive_gemm_##ACC(r, h, n, k, A, lda, B, ldb, C, ldc, accumulate);   \
+        _Pragma("omp task")                                                     \
+        recursive_gemm_##ACC(r, m - h, n, k, A + (size_t)h * lda, lda, B, ldb,  \
+                             C + (size_t)h * ldc, ldc, accumulate);             \
+        _Pragma("omp taskwait")                                                 \
+    } else if (n >= k) {                                                        \
+        int h = n / 2;                                                          \
+        _Pragma("omp task")                                                     \
+        recursive_gemm_##ACC(r, m, h, k, A, lda, B, ldb, C, ldc, accumulate);   \
+        _Pragma("omp task")                                                     \
+        recursive_gemm_##ACC(r, m, n - h, k, A, lda, B + h, ldb, C + h, ldc,    \
+                             accumulate);                                       \
+        _Pragma("omp taskwait")                                                 \
+    } else {                                                                    \
+        int h = k / 2;                                                          \
+        recursive_gemm_##ACC(r, m, n, h, A, lda, B, ldb, C, ldc, accumulate);   \
+        recursive_gemm_##ACC(r, m, n, k - h, A + h, lda, B + (size_t)h * ldb,   \
+                             ldb, C, ldc, 1);                                   \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+/* The h x h operand X (+ or -) Y of a Strassen product: X alone if y < 0, */   \
+/* otherwise the sum written to D. Quadrants are numbered 0 1 / 2 3. */         \
+static const T *strassen_operand_##ACC(const T *M, int n, int x, int y, int sign, \
+                                       T *D) {                                  \
+    int h = n / 2;                                                              \
+    const T *X = M + (size_t)(x / 2) * h * n + (x % 2) * h;                     \
+    const T *Y;                                                                 \
+                                                                                \
+    if (y < 0) {                                                                \
+        return X;                                                               \
+    }                                                                           \
+    Y = M + (size_t)(y / 2) * h * n + (y % 2) * h;                              \
+    for (int i = 0; i < h; i++) {                                               \
+        for (int j = 0; j < h; j++) {                                           \
+            D[(size_t)i * h + j] = X[(size_t)i * n + j] + sign * Y[(size_t)i * n + j]; \
+        }                                                                       \
+    }                                                                           \
+    return D;                                                                   \
+}                                                                               \
+                                                                                \
+/* One Strassen level over an even n, each product a recursive task */          \
+static void strassen_gemm_##ACC(const recursion_##ACC *r, const T *A,           \
+                                const T *B, T *C, int n) {                      \
+    /* M_p = (A_a1 + sa A_a2)(B_b1 + sb B_b2); -1 marks a single quadrant */    \
+    static const int prod[7][6] = {                                             \
+        { 0, 3, 1, 0, 3, 1 }, { 2, 3, 1, 0, -1, 0 }, { 0, -1, 0, 1, 3, -1 },    \
+        { 3, -1, 0, 2, 0, -1 }, { 0, 1, 1, 3, -1, 0 }, { 2, 0, -1, 0, 1, 1 },   \
+        { 1, 3, -1, 2, 3, 1 }                                                   \
+    };                                                                          \
+    int h = n / 2;                                                              \
+    size_t hh = (size_t)h * h;                                                  \
+    T *work;                                                                    \
+                                                                                \
+    /* Seven products and two operands for each */                              \
+    if (posix_memalign((void **)&work, 64, 21 * hh * sizeof(T)) != 0) {         \
+        fprintf(stderr, "Memory allocation failed\n");                          \
+        exit(1);                                                                \
+    }                                                                           \
+    for (int p = 0; p < 7; p++) {                                               \
+        _Pragma("omp task")                                                     \
+        {                                                                       \
+            T *M = work + (size_t)p * hh;                                       \
+            T *Da = work + (7 + 2 * (size_t)p) * hh, *Db = Da + hh;             \
+            const T *X = strassen_operand_##ACC(A, n, prod[p][0], prod[p][1],   \
+                                                prod[p][2], Da);                \
+            const T *Y = strassen_operand_##ACC(B, n, prod[p][3], prod[p][4],   \
+                                                prod[p][5], Db);                \
+            int ldx = (prod[p][1] < 0) ? n : h, ldy = (prod[p][4] < 0) ? n : h; \
+            recursive_gemm_##ACC(r, h, h, h, X, ldx, Y, ldy, M, h, 0);          \
+        }                                                                       \
+    }                                                                           \
+    _Pragma("omp taskwait")                                                     \
+                                                                                \
+    const T *M1 = work, *M2 = M1 + hh, *M3 = M2 + hh, *M4 = M3 + hh;            \
+    const T *M5 = M4 + hh, *M6 = M5 + hh, *M7 = M6 + hh;                        \
+    _Pragma("omp taskloop")                                                     \
+    for (int i = 0; i < h; i++) {                                               \
+        for (int j = 0; j < h; j++) {                                           \
+            size_t q = (size_t)i * h + j;                                       \
+            C[(size_t)i * n + j] = M1[q] + M4[q] - M5[q] + M7[q];               \
+            C[(size_t)i * n + h + j] = M3[q] + M5[q];                           \
+            C[(size_t)(h + i) * n + j] = M2[q] + M4[q];                         \
+            C[(size_t)(h + i) * n + h + j] = M1[q] - M2[q] + M3[q] + M6[q];     \
+        }                                                                       \
+    }                                                                           \
+    free(work);                                                                 \
+}                                                                               \
+                                                                                \
+static void matmul_recursive_##ACC(const T *A, const T *B, T *C, int n,         \
+                                   const recursive_params *rp,                  \
+                                   const gemm_kernel_##ACC *uk) {               \
+    int tm = uk->tile_m, tn = uk->tile_n, base = rp->base;                      \
+    int nthreads = omp_get_max_threads();                                       \
+    recursion_##ACC r = { uk, base, 0, 0, NULL, NULL };                         \
+                                                                                \
+    r.a_size = (size_t)((base + tm - 1) / tm * tm) * base;                      \
+    r.b_size = (size_t)((base + tn - 1) / tn * tn) * base;                      \
+    if (posix_memalign((void **)&r.Ap, 64, r.a_size * nthreads * sizeof(T)) != 0 || \
+        posix_memalign((void **)&r.Bp, 64, r.b_size * nthreads * sizeof(T)) != 0) { \
+        fprintf(stderr, "Memory allocation failed\n");                          \
+        exit(1);                                                                \
+    }                                                                           \
+                                                                                \
+    _Pragma("omp parallel")                                                     \
+    _Pragma("omp single")                                                       \
+    {                                                                           \
+        if (rp->strassen > 0 && n >= rp->strassen && n % 2 == 0) {              \
+            strassen_gemm_##ACC(&r, A, B, C, n);                                \
+        } else {                                                                \
+            recursive_gemm_##ACC(&r, n, n, n, A, n, B, n, C, n, 0);             \
+        }                                                                       \
+    }                                                                           \
+                                                                                \
+    free(r.Ap);                                                                 \
+    free(r.Bp);                                                                 \
+}
+
+GEMM_RECURSIVE(f64, double)
+GEMM_RECURSIVE(f32, float)
+#ifdef PRECISION_HAVE_FP16
+GEMM_RECURSIVE(f16, _Float16)
+#endif
+
+// The matrix multiplications for one --type: inputs of type IN (rounded
+// from double with STORE, widened with LOAD) and products summed and
+// stored in the accumulation type ACC_T. Each input is converted to ACC_T
+// before the multiply, so with fp16 or bf16 inputs and fp32 accumulation
+// the products are exact and only the sums round.
+#define GEMM_TYPE(TAG, IN, ACC, ACC_T, LOAD, STORE)                             \
+                                                                                \
+/* Initialize matrix with values */                                             \
+static void initialize_matrix_##TAG(void *matrix, int n, int seed) {            \
+    IN *m = matrix;                                                             \
+    for (int i = 0; i < n; i++) {                                               \
+        for (int j = 0; j < n; j++) {                                           \
+            m[i * n + j] = STORE((double)((i + j + seed) % 100) / 10.0);        \
+        }                                                                       \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+/* Serial matrix multiplication */                                              \
+void matmul_serial_##TAG(const void *vA, const void *vB, void *vC, int n) {     \
+    const IN *A = vA, *B = vB;                                                  \
+    ACC_T *C = vC;                                                              \
+    for (int i = 0; i < n; i++) {                                               \
+        for (int j = 0; j < n; j++) {                                           \
+            ACC_T sum = 0;                                                      \
+            for (int k = 0; k < n; k++) {                                       \
+                sum += (ACC_T)LOAD(A[i * n + k]) * (ACC_T)LOAD(B[k * n + j]);   \
+            }                                                                   \
+            C[i * n + j] = sum;                                                 \
+        }                                                                       \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+/* Parallel matrix multiplication using OpenMP (schedule from --schedule) */    \
+void matmul_parallel_##TAG(const void *vA, const void *vB, void *vC, int n) {   \
+    const IN *A = vA, *B = vB;                                                  \
+    ACC_T *C = vC;                                                              \
+    _Pragma("omp parallel for schedule(runtime)")                               \
+    for (int i = 0; i < n; i++) {                                               \
+        for (int j = 0; j < n; j++) {                                           \
+            ACC_T sum = 0;                                                      \
+            for (int k = 0; k < n; k++) {                                       \
+                sum += (ACC_T)LOAD(A[i * n + k]) * (ACC_T)LOAD(B[k * n + j]);   \
+            }                                                                   \
+            C[i * n + j] = sum;                                                 \
+        }                                                                       \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+/* Parallel matrix multiplication with loop collapse */                         \
+void matmul_parallel_collapse_##TAG(const void *vA, const void *vB, void *vC,   \
+                                    int n) {                                    \
+    const IN *A = vA, *B = vB;                                                  \
+    ACC_T *C = vC;                                                              \
+    _Pragma("omp parallel for collapse(2) schedule(runtime)")                   \
+    for (int i = 0; i < n; i++) {                                               \
+        for (int j = 0; j < n; j++) {                                           \
+            ACC_T sum = 0;                                                      \
+            for (int k = 0; k < n; k++) {                                       \
+                sum += (ACC_T)LOAD(A[i * n + k]) * (ACC_T)LOAD(B[k * n + j]);   \
+            }                                                                   \
+            C[i * n + j] = sum;                                                 \
+        }                                                                       \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+/* One row of C, for the tasks of matmul_taskloop */                            \
+static void matmul_row_##TAG(const IN *A, const IN *B, ACC_T *C, int n, int i) { \
+    for (int j = 0; j < n; j++) {                                               \
+        ACC_T sum = 0;                                                          \
+        for (int k = 0; k < n; k++) {                                           \
+            sum += (ACC_T)LOAD(A[i * n + k]) * (ACC_T)LOAD(B[k * n + j]);       \
+        }                                                                       \
+        C[i * n + j] = sum;                                                     \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+/* Parallel matrix multiplication with omp taskloop: one thread creates */      \
+/* tasks of grainsize rows (or as many as the runtime chooses, if 0) and */     \
+/* the team executes them as they become idle */                                \
+void matmul_taskloop_##TAG(const void *vA, const void *vB, void *vC, int n,     \
+                           int grainsize) {                                     \
+    const IN *A = vA, *B = vB;                                                  \
+    ACC_T *C = vC;                                                              \
+    _Pragma("omp parallel")                                                     \
+    _Pragma("omp single")                                                       \
+    {                                                                           \
+        if (grainsize > 0) {                                                    \
+            _Pragma("omp taskloop grainsize(grainsize)")                        \
+            for (int i = 0; i < n; i++) {                                       \
+                matmul_row_##TAG(A, B, C, n, i);                                \
+            }                                                                   \
+        } else {                                                                \
+            _Pragma("omp taskloop")                                             \
+            for (int i = 0; i < n; i++) {                                       \
+                matmul_row_##TAG(A, B, C, n, i);                                \
+            }                                                                   \
+        }                                                                       \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+/* Pack rows [0, mc) x columns [0, kc) of A (leading dimension ld) into */      \
+/* tm-row slivers stored column by column, zero-padding the last sliver */      \
+static void pack_a_##TAG(const IN *A, ACC_T *Ap, int mc, int kc, int ld, int tm) { \
+    for (int i = 0; i < mc; i += tm) {                                          \
+        int rows = (mc - i < tm) ? mc - i : tm;                                 \
+        for (int p = 0; p < kc; p++) {                                          \
+            for (int r = 0; r < tm; r++) {                                      \
+                *Ap++ = (r < rows) ? (ACC_T)LOAD(A[(size_t)(i + r) * ld + p]) : 0; \
+            }                                                                   \
+        }                                                                       \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+/* Pack one kc x tn sliver of B (leading dimension ld) row by row, */           \
+/* zero-padding columns past cols */                                            \
+static void pack_b_sliver_##TAG(const IN *B, ACC_T *Bp, int kc, int cols, int ld, \
+                                int tn) {                                       \
+    for (int p = 0; p < kc; p++) {                                              \
+        for (int c = 0; c < tn; c++) {                                          \
+            *Bp++ = (c < cols) ? (ACC_T)LOAD(B[(size_t)p * ld + c]) : 0;        \
+        }                                                                       \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+/* Pack buffers of gemm_blocked, kept from one call to the next and only */   \
+/* reallocated when a call needs more, so that repeated products (timed */      \
+/* runs, SUMMA panels and slices) do not allocate and fault in pages */         \
+static ACC_T *pack_buf_##TAG;                                                   \
+static size_t pack_count_##TAG;                                                 \
+                                                                                \
+static ACC_T *pack_buffers_##TAG(size_t count) {                                \
+    if (count > pack_count_##TAG) {                                             \
+        free(pack_buf_##TAG);                                                   \
+        if (posix_memalign((void **)&pack_buf_##TAG, 64, count * sizeof(ACC_T)) != 0) { \
+            fprintf(stderr, "Memory allocation failed\n");                      \
+            exit(1);                                                            \
+        }                                                                       \
+        pack_count_##TAG = count;                                               \
+    }                                                                           \
+    return pack_buf_##TAG;                                                      \
+}                                                                               \
+                                                                                \
+/* Cache-blocked, register-tiled C[0:m, 0:n] (+)= A[0:m, 0:k] * B[0:k, 0:n], */ \
+/* with leading dimensions lda, ldb and ldc (GotoBLAS loop order). Each */      \
+/* KC x NC panel of B is packed once by all threads; each thread then   */      \
+/* packs its own MC x KC blocks of A and sweeps the register tiles over */      \
+/* them. Packing widens the inputs to ACC_T. The pack buffers are shared */     \
+/* between calls, so calls must not overlap.                            */      \
+void gemm_blocked_##TAG(int m, int n, int k, const IN *A, int lda, const IN *B, \
+                        int ldb, ACC_T *C, int ldc, int accumulate,             \
+                        const block_params *bp, const gemm_kernel_##ACC *uk) {  \
+    int mc = bp->mc, kc = bp->kc, nc = bp->nc;                                  \
+    int tm = uk->tile_m, tn = uk->tile_n;                                       \
+    int nc_pad = (nc + tn - 1) / tn * tn;                                       \
+    int mc_pad = (mc + tm - 1) / tm * tm;                                       \
+    size_t line = 64 / sizeof(ACC_T);                                           \
+    size_t b_size = ((size_t)kc * nc_pad + line - 1) / line * line;             \
+    size_t a_size = ((size_t)mc_pad * kc + line - 1) / line * line;             \
+    int nthreads = omp_get_max_threads();                                       \
+    ACC_T *Bp = pack_buffers_##TAG(b_size + a_size * nthreads);                 \
+    ACC_T *Ap_all = Bp + b_size;                                                \
+                                                                                \
+    _Pragma("omp parallel")                                                     \
+    {                                                                           \
+        ACC_T *Ap = Ap_all + a_size * omp_get_thread_num();                     \
+                                                                                \
+        for (int jc = 0; jc < n; jc += nc) {                                    \
+            int ncur = (n - jc < nc) ? n - jc : nc;                             \
+            for (int pc = 0; pc < k; pc += kc) {                                \
+                int kcur = (k - pc < kc) ? k - pc : kc;                         \
+                                                                                \
+                _Pragma("omp for schedule(static)")                             \
+                for (int jr = 0; jr < ncur; jr += tn) {                         \
+                    int cols = (ncur - jr < tn) ? ncur - jr : tn;               \
+                    pack_b_sliver_##TAG(&B[(size_t)pc * ldb + jc + jr],         \
+                                        &Bp[(size_t)jr * kcur], kcur, cols, ldb, tn); \
+                }                                                               \
+                                                                                \
+                _Pragma("omp for schedule(static)")                             \
+                for (int ic = 0; ic < m; ic += mc) {                            \
+                    int mcur = (m - ic < mc) ? m - ic : mc;                     \
+                    pack_a_##TAG(&A[(size_t)ic * lda + pc], Ap, mcur, kcur, lda, tm); \
+                                                                                \
+                    for (int jr = 0; jr < ncur; jr += tn) {                     \
+                        int nr = (ncur - jr < tn) ? ncur - jr : tn;             \
+                        for (int ir = 0; ir < mcur; ir += tm) {                 \
+                            int mr = (mcur - ir < tm) ? mcur - ir : tm;         \
+                            uk->run(kcur, &Ap[(size_t)ir * kcur], &Bp[(size_t)jr * kcur], \
+                                    &C[(size_t)(ic + ir) * ldc + jc + jr], ldc, mr, nr, \
+                                    accumulate || pc > 0);                      \
+                        }                                                       \
+                    }                                                           \
+                }                                                               \
+            }                                                                   \
+        }                                                                       \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+/* The square n x n product C = A * B of the matmul_blocked variant */          \
+void matmul_blocked_##TAG(const IN *A, const IN *B, ACC_T *C, int n,            \
+                          const block_params *bp, const gemm_kernel_##ACC *uk) { \
+    gemm_blocked_##TAG(n, n, n, A, n, B, n, C, n, 0, bp, uk);                   \
+}                                                                               \
+                                                                                \
+static void matmul_blocked_portable_##TAG(const void *A, const void *B, void *C, \
+                                          int n, const block_params *bp) {      \
+    matmul_blocked_##TAG(A, B, C, n, bp, &portable_kernel_##ACC);               \
+}                                                                               \
+                                                                                \
+/* The recursion works in ACC_T throughout (the Strassen sums are formed */     \
+/* in it), so narrower inputs are widened into a copy first. IN and ACC_T */    \
+/* are the same type whenever they have the same size. */                     \
+static void matmul_recursive_portable_##TAG(const void *vA, const void *vB,     \
+                                            void *vC, int n,                    \
+                                            const recursive_params *rp) {       \
+    const ACC_T *A = vA, *B = vB;                                               \
+    ACC_T *wide = NULL;                                                         \
+    size_t count = (size_t)n * n;                                               \
+                                                                                \
+    if (sizeof(IN) != sizeof(ACC_T)) {                                          \
+        const IN *inA = vA, *inB = vB;                                          \
+        wide = malloc(2 * count * sizeof(ACC_T));                               \
+        if (!wide) {                                                            \
+            fprintf(stderr, "Memory allocation failed\n");                      \
+            exit(1);                                                            \
+        }                                                                       \
+        _Pragma("omp parallel for")                                             \
+        for (size_t i = 0; i < count; i++) {                                    \
+            wide[i] = (ACC_T)LOAD(inA[i]);                                      \
+            wide[count + i] = (ACC_T)LOAD(inB[i]);                              \
+        }                                                                       \
+        A = wide;                                                               \
+        B = wide + count;                                                       \
+    }                                                                           \
+    matmul_recursive_##ACC(A, B, vC, n, rp, &portable_kernel_##ACC);            \
+    free(wide);                                                                 \
+}                                                                               \
+                                                                                \
+static double get_##TAG(const void *C, size_t i) {                              \
+    return (double)((const ACC_T *)C)[i];                                       \
+}                                                                               \
+                                                                                \
+static double get_input_##TAG(const void *M, size_t i) {                        \
+    return (double)LOAD(((const IN *)M)[i]);                                    \
+}
+
+
+GEMM_TYPE(fp64, double, f64, double, PRECISION_IDENTITY, PRECISION_IDENTITY)
+GEMM_TYPE(fp32, float, f32, float, PRECISION_IDENTITY, PRECISION_IDENTITY)
+#ifdef PRECISION_HAVE_FP16
+GEMM_TYPE(fp16, _Float16, f16, _Float16, PRECISION_IDENTITY, PRECISION_IDENTITY)
+GEMM_TYPE(fp16_fp32, _Float16, f32, float, PRECISION_IDENTITY, PRECISION_IDENTITY)
+#endif
+GEMM_TYPE(bf16_fp32, uint16_t, f32, float, bf16_to_float, bf16_from_float)
+
+
+#define GEMM_TYPE_ENTRY(TAG, NAME, IN, ACC)                                     \
+    { NAME, IN, ACC, initialize_matrix_##TAG, matmul_serial_##TAG,              \
+      matmul_parallel_##TAG, matmul_parallel_collapse_##TAG,                    \
+      matmul_taskloop_##TAG,                                                    \
+      matmul_blocked_portable_##TAG, matmul_recursive_portable_##TAG,           \
+      get_##TAG, get_input_##TAG }
+
+const gemm_type gemm_types[] = {
+    GEMM_TYPE_ENTRY(fp64, "fp64", PREC_FP64, PREC_FP64),
+    GEMM_TYPE_ENTRY(fp32, "fp32", PREC_FP32, PREC_FP32),
+#ifdef PRECISION_HAVE_FP16
+    GEMM_TYPE_ENTRY(fp16, "fp16", PREC_FP16, PREC_FP16),
+    GEMM_TYPE_ENTRY(fp16_fp32, "fp16:fp32", PREC_FP16, PREC_FP32),
+#endif
+    GEMM_TYPE_ENTRY(bf16_fp32, "bf16:fp32", PREC_BF16, PREC_FP32),
+};
+
+const size_t gemm_type_count = sizeof(gemm_types) / sizeof(gemm_types[0]);
+
+// Look up a --type; there is no bf16 arithmetic, so "bf16" means bf16
+// inputs accumulated in fp32
+const gemm_type *gemm_type_select(const char *name) {
+    if (strcmp(name, "bf16") == 0) {
+        name = "bf16:fp32";
+    }
+    for (size_t i = 0; i < gemm_type_count; i++) {
+        if (strcmp(gemm_types[i].name, name) == 0) {
+            return &gemm_types[i];
+        }
+    }
+    fprintf(stderr, "Unknown type: %s (available:", name);
+    for (size_t i = 0; i < gemm_type_count; i++) {
+        fprintf(stderr, " %s", gemm_types[i].name);
+    }
+    fprintf(stderr, ")\n");
+    return NULL;
+}
+
+double gemm_tolerance(precision accumulate, int n) {
+    double u = precision_epsilon(accumulate), worst = 2.0 * n * u;
+    return worst <= GEMM_WORST_CASE_TOL ? worst : 4.0 * sqrt((double)n) * u;
+}
+
+int gemm_sample_reference(const gemm_type *gt, const void *A, const void *B, int n,
+                          size_t count, gemm_sample *sample) {
+    size_t total = (size_t)n * n;
+    uint64_t x = 0x9e3779b97f4a7c15ull;
+
+    if (count > total) {
+        count = total;
+    }
+    sample->count = count;
+    sample->index = malloc(count * sizeof(size_t));
+    sample->value = malloc(count * sizeof(double));
+    if (!sample->index || !sample->value) {
+        return -1;
+    }
+    for (size_t s = 0; s < count; s++) {
+        if (count == total) {
+            sample->index[s] = s;
+            continue;
+        }
+        // The corners cover the partial edge tiles of matmul_blocked and
+        // the recursive leaves; the rest are pseudo-random (xorshift64)
+        switch (s) {
+        case 0: sample->index[s] = 0; break;
+        case 1: sample->index[s] = (size_t)n - 1; break;
+        case 2: sample->index[s] = total - n; break;
+        case 3: sample->index[s] = total - 1; break;
+        default:
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            sample->index[s] = x % total;
+        }
+    }
+
+    #pragma omp parallel for
+    for (size_t s = 0; s < count; s++) {
+        size_t i = sample->index[s] / n, j = sample->index[s] % n;
+        double sum = 0.0;
+        for (int k = 0; k < n; k++) {
+            sum += gt->get_input(A, i * n + k) * gt->get_input(B, (size_t)k * n + j);
+        }
+        sample->value[s] = sum;
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * Matrix multiplication kernels, shared by matmul.c, the bench driver and
+ * the distributed summa.c
+ *
+ * Each --type is a gemm_type: the element type of A and B, the type C is
+ * accumulated in, and one function per variant. The kernels themselves
+ * are generated once per type in gemm_kernels.c.
+ */
+
+#ifndef GEMM_KERNELS_H
+#define GEMM_KERNELS_H
+
+#include <stddef.h>
+#include "precision.h"
+
+// Default cache blocking for matmul_blocked; override with --mc/--kc/--nc.
+// A KC x NR sliver of B should stay in L1, an MC x KC block of A in L2 and
+// the KC x NC panel of B in the last-level cache.
+#ifndef BLOCK_MC
+#define BLOCK_MC 128
+#endif
+#ifndef BLOCK_KC
+#define BLOCK_KC 256
+#endif
+#ifndef BLOCK_NC
+#define BLOCK_NC 4096
+#endif
+
+// Register tile of the portable micro-kernel: MR rows x NR columns of C
+#define MR 4
+#define NR 8
+
+typedef struct {
+    int mc;
+    int kc;
+    int nc;
+} block_params;
+
+// Base-case size and Strassen threshold of matmul_recursive (--base and
+// --strassen); strassen 0 disables the Strassen step
+#ifndef RECURSIVE_BASE
+#define RECURSIVE_BASE 128
+#endif
+
+typedef struct {
+    int base;
+    int strassen;
+} recursive_params;
+
+// A micro-kernel computes C[0:mr, 0:nr] (+)= Ap * Bp for one register tile
+// of up to tile_m x tile_n elements, where Ap holds tile_m-row slivers and
+// Bp tile_n-column slivers of the packed panels. tile_n may be chosen at
+// run time (the RVV kernel uses the hardware vector length). There is one
+// kernel type per accumulation type ACC (f64, f32, f16).
+#define GEMM_KERNEL_TYPE(ACC, T)                                                \
+typedef struct {                                                                \
+    const char *name;                                                           \
+    int tile_m;                                                                 \
+    int tile_n;                                                                 \
+    void (*run)(int kc, const T *restrict Ap, const T *restrict Bp,             \
+                T *restrict C, int ldc, int mr, int nr, int accumulate);        \
+} gemm_kernel_##ACC;
+
+GEMM_KERNEL_TYPE(f64, double)
+GEMM_KERNEL_TYPE(f32, float)
+#ifdef PRECISION_HAVE_FP16
+GEMM_KERNEL_TYPE(f16, _Float16)
+#endif
+
+// Name of the portable MR x NR micro-kernel, for the results record
+#define GEMM_PORTABLE_NAME "portable 4x8"
+
+// One --type: the element type of A and B and the type C is accumulated in
+typedef struct {
+    const char *name;
+    precision input;
+    precision accumulate;
+    void (*init)(void *matrix, int n, int seed);
+    void (*serial)(const void *A, const void *B, void *C, int n);
+    void (*parallel)(const void *A, const void *B, void *C, int n);
+    void (*collapse)(const void *A, const void *B, void *C, int n);
+    void (*taskloop)(const void *A, const void *B, void *C, int n, int grainsize);
+    void (*blocked)(const void *A, const void *B, void *C, int n, const block_params *bp);
+    void (*recursive)(const void *A, const void *B, void *C, int n,
+                      const recursive_params *rp);
+    double (*get)(const void *C, size_t i);
+    double (*get_input)(const void *M, size_t i);
+} gemm_type;
+
+// All types built in, in --help order
+extern const gemm_type gemm_types[];
+extern const size_t gemm_type_count;
+
+// Look up a --type ("bf16" is "bf16:fp32"); prints the choices and
+// returns NULL if name is unknown
+const gemm_type *gemm_type_select(const char *name);
+
+// The portable fp64 micro-kernel, and the blocked multiplication of
+// matmul_blocked generalized to C[0:m, 0:n] (+)= A[0:m, 0:k] * B[0:k, 0:n]
+// with leading dimensions, for the local blocks of the distributed matmul
+// (summa.c). accumulate adds to C instead of overwriting it. The pack
+// buffers are allocated on the first call and reused, so calls must not
+// run concurrently.
+const gemm_kernel_f64 *gemm_portable_kernel(void);
+void gemm_blocked_fp64(int m, int n, int k, const double *A, int lda, const double *B,
+                       int ldb, double *C, int ldc, int accumulate, const block_params *bp,
+                       const gemm_kernel_f64 *uk);
+
+#ifdef __riscv_vector
+// RVV fp64 micro-kernel (tile width from VLEN) and the blocked driver that
+// it plugs into
+const gemm_kernel_f64 *gemm_rvv_kernel(void);
+void matmul_blocked_fp64(const double *A, const double *B, double *C, int n,
+                         const block_params *bp, const gemm_kernel_f64 *uk);
+#endif
+
+// Relative tolerance for checking an n x n product accumulated in
+// accumulate against the exact one or another variant's result. The
+// worst-case bound 2*n*u (u the unit roundoff) is used while it is below
+// GEMM_WORST_CASE_TOL. Beyond that it would reach 1 for fp16 at n = 1024
+// and pass even an all-zero C, so the probabilistic bound 4*sqrt(n)*u of
+// independently rounded sums takes over (fp16 errors reach about half of
+// it at n = 1024, as the non-negative test matrices round one way).
+#define GEMM_WORST_CASE_TOL 0.01
+double gemm_tolerance(precision accumulate, int n);
+
+// Tolerances from this on cannot tell a wrong product from rounding
+#define GEMM_WEAK_TOL 0.1
+
+// A few entries of C recomputed from the inputs with fp64 accumulation:
+// O(n) per entry instead of an O(n^3) reference multiplication
+typedef struct {
+    size_t count;
+    size_t *index;
+    double *value;
+} gemm_sample;
+
+// Fill sample with up to count entries: the four corners (which cover the
+// partial edge tiles) and pseudo-random ones from a fixed seed, or all of
+// C if it has no more than count. Returns -1 if allocation fails.
+int gemm_sample_reference(const gemm_type *gt, const void *A, const void *B, int n,
+                          size_t count, gemm_sample *sample);
+
+#endif
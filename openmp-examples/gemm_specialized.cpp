@@ -0,0 +1,115 @@
+/*
+ * Compile-time specialized matrix multiplication; see gemm_specialized.h.
+ *
+ * Built without exceptions or RTTI and using nothing from the C++ library,
+ * so the C drivers link it with the C compiler.
+ */
+
+// precision.h is a C header without extern "C" of its own
+extern "C" {
+#include "precision.h"
+}
+#include "gemm_specialized.h"
+
+
+// Row update of one cache tile: c[j0:j1] += a * b[j0:j1], UNROLL columns
+// per step. With ALIGNED both rows start on GEMM_ALIGN bytes at j0.
+template <typename T, int UNROLL, bool ALIGNED>
+static inline void axpy_row(T *__restrict__ c, const T *__restrict__ b, T a, int j0, int j1) {
+    if (ALIGNED) {
+        c = static_cast<T *>(__builtin_assume_aligned(c + j0, GEMM_ALIGN)) - j0;
+        b = static_cast<const T *>(__builtin_assume_aligned(b + j0, GEMM_ALIGN)) - j0;
+    }
+    int j = j0;
+    for (; j + UNROLL <= j1; j += UNROLL) {
+        for (int u = 0; u < UNROLL; u++) {
+            c[j + u] += a * b[j + u];
+        }
+    }
+    for (; j < j1; j++) {
+        c[j] += a * b[j];
+    }
+}
+
+// C = A * B, tiled over i, k and j with TILE x TILE tiles and threads
+// over row tiles. N > 0 fixes the size at compile time: when N is a
+// multiple of TILE every tile is full, so all trip counts are constants
+// and the remainder loops disappear. N == 0 takes the size from n.
+template <typename T, int N, int TILE, int UNROLL, bool ALIGNED>
+static void gemm_tiled(const void *vA, const void *vB, void *vC, int n_arg) {
+    static_assert(TILE % UNROLL == 0, "the tile must be a multiple of the unroll factor");
+    static_assert(!ALIGNED || TILE * sizeof(T) % GEMM_ALIGN == 0,
+                  "aligned tiles must start on GEMM_ALIGN bytes");
+    constexpr bool full_tiles = N > 0 && N % TILE == 0;
+    const int n = N > 0 ? N : n_arg;
+    const T *__restrict__ A = static_cast<const T *>(vA);
+    const T *__restrict__ B = static_cast<const T *>(vB);
+    T *__restrict__ C = static_cast<T *>(vC);
+
+    #pragma omp parallel for schedule(static)
+    for (int ii = 0; ii < n; ii += TILE) {
+        const int i1 = full_tiles || ii + TILE < n ? ii + TILE : n;
+        for (int i = ii; i < i1; i++) {
+            for (int j = 0; j < n; j++) {
+                C[(size_t)i * n + j] = 0;
+            }
+        }
+        for (int kk = 0; kk < n; kk += TILE) {
+            const int k1 = full_tiles || kk + TILE < n ? kk + TILE : n;
+            // A TILE x TILE tile of B stays in cache across the rows of C
+            for (int jj = 0; jj < n; jj += TILE) {
+                const int j1 = full_tiles || jj + TILE < n ? jj + TILE : n;
+                for (int i = ii; i < i1; i++) {
+                    T *c = C + (size_t)i * n;
+                    for (int k = kk; k < k1; k++) {
+                        axpy_row<T, UNROLL, ALIGNED>(c, B + (size_t)k * n,
+                                                     A[(size_t)i * n + k], jj, j1);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// One table entry. The unroll factor is one 64-byte line of C: 8 fp64 or
+// 16 fp32 columns.
+#define SPECIALIZE(T, TYPE, N, NNAME, TILE, UNROLL, ALIGNED, ANAME)             \
+    { "n=" NNAME " tile=" #TILE " unroll=" #UNROLL " " ANAME, TYPE, N, TILE,    \
+      UNROLL, ALIGNED, gemm_tiled<T, N, TILE, UNROLL, ALIGNED> }
+
+#define SPECIALIZE_TYPE(T, TYPE, UNROLL)                                        \
+    SPECIALIZE(T, TYPE, 512, "512", 64, UNROLL, true, "aligned"),               \
+    SPECIALIZE(T, TYPE, 1024, "1024", 64, UNROLL, true, "aligned"),             \
+    SPECIALIZE(T, TYPE, 2048, "2048", 64, UNROLL, true, "aligned"),             \
+    SPECIALIZE(T, TYPE, 0, "any", 64, UNROLL, true, "aligned"),                 \
+    SPECIALIZE(T, TYPE, 0, "any", 64, UNROLL, false, "unaligned")
+
+extern "C" {
+
+const gemm_specialization gemm_specializations[] = {
+    SPECIALIZE_TYPE(double, PREC_FP64, 8),
+    SPECIALIZE_TYPE(float, PREC_FP32, 16),
+};
+
+const size_t gemm_specialization_count =
+    sizeof(gemm_specializations) / sizeof(gemm_specializations[0]);
+
+const gemm_specialization *gemm_specialized_select(precision input, precision accumulate,
+                                                   int n, int aligned) {
+    if (input != accumulate) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < gemm_specialization_count; i++) {
+        const gemm_specialization *s = &gemm_specializations[i];
+        if (s->type != input || (s->n != 0 && s->n != n)) {
+            continue;
+        }
+        if (s->aligned && (!aligned || (size_t)n * precision_size(input) % GEMM_ALIGN != 0)) {
+            continue;
+        }
+        return s;
+    }
+    return nullptr;
+}
+
+}
@@ -0,0 +1,54 @@
+/*
+ * Compile-time specialized matrix multiplication (gemm_specialized.cpp)
+ *
+ * The C kernels of gemm_kernels.c take the size, the register tile and the
+ * unrolling as run-time values, so the compiler cannot specialize their
+ * loops. This C++ layer instantiates one tiled i-k-j multiplication per
+ * element type, matrix size, tile size, unroll factor and alignment
+ * guarantee; with the size and tile fixed, every trip count is a constant
+ * and the inner loops are unrolled and vectorized without remainders.
+ *
+ * The table holds instantiations for the sizes of the matmul-512,
+ * matmul-1024 and matmul-2048 builds plus a fallback for any size, for
+ * the fp64 and fp32 types (A, B and C of one type). gemm_specialized_select
+ * picks one at run time, so one binary covers all of them.
+ */
+
+#ifndef GEMM_SPECIALIZED_H
+#define GEMM_SPECIALIZED_H
+
+#include "precision.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Alignment in bytes that the aligned instantiations assume of A, B and C
+#define GEMM_ALIGN 64
+
+typedef struct {
+    const char *name;       // e.g. "n=1024 tile=64 unroll=8 aligned"
+    precision type;         // of A, B and C
+    int n;                  // matrix size, or 0 for any size
+    int tile;               // rows, columns and depth of one cache tile
+    int unroll;             // columns of C per unrolled step
+    int aligned;            // A, B, C and their rows on GEMM_ALIGN bytes
+    void (*run)(const void *A, const void *B, void *C, int n);
+} gemm_specialization;
+
+// All instantiations, most specialized first
+extern const gemm_specialization gemm_specializations[];
+extern const size_t gemm_specialization_count;
+
+// The most specialized instantiation for an n x n multiplication of type
+// (inputs and accumulation both of that type), or NULL if there is none.
+// aligned says that A, B and C start on GEMM_ALIGN-byte boundaries; the
+// aligned instantiations also need rows of a multiple of GEMM_ALIGN bytes.
+const gemm_specialization *gemm_specialized_select(precision input, precision accumulate,
+                                                   int n, int aligned);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -8,9 +8,22 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
+#include <string.h>
 #include <math.h>
+#include <getopt.h>
 #include <omp.h>
+#include "affinity.h"
+#include "timer.h"
+#include "report.h"
+#include "stats.h"
+#include "counters.h"
+#include "energy.h"
+#include "precision.h"
+#include "schedule.h"
+#include "tune.h"
+#include "pages.h"
+#include "gemm_kernels.h"
+#include "gemm_specialized.h"
 
 #ifndef MATRIX_SIZE
 #define MATRIX_SIZE 1024
@@ -18,84 +31,779 @@
 
 #define ITERATIONS 5
 
-// Function to get wall-clock time in seconds
+// Entries of C checked by --verify sample, besides the four corners
+#ifndef VERIFY_SAMPLES
+#define VERIFY_SAMPLES 4096
+#endif
+
+// Rows of C per task in matmul_taskloop (--grainsize); 0 lets the runtime
+// choose the number of tasks
+static int taskloop_grainsize = 0;
+
+// Instantiation of the C++ kernel layer for this type and size, or NULL
+static const gemm_specialization *specialized = NULL;
+
+// Page size of the matrices (--pages); see common/pages.h
+static page_mode pages = PAGES_DEFAULT;
+
+// Matrices start on PAGES_ALIGN bytes, a multiple of GEMM_ALIGN, so the
+// aligned instantiations of gemm_specialized.h apply whenever a row is a
+// multiple of it. They are faulted in here, as initialize_matrix is serial
+// and the results are first written inside the timed runs.
+static void *alloc_matrix(size_t bytes) {
+    void *p = pages_alloc(bytes, pages);
+    if (p) {
+        pages_prefault(p, bytes);
+    }
+    return p;
+}
+
+// Function to get wall-clock time in seconds (timer chosen with --timer)
 double get_time() {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return ts.tv_sec + ts.tv_nsec * 1e-9;
+    return timer_seconds();
+}
+
+// Theoretical peak as derived in analysis/flops_analysis.md:
+// cores x frequency x FLOP/cycle, where one FMA per cycle gives 2 FLOP per
+// lane and an RVV build has VLEN/SEW lanes of the accumulation type.
+static int default_flops_per_cycle(precision acc) {
+#ifdef __riscv_vector
+    return 2 * (int)(__riscv_vsetvlmax_e8m1() / precision_size(acc));
+#else
+    (void)acc;
+    return 2;
+#endif
 }
 
-// Initialize matrix with values
-void initialize_matrix(double *matrix, int n, int seed) {
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < n; j++) {
-            matrix[i * n + j] = (double)((i + j + seed) % 100) / 10.0;
+// Maximum CPU frequency in GHz from cpufreq, or 0 if it is not exposed
+static double detect_freq_ghz(void) {
+    FILE *f = fopen("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq", "r");
+    long khz = 0;
+    if (f) {
+        if (fscanf(f, "%ld", &khz) != 1) {
+            khz = 0;
         }
+        fclose(f);
     }
+    return khz / 1e6;
 }
 
-// Serial matrix multiplication
-void matmul_serial(double *A, double *B, double *C, int n) {
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < n; j++) {
-            double sum = 0.0;
-            for (int k = 0; k < n; k++) {
-                sum += A[i * n + k] * B[k * n + j];
-            }
-            C[i * n + j] = sum;
+// Verify results (compare two matrices). The tolerance is relative to the
+// larger of |C1| and 1; a non-finite element (fp16 overflow) is an error.
+// The count is a parallel reduction; only a failing check walks the
+// matrices again, serially, to print the first errors.
+static int element_error(double v1, double v2, double tolerance) {
+    return !isfinite(v1) || !isfinite(v2) || fabs(v1 - v2) > tolerance * fmax(fabs(v1), 1.0);
+}
+
+int verify_results(const gemm_type *gt, const void *C1, const void *C2, int n,
+                   double tolerance) {
+    size_t count = (size_t)n * n;
+    int errors = 0;
+
+    #pragma omp parallel for reduction(+:errors)
+    for (size_t i = 0; i < count; i++) {
+        errors += element_error(gt->get(C1, i), gt->get(C2, i), tolerance);
+    }
+
+    int shown = 0;
+    for (size_t i = 0; i < count && shown < errors && shown < 5; i++) {
+        double v1 = gt->get(C1, i), v2 = gt->get(C2, i);
+        if (element_error(v1, v2, tolerance)) {  // Print first 5 errors
+            shown++;
+            printf("  Error at index %zu: %.6f != %.6f (diff: %.6e)\n",
+                   i, v1, v2, fabs(v1 - v2));
         }
     }
+    return errors;
 }
 
-// Parallel matrix multiplication using OpenMP
-void matmul_parallel(double *A, double *B, double *C, int n) {
-    #pragma omp parallel for
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < n; j++) {
-            double sum = 0.0;
-            for (int k = 0; k < n; k++) {
-                sum += A[i * n + k] * B[k * n + j];
+static int verify_sampled(const gemm_type *gt, const gemm_sample *sample, const void *C,
+                          double tolerance) {
+    int errors = 0;
+    for (size_t s = 0; s < sample->count; s++) {
+        double ref = sample->value[s], v = gt->get(C, sample->index[s]);
+        if (element_error(ref, v, tolerance)) {
+            errors++;
+            if (errors <= 5) {  // Print first 5 errors
+                printf("  Error at index %zu: %.6f != %.6f (diff: %.6e)\n",
+                       sample->index[s], ref, v, fabs(ref - v));
             }
-            C[i * n + j] = sum;
         }
     }
+    return errors;
+}
+
+// Check one variant against the serial result, or against the sample
+static int verify_variant(const char *label, const gemm_type *gt, const void *C_serial,
+                          const gemm_sample *sample, const void *C, int n,
+                          double tolerance) {
+    int errors;
+
+    if (sample) {
+        printf("Comparing %s vs fp64 reference (%zu entries):\n", label, sample->count);
+        errors = verify_sampled(gt, sample, C, tolerance);
+    } else {
+        printf("Comparing %s vs serial:\n", label);
+        errors = verify_results(gt, C_serial, C, n, tolerance);
+    }
+    if (errors == 0) {
+        printf("  Verification: PASSED\n");
+    } else {
+        printf("  Verification: FAILED (%d errors)\n", errors);
+    }
+    return errors;
+}
+
+// The timed versions after the serial one, in output order; --variants
+// selects a subset (the serial run is controlled by --serial-runs)
+enum {
+    VARIANT_PARALLEL,
+    VARIANT_COLLAPSE,
+    VARIANT_TASKLOOP,
+    VARIANT_BLOCKED,
+    VARIANT_RECURSIVE,
+    VARIANT_SPECIALIZED,
+#ifdef __riscv_vector
+    VARIANT_BLOCKED_RVV,
+#endif
+    NUM_VARIANTS
+};
+
+static const struct {
+    const char *name;       // --variants, counter region and verification label
+    const char *title;      // "Running ..." line
+    const char *label;      // summary tables
+    const char *kernel;     // report kernel, if not name
+} variants[NUM_VARIANTS] = {
+    { "parallel",    "parallel version",                      "Parallel:",            NULL },
+    { "collapse",    "parallel version with collapse(2)",     "Parallel (collapse):", NULL },
+    { "taskloop",    "taskloop version",                      "Taskloop:",            NULL },
+    { "blocked",     "blocked version",                       "Blocked:",             NULL },
+    { "recursive",   "recursive version",                     "Recursive:",           NULL },
+    { "specialized", "compile-time specialized version",      "Specialized:",         NULL },
+#ifdef __riscv_vector
+    { "blocked-rvv", "blocked version with RVV micro-kernel", "Blocked (RVV):",       "blocked" },
+#endif
+};
+
+// Tolerance factor for the recursive variant with a Strassen step. Its
+// error bound is normwise only (the quadrant sums can cancel), so there is
+// no componentwise 2*n*u; in practice one step stays well within 8 times it.
+#define STRASSEN_TOLERANCE 8.0
+
+// Parse a comma-separated --variants list into enabled[]
+static int parse_variants(const char *list, int *enabled) {
+    char buf[256];
+    int any = 0;
+
+    if (strlen(list) >= sizeof(buf)) {
+        return -1;
+    }
+    strcpy(buf, list);
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+        enabled[v] = 0;
+    }
+    for (char *tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+        int v = 0;
+        while (v < NUM_VARIANTS && strcmp(tok, variants[v].name) != 0) {
+            v++;
+        }
+        if (v == NUM_VARIANTS) {
+            return -1;
+        }
+        enabled[v] = 1;
+        any = 1;
+    }
+    return any ? 0 : -1;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  --type TYPE            input type, or input:accumulate type, of the\n");
+    fprintf(stderr, "                         matrices:");
+    for (size_t i = 0; i < gemm_type_count; i++) {
+        fprintf(stderr, " %s", gemm_types[i].name);
+    }
+    fprintf(stderr, "\n                         (default fp64)\n");
+    fprintf(stderr, "  --size N               matrix dimension (default %d)\n", MATRIX_SIZE);
+    fprintf(stderr, "  --variants LIST        versions to time besides serial, from\n");
+    fprintf(stderr, "                        ");
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+        fprintf(stderr, "%s%s", v ? "," : " ", variants[v].name);
+    }
+    fprintf(stderr, " (default all)\n");
+    fprintf(stderr, "  --serial-runs N        timed runs of the serial version, 0 to %d; the\n", ITERATIONS);
+    fprintf(stderr, "                         first is the full reference (default 1)\n");
+    fprintf(stderr, "  --verify MODE          full: compare every element with the serial\n");
+    fprintf(stderr, "                         result; sample: %d entries against an fp64\n", VERIFY_SAMPLES + 4);
+    fprintf(stderr, "                         dot product, for sizes where the serial run is\n");
+    fprintf(stderr, "                         too slow (default full)\n");
+    fprintf(stderr, "  --schedule KIND[,N]    schedule of the parallel and collapse versions:\n");
+    fprintf(stderr, "                         static, dynamic, guided or auto, with an optional\n");
+    fprintf(stderr, "                         chunk size (default static or OMP_SCHEDULE)\n");
+    fprintf(stderr, "  --grainsize N          rows per task of the taskloop version\n");
+    fprintf(stderr, "                         (default: chosen by the runtime)\n");
+    fprintf(stderr, "  --mc N                 rows of A per L2 block in matmul_blocked (default %d)\n", BLOCK_MC);
+    fprintf(stderr, "  --kc N                 depth of the packed L1 panels (default %d)\n", BLOCK_KC);
+    fprintf(stderr, "  --nc N                 columns of B per packed panel (default %d)\n", BLOCK_NC);
+    fprintf(stderr, "  --base N               largest block the recursive version hands to the\n");
+    fprintf(stderr, "                         micro-kernel (default %d)\n", RECURSIVE_BASE);
+    fprintf(stderr, "  --strassen N           one Strassen step in the recursive version for\n");
+    fprintf(stderr, "                         even sizes of at least N (default 0: never)\n");
+    fprintf(stderr, "  --autotune[=SEARCH]    search MC/KC/NC and the recursion base at this\n");
+    fprintf(stderr, "                         size by grid or halving (default halving), store\n");
+    fprintf(stderr, "                         the winners in the tuning profile and run with them\n");
+    fprintf(stderr, "  --profile FILE         tuning profile to load at startup and --autotune\n");
+    fprintf(stderr, "                         into, or none (default $BENCH_TUNE_PROFILE or\n");
+    fprintf(stderr, "                         ~/.config/riscv-hpc-bench/tune.profile)\n");
+    fprintf(stderr, "  --pages MODE           pages of the matrices: default, 4k, 2m (THP) or 1g\n");
+    fprintf(stderr, "                         (hugetlbfs); see common/pages.h (default default)\n");
+    fprintf(stderr, "  --bind SPEC            pin threads: none, compact, spread or a CPU list\n");
+    fprintf(stderr, "                         such as 0,2,4-7 (default none)\n");
+    fprintf(stderr, "  --timer NAME           monotonic-raw, monotonic, gettimeofday, rdtime\n");
+    fprintf(stderr, "                         or rdcycle (default monotonic-raw)\n");
+    fprintf(stderr, "  --freq GHZ             core frequency for the theoretical peak\n");
+    fprintf(stderr, "                         (default: cpufreq maximum, if available)\n");
+    fprintf(stderr, "  --flops-per-cycle N    per-core FLOP/cycle in the accumulation type\n");
+    fprintf(stderr, "                         (default %d for fp64)\n", default_flops_per_cycle(PREC_FP64));
+    fprintf(stderr, "  --counters LIST        count hardware events per variant and thread:\n");
+    fprintf(stderr, "                         default or e.g. cycles,instructions,cache-misses\n");
+    fprintf(stderr, "  --energy[=LIST]        joules, watts and GFLOPS per watt of each variant\n");
+    fprintf(stderr, "                         from auto, rapl, hwmon or sensor paths, interval=MS\n");
+    fprintf(stderr, "                         (default auto; see common/energy.h)\n");
+    fprintf(stderr, "  --format FMT           also write a text, json or csv record (default text)\n");
+    fprintf(stderr, "  --output FILE          write the record to FILE instead of stdout\n");
+    fprintf(stderr, "  --help                 show this message\n");
 }
 
-// Parallel matrix multiplication with loop collapse
-void matmul_parallel_collapse(double *A, double *B, double *C, int n) {
-    #pragma omp parallel for collapse(2)
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < n; j++) {
-            double sum = 0.0;
-            for (int k = 0; k < n; k++) {
-                sum += A[i * n + k] * B[k * n + j];
+static int parse_positive(const char *arg, int *value) {
+    char *end;
+    long v = strtol(arg, &end, 10);
+    if (end == arg || *end != '\0' || v <= 0 || v > 1 << 20) {
+        return -1;
+    }
+    *value = (int)v;
+    return 0;
+}
+
+typedef struct {
+    double freq_ghz;
+    int flops_per_cycle;
+} peak_params;
+
+typedef struct {
+    int serial_runs;
+    int sampled;
+} verify_params;
+
+typedef struct {
+    int autotune;
+    tune_strategy strategy;
+} tune_config;
+
+static void parse_args(int argc, char *argv[], int *n, const gemm_type **gt,
+                       block_params *bp, recursive_params *rp, peak_params *pp,
+                       verify_params *vp, schedule_config *sched, tune_config *tc,
+                       int *enabled, affinity_config *bind, report_format *fmt,
+                       const char **out_path) {
+    static const struct option long_options[] = {
+        {"type",            required_argument, NULL, 'y'},
+        {"size",            required_argument, NULL, 'n'},
+        {"variants",        required_argument, NULL, 'V'},
+        {"serial-runs",     required_argument, NULL, 's'},
+        {"schedule",        required_argument, NULL, 'S'},
+        {"grainsize",       required_argument, NULL, 'g'},
+        {"verify",          required_argument, NULL, 'v'},
+        {"mc",              required_argument, NULL, 'm'},
+        {"kc",              required_argument, NULL, 'k'},
+        {"nc",              required_argument, NULL, 'c'},
+        {"base",            required_argument, NULL, 'r'},
+        {"strassen",        required_argument, NULL, 'x'},
+        {"autotune",        optional_argument, NULL, 'A'},
+        {"profile",         required_argument, NULL, 'P'},
+        {"freq",            required_argument, NULL, 'f'},
+        {"flops-per-cycle", required_argument, NULL, 'p'},
+        {"pages",           required_argument, NULL, 'G'},
+        {"bind",            required_argument, NULL, 'b'},
+        {"timer",           required_argument, NULL, 't'},
+        {"counters",        required_argument, NULL, 'e'},
+        {"energy",          optional_argument, NULL, 'E'},
+        {"format",          required_argument, NULL, 'F'},
+        {"output",          required_argument, NULL, 'o'},
+        {"help",            no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'y':
+            *gt = gemm_type_select(optarg);
+            if (!*gt) {
+                exit(1);
+            }
+            break;
+        case 'n':
+            // i * n + j indexing stays within int
+            if (parse_positive(optarg, n) != 0 || *n > 32768) {
+                fprintf(stderr, "Invalid matrix size: %s (1 to 32768)\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'V':
+            if (parse_variants(optarg, enabled) != 0) {
+                fprintf(stderr, "Invalid variant list: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 's': {
+            char *end;
+            long v = strtol(optarg, &end, 10);
+            if (end == optarg || *end != '\0' || v < 0 || v > ITERATIONS) {
+                fprintf(stderr, "Invalid serial run count: %s (0 to %d)\n", optarg, ITERATIONS);
+                exit(1);
+            }
+            vp->serial_runs = (int)v;
+            break;
+        }
+        case 'S':
+            if (schedule_parse(optarg, sched) != 0) {
+                fprintf(stderr, "Invalid schedule: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'g':
+            if (parse_positive(optarg, &taskloop_grainsize) != 0) {
+                fprintf(stderr, "Invalid grain size: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'v':
+            if (strcmp(optarg, "full") == 0) {
+                vp->sampled = 0;
+            } else if (strcmp(optarg, "sample") == 0) {
+                vp->sampled = 1;
+            } else {
+                fprintf(stderr, "Unknown verification mode: %s (full or sample)\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'm':
+        case 'k':
+        case 'c': {
+            int *field = (opt == 'm') ? &bp->mc : (opt == 'k') ? &bp->kc : &bp->nc;
+            if (parse_positive(optarg, field) != 0) {
+                fprintf(stderr, "Invalid block size: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        }
+        case 'r':
+            if (parse_positive(optarg, &rp->base) != 0 || rp->base > 2048) {
+                fprintf(stderr, "Invalid base size: %s (1 to 2048)\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'x': {
+            char *end;
+            long v = strtol(optarg, &end, 10);
+            if (end == optarg || *end != '\0' || v < 0 || v > 1 << 20) {
+                fprintf(stderr, "Invalid Strassen threshold: %s\n", optarg);
+                exit(1);
+            }
+            rp->strassen = (int)v;
+            break;
+        }
+        case 'A':
+            tc->autotune = 1;
+            if (optarg && tune_parse_strategy(optarg, &tc->strategy) != 0) {
+                fprintf(stderr, "Unknown search: %s (grid or halving)\n", optarg);
+                exit(1);
             }
-            C[i * n + j] = sum;
+            break;
+        case 'P':
+            tune_set_profile(optarg);
+            break;
+        case 'f': {
+            char *end;
+            pp->freq_ghz = strtod(optarg, &end);
+            if (end == optarg || *end != '\0' || pp->freq_ghz <= 0.0) {
+                fprintf(stderr, "Invalid frequency: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        }
+        case 'p':
+            if (parse_positive(optarg, &pp->flops_per_cycle) != 0) {
+                fprintf(stderr, "Invalid FLOP/cycle: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'G':
+            if (pages_parse(optarg, &pages) != 0) {
+                fprintf(stderr, "Invalid pages: %s (default, 4k, 2m or 1g)\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'b':
+            if (affinity_parse(optarg, bind) != 0) {
+                fprintf(stderr, "Invalid binding: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 't':
+            if (timer_select(optarg) != 0) {
+                exit(1);
+            }
+            break;
+        case 'e':
+            if (counters_parse(optarg) != 0) {
+                fprintf(stderr, "Invalid counter list: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'E':
+            if (energy_parse(optarg != NULL ? optarg : "auto") != 0) {
+                fprintf(stderr, "Invalid energy sensor list: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'F':
+            if (report_parse_format(optarg, fmt) != 0) {
+                fprintf(stderr, "Unknown format: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'o':
+            *out_path = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            usage(argv[0]);
+            exit(1);
         }
     }
+    if (vp->serial_runs == 0 && !vp->sampled) {
+        fprintf(stderr, "--serial-runs 0 needs --verify sample\n");
+        exit(1);
+    }
+    if (tc->autotune && (bp->mc || bp->kc || bp->nc || rp->base)) {
+        fprintf(stderr, "--autotune searches the block sizes; drop --mc, --kc, --nc and --base\n");
+        exit(1);
+    }
 }
 
-// Verify results (compare two matrices)
-int verify_results(double *C1, double *C2, int n, double tolerance) {
-    int errors = 0;
-    for (int i = 0; i < n * n; i++) {
-        if (fabs(C1[i] - C2[i]) > tolerance) {
-            errors++;
-            if (errors <= 5) {  // Print first 5 errors
-                printf("  Error at index %d: %.6f != %.6f (diff: %.6e)\n", 
-                       i, C1[i], C2[i], fabs(C1[i] - C2[i]));
+// Size class of the profile entries: the largest power of two up to n.
+// --autotune caps its candidates at n, so winners at one size need not
+// suit a much larger one; within a class they at most double.
+static int size_class(int n) {
+    int c = 1;
+    while (c <= n / 2) {
+        c *= 2;
+    }
+    return c;
+}
+
+// Profile entries, per --type and size class
+static void profile_key(char *buf, size_t len, const gemm_type *gt, int n, const char *param) {
+    snprintf(buf, len, "matmul.%s.n%d.%s", gt->name, size_class(n), param);
+}
+
+// Fill the block sizes not given on the command line from the tuning
+// profile, then from the defaults. Returns 1 if the profile supplied any.
+static int load_profile(const gemm_type *gt, int n, block_params *bp, recursive_params *rp) {
+    char key[64], value[64];
+    int mc, kc, nc, base, loaded = 0;
+
+    profile_key(key, sizeof(key), gt, n, "blocking");
+    if (tune_get(key, value, sizeof(value)) == 0 &&
+        sscanf(value, "%d,%d,%d", &mc, &kc, &nc) == 3 && mc > 0 && kc > 0 && nc > 0) {
+        loaded |= !bp->mc || !bp->kc || !bp->nc;
+        bp->mc = bp->mc ? bp->mc : mc;
+        bp->kc = bp->kc ? bp->kc : kc;
+        bp->nc = bp->nc ? bp->nc : nc;
+    }
+    profile_key(key, sizeof(key), gt, n, "recursive_base");
+    if (!rp->base && tune_get(key, value, sizeof(value)) == 0 &&
+        sscanf(value, "%d", &base) == 1 && base > 0 && base <= 2048) {
+        rp->base = base;
+        loaded = 1;
+    }
+    bp->mc = bp->mc ? bp->mc : BLOCK_MC;
+    bp->kc = bp->kc ? bp->kc : BLOCK_KC;
+    bp->nc = bp->nc ? bp->nc : BLOCK_NC;
+    rp->base = rp->base ? rp->base : RECURSIVE_BASE;
+    return loaded;
+}
+
+// Search spaces of --autotune; sizes well beyond n behave like n and are
+// left out
+static const int tune_mc[] = { 32, 64, 128, 256 };
+static const int tune_kc[] = { 64, 128, 256, 512 };
+static const int tune_nc[] = { 256, 1024, 4096 };
+static const int tune_base[] = { 32, 64, 128, 256, 512 };
+#define TUNE_MAX_CANDIDATES 64
+#define TUNE_SHOWN 5
+
+typedef struct {
+    const gemm_type *gt;
+    const void *A, *B;
+    void *C;
+    int n;
+    int blocking;           // 1: block sizes, 0: recursion base
+    block_params bp[TUNE_MAX_CANDIDATES];
+    recursive_params rp[TUNE_MAX_CANDIDATES];
+} tune_context;
+
+static double tune_run(int i, void *arg) {
+    tune_context *ctx = arg;
+    double t = get_time();
+
+    if (ctx->blocking) {
+        ctx->gt->blocked(ctx->A, ctx->B, ctx->C, ctx->n, &ctx->bp[i]);
+    } else {
+        ctx->gt->recursive(ctx->A, ctx->B, ctx->C, ctx->n, &ctx->rp[i]);
+    }
+    return get_time() - t;
+}
+
+static int fits(int size, const int *space, int k, int n) {
+    return k == 0 || space[k - 1] < n || size <= n;
+}
+
+// Print the fastest candidates of a search, best first
+static void print_search(const tune_context *ctx, int ncand, const double *best,
+                         const int *runs) {
+    int order[TUNE_MAX_CANDIDATES];
+    double flops = 2.0 * ctx->n * ctx->n * ctx->n;
+
+    for (int i = 0; i < ncand; i++) {
+        order[i] = i;
+        for (int j = i; j > 0 && best[order[j - 1]] > best[order[j]]; j--) {
+            int t = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = t;
+        }
+    }
+    for (int i = 0; i < ncand && i < TUNE_SHOWN; i++) {
+        int c = order[i];
+        if (ctx->blocking) {
+            printf("  MC=%-4d KC=%-4d NC=%-5d", ctx->bp[c].mc, ctx->bp[c].kc, ctx->bp[c].nc);
+        } else {
+            printf("  base=%-4d              ", ctx->rp[c].base);
+        }
+        printf(" %.6f s  %8.2f GFLOPS  (%d run%s)\n", best[c], flops / best[c] / 1e9,
+               runs[c], runs[c] > 1 ? "s" : "");
+    }
+}
+
+// --autotune: search the block sizes of the blocked version and the base
+// of the recursive one at size n, on matrices of its own initialized like
+// the benchmark's, store the winners and return them in bp and rp
+static void autotune(const gemm_type *gt, int n, tune_strategy strategy, block_params *bp,
+                     recursive_params *rp) {
+    static tune_context ctx;
+    size_t in_bytes = (size_t)n * n * precision_size(gt->input);
+    void *A = alloc_matrix(in_bytes), *B = alloc_matrix(in_bytes);
+    double best[TUNE_MAX_CANDIDATES];
+    int runs[TUNE_MAX_CANDIDATES], ncand = 0, w;
+    char key[64], value[64];
+
+    ctx.gt = gt;
+    ctx.A = A;
+    ctx.B = B;
+    ctx.n = n;
+    ctx.C = alloc_matrix((size_t)n * n * precision_size(gt->accumulate));
+    if (!A || !B || !ctx.C) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    gt->init(A, n, 1);
+    gt->init(B, n, 2);
+    for (int i = 0; i < (int)(sizeof(tune_mc) / sizeof(*tune_mc)); i++) {
+        for (int k = 0; k < (int)(sizeof(tune_kc) / sizeof(*tune_kc)); k++) {
+            for (int j = 0; j < (int)(sizeof(tune_nc) / sizeof(*tune_nc)); j++) {
+                if (fits(tune_mc[i], tune_mc, i, n) && fits(tune_kc[k], tune_kc, k, n) &&
+                    fits(tune_nc[j], tune_nc, j, n)) {
+                    ctx.bp[ncand++] = (block_params){ tune_mc[i], tune_kc[k], tune_nc[j] };
+                }
             }
         }
     }
-    return errors;
+    printf("Autotuning the blocked version (%s search, %d candidates)...\n",
+           tune_strategy_name(strategy), ncand);
+    ctx.blocking = 1;
+    gt->blocked(A, B, ctx.C, n, &ctx.bp[0]);  // warm-up
+    w = tune_search(strategy, ncand, tune_run, &ctx, best, runs);
+    print_search(&ctx, ncand, best, runs);
+    *bp = ctx.bp[w];
+
+    ncand = 0;
+    for (int i = 0; i < (int)(sizeof(tune_base) / sizeof(*tune_base)); i++) {
+        if (fits(tune_base[i], tune_base, i, n)) {
+            ctx.rp[ncand++] = (recursive_params){ tune_base[i], rp->strassen };
+        }
+    }
+    printf("Autotuning the recursive version (%s search, %d candidates)...\n",
+           tune_strategy_name(strategy), ncand);
+    ctx.blocking = 0;
+    w = tune_search(strategy, ncand, tune_run, &ctx, best, runs);
+    print_search(&ctx, ncand, best, runs);
+    rp->base = ctx.rp[w].base;
+    pages_free(ctx.C);
+    pages_free(A);
+    pages_free(B);
+
+    profile_key(key, sizeof(key), gt, n, "blocking");
+    snprintf(value, sizeof(value), "%d,%d,%d", bp->mc, bp->kc, bp->nc);
+    int stored = tune_put(key, value) == 0;
+    profile_key(key, sizeof(key), gt, n, "recursive_base");
+    snprintf(value, sizeof(value), "%d", rp->base);
+    stored = tune_put(key, value) == 0 && stored;
+    if (tune_profile() && stored) {
+        printf("Stored in %s for %s, n %d-%d\n\n", tune_profile(), tune_host(),
+               size_class(n), 2 * size_class(n) - 1);
+    } else {
+        printf("Not stored (--profile none or write error)\n\n");
+    }
+}
+
+// Median GFLOPS with its confidence interval, p5-p95 range, spread and the
+// number of outlying iterations (see stats.h)
+static void print_sustained(const char *label, const double *times, int ntimes,
+                            double flops) {
+    stats_summary st;
+
+    stats_summarize(times, ntimes, &st);
+    printf("  %-19s %.2f GFLOPS [%.2f, %.2f], p5-p95 %.2f-%.2f, stddev %.2f%%, %d outliers\n",
+           label, flops / st.median / 1e9, flops / st.ci_hi / 1e9, flops / st.ci_lo / 1e9,
+           flops / st.p95 / 1e9, flops / st.p5 / 1e9, 100.0 * st.stddev / st.mean,
+           st.outliers);
+}
+
+// Add one variant's per-iteration times to the --format record
+static void report_gemm(const gemm_type *gt, const char *kernel, const char *variant,
+                        const double *times, int ntimes, double best, int n) {
+    double in = precision_size(gt->input), acc = precision_size(gt->accumulate);
+    report_result r;
+
+    memset(&r, 0, sizeof(r));
+    r.kernel = kernel;
+    r.variant = variant;
+    r.working_set = (2.0 * in + acc) * n * n;
+    // Compulsory traffic: A and B read once, C read and written once
+    r.bytes = (2.0 * in + 2.0 * acc) * n * n;
+    r.flops = 2.0 * n * n * n;
+    r.rate = r.flops / best / 1e9;
+    r.unit = "GFLOPS";
+    r.times = times;
+    r.ntimes = ntimes;
+    report_add(&r);
+}
+
+// Run one multiplication of the given variant into C
+static void run_variant(int v, const gemm_type *gt, const void *A, const void *B, void *C,
+                        int n, const block_params *bp, const recursive_params *rp) {
+    switch (v) {
+    case VARIANT_PARALLEL:
+        gt->parallel(A, B, C, n);
+        break;
+    case VARIANT_COLLAPSE:
+        gt->collapse(A, B, C, n);
+        break;
+    case VARIANT_TASKLOOP:
+        gt->taskloop(A, B, C, n, taskloop_grainsize);
+        break;
+    case VARIANT_BLOCKED:
+        gt->blocked(A, B, C, n, bp);
+        break;
+    case VARIANT_RECURSIVE:
+        gt->recursive(A, B, C, n, rp);
+        break;
+    case VARIANT_SPECIALIZED:
+        specialized->run(A, B, C, n);
+        break;
+#ifdef __riscv_vector
+    case VARIANT_BLOCKED_RVV:
+        matmul_blocked_fp64(A, B, C, n, bp, gemm_rvv_kernel());
+        break;
+#endif
+    }
 }
 
 int main(int argc, char *argv[]) {
     int n = MATRIX_SIZE;
-    double *A, *B, *C_serial, *C_parallel, *C_collapse;
+    void *A, *B, *C_serial;
+    void *C[NUM_VARIANTS] = { NULL };
     double start_time, end_time;
-    double serial_time, parallel_time, collapse_time;
-    double min_serial_time = 1e9, min_parallel_time = 1e9, min_collapse_time = 1e9;
+    double serial_time, min_serial_time = 1e9;
+    double serial_times[ITERATIONS];
+    double times[NUM_VARIANTS][ITERATIONS], best[NUM_VARIANTS];
+    int enabled[NUM_VARIANTS];
+    // Zero block sizes come from the tuning profile or the defaults
+    block_params bp = { 0, 0, 0 };
+    recursive_params rp = { 0, 0 };
+    peak_params pp = { 0.0, 0 };
+    verify_params vp = { 1, 0 };
+    schedule_config sched = { 0, SCHED_STATIC, 0 };
+    tune_config tc = { 0, TUNE_HALVING };
+    const char *tuning = "defaults";
+    char sched_name[32];
+    gemm_sample sample = { 0, NULL, NULL };
+    const gemm_type *gt = &gemm_types[0];
+    affinity_config bind = { BIND_NONE };
+    report_format out_format = REPORT_TEXT;
+    const char *out_path = NULL;
+#ifdef __riscv_vector
+    const gemm_kernel_f64 *rvv = gemm_rvv_kernel();
+#endif
+    
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+        enabled[v] = 1;
+        best[v] = 1e9;
+    }
+    parse_args(argc, argv, &n, &gt, &bp, &rp, &pp, &vp, &sched, &tc, enabled, &bind,
+               &out_format, &out_path);
+    if (bp.mc || bp.kc || bp.nc || rp.base) {
+        tuning = "command line";
+    }
+    if (tc.autotune) {
+        tuning = "autotune";
+    } else if (load_profile(gt, n, &bp, &rp)) {
+        tuning = "profile";
+    }
+    schedule_apply(&sched);
+    schedule_name(sched_name, sizeof(sched_name));
+    size_t in_size = precision_size(gt->input), acc_size = precision_size(gt->accumulate);
+    if (pp.flops_per_cycle == 0) {
+        pp.flops_per_cycle = default_flops_per_cycle(gt->accumulate);
+    }
+#ifdef __riscv_vector
+    // The RVV micro-kernel is double precision only
+    int use_rvv = enabled[VARIANT_BLOCKED_RVV] && gt->input == PREC_FP64;
+    enabled[VARIANT_BLOCKED_RVV] = use_rvv;
+#endif
+    // The C++ kernel layer has one-type instantiations only
+    specialized = gemm_specialized_select(gt->input, gt->accumulate, n, 1);
+    enabled[VARIANT_SPECIALIZED] = enabled[VARIANT_SPECIALIZED] && specialized;
+    int runnable = 0;
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+        runnable += enabled[v];
+    }
+    if (!runnable) {
+        fprintf(stderr, "None of the selected variants supports --type %s\n", gt->name);
+        return 1;
+    }
+    int strassen = rp.strassen > 0 && n >= rp.strassen && n % 2 == 0;
+    if (report_open("matmul", out_format, out_path) != 0) {
+        return 1;
+    }
+    if (pp.freq_ghz == 0.0) {
+        pp.freq_ghz = detect_freq_ghz();
+    }
     
     printf("========================================\n");
     printf("OpenMP Matrix Multiplication Benchmark\n");
@@ -109,138 +817,351 @@ int main(int argc, char *argv[]) {
             printf("Number of threads: %d\n", omp_get_num_threads());
         }
     }
+    // Before the binding, so the sampling thread is not pinned with the master
+    if (energy_open() != 0) {
+        return 1;
+    }
+    if (affinity_apply(&bind) != 0) {
+        return 1;
+    }
+    printf("Thread binding: %s\n", affinity_name(&bind));
+    affinity_report(stdout);
+    if (counters_open() != 0) {
+        return 1;
+    }
+    printf("Timer: %s (resolution %.1f ns)\n", timer_name(), timer_resolution() * 1e9);
+    if (tc.autotune) {
+        printf("\n");
+        autotune(gt, n, tc.strategy, &bp, &rp);
+    }
     
+    int nvariants = 0;
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+        nvariants += enabled[v];
+    }
+    size_t matrices = (vp.serial_runs > 0) + nvariants;
     printf("Matrix size: %d x %d\n", n, n);
-    printf("Memory per matrix: %.2f MB\n", (n * n * sizeof(double)) / (1024.0 * 1024.0));
-    printf("Total memory: %.2f MB\n", (4 * n * n * sizeof(double)) / (1024.0 * 1024.0));
-    printf("Iterations: %d\n", ITERATIONS);
+    printf("Element type: %s (%zu-byte inputs, %zu-byte accumulation)\n",
+           gt->name, in_size, acc_size);
+    printf("Memory per matrix: %.2f MB\n", ((double)n * n * in_size) / (1024.0 * 1024.0));
+    printf("Total memory: %.2f MB\n",
+           ((double)n * n * (2 * in_size + matrices * acc_size)) / (1024.0 * 1024.0));
+    printf("Iterations: %d (serial: %d)\n", ITERATIONS, vp.serial_runs);
+    printf("Verification: %s\n", vp.sampled ? "sampled fp64 reference" : "full, against serial");
     printf("Operations per multiplication: %ld (2*n^3)\n", 2L * n * n * n);
+    printf("Variants:");
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+        if (enabled[v]) {
+            printf(" %s", variants[v].name);
+        }
+    }
+    printf("\n");
+    printf("Schedule: %s; taskloop grain size: ", sched_name);
+    if (taskloop_grainsize > 0) {
+        printf("%d rows\n", taskloop_grainsize);
+    } else {
+        printf("runtime default\n");
+    }
+    printf("Blocking: MC=%d, KC=%d, NC=%d, %dx%d register tile\n", bp.mc, bp.kc, bp.nc, MR, NR);
+    printf("Tuning: %s", tuning);
+    if (strcmp(tuning, "profile") == 0) {
+        printf(" (%s, %s, n %d-%d)", tune_profile(), tune_host(),
+               size_class(n), 2 * size_class(n) - 1);
+    }
+    printf("\n");
+    printf("Recursion: base %d", rp.base);
+    if (strassen) {
+        printf(", one Strassen level (n >= %d)\n", rp.strassen);
+    } else {
+        printf(", no Strassen level\n");
+    }
+    if (specialized) {
+        printf("Specialized kernel: %s\n", specialized->name);
+    } else {
+        printf("Specialized kernel: skipped (fp64 and fp32 only)\n");
+    }
+#ifdef __riscv_vector
+    if (use_rvv) {
+        printf("RVV micro-kernel: %dx%d register tile (VLEN=%d bits)\n",
+               rvv->tile_m, rvv->tile_n, (int)__riscv_vsetvlmax_e64m1() * 64);
+    } else {
+        printf("RVV micro-kernel: skipped (fp64 only)\n");
+    }
+#endif
     printf("\n");
     
+    report_param_int("matrix_size", n);
+    report_param_str("type", gt->name);
+    report_param_int("iterations", ITERATIONS);
+    report_param_int("serial_runs", vp.serial_runs);
+    report_param_str("verify", vp.sampled ? "sample" : "full");
+    report_param_str("schedule", sched_name);
+    report_param_int("grainsize", taskloop_grainsize);
+    report_param_int("mc", bp.mc);
+    report_param_int("kc", bp.kc);
+    report_param_int("nc", bp.nc);
+    report_param_int("recursive_base", rp.base);
+    report_param_str("tuning", tuning);
+    report_param_int("strassen", strassen ? rp.strassen : 0);
+    report_param_str("binding", affinity_name(&bind));
+    report_param_num("freq_ghz", pp.freq_ghz);
+    report_param_int("flops_per_cycle", pp.flops_per_cycle);
+    
     // Allocate memory
-    A = (double *)malloc(n * n * sizeof(double));
-    B = (double *)malloc(n * n * sizeof(double));
-    C_serial = (double *)malloc(n * n * sizeof(double));
-    C_parallel = (double *)malloc(n * n * sizeof(double));
-    C_collapse = (double *)malloc(n * n * sizeof(double));
+    A = alloc_matrix((size_t)n * n * in_size);
+    B = alloc_matrix((size_t)n * n * in_size);
+    C_serial = vp.serial_runs > 0 ? alloc_matrix((size_t)n * n * acc_size) : NULL;
     
-    if (!A || !B || !C_serial || !C_parallel || !C_collapse) {
+    if (!A || !B || (vp.serial_runs > 0 && !C_serial)) {
         fprintf(stderr, "Memory allocation failed\n");
         return 1;
     }
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+        if (enabled[v]) {
+            C[v] = alloc_matrix((size_t)n * n * acc_size);
+            if (!C[v]) {
+                fprintf(stderr, "Memory allocation failed\n");
+                return 1;
+            }
+        }
+    }
     
     // Initialize matrices
     printf("Initializing matrices...\n");
-    initialize_matrix(A, n, 1);
-    initialize_matrix(B, n, 2);
+    gt->init(A, n, 1);
+    gt->init(B, n, 2);
+    char page_text[96];
+    pages_describe(A, page_text, sizeof(page_text));
+    printf("Pages: %s requested, %s obtained\n", pages_name(pages), page_text);
+    report_param_str("pages", pages_name(pages));
+    report_param_str("pages_obtained", page_text);
     
-    // Warm-up run
+    // Warm-up run, with the first variant
+    int first = 0;
+    while (!enabled[first]) {
+        first++;
+    }
     printf("Performing warm-up run...\n");
-    matmul_parallel(A, B, C_parallel, n);
+    run_variant(first, gt, A, B, C[first], n, &bp, &rp);
     
-    // Serial execution
-    printf("\nRunning serial version...\n");
-    for (int iter = 0; iter < ITERATIONS; iter++) {
+    // Serial execution; the first run is also the reference for --verify full
+    if (vp.serial_runs > 0) {
+        printf("\nRunning serial version...\n");
+    }
+    // GFLOP of one multiplication, for GFLOPS per watt
+    double gflop = 2.0 * n * n * n / 1e9;
+    int serial_region = counters_region("serial");
+    int serial_energy = energy_region("serial");
+    energy_work(serial_energy, gflop, "GFLOPS");
+    for (int iter = 0; iter < vp.serial_runs; iter++) {
+        energy_begin(serial_energy);
+        counters_begin(serial_region);
         start_time = get_time();
-        matmul_serial(A, B, C_serial, n);
+        gt->serial(A, B, C_serial, n);
         end_time = get_time();
+        counters_end(serial_region);
+        energy_end(serial_energy);
         serial_time = end_time - start_time;
-        
+        serial_times[iter] = serial_time;
+    
         if (serial_time < min_serial_time) {
             min_serial_time = serial_time;
         }
-        
-        printf("  Iteration %d: %.6f seconds (%.2f GFLOPS)\n", 
+    
+        printf("  Iteration %d: %.6f seconds (%.2f GFLOPS)\n",
                iter + 1, serial_time, (2.0 * n * n * n) / serial_time / 1e9);
     }
     
-    // Parallel execution
-    printf("\nRunning parallel version...\n");
-    for (int iter = 0; iter < ITERATIONS; iter++) {
-        start_time = get_time();
-        matmul_parallel(A, B, C_parallel, n);
-        end_time = get_time();
-        parallel_time = end_time - start_time;
-        
-        if (parallel_time < min_parallel_time) {
-            min_parallel_time = parallel_time;
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+        if (!enabled[v]) {
+            continue;
         }
-        
-        printf("  Iteration %d: %.6f seconds (%.2f GFLOPS)\n", 
-               iter + 1, parallel_time, (2.0 * n * n * n) / parallel_time / 1e9);
-    }
+        printf("\nRunning %s...\n", variants[v].title);
+        int region = counters_region(variants[v].name);
+        int energy_id = energy_region(variants[v].name);
+        energy_work(energy_id, gflop, "GFLOPS");
+        for (int iter = 0; iter < ITERATIONS; iter++) {
+            energy_begin(energy_id);
+            counters_begin(region);
+            start_time = get_time();
+            run_variant(v, gt, A, B, C[v], n, &bp, &rp);
+            end_time = get_time();
+            counters_end(region);
+            energy_end(energy_id);
+            times[v][iter] = end_time - start_time;
     
-    // Parallel execution with collapse
-    printf("\nRunning parallel version with collapse(2)...\n");
-    for (int iter = 0; iter < ITERATIONS; iter++) {
-        start_time = get_time();
-        matmul_parallel_collapse(A, B, C_collapse, n);
-        end_time = get_time();
-        collapse_time = end_time - start_time;
-        
-        if (collapse_time < min_collapse_time) {
-            min_collapse_time = collapse_time;
+            if (times[v][iter] < best[v]) {
+                best[v] = times[v][iter];
+            }
+    
+            printf("  Iteration %d: %.6f seconds (%.2f GFLOPS)\n",
+                   iter + 1, times[v][iter], (2.0 * n * n * n) / times[v][iter] / 1e9);
         }
-        
-        printf("  Iteration %d: %.6f seconds (%.2f GFLOPS)\n", 
-               iter + 1, collapse_time, (2.0 * n * n * n) / collapse_time / 1e9);
     }
     
-    // Verify correctness
-    printf("\nVerifying results...\n");
-    
-    printf("Comparing parallel vs serial:\n");
-    int errors_parallel = verify_results(C_serial, C_parallel, n, 1e-6);
-    if (errors_parallel == 0) {
-        printf("  Verification: PASSED\n");
-    } else {
-        printf("  Verification: FAILED (%d errors)\n", errors_parallel);
+    // Verify correctness. Each result differs from the exact product by at
+    // most n*u*|A||B| (u the unit roundoff of the accumulation type), and
+    // all elements are non-negative, so |A||B| is C itself; gemm_tolerance
+    // replaces that bound by a c*sqrt(n)*u one where it becomes useless.
+    // The Strassen step adds and subtracts quadrants before and after the
+    // products, which loosens the bound for the recursive variant.
+    double tolerance = gemm_tolerance(gt->accumulate, n);
+    printf("\nVerifying results (relative tolerance %.1e", tolerance);
+    if (strassen && enabled[VARIANT_RECURSIVE]) {
+        printf(", %.1e with Strassen", STRASSEN_TOLERANCE * tolerance);
+    }
+    printf(")...\n");
+    if (tolerance >= GEMM_WEAK_TOL) {
+        printf("Warning: a tolerance of %.2g cannot tell wrong results from %s rounding;\n"
+               "         use a smaller size or a wider accumulation type\n",
+               tolerance, precision_name(gt->accumulate));
     }
+    report_param_num("verify_tolerance", tolerance);
     
-    printf("Comparing collapse vs serial:\n");
-    int errors_collapse = verify_results(C_serial, C_collapse, n, 1e-6);
-    if (errors_collapse == 0) {
-        printf("  Verification: PASSED\n");
-    } else {
-        printf("  Verification: FAILED (%d errors)\n", errors_collapse);
+    if (vp.sampled && gemm_sample_reference(gt, A, B, n, VERIFY_SAMPLES + 4, &sample) != 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return 1;
+    }
+    const gemm_sample *ref = vp.sampled ? &sample : NULL;
+    int errors = 0;
+    if (vp.sampled && vp.serial_runs > 0) {
+        errors += verify_variant("serial", gt, NULL, ref, C_serial, n, tolerance);
+    }
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+        if (enabled[v]) {
+            double tol = (v == VARIANT_RECURSIVE && strassen) ? STRASSEN_TOLERANCE * tolerance
+                                                             : tolerance;
+            errors += verify_variant(variants[v].name, gt, C_serial, ref, C[v], n, tol);
+        }
     }
+    report_param_str("verification", errors == 0 ? "passed" : "failed");
     
     // Calculate and display performance metrics
     printf("\n========================================\n");
     printf("Performance Results\n");
     printf("========================================\n\n");
     
+    // Strassen performs fewer operations; its rate is in 2*n^3-equivalent
+    // GFLOPS so that the variants compare by time
     double flops = 2.0 * n * n * n;
     
     printf("Best execution times:\n");
-    printf("  Serial:             %.6f seconds\n", min_serial_time);
-    printf("  Parallel:           %.6f seconds\n", min_parallel_time);
-    printf("  Parallel (collapse): %.6f seconds\n", min_collapse_time);
+    if (vp.serial_runs > 0) {
+        printf("  %-19s %.6f seconds\n", "Serial:", min_serial_time);
+    }
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+        if (enabled[v]) {
+            printf("  %-19s %.6f seconds\n", variants[v].label, best[v]);
+        }
+    }
     
     printf("\nPerformance (GFLOPS):\n");
-    printf("  Serial:             %.2f GFLOPS\n", flops / min_serial_time / 1e9);
-    printf("  Parallel:           %.2f GFLOPS\n", flops / min_parallel_time / 1e9);
-    printf("  Parallel (collapse): %.2f GFLOPS\n", flops / min_collapse_time / 1e9);
+    if (vp.serial_runs > 0) {
+        printf("  %-19s %.2f GFLOPS\n", "Serial:", flops / min_serial_time / 1e9);
+    }
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+        if (enabled[v]) {
+            printf("  %-19s %.2f GFLOPS\n", variants[v].label, flops / best[v] / 1e9);
+        }
+    }
     
-    printf("\nSpeedup:\n");
-    printf("  Parallel:           %.2fx\n", min_serial_time / min_parallel_time);
-    printf("  Parallel (collapse): %.2fx\n", min_serial_time / min_collapse_time);
+    printf("\nSustained performance (median, %.0f%% CI of the median):\n",
+           STATS_CONFIDENCE * 100.0);
+    if (vp.serial_runs > 0) {
+        print_sustained("Serial:", serial_times, vp.serial_runs, flops);
+    }
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+        if (enabled[v]) {
+            print_sustained(variants[v].label, times[v], ITERATIONS, flops);
+        }
+    }
     
     int num_threads = omp_get_max_threads();
-    printf("\nParallel Efficiency:\n");
-    printf("  Parallel:           %.2f%%\n", 
-           (min_serial_time / min_parallel_time) / num_threads * 100.0);
-    printf("  Parallel (collapse): %.2f%%\n", 
-           (min_serial_time / min_collapse_time) / num_threads * 100.0);
+    if (vp.serial_runs > 0) {
+        printf("\nSpeedup:\n");
+        for (int v = 0; v < NUM_VARIANTS; v++) {
+            if (enabled[v]) {
+                printf("  %-19s %.2fx\n", variants[v].label, min_serial_time / best[v]);
+            }
+        }
+    
+        printf("\nParallel Efficiency:\n");
+        for (int v = 0; v < NUM_VARIANTS; v++) {
+            if (enabled[v]) {
+                printf("  %-19s %.2f%%\n", variants[v].label,
+                       (min_serial_time / best[v]) / num_threads * 100.0);
+            }
+        }
+    }
+    
+    // Fraction of the theoretical peak; the serial version is compared
+    // against a single core
+    printf("\nFraction of Theoretical Peak:\n");
+    if (pp.freq_ghz > 0.0) {
+        double core_peak = pp.freq_ghz * pp.flops_per_cycle;
+        double peak = core_peak * num_threads;
+        printf("  Peak: %.2f GFLOPS (%d cores x %.2f GHz x %d FLOP/cycle)\n",
+               peak, num_threads, pp.freq_ghz, pp.flops_per_cycle);
+        if (vp.serial_runs > 0) {
+            printf("  %-19s %.2f%%\n", "Serial:", flops / min_serial_time / 1e9 / core_peak * 100.0);
+        }
+        for (int v = 0; v < NUM_VARIANTS; v++) {
+            if (enabled[v]) {
+                printf("  %-19s %.2f%%\n", variants[v].label, flops / best[v] / 1e9 / peak * 100.0);
+            }
+        }
+    } else {
+        printf("  Unknown core frequency; pass --freq GHZ to compute it\n");
+    }
     
     printf("\n========================================\n");
     
+    if (counters_enabled()) {
+        printf("\n");
+        counters_report(stdout);
+        printf("\n========================================\n");
+    }
+    counters_close();
+    if (energy_enabled()) {
+        printf("\n");
+        energy_report(stdout);
+        printf("\n========================================\n");
+    }
+    energy_close();
+    
+    if (vp.serial_runs > 0) {
+        report_gemm(gt, "serial", NULL, serial_times, vp.serial_runs, min_serial_time, n);
+    }
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+        if (!enabled[v]) {
+            continue;
+        }
+        const char *kernel = variants[v].kernel ? variants[v].kernel : variants[v].name;
+        const char *variant = NULL;
+        if (v == VARIANT_BLOCKED) {
+            variant = GEMM_PORTABLE_NAME;
+        } else if (v == VARIANT_RECURSIVE) {
+            variant = strassen ? "strassen" : NULL;
+        } else if (v == VARIANT_SPECIALIZED) {
+            variant = specialized->name;
+#ifdef __riscv_vector
+        } else if (v == VARIANT_BLOCKED_RVV) {
+            variant = rvv->name;
+#endif
+        }
+        report_gemm(gt, kernel, variant, times[v], ITERATIONS, best[v], n);
+    }
+    report_end();
+    
     // Clean up
-    free(A);
-    free(B);
-    free(C_serial);
-    free(C_parallel);
-    free(C_collapse);
+    pages_free(A);
+    pages_free(B);
+    pages_free(C_serial);
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+        pages_free(C[v]);
+    }
+    free(sample.index);
+    free(sample.value);
     
     return 0;
 }
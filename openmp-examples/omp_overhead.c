@@ -0,0 +1,389 @@
+/*
+ * OpenMP Overhead Benchmark
+ *
+ * Measures what the OpenMP runtime costs per construct, in the style of
+ * the EPCC OpenMP microbenchmarks (syncbench).  A reference loop runs a
+ * calibrated delay innerreps times; each test runs the same number of
+ * delays per thread inside the construct under test.  The overhead of
+ * one construct is then
+ *
+ *     (test time - reference time) / innerreps
+ *
+ * with innerreps chosen so one test lasts about --target-us and the
+ * measurement repeated --reps times for the median and its confidence
+ * interval.  A parallel loop chunk needs to run for many times the "for"
+ * or "parallel for" overhead before the runtime cost becomes negligible.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <omp.h>
+#include "affinity.h"
+#include "timer.h"
+#include "report.h"
+#include "stats.h"
+
+#define DEFAULT_DELAY_NS 100
+#define DEFAULT_TARGET_US 1000
+#define DEFAULT_REPS 20
+#define MAX_REPS 1000
+
+typedef struct {
+    const char *name;
+    // Runs innerreps instances of the construct; each thread executes
+    // innerreps delays in total unless per_thread_share is set, in which
+    // case the threads share them (critical sections serialize)
+    void (*run)(long innerreps);
+    int per_thread_share;
+} overhead_test;
+
+// Iterations of the delay loop that take about --delay-ns
+static long delay_length = 1;
+
+// Target of the atomic test
+static long atomic_counter = 0;
+
+// EPCC-style busy delay: a dependent chain the compiler cannot remove
+// because the result is conditionally printed
+static void delay(long length) {
+    double a = 0.0;
+
+    for (long i = 0; i < length; i++) {
+        a += (double)i;
+    }
+    if (a < 0.0) {
+        printf("%f\n", a);
+    }
+}
+
+static void reference(long innerreps) {
+    for (long j = 0; j < innerreps; j++) {
+        delay(delay_length);
+    }
+}
+
+static void test_parallel(long innerreps) {
+    for (long j = 0; j < innerreps; j++) {
+        #pragma omp parallel
+        delay(delay_length);
+    }
+}
+
+static void test_for(long innerreps) {
+    #pragma omp parallel
+    {
+        int nthreads = omp_get_num_threads();
+        for (long j = 0; j < innerreps; j++) {
+            #pragma omp for schedule(static)
+            for (int i = 0; i < nthreads; i++) {
+                delay(delay_length);
+            }
+        }
+    }
+}
+
+static void test_parallel_for(long innerreps) {
+    int nthreads = omp_get_max_threads();
+
+    for (long j = 0; j < innerreps; j++) {
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < nthreads; i++) {
+            delay(delay_length);
+        }
+    }
+}
+
+static void test_barrier(long innerreps) {
+    #pragma omp parallel
+    for (long j = 0; j < innerreps; j++) {
+        delay(delay_length);
+        #pragma omp barrier
+    }
+}
+
+static void test_single(long innerreps) {
+    #pragma omp parallel
+    for (long j = 0; j < innerreps; j++) {
+        #pragma omp single
+        delay(delay_length);
+    }
+}
+
+static void test_critical(long innerreps) {
+    #pragma omp parallel
+    {
+        long share = innerreps / omp_get_num_threads();
+        for (long j = 0; j < share; j++) {
+            #pragma omp critical
+            delay(delay_length);
+        }
+    }
+}
+
+static void test_atomic(long innerreps) {
+    #pragma omp parallel
+    for (long j = 0; j < innerreps; j++) {
+        delay(delay_length);
+        #pragma omp atomic
+        atomic_counter++;
+    }
+}
+
+static void test_reduction(long innerreps) {
+    long sum = 0;
+
+    for (long j = 0; j < innerreps; j++) {
+        #pragma omp parallel reduction(+:sum)
+        {
+            delay(delay_length);
+            sum += 1;
+        }
+    }
+    if (sum < 0) {
+        printf("%ld\n", sum);
+    }
+}
+
+static const overhead_test tests[] = {
+    { "parallel",     test_parallel,     0 },
+    { "for",          test_for,          0 },
+    { "parallel for", test_parallel_for, 0 },
+    { "barrier",      test_barrier,      0 },
+    { "single",       test_single,       0 },
+    { "critical",     test_critical,     1 },
+    { "atomic",       test_atomic,       0 },
+    { "reduction",    test_reduction,    0 },
+};
+
+#define NTESTS ((int)(sizeof(tests) / sizeof(tests[0])))
+
+static double time_run(void (*run)(long), long innerreps) {
+    double start = timer_seconds();
+    run(innerreps);
+    return timer_seconds() - start;
+}
+
+// Iterations of delay() that take delay_ns when called back to back as in
+// reference(). One long chain gives the first estimate; consecutive short
+// delays overlap on an out-of-order core, so the estimate is refined
+// against reference() itself.
+static long calibrate_delay(double delay_ns) {
+    long probe = 1L << 16;
+    double t;
+
+    while ((t = time_run(delay, probe)) < 0.01 && probe < (1L << 40)) {
+        probe *= 2;
+    }
+    delay_length = (long)(delay_ns * 1e-9 / t * probe);
+    for (int pass = 0; pass < 3 && delay_length > 0; pass++) {
+        long calls = (long)(0.01 / (delay_ns * 1e-9)) + 1;
+        t = time_run(reference, calls) / calls;
+        delay_length = (long)(delay_length * delay_ns * 1e-9 / t);
+    }
+    return delay_length > 0 ? delay_length : 1;
+}
+
+typedef struct {
+    double delay_ns;
+    double target_us;
+    int reps;
+    const char *only;       // NULL for all tests
+} overhead_options;
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  --test NAME        run one construct: parallel, for, parallel-for,\n");
+    fprintf(stderr, "                     barrier, single, critical, atomic or reduction\n");
+    fprintf(stderr, "                     (default all)\n");
+    fprintf(stderr, "  --delay-ns N       work per construct instance (default %d)\n",
+            DEFAULT_DELAY_NS);
+    fprintf(stderr, "  --target-us N      approximate duration of one test (default %d)\n",
+            DEFAULT_TARGET_US);
+    fprintf(stderr, "  --reps N           outer repetitions per test (default %d)\n", DEFAULT_REPS);
+    fprintf(stderr, "  --bind SPEC        pin threads: none, compact, spread or a CPU list\n");
+    fprintf(stderr, "                     such as 0,2,4-7 (default none)\n");
+    fprintf(stderr, "  --timer NAME       monotonic-raw, monotonic, gettimeofday, rdtime or\n");
+    fprintf(stderr, "                     rdcycle (default monotonic-raw)\n");
+    fprintf(stderr, "  --format FMT       also write a text, json or csv record (default text)\n");
+    fprintf(stderr, "  --output FILE      write the record to FILE instead of stdout\n");
+    fprintf(stderr, "  --help             show this message\n");
+}
+
+static void parse_args(int argc, char *argv[], overhead_options *oo, affinity_config *bind,
+                       report_format *fmt, const char **out_path) {
+    static const struct option long_options[] = {
+        {"test", required_argument, NULL, 'T'},
+        {"delay-ns", required_argument, NULL, 'd'},
+        {"target-us", required_argument, NULL, 'u'},
+        {"reps", required_argument, NULL, 'r'},
+        {"bind", required_argument, NULL, 'b'},
+        {"timer", required_argument, NULL, 't'},
+        {"format", required_argument, NULL, 'F'},
+        {"output", required_argument, NULL, 'o'},
+        {"help", no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    char *end;
+
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'T': {
+            int found = 0;
+            for (int i = 0; i < NTESTS; i++) {
+                // "parallel-for" is accepted for the name with a space
+                if (strcmp(optarg, tests[i].name) == 0 ||
+                    (strcmp(optarg, "parallel-for") == 0 && strcmp(tests[i].name, "parallel for") == 0)) {
+                    oo->only = tests[i].name;
+                    found = 1;
+                }
+            }
+            if (!found) {
+                fprintf(stderr, "Unknown test: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        }
+        case 'd':
+            oo->delay_ns = strtod(optarg, &end);
+            if (end == optarg || *end != '\0' || oo->delay_ns <= 0.0) {
+                fprintf(stderr, "Invalid delay: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'u':
+            oo->target_us = strtod(optarg, &end);
+            if (end == optarg || *end != '\0' || oo->target_us <= 0.0) {
+                fprintf(stderr, "Invalid target time: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'r':
+            oo->reps = (int)strtol(optarg, &end, 10);
+            if (end == optarg || *end != '\0' || oo->reps < 2 || oo->reps > MAX_REPS) {
+                fprintf(stderr, "Invalid repetitions: %s (2 to %d)\n", optarg, MAX_REPS);
+                exit(1);
+            }
+            break;
+        case 'b':
+            if (affinity_parse(optarg, bind) != 0) {
+                fprintf(stderr, "Invalid binding: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 't':
+            if (timer_select(optarg) != 0) {
+                exit(1);
+            }
+            break;
+        case 'F':
+            if (report_parse_format(optarg, fmt) != 0) {
+                fprintf(stderr, "Unknown format: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'o':
+            *out_path = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+}
+
+// Overhead of one construct in seconds for each of reps repetitions; each
+// repetition is timed against its own reference run so drift in the clock
+// or frequency cancels
+static void measure(const overhead_test *t, long innerreps, int reps, double *overheads) {
+    int nthreads = omp_get_max_threads();
+    long ref_reps = t->per_thread_share ? innerreps / nthreads * nthreads : innerreps;
+
+    // Warm-up run, which also starts the thread pool
+    t->run(innerreps / 10 + 1);
+    for (int r = 0; r < reps; r++) {
+        double ref = time_run(reference, ref_reps);
+        double test = time_run(t->run, innerreps);
+        overheads[r] = (test - ref) / (double)ref_reps;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    overhead_options oo = { DEFAULT_DELAY_NS, DEFAULT_TARGET_US, DEFAULT_REPS, NULL };
+    affinity_config bind = { BIND_NONE };
+    report_format out_format = REPORT_TEXT;
+    const char *out_path = NULL;
+    double overheads[MAX_REPS];
+    char variant[32];
+
+    parse_args(argc, argv, &oo, &bind, &out_format, &out_path);
+    if (report_open("omp_overhead", out_format, out_path) != 0) {
+        return 1;
+    }
+
+    printf("========================================\n");
+    printf("OpenMP Overhead Benchmark\n");
+    printf("========================================\n\n");
+
+    int num_threads = omp_get_max_threads();
+    printf("Number of threads: %d\n", num_threads);
+    if (affinity_apply(&bind) != 0) {
+        return 1;
+    }
+    printf("Thread binding: %s\n", affinity_name(&bind));
+    affinity_report(stdout);
+    printf("Timer: %s (resolution %.1f ns)\n", timer_name(), timer_resolution() * 1e9);
+
+    delay_length = calibrate_delay(oo.delay_ns);
+    double delay_time = time_run(reference, 10000) / 10000;
+    long innerreps = (long)(oo.target_us * 1e-6 / delay_time);
+    if (innerreps < num_threads) {
+        innerreps = num_threads;
+    }
+    printf("Delay: %ld iterations, %.1f ns\n", delay_length, delay_time * 1e9);
+    printf("Inner repetitions: %ld (%.0f us per reference run), outer: %d\n",
+           innerreps, innerreps * delay_time * 1e6, oo.reps);
+
+    report_param_num("delay_ns", delay_time * 1e9);
+    report_param_int("delay_length", delay_length);
+    report_param_int("innerreps", innerreps);
+    report_param_int("reps", oo.reps);
+    report_param_str("binding", affinity_name(&bind));
+
+    printf("\nOverhead per construct (median, %.0f%% CI of the median, p5-p95):\n",
+           STATS_CONFIDENCE * 100.0);
+    printf("Construct       Overhead (us)      CI low     CI high      p5 (us)     p95 (us)   Stddev\n");
+    snprintf(variant, sizeof(variant), "%d threads", num_threads);
+    for (int i = 0; i < NTESTS; i++) {
+        const overhead_test *t = &tests[i];
+        stats_summary st;
+        report_result r;
+
+        if (oo.only && strcmp(oo.only, t->name) != 0) {
+            continue;
+        }
+        measure(t, innerreps, oo.reps, overheads);
+        stats_summarize(overheads, oo.reps, &st);
+        printf("%-14s %14.3f  %10.3f  %10.3f  %11.3f  %11.3f  %6.1f%%\n", t->name,
+               st.median * 1e6, st.ci_lo * 1e6, st.ci_hi * 1e6, st.p5 * 1e6, st.p95 * 1e6,
+               st.mean != 0.0 ? 100.0 * st.stddev / st.mean : 0.0);
+
+        memset(&r, 0, sizeof(r));
+        r.kernel = t->name;
+        r.variant = variant;
+        r.rate = st.median * 1e6;
+        r.unit = "us";
+        r.times = overheads;
+        r.ntimes = oo.reps;
+        report_add(&r);
+    }
+
+    printf("\n========================================\n");
+    report_end();
+    return 0;
+}
@@ -0,0 +1,475 @@
+/*
+ * OpenMP Peak FLOPS Benchmark
+ *
+ * Measures the FPU ceiling of the machine.  Every thread runs a number of
+ * independent multiply-add chains entirely in registers: with one chain
+ * the rate is bounded by FMA latency, and with enough chains to cover
+ * latency x FMA pipes it reaches the throughput limit.  Sweeping the
+ * number of chains shows both, and the resulting FLOP/cycle per core.
+ *
+ * Kernels, each in double (fp64) and single (fp32) precision:
+ *   scalar  one fmadd.d/fmadd.s (or the host's scalar FMA) per chain step
+ *   vector  one vfmacc.vf per chain step on RVV; on other targets a GCC
+ *           vector-extension FMA of the widest native SIMD width
+ *
+ * Every configuration is timed on one thread (per-core) and on all
+ * OpenMP threads (all-core).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <omp.h>
+#include "affinity.h"
+#include "timer.h"
+#include "report.h"
+
+#ifdef __riscv_vector
+#include <riscv_vector.h>
+#endif
+
+// Steps of every chain per timed iteration (override with --steps)
+#ifndef PEAK_STEPS
+#define PEAK_STEPS 20000000L
+#endif
+
+#define ITERATIONS 5
+
+// Keep the scalar chains scalar: without this GCC's SLP vectorizer packs
+// independent chains into vector registers
+#if defined(__GNUC__) && !defined(__clang__)
+#define NO_VECTORIZE __attribute__((optimize("no-tree-vectorize")))
+#else
+#define NO_VECTORIZE
+#endif
+
+// Chain lists: FOR_N(X) expands X(i) for i = 0 .. N-1
+#define FOR_1(X)  X(0)
+#define FOR_2(X)  FOR_1(X) X(1)
+#define FOR_4(X)  FOR_2(X) X(2) X(3)
+#define FOR_8(X)  FOR_4(X) X(4) X(5) X(6) X(7)
+#define FOR_12(X) FOR_8(X) X(8) X(9) X(10) X(11)
+#define FOR_16(X) FOR_12(X) X(12) X(13) X(14) X(15)
+
+typedef double (*chain_fn)(long steps, int seed);
+
+typedef struct {
+    const char *kind;       // "scalar" or "vector"
+    const char *type;       // "fp64" or "fp32"
+    int chains;
+    chain_fn run;
+} chain_kernel;
+
+// Scalar chains: x -> x * mul + add converges to 1.0, so the values stay
+// finite however many steps run, and the multiply depends on the chain so
+// it cannot be hoisted out of the FMA
+#define SCALAR_DECL(i) T a##i = (T)(seed + i);
+#define SCALAR_STEP(i) a##i = a##i * mul + add;
+#define SCALAR_SUM(i)  sum += a##i;
+
+#define SCALAR_KERNEL(TYPE, NAME, N)                                        \
+NO_VECTORIZE static double scalar_##NAME##_##N(long steps, int seed) {     \
+    typedef TYPE T;                                                         \
+    const T mul = (T)0.999999, add = (T)0.000001;                           \
+    double sum = 0.0;                                                       \
+    FOR_##N(SCALAR_DECL)                                                    \
+    for (long s = 0; s < steps; s++) {                                      \
+        FOR_##N(SCALAR_STEP)                                                \
+    }                                                                       \
+    FOR_##N(SCALAR_SUM)                                                     \
+    return sum;                                                             \
+}
+
+#define SCALAR_KERNELS(TYPE, NAME) \
+    SCALAR_KERNEL(TYPE, NAME, 1) SCALAR_KERNEL(TYPE, NAME, 2) SCALAR_KERNEL(TYPE, NAME, 4) \
+    SCALAR_KERNEL(TYPE, NAME, 8) SCALAR_KERNEL(TYPE, NAME, 12) SCALAR_KERNEL(TYPE, NAME, 16)
+
+SCALAR_KERNELS(double, fp64)
+SCALAR_KERNELS(float, fp32)
+
+#ifdef __riscv_vector
+// RVV chains: one LMUL=1 register per chain, acc += k * x with vfmacc.vf.
+// k is small enough that the linear growth stays harmless, and the
+// intrinsic keeps the fused form whatever the compiler knows about x.
+#define VECTOR_DECL(i) VT a##i = VFMV((ET)(seed + i), vl);
+#define VECTOR_STEP(i) a##i = VFMACC(a##i, k, x, vl);
+#define VECTOR_SUM(i)  sum += VFIRST(a##i);
+
+#define VECTOR_KERNEL(NAME, N)                                              \
+static double vector_##NAME##_##N(long steps, int seed) {                  \
+    size_t vl = VSETVLMAX();                                                \
+    const ET k = (ET)1e-9;                                                  \
+    const VT x = VFMV((ET)1.0, vl);                                         \
+    double sum = 0.0;                                                       \
+    FOR_##N(VECTOR_DECL)                                                    \
+    for (long s = 0; s < steps; s++) {                                      \
+        FOR_##N(VECTOR_STEP)                                                \
+    }                                                                       \
+    FOR_##N(VECTOR_SUM)                                                     \
+    return sum;                                                             \
+}
+
+#define VECTOR_KERNELS(NAME) \
+    VECTOR_KERNEL(NAME, 1) VECTOR_KERNEL(NAME, 2) VECTOR_KERNEL(NAME, 4) \
+    VECTOR_KERNEL(NAME, 8) VECTOR_KERNEL(NAME, 12) VECTOR_KERNEL(NAME, 16)
+
+#define ET double
+#define VT vfloat64m1_t
+#define VSETVLMAX() __riscv_vsetvlmax_e64m1()
+#define VFMV __riscv_vfmv_v_f_f64m1
+#define VFMACC __riscv_vfmacc_vf_f64m1
+#define VFIRST __riscv_vfmv_f_s_f64m1_f64
+VECTOR_KERNELS(fp64)
+#undef ET
+#undef VT
+#undef VSETVLMAX
+#undef VFMV
+#undef VFMACC
+#undef VFIRST
+
+#define ET float
+#define VT vfloat32m1_t
+#define VSETVLMAX() __riscv_vsetvlmax_e32m1()
+#define VFMV __riscv_vfmv_v_f_f32m1
+#define VFMACC __riscv_vfmacc_vf_f32m1
+#define VFIRST __riscv_vfmv_f_s_f32m1_f32
+VECTOR_KERNELS(fp32)
+#undef ET
+#undef VT
+#undef VSETVLMAX
+#undef VFMV
+#undef VFMACC
+#undef VFIRST
+
+static int vector_lanes(const char *type) {
+    return strcmp(type, "fp64") == 0 ? (int)__riscv_vsetvlmax_e64m1()
+                                     : (int)__riscv_vsetvlmax_e32m1();
+}
+#else
+// Other targets: GCC vector extensions of the widest native SIMD width,
+// with the same convergent multiply-add as the scalar chains
+#if defined(__AVX512F__)
+#define VEC_BYTES 64
+#elif defined(__AVX__)
+#define VEC_BYTES 32
+#else
+#define VEC_BYTES 16
+#endif
+
+typedef double vec_fp64 __attribute__((vector_size(VEC_BYTES)));
+typedef float vec_fp32 __attribute__((vector_size(VEC_BYTES)));
+
+#define VECTOR_DECL(i) V a##i = (V){0} + (T)(seed + i);
+#define VECTOR_STEP(i) a##i = a##i * mul + add;
+#define VECTOR_SUM(i)  sum += a##i[0];
+
+#define VECTOR_KERNEL(TYPE, NAME, N)                                        \
+static double vector_##NAME##_##N(long steps, int seed) {                  \
+    typedef TYPE T;                                                         \
+    typedef vec_##NAME V;                                                   \
+    const T mul = (T)0.999999, add = (T)0.000001;                           \
+    double sum = 0.0;                                                       \
+    FOR_##N(VECTOR_DECL)                                                    \
+    for (long s = 0; s < steps; s++) {                                      \
+        FOR_##N(VECTOR_STEP)                                                \
+    }                                                                       \
+    FOR_##N(VECTOR_SUM)                                                     \
+    return sum;                                                             \
+}
+
+#define VECTOR_KERNELS(TYPE, NAME) \
+    VECTOR_KERNEL(TYPE, NAME, 1) VECTOR_KERNEL(TYPE, NAME, 2) VECTOR_KERNEL(TYPE, NAME, 4) \
+    VECTOR_KERNEL(TYPE, NAME, 8) VECTOR_KERNEL(TYPE, NAME, 12) VECTOR_KERNEL(TYPE, NAME, 16)
+
+VECTOR_KERNELS(double, fp64)
+VECTOR_KERNELS(float, fp32)
+
+static int vector_lanes(const char *type) {
+    return VEC_BYTES / (strcmp(type, "fp64") == 0 ? 8 : 4);
+}
+#endif
+
+#define KERNEL_ROW(KIND, TYPE) \
+    { #KIND, #TYPE, 1, KIND##_##TYPE##_1 }, { #KIND, #TYPE, 2, KIND##_##TYPE##_2 }, \
+    { #KIND, #TYPE, 4, KIND##_##TYPE##_4 }, { #KIND, #TYPE, 8, KIND##_##TYPE##_8 }, \
+    { #KIND, #TYPE, 12, KIND##_##TYPE##_12 }, { #KIND, #TYPE, 16, KIND##_##TYPE##_16 }
+
+static const chain_kernel kernels[] = {
+    KERNEL_ROW(scalar, fp64),
+    KERNEL_ROW(scalar, fp32),
+    KERNEL_ROW(vector, fp64),
+    KERNEL_ROW(vector, fp32),
+};
+
+#define NKERNELS ((int)(sizeof(kernels) / sizeof(kernels[0])))
+
+// Lanes per FMA instruction of a kernel
+static int kernel_lanes(const chain_kernel *k) {
+    return strcmp(k->kind, "vector") == 0 ? vector_lanes(k->type) : 1;
+}
+
+// Run the chains on nthreads threads; returns a checksum so the work is kept
+static double run_chains(const chain_kernel *k, long steps, int nthreads) {
+    double sum = 0.0;
+
+    #pragma omp parallel num_threads(nthreads) reduction(+:sum)
+    sum += k->run(steps, omp_get_thread_num());
+    return sum;
+}
+
+// Maximum CPU frequency in GHz from cpufreq, or 0 if it is not exposed
+static double detect_freq_ghz(void) {
+    FILE *f = fopen("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq", "r");
+    long khz = 0;
+    if (f) {
+        if (fscanf(f, "%ld", &khz) != 1) {
+            khz = 0;
+        }
+        fclose(f);
+    }
+    return khz / 1e6;
+}
+
+typedef struct {
+    const char *kind;       // NULL for all
+    const char *type;       // NULL for all
+    int chains;             // 0 for all
+    long steps;
+    double freq_ghz;
+} peak_options;
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  --kind KIND        scalar, vector or all (default all)\n");
+    fprintf(stderr, "  --type TYPE        fp64, fp32 or all (default all)\n");
+    fprintf(stderr, "  --chains N         independent chains per thread: 1, 2, 4, 8, 12, 16\n");
+    fprintf(stderr, "                     or all (default all)\n");
+    fprintf(stderr, "  --steps N          steps of every chain per iteration (default %ld)\n",
+            PEAK_STEPS);
+    fprintf(stderr, "  --freq GHZ         core frequency for FLOP/cycle\n");
+    fprintf(stderr, "                     (default: cpufreq maximum, if available)\n");
+    fprintf(stderr, "  --bind SPEC        pin threads: none, compact, spread or a CPU list\n");
+    fprintf(stderr, "                     such as 0,2,4-7 (default none)\n");
+    fprintf(stderr, "  --timer NAME       monotonic-raw, monotonic, gettimeofday, rdtime or\n");
+    fprintf(stderr, "                     rdcycle (default monotonic-raw)\n");
+    fprintf(stderr, "  --format FMT       also write a text, json or csv record (default text)\n");
+    fprintf(stderr, "  --output FILE      write the record to FILE instead of stdout\n");
+    fprintf(stderr, "  --help             show this message\n");
+}
+
+static void parse_args(int argc, char *argv[], peak_options *po, affinity_config *bind,
+                       report_format *fmt, const char **out_path) {
+    static const struct option long_options[] = {
+        {"kind", required_argument, NULL, 'k'},
+        {"type", required_argument, NULL, 'y'},
+        {"chains", required_argument, NULL, 'c'},
+        {"steps", required_argument, NULL, 's'},
+        {"freq", required_argument, NULL, 'f'},
+        {"bind", required_argument, NULL, 'b'},
+        {"timer", required_argument, NULL, 't'},
+        {"format", required_argument, NULL, 'F'},
+        {"output", required_argument, NULL, 'o'},
+        {"help", no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    char *end;
+
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'k':
+            if (strcmp(optarg, "all") == 0) {
+                po->kind = NULL;
+            } else if (strcmp(optarg, "scalar") == 0 || strcmp(optarg, "vector") == 0) {
+                po->kind = optarg;
+            } else {
+                fprintf(stderr, "Unknown kind: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'y':
+            if (strcmp(optarg, "all") == 0) {
+                po->type = NULL;
+            } else if (strcmp(optarg, "fp64") == 0 || strcmp(optarg, "fp32") == 0) {
+                po->type = optarg;
+            } else {
+                fprintf(stderr, "Unknown type: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'c': {
+            // all, or a count that some kernel has
+            int known = strcmp(optarg, "all") == 0;
+            po->chains = 0;
+            if (!known) {
+                long v = strtol(optarg, &end, 10);
+                for (int i = 0; i < NKERNELS && *end == '\0' && end != optarg; i++) {
+                    known = known || kernels[i].chains == v;
+                }
+                po->chains = (int)v;
+            }
+            if (!known) {
+                fprintf(stderr, "Invalid chain count: %s (1, 2, 4, 8, 12, 16 or all)\n", optarg);
+                exit(1);
+            }
+            break;
+        }
+        case 's':
+            po->steps = strtol(optarg, &end, 10);
+            if (end == optarg || *end != '\0' || po->steps <= 0) {
+                fprintf(stderr, "Invalid step count: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'f':
+            po->freq_ghz = strtod(optarg, &end);
+            if (end == optarg || *end != '\0' || po->freq_ghz <= 0.0) {
+                fprintf(stderr, "Invalid frequency: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'b':
+            if (affinity_parse(optarg, bind) != 0) {
+                fprintf(stderr, "Invalid binding: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 't':
+            if (timer_select(optarg) != 0) {
+                exit(1);
+            }
+            break;
+        case 'F':
+            if (report_parse_format(optarg, fmt) != 0) {
+                fprintf(stderr, "Unknown format: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'o':
+            *out_path = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+}
+
+// Best GFLOPS of ITERATIONS runs on nthreads threads; records every
+// iteration in the --format record
+static double measure(const chain_kernel *k, long steps, int nthreads, double *checksum) {
+    double times[ITERATIONS], min_time = 1e9;
+    double flops = 2.0 * kernel_lanes(k) * k->chains * steps * nthreads;
+    char kernel[32], variant[32];
+    report_result r;
+
+    // Warm-up run, which also brings the cores up to speed
+    *checksum += run_chains(k, steps / 10, nthreads);
+    for (int iter = 0; iter < ITERATIONS; iter++) {
+        double start_time = timer_seconds();
+        *checksum += run_chains(k, steps, nthreads);
+        times[iter] = timer_seconds() - start_time;
+        if (times[iter] < min_time) {
+            min_time = times[iter];
+        }
+    }
+
+    snprintf(kernel, sizeof(kernel), "fma-%s-%s", k->kind, k->type);
+    snprintf(variant, sizeof(variant), "%d chains, %d threads", k->chains, nthreads);
+    memset(&r, 0, sizeof(r));
+    r.kernel = kernel;
+    r.variant = variant;
+    r.flops = flops;
+    r.rate = flops / min_time / 1e9;
+    r.unit = "GFLOPS";
+    r.times = times;
+    r.ntimes = ITERATIONS;
+    report_add(&r);
+    return r.rate;
+}
+
+int main(int argc, char *argv[]) {
+    peak_options po = { NULL, NULL, 0, PEAK_STEPS, 0.0 };
+    affinity_config bind = { BIND_NONE };
+    report_format out_format = REPORT_TEXT;
+    const char *out_path = NULL;
+    double checksum = 0.0, best[2][2] = {{0}};
+
+    parse_args(argc, argv, &po, &bind, &out_format, &out_path);
+    if (report_open("peak_flops", out_format, out_path) != 0) {
+        return 1;
+    }
+    if (po.freq_ghz == 0.0) {
+        po.freq_ghz = detect_freq_ghz();
+    }
+
+    printf("========================================\n");
+    printf("OpenMP Peak FLOPS Benchmark\n");
+    printf("========================================\n\n");
+
+    int num_threads = omp_get_max_threads();
+    printf("Number of threads: %d\n", num_threads);
+    if (affinity_apply(&bind) != 0) {
+        return 1;
+    }
+    printf("Thread binding: %s\n", affinity_name(&bind));
+    affinity_report(stdout);
+    printf("Timer: %s (resolution %.1f ns)\n", timer_name(), timer_resolution() * 1e9);
+#ifdef __riscv_vector
+    printf("Vector kernels: RVV vfmacc.vf, LMUL=1 (VLEN=%d bits)\n",
+           (int)__riscv_vsetvlmax_e64m1() * 64);
+#else
+    printf("Vector kernels: %d-byte GCC vector extension\n", VEC_BYTES);
+#endif
+    printf("Steps per chain: %ld, iterations: %d\n", po.steps, ITERATIONS);
+    if (po.freq_ghz > 0.0) {
+        printf("Core frequency: %.2f GHz\n", po.freq_ghz);
+    } else {
+        printf("Core frequency: unknown (pass --freq GHZ for FLOP/cycle)\n");
+    }
+
+    report_param_int("steps", po.steps);
+    report_param_int("iterations", ITERATIONS);
+    report_param_str("binding", affinity_name(&bind));
+    report_param_num("freq_ghz", po.freq_ghz);
+
+    printf("\nKind    Type  Lanes  Chains   1-core GFLOPS  FLOP/cycle  All-core GFLOPS\n");
+    for (int i = 0; i < NKERNELS; i++) {
+        const chain_kernel *k = &kernels[i];
+        double one, all;
+
+        if ((po.kind && strcmp(po.kind, k->kind) != 0) ||
+            (po.type && strcmp(po.type, k->type) != 0) ||
+            (po.chains && po.chains != k->chains)) {
+            continue;
+        }
+        one = measure(k, po.steps, 1, &checksum);
+        all = num_threads > 1 ? measure(k, po.steps, num_threads, &checksum) : one;
+
+        printf("%-7s %-5s %5d  %6d  %14.2f", k->kind, k->type, kernel_lanes(k), k->chains, one);
+        if (po.freq_ghz > 0.0) {
+            printf("  %10.2f", one / po.freq_ghz);
+        } else {
+            printf("  %10s", "-");
+        }
+        printf("  %15.2f\n", all);
+
+        int ki = strcmp(k->kind, "vector") == 0, ti = strcmp(k->type, "fp32") == 0;
+        if (all > best[ki][ti]) {
+            best[ki][ti] = all;
+        }
+    }
+
+    printf("\nBest all-core GFLOPS over the chain counts:\n");
+    printf("  scalar fp64: %8.2f   scalar fp32: %8.2f\n", best[0][0], best[0][1]);
+    printf("  vector fp64: %8.2f   vector fp32: %8.2f\n", best[1][0], best[1][1]);
+    printf("Checksum: %.6f\n", checksum);
+    printf("\n========================================\n");
+
+    report_end();
+    return 0;
+}
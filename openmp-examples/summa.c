@@ -0,0 +1,609 @@
+/*
+ * Distributed Matrix Multiplication (SUMMA), MPI+OpenMP
+ *
+ * C = A * B for n x n fp64 matrices distributed in blocks over a P x Q
+ * process grid: rank (p, q) holds rows p and columns q of the grid
+ * partition of A, B and C. For each panel of kb columns of A and kb rows
+ * of B, the owners broadcast the A panel along their process row and the
+ * B panel along their process column, and every rank adds the product of
+ * the two panels to its block of C with the blocked kernel of matmul
+ * (gemm_blocked_fp64 with the rank's OpenMP threads).
+ *
+ * By default the broadcasts of the next panel are posted (MPI_Ibcast)
+ * before the current panel is multiplied, and the local multiplication
+ * is split into slices that test the requests in between, so the MPI
+ * library can progress them while the threads compute. --no-overlap waits
+ * for each broadcast before the multiplication, for comparison. Each rank
+ * records how long it waited for broadcasts; the difference between the
+ * two modes, and between the wait time and the run time, shows whether a
+ * configuration is bound by the network or by the local kernel.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <mpi.h>
+#include <omp.h>
+#include "affinity.h"
+#include "timer.h"
+#include "report.h"
+#include "stats.h"
+#include "gemm_kernels.h"
+
+#define SUMMA_SIZE 2048
+#define SUMMA_PANEL 256
+#define SUMMA_REPS 5
+#define MAX_REPS 100
+
+// Slices of the local multiplication, with a test of the pending
+// broadcasts after each one
+#define PROGRESS_SLICES 4
+
+// Entries of C checked on each rank against an fp64 dot product
+#define SAMPLE_COUNT 256
+
+// A panel: kb columns of the global k dimension, owned by one process
+// column for A and one process row for B
+typedef struct {
+    int k0;
+    int width;
+    int a_root;
+    int b_root;
+} summa_panel;
+
+typedef struct {
+    int n;
+    int panel;                  // kb
+    int prows, pcols;           // P x Q, 0 for MPI_Dims_create
+    int reps;
+    int overlap;
+} summa_config;
+
+static int rank = 0, nranks = 1;
+
+// The grid partition: part i of n split into parts holds [lo, hi)
+static void partition(int n, int parts, int i, int *lo, int *hi) {
+    *lo = (int)((long long)n * i / parts);
+    *hi = (int)((long long)n * (i + 1) / parts);
+}
+
+// The part of n split into parts that holds index x
+static int owner(int n, int parts, int x) {
+    int lo, hi;
+
+    for (int i = 0; i < parts - 1; i++) {
+        partition(n, parts, i, &lo, &hi);
+        if (x < hi) {
+            return i;
+        }
+    }
+    return parts - 1;
+}
+
+// The inputs of matmul's initialize_matrix for seeds 1 (A) and 2 (B),
+// as a function of the global indices
+static double input_a(int i, int k) {
+    return (double)((i + k + 1) % 100) / 10.0;
+}
+
+static double input_b(int k, int j) {
+    return (double)((k + j + 2) % 100) / 10.0;
+}
+
+// Split [0, n) into panels of at most kb that never cross the boundary
+// of an A column block or a B row block, so one rank owns each half.
+// Returns the number of panels.
+static int make_panels(int n, int kb, int prows, int pcols, summa_panel *panels) {
+    int count = 0, k0 = 0;
+
+    while (k0 < n) {
+        int qa = owner(n, pcols, k0), pb = owner(n, prows, k0);
+        int lo, a_hi, b_hi, end = k0 + kb < n ? k0 + kb : n;
+
+        partition(n, pcols, qa, &lo, &a_hi);
+        partition(n, prows, pb, &lo, &b_hi);
+        end = end < a_hi ? end : a_hi;
+        end = end < b_hi ? end : b_hi;
+        panels[count].k0 = k0;
+        panels[count].width = end - k0;
+        panels[count].a_root = qa;
+        panels[count].b_root = pb;
+        count++;
+        k0 = end;
+    }
+    return count;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: mpirun [mpi options] %s [options]\n", prog);
+    fprintf(stderr, "  --size N           matrix size (default %d)\n", SUMMA_SIZE);
+    fprintf(stderr, "  --grid PxQ         process grid (default from MPI_Dims_create)\n");
+    fprintf(stderr, "  --panel N          panel width kb (default %d)\n", SUMMA_PANEL);
+    fprintf(stderr, "  --reps N           timed runs, after one warm-up (default %d)\n",
+            SUMMA_REPS);
+    fprintf(stderr, "  --no-overlap       wait for each broadcast before multiplying\n");
+    fprintf(stderr, "  --bind SPEC        pin each rank's threads: none, compact, spread\n");
+    fprintf(stderr, "                     or a CPU list (default none)\n");
+    fprintf(stderr, "  --timer NAME       monotonic-raw, monotonic, gettimeofday, rdtime or\n");
+    fprintf(stderr, "                     rdcycle (default monotonic-raw)\n");
+    fprintf(stderr, "  --format FMT       also write a text, json or csv record (default text)\n");
+    fprintf(stderr, "  --output FILE      write the record to FILE instead of stdout\n");
+    fprintf(stderr, "  --help             show this message\n");
+}
+
+static int parse_int(const char *arg, int min, int max, int *value) {
+    char *end;
+    long v = strtol(arg, &end, 10);
+
+    if (end == arg || *end != '\0' || v < min || v > max) {
+        return -1;
+    }
+    *value = (int)v;
+    return 0;
+}
+
+// Every rank parses the same arguments, so any of them may abort
+static void parse_args(int argc, char *argv[], summa_config *cfg, affinity_config *bind,
+                       report_format *fmt, const char **out_path) {
+    static const struct option long_options[] = {
+        {"size", required_argument, NULL, 'n'},
+        {"grid", required_argument, NULL, 'g'},
+        {"panel", required_argument, NULL, 'k'},
+        {"reps", required_argument, NULL, 'r'},
+        {"no-overlap", no_argument, NULL, 'N'},
+        {"bind", required_argument, NULL, 'b'},
+        {"timer", required_argument, NULL, 't'},
+        {"format", required_argument, NULL, 'F'},
+        {"output", required_argument, NULL, 'o'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'n':
+            if (parse_int(optarg, 1, 1 << 20, &cfg->n) != 0) {
+                fprintf(stderr, "Invalid matrix size: %s\n", optarg);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            break;
+        case 'g':
+            if (sscanf(optarg, "%dx%d", &cfg->prows, &cfg->pcols) != 2 ||
+                cfg->prows < 1 || cfg->pcols < 1) {
+                fprintf(stderr, "Invalid grid: %s (expected PxQ)\n", optarg);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            break;
+        case 'k':
+            if (parse_int(optarg, 1, 1 << 16, &cfg->panel) != 0) {
+                fprintf(stderr, "Invalid panel width: %s\n", optarg);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            break;
+        case 'r':
+            if (parse_int(optarg, 1, MAX_REPS, &cfg->reps) != 0) {
+                fprintf(stderr, "Invalid repetition count: %s (1 to %d)\n", optarg, MAX_REPS);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            break;
+        case 'N':
+            cfg->overlap = 0;
+            break;
+        case 'b':
+            if (affinity_parse(optarg, bind) != 0) {
+                fprintf(stderr, "Invalid binding: %s\n", optarg);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            break;
+        case 't':
+            if (timer_select(optarg) != 0) {
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            break;
+        case 'F':
+            if (report_parse_format(optarg, fmt) != 0) {
+                fprintf(stderr, "Unknown format: %s\n", optarg);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            break;
+        case 'o':
+            *out_path = optarg;
+            break;
+        case 'h':
+            if (rank == 0) {
+                usage(argv[0]);
+            }
+            MPI_Finalize();
+            exit(0);
+        default:
+            if (rank == 0) {
+                usage(argv[0]);
+            }
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+}
+
+// One rank's share of the computation and its buffers
+typedef struct {
+    int myrow, mycol;
+    int row_lo, row_hi;         // rows of A and C
+    int col_lo, col_hi;         // columns of B and C
+    int k_row_lo, k_row_hi;     // rows of B (k range of the process row)
+    int k_col_lo, k_col_hi;     // columns of A (k range of the process column)
+    int m, nl;                  // local C is m x nl
+    double *A, *B, *C;          // local blocks, row-major
+    double *Abuf[2], *Bbuf[2];  // received panels, double-buffered
+    const double *Bpanel[2];    // B panel in use: Bbuf or the local block
+    MPI_Comm row_comm, col_comm;
+    MPI_Request req[2][2];
+    double wait_time;
+} summa_rank;
+
+// Post the broadcasts of panel pn into buffer set s
+static void start_panel(summa_rank *sr, const summa_panel *pn, int s) {
+    int w = pn->width;
+    double *Ab = sr->Abuf[s];
+
+    if (sr->mycol == pn->a_root) {
+        int off = pn->k0 - sr->k_col_lo, lda = sr->k_col_hi - sr->k_col_lo;
+        for (int i = 0; i < sr->m; i++) {
+            memcpy(&Ab[(size_t)i * w], &sr->A[(size_t)i * lda + off], w * sizeof(double));
+        }
+    }
+    // B rows are contiguous, so the owner broadcasts straight from its block
+    if (sr->myrow == pn->b_root) {
+        sr->Bpanel[s] = sr->B + (size_t)(pn->k0 - sr->k_row_lo) * sr->nl;
+    } else {
+        sr->Bpanel[s] = sr->Bbuf[s];
+    }
+    MPI_Ibcast(Ab, sr->m * w, MPI_DOUBLE, pn->a_root, sr->row_comm, &sr->req[s][0]);
+    MPI_Ibcast((void *)sr->Bpanel[s], w * sr->nl, MPI_DOUBLE, pn->b_root, sr->col_comm,
+               &sr->req[s][1]);
+}
+
+static void wait_panel(summa_rank *sr, int s) {
+    double t = timer_seconds();
+
+    MPI_Waitall(2, sr->req[s], MPI_STATUSES_IGNORE);
+    sr->wait_time += timer_seconds() - t;
+}
+
+// C = A * B over all panels
+static void summa(summa_rank *sr, const summa_panel *panels, int npanels,
+                  const summa_config *cfg, const block_params *bp,
+                  const gemm_kernel_f64 *uk) {
+    sr->wait_time = 0.0;
+    if (cfg->overlap) {
+        start_panel(sr, &panels[0], 0);
+    }
+    for (int p = 0; p < npanels; p++) {
+        int s = p % 2, w = panels[p].width;
+
+        if (cfg->overlap) {
+            wait_panel(sr, s);
+            if (p + 1 < npanels) {
+                start_panel(sr, &panels[p + 1], 1 - s);
+            }
+        } else {
+            start_panel(sr, &panels[p], s);
+            wait_panel(sr, s);
+        }
+        if (sr->m == 0 || sr->nl == 0) {
+            continue;
+        }
+        // Slices of rows of C, testing the next panel's broadcasts between
+        // them so that the library can progress them
+        for (int sl = 0; sl < PROGRESS_SLICES; sl++) {
+            int lo = (int)((long long)sr->m * sl / PROGRESS_SLICES);
+            int hi = (int)((long long)sr->m * (sl + 1) / PROGRESS_SLICES);
+            int done;
+
+            if (hi > lo) {
+                gemm_blocked_fp64(hi - lo, sr->nl, w, sr->Abuf[s] + (size_t)lo * w, w,
+                                  sr->Bpanel[s], sr->nl, sr->C + (size_t)lo * sr->nl,
+                                  sr->nl, p > 0, bp, uk);
+            }
+            if (cfg->overlap && p + 1 < npanels) {
+                MPI_Testall(2, sr->req[1 - s], &done, MPI_STATUSES_IGNORE);
+            }
+        }
+    }
+}
+
+// Sampled check of the local block of C: its corners and pseudo-random
+// entries against an fp64 dot product of the inputs. Returns the number
+// of entries outside the relative tolerance.
+static int verify_local(const summa_rank *sr, int n, double tolerance) {
+    uint64_t x = 0x9e3779b97f4a7c15ull + (uint64_t)rank;
+    size_t total = (size_t)sr->m * sr->nl;
+    int bad = 0;
+
+    if (total == 0) {
+        return 0;
+    }
+    for (int s = 0; s < SAMPLE_COUNT; s++) {
+        size_t idx;
+        double ref = 0.0, got;
+
+        switch (s) {
+        case 0: idx = 0; break;
+        case 1: idx = (size_t)sr->nl - 1; break;
+        case 2: idx = total - sr->nl; break;
+        case 3: idx = total - 1; break;
+        default:
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            idx = x % total;
+        }
+        int i = sr->row_lo + (int)(idx / sr->nl), j = sr->col_lo + (int)(idx % sr->nl);
+        for (int k = 0; k < n; k++) {
+            ref += input_a(i, k) * input_b(k, j);
+        }
+        got = sr->C[idx];
+        if (fabs(got - ref) > tolerance * fabs(ref)) {
+            if (bad == 0) {
+                fprintf(stderr, "Rank %d: C[%d][%d] = %f, expected %f\n", rank, i, j, got, ref);
+            }
+            bad++;
+        }
+    }
+    return bad;
+}
+
+int main(int argc, char *argv[]) {
+    summa_config cfg = { SUMMA_SIZE, SUMMA_PANEL, 0, 0, SUMMA_REPS, 1 };
+    block_params bp = { BLOCK_MC, BLOCK_KC, BLOCK_NC };
+    affinity_config bind = { BIND_NONE };
+    report_format out_format = REPORT_TEXT;
+    const char *out_path = NULL;
+    const gemm_kernel_f64 *uk = gemm_portable_kernel();
+    summa_rank sr;
+    summa_panel *panels;
+    int provided, npanels, dims[2] = {0, 0}, periods[2] = {0, 0}, coords[2];
+    double times[MAX_REPS], waits[MAX_REPS], run_max[MAX_REPS], wait_max[MAX_REPS];
+    double best = DBL_MAX, best_wait = 0.0, local_flops, flops, tolerance;
+    int bad, total_bad = 0;
+    MPI_Comm grid;
+    report_result r;
+
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nranks);
+    parse_args(argc, argv, &cfg, &bind, &out_format, &out_path);
+    if (provided < MPI_THREAD_FUNNELED && rank == 0) {
+        fprintf(stderr, "Warning: the MPI library does not support MPI_THREAD_FUNNELED\n");
+    }
+    if (report_open("summa", rank == 0 ? out_format : REPORT_TEXT, out_path) != 0) {
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+#ifdef __riscv_vector
+    uk = gemm_rvv_kernel();
+#endif
+
+    if (cfg.prows > 0) {
+        if (cfg.prows * cfg.pcols != nranks) {
+            if (rank == 0) {
+                fprintf(stderr, "Grid %dx%d does not match %d ranks\n", cfg.prows, cfg.pcols,
+                        nranks);
+            }
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        dims[0] = cfg.prows;
+        dims[1] = cfg.pcols;
+    }
+    MPI_Dims_create(nranks, 2, dims);
+    cfg.prows = dims[0];
+    cfg.pcols = dims[1];
+    if (cfg.prows > cfg.n || cfg.pcols > cfg.n) {
+        if (rank == 0) {
+            fprintf(stderr, "Grid %dx%d is larger than the matrix\n", cfg.prows, cfg.pcols);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Cart_create(MPI_COMM_WORLD, 2, dims, periods, 0, &grid);
+    MPI_Comm_rank(grid, &rank);
+    MPI_Cart_coords(grid, rank, 2, coords);
+    memset(&sr, 0, sizeof(sr));
+    sr.myrow = coords[0];
+    sr.mycol = coords[1];
+    MPI_Comm_split(grid, sr.myrow, sr.mycol, &sr.row_comm);
+    MPI_Comm_split(grid, sr.mycol, sr.myrow, &sr.col_comm);
+
+    partition(cfg.n, cfg.prows, sr.myrow, &sr.row_lo, &sr.row_hi);
+    partition(cfg.n, cfg.pcols, sr.mycol, &sr.col_lo, &sr.col_hi);
+    partition(cfg.n, cfg.prows, sr.myrow, &sr.k_row_lo, &sr.k_row_hi);
+    partition(cfg.n, cfg.pcols, sr.mycol, &sr.k_col_lo, &sr.k_col_hi);
+    sr.m = sr.row_hi - sr.row_lo;
+    sr.nl = sr.col_hi - sr.col_lo;
+
+    panels = malloc(((size_t)cfg.n / cfg.panel + cfg.prows + cfg.pcols + 1) * sizeof(*panels));
+    if (!panels) {
+        fprintf(stderr, "Memory allocation failed\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    npanels = make_panels(cfg.n, cfg.panel, cfg.prows, cfg.pcols, panels);
+
+    {
+        size_t a_count = (size_t)sr.m * (sr.k_col_hi - sr.k_col_lo);
+        size_t b_count = (size_t)(sr.k_row_hi - sr.k_row_lo) * sr.nl;
+        size_t c_count = (size_t)sr.m * sr.nl;
+        size_t pa = (size_t)sr.m * cfg.panel, pb = (size_t)cfg.panel * sr.nl;
+
+        sr.A = malloc((a_count ? a_count : 1) * sizeof(double));
+        sr.B = malloc((b_count ? b_count : 1) * sizeof(double));
+        sr.C = malloc((c_count ? c_count : 1) * sizeof(double));
+        for (int s = 0; s < 2; s++) {
+            sr.Abuf[s] = malloc((pa ? pa : 1) * sizeof(double));
+            sr.Bbuf[s] = malloc((pb ? pb : 1) * sizeof(double));
+        }
+        if (!sr.A || !sr.B || !sr.C || !sr.Abuf[0] || !sr.Abuf[1] || !sr.Bbuf[0] ||
+            !sr.Bbuf[1]) {
+            fprintf(stderr, "Rank %d: memory allocation failed\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    // First touch by the threads that run the kernel
+    #pragma omp parallel for
+    for (int i = 0; i < sr.m; i++) {
+        for (int k = sr.k_col_lo; k < sr.k_col_hi; k++) {
+            sr.A[(size_t)i * (sr.k_col_hi - sr.k_col_lo) + k - sr.k_col_lo] =
+                input_a(sr.row_lo + i, k);
+        }
+        for (int j = 0; j < sr.nl; j++) {
+            sr.C[(size_t)i * sr.nl + j] = 0.0;
+        }
+    }
+    #pragma omp parallel for
+    for (int k = sr.k_row_lo; k < sr.k_row_hi; k++) {
+        for (int j = 0; j < sr.nl; j++) {
+            sr.B[(size_t)(k - sr.k_row_lo) * sr.nl + j] = input_b(k, sr.col_lo + j);
+        }
+    }
+
+    if (affinity_apply(&bind) != 0) {
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (rank == 0) {
+        printf("========================================\n");
+        printf("SUMMA Distributed Matrix Multiplication\n");
+        printf("========================================\n\n");
+        printf("Matrix size: %d x %d (fp64)\n", cfg.n, cfg.n);
+        printf("Process grid: %d x %d, %d thread(s) per rank\n", cfg.prows, cfg.pcols,
+               omp_get_max_threads());
+        printf("Panel width: %d (%d panels), broadcasts %s\n", cfg.panel, npanels,
+               cfg.overlap ? "overlapped with the local kernel" : "not overlapped");
+        printf("Local kernel: blocked %s, MC=%d KC=%d NC=%d\n", uk->name, bp.mc, bp.kc,
+               bp.nc);
+        printf("Thread binding: %s, timer: %s\n", affinity_name(&bind), timer_name());
+        printf("Runs: %d after one warm-up\n\n", cfg.reps);
+    }
+    report_param_int("matrix_size", cfg.n);
+    report_param_int("grid_rows", cfg.prows);
+    report_param_int("grid_cols", cfg.pcols);
+    report_param_int("threads_per_rank", omp_get_max_threads());
+    report_param_int("panel", cfg.panel);
+    report_param_str("overlap", cfg.overlap ? "yes" : "no");
+    report_param_str("kernel", uk->name);
+    report_param_str("binding", affinity_name(&bind));
+
+    // Warm-up, then the timed runs from a common start
+    summa(&sr, panels, npanels, &cfg, &bp, uk);
+    for (int rep = 0; rep < cfg.reps; rep++) {
+        MPI_Barrier(grid);
+        double t = timer_seconds();
+        summa(&sr, panels, npanels, &cfg, &bp, uk);
+        times[rep] = timer_seconds() - t;
+        waits[rep] = sr.wait_time;
+    }
+    MPI_Reduce(times, run_max, cfg.reps, MPI_DOUBLE, MPI_MAX, 0, grid);
+    MPI_Reduce(waits, wait_max, cfg.reps, MPI_DOUBLE, MPI_MAX, 0, grid);
+
+    // An entry is an n-term dot product of positive inputs, so its rounding
+    // error is within about n units of roundoff of the entry
+    tolerance = 2.0 * cfg.n * DBL_EPSILON;
+    bad = verify_local(&sr, cfg.n, tolerance);
+    MPI_Reduce(&bad, &total_bad, 1, MPI_INT, MPI_SUM, 0, grid);
+
+    // Per-rank summary: best run and its broadcast wait, and local GFLOPS
+    flops = 2.0 * cfg.n * (double)cfg.n * cfg.n;
+    local_flops = 2.0 * sr.m * (double)sr.nl * cfg.n;
+    {
+        double mine[3], *all = NULL;
+        int rbest = 0;
+
+        for (int rep = 1; rep < cfg.reps; rep++) {
+            rbest = times[rep] < times[rbest] ? rep : rbest;
+        }
+        mine[0] = times[rbest];
+        mine[1] = waits[rbest];
+        // A rank that waited through (almost) all of the run has no
+        // measurable kernel time: -1, printed as "-"
+        double compute = times[rbest] - waits[rbest];
+        mine[2] = compute > timer_resolution() ? local_flops / compute * 1e-9 : -1.0;
+        if (rank == 0) {
+            all = malloc(3 * sizeof(double) * nranks);
+            if (!all) {
+                fprintf(stderr, "Memory allocation failed\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
+        MPI_Gather(mine, 3, MPI_DOUBLE, all, 3, MPI_DOUBLE, 0, grid);
+        if (rank == 0) {
+            printf("Rank  Grid     Local block     Best time  Bcast wait  Kernel GFLOPS\n");
+            for (int q = 0; q < nranks; q++) {
+                int c[2], rlo, rhi, clo, chi;
+                char block[32];
+
+                MPI_Cart_coords(grid, q, 2, c);
+                partition(cfg.n, cfg.prows, c[0], &rlo, &rhi);
+                partition(cfg.n, cfg.pcols, c[1], &clo, &chi);
+                snprintf(block, sizeof(block), "%d x %d", rhi - rlo, chi - clo);
+                printf("%4d  (%d,%d)  %-14s %10.6f  %9.1f%%  ", q, c[0], c[1], block,
+                       all[3 * q], 100.0 * all[3 * q + 1] / all[3 * q]);
+                if (all[3 * q + 2] >= 0.0) {
+                    printf("%13.2f\n", all[3 * q + 2]);
+                } else {
+                    printf("%13s\n", "-");
+                }
+            }
+            printf("\n");
+            free(all);
+        }
+    }
+
+    if (rank == 0) {
+        stats_summary st;
+
+        for (int rep = 0; rep < cfg.reps; rep++) {
+            if (run_max[rep] < best) {
+                best = run_max[rep];
+                best_wait = wait_max[rep];
+            }
+        }
+        stats_summarize(run_max, cfg.reps, &st);
+        printf("Best time (slowest rank): %.6f seconds\n", best);
+        printf("Aggregate: %.2f GFLOPS (%.2f per rank), median %.2f GFLOPS\n",
+               flops / best * 1e-9, flops / best * 1e-9 / nranks, flops / st.median * 1e-9);
+        printf("Longest broadcast wait:   %.6f seconds (%.1f%% of the run)\n", best_wait,
+               100.0 * best_wait / best);
+        printf("\nVerifying %d entries per rank (relative tolerance %.1e)...\n",
+               SAMPLE_COUNT, tolerance);
+        printf("Verification: %s\n", total_bad == 0 ? "PASSED" : "FAILED");
+        report_param_str("verification", total_bad == 0 ? "passed" : "failed");
+        report_param_num("bcast_wait_fraction", best_wait / best);
+
+        memset(&r, 0, sizeof(r));
+        r.kernel = "summa";
+        r.variant = cfg.overlap ? "overlap" : "blocking";
+        r.working_set = 3.0 * cfg.n * (double)cfg.n * sizeof(double);
+        r.flops = flops;
+        r.rate = flops / best * 1e-9;
+        r.unit = "GFLOPS";
+        r.times = run_max;
+        r.ntimes = cfg.reps;
+        report_add(&r);
+    }
+
+    report_end();
+    free(sr.A);
+    free(sr.B);
+    free(sr.C);
+    for (int s = 0; s < 2; s++) {
+        free(sr.Abuf[s]);
+        free(sr.Bbuf[s]);
+    }
+    free(panels);
+    MPI_Comm_free(&sr.row_comm);
+    MPI_Comm_free(&sr.col_comm);
+    MPI_Comm_free(&grid);
+    MPI_Finalize();
+    return total_bad == 0 ? 0 : 1;
+}
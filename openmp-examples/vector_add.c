@@ -7,51 +7,348 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
+#include <math.h>
+#include <string.h>
+#include <getopt.h>
 #include <omp.h>
+#include "affinity.h"
+#include "timer.h"
+#include "report.h"
+#include "stats.h"
+#include "counters.h"
+#include "energy.h"
+#include "precision.h"
+#include "schedule.h"
+#include "pages.h"
+#include "vector_kernels.h"
 
 #define VECTOR_SIZE 100000000  // 100 million elements
 #define ITERATIONS 10
 
-// Function to get wall-clock time in seconds
+// Scalar of the --fused chain c = s * (a + b) + a; exact in every type
+#define CHAIN_SCALAR 0.5
+
+// Elements per tile of the tiled chain (--tile): the three tiles of a, b
+// and c take 192 KiB in fp64, which an L2 cache holds
+#define CHAIN_TILE 8192
+
+// Elements per task in vector_add_taskloop (--grainsize); 0 lets the
+// runtime choose the number of tasks
+static long taskloop_grainsize = 0;
+
+// --fused: also time the add+axpy chain unfused, fused and tiled
+static int run_fused = 0;
+static size_t chain_tile = CHAIN_TILE;
+
+// Page size of the vectors (--pages); see common/pages.h
+static page_mode pages = PAGES_DEFAULT;
+
+// Function to get wall-clock time in seconds (timer chosen with --timer)
 double get_time() {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return ts.tv_sec + ts.tv_nsec * 1e-9;
+    return timer_seconds();
 }
 
-// Serial vector addition for verification
-void vector_add_serial(double *a, double *b, double *c, size_t n) {
-    for (size_t i = 0; i < n; i++) {
-        c[i] = a[i] + b[i];
+// One vector, faulted in before anything is timed: the serial result is
+// otherwise first written inside the timed serial loop
+static void *alloc_vector(size_t bytes) {
+    void *p = pages_alloc(bytes, pages);
+    if (p) {
+        pages_prefault(p, bytes);
     }
+    return p;
 }
 
-// Parallel vector addition using OpenMP
-void vector_add_parallel(double *a, double *b, double *c, size_t n) {
-    #pragma omp parallel for
-    for (size_t i = 0; i < n; i++) {
-        c[i] = a[i] + b[i];
+// Verify results
+int verify_results(const vector_kernels *vk, const void *c1, const void *c2, size_t n,
+                   double tolerance) {
+    size_t first;
+    size_t errors = vk->compare(c1, c2, n, tolerance, &first);
+    if (errors > 0) {
+        printf("Verification failed at index %zu: %f != %f (%zu errors)\n", first,
+               vk->get(c1, first), vk->get(c2, first), errors);
+        return 0;
     }
+    return 1;
 }
 
-// Verify results
-int verify_results(double *c1, double *c2, size_t n, double tolerance) {
-    for (size_t i = 0; i < n; i++) {
-        if (fabs(c1[i] - c2[i]) > tolerance) {
-            printf("Verification failed at index %zu: %f != %f\n", i, c1[i], c2[i]);
-            return 0;
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  --type TYPE        element type: %s\n", precision_list());
+    fprintf(stderr, "                     (default fp64)\n");
+    fprintf(stderr, "  --schedule KIND[,N] schedule of the parallel version: static, dynamic,\n");
+    fprintf(stderr, "                     guided or auto, with an optional chunk size\n");
+    fprintf(stderr, "                     (default static or OMP_SCHEDULE)\n");
+    fprintf(stderr, "  --grainsize N      elements per task of the taskloop version\n");
+    fprintf(stderr, "                     (default: chosen by the runtime)\n");
+    fprintf(stderr, "  --fused            also time c = s * (a + b) + a as two passes, fused\n");
+    fprintf(stderr, "                     into one, and tiled so each chunk stays in cache\n");
+    fprintf(stderr, "  --tile N           elements per tile of the tiled chain (default %d)\n",
+            CHAIN_TILE);
+    fprintf(stderr, "  --pages MODE       pages of the vectors: default, 4k, 2m (THP) or 1g\n");
+    fprintf(stderr, "                     (hugetlbfs); see common/pages.h (default default)\n");
+    fprintf(stderr, "  --bind SPEC        pin threads: none, compact, spread or a CPU list\n");
+    fprintf(stderr, "                     such as 0,2,4-7 (default none)\n");
+    fprintf(stderr, "  --timer NAME       monotonic-raw, monotonic, gettimeofday, rdtime or\n");
+    fprintf(stderr, "                     rdcycle (default monotonic-raw)\n");
+    fprintf(stderr, "  --counters LIST    count hardware events per version and thread:\n");
+    fprintf(stderr, "                     default or e.g. cycles,instructions,cache-misses\n");
+    fprintf(stderr, "  --energy[=LIST]    joules, watts and GB/s per watt of each version from\n");
+    fprintf(stderr, "                     auto, rapl, hwmon or sensor paths, interval=MS\n");
+    fprintf(stderr, "                     (default auto; see common/energy.h)\n");
+    fprintf(stderr, "  --format FMT       also write a text, json or csv record (default text)\n");
+    fprintf(stderr, "  --output FILE      write the record to FILE instead of stdout\n");
+    fprintf(stderr, "  --help             show this message\n");
+}
+
+static void parse_args(int argc, char *argv[], precision *type, schedule_config *sched,
+                       affinity_config *bind, report_format *fmt, const char **out_path) {
+    static const struct option long_options[] = {
+        {"type", required_argument, NULL, 'y'},
+        {"schedule", required_argument, NULL, 'S'},
+        {"grainsize", required_argument, NULL, 'g'},
+        {"fused", no_argument, NULL, 'u'},
+        {"tile", required_argument, NULL, 'T'},
+        {"pages", required_argument, NULL, 'G'},
+        {"bind", required_argument, NULL, 'b'},
+        {"timer", required_argument, NULL, 't'},
+        {"counters", required_argument, NULL, 'e'},
+        {"energy", optional_argument, NULL, 'E'},
+        {"format", required_argument, NULL, 'F'},
+        {"output", required_argument, NULL, 'o'},
+        {"help", no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'y':
+            if (precision_parse(optarg, type) != 0) {
+                exit(1);
+            }
+            break;
+        case 'S':
+            if (schedule_parse(optarg, sched) != 0) {
+                fprintf(stderr, "Invalid schedule: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'g': {
+            char *end;
+            long v = strtol(optarg, &end, 10);
+            if (end == optarg || *end != '\0' || v <= 0) {
+                fprintf(stderr, "Invalid grain size: %s\n", optarg);
+                exit(1);
+            }
+            taskloop_grainsize = v;
+            break;
+        }
+        case 'u':
+            run_fused = 1;
+            break;
+        case 'G':
+            if (pages_parse(optarg, &pages) != 0) {
+                fprintf(stderr, "Invalid pages: %s (default, 4k, 2m or 1g)\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'T': {
+            char *end;
+            long v = strtol(optarg, &end, 10);
+            if (end == optarg || *end != '\0' || v <= 0) {
+                fprintf(stderr, "Invalid tile size: %s\n", optarg);
+                exit(1);
+            }
+            chain_tile = (size_t)v;
+            break;
+        }
+        case 'b':
+            if (affinity_parse(optarg, bind) != 0) {
+                fprintf(stderr, "Invalid binding: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 't':
+            if (timer_select(optarg) != 0) {
+                exit(1);
+            }
+            break;
+        case 'e':
+            if (counters_parse(optarg) != 0) {
+                fprintf(stderr, "Invalid counter list: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'E':
+            if (energy_parse(optarg != NULL ? optarg : "auto") != 0) {
+                fprintf(stderr, "Invalid energy sensor list: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'F':
+            if (report_parse_format(optarg, fmt) != 0) {
+                fprintf(stderr, "Unknown format: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'o':
+            *out_path = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            usage(argv[0]);
+            exit(1);
         }
     }
-    return 1;
+}
+
+// Median bandwidth with its confidence interval, p5-p95 range, spread and
+// the number of outlying iterations (see stats.h)
+static void print_sustained(const char *label, const double *times, double bytes) {
+    const double gb = 1024.0 * 1024.0 * 1024.0;
+    stats_summary st;
+
+    stats_summarize(times, ITERATIONS, &st);
+    printf("  %-9s %.2f GB/s [%.2f, %.2f], p5-p95 %.2f-%.2f, stddev %.2f%%, %d outliers\n",
+           label, bytes / st.median / gb, bytes / st.ci_hi / gb, bytes / st.ci_lo / gb,
+           bytes / st.p95 / gb, bytes / st.p5 / gb, 100.0 * st.stddev / st.mean, st.outliers);
+}
+
+// Energy region of one version, with the bytes it moves for GB/s per watt
+static int energy_vector_region(const char *name, double bytes) {
+    int id = energy_region(name);
+    energy_work(id, bytes / (1024.0 * 1024.0 * 1024.0), "GB/s");
+    return id;
+}
+
+// Add one version's per-iteration times to the --format record
+static void report_vector(const char *kernel, const double *times, double best, size_t n,
+                          size_t elem_size) {
+    report_result r;
+
+    memset(&r, 0, sizeof(r));
+    r.kernel = kernel;
+    r.working_set = 3.0 * n * elem_size;
+    r.bytes = 3.0 * n * elem_size;
+    r.flops = (double)n;
+    r.rate = r.bytes / best / (1024.0 * 1024.0 * 1024.0);
+    r.unit = "GB/s";
+    r.times = times;
+    r.ntimes = ITERATIONS;
+    report_add(&r);
+}
+
+/*
+ * Time the chain unfused, fused and tiled into the three result buffers,
+ * which the main versions no longer need.  Bytes are the memory traffic
+ * each version asks for: the unfused chain moves 6 words per element, the
+ * fused and tiled ones 3, for the same 3 FLOPs.  "Unfused-equivalent" is
+ * the bandwidth the unfused chain would need to finish in the same time.
+ */
+static int run_chain(const vector_kernels *vk, const void *a, const void *b, void *c_chain,
+                     void *c_fused, void *c_tiled, size_t n, size_t elem_size) {
+    const double gb = 1024.0 * 1024.0 * 1024.0;
+    static const char *names[3] = {"unfused", "fused", "tiled"};
+    static const char *labels[3] = {"Unfused:", "Fused:", "Tiled:"};
+    static const double words[3] = {6.0, 3.0, 3.0};
+    void *out[3] = {c_chain, c_fused, c_tiled};
+    double times[3][ITERATIONS], best[3];
+    char region[32];
+    report_result r;
+    int ok;
+
+    printf("\nRunning the chain c = %g * (a + b) + a (tile %zu elements)...\n",
+           CHAIN_SCALAR, chain_tile);
+    vk->fused(a, b, c_fused, CHAIN_SCALAR, n);
+    for (int v = 0; v < 3; v++) {
+        int id, energy_id;
+
+        snprintf(region, sizeof(region), "chain-%s", names[v]);
+        id = counters_region(region);
+        energy_id = energy_vector_region(region, words[v] * n * elem_size);
+        best[v] = 1e9;
+        for (int iter = 0; iter < ITERATIONS; iter++) {
+            energy_begin(energy_id);
+            counters_begin(id);
+            double t = get_time();
+            if (v == 0) {
+                vk->chain(a, b, out[v], CHAIN_SCALAR, n);
+            } else if (v == 1) {
+                vk->fused(a, b, out[v], CHAIN_SCALAR, n);
+            } else {
+                vk->tiled(a, b, out[v], CHAIN_SCALAR, n, chain_tile);
+            }
+            times[v][iter] = get_time() - t;
+            counters_end(id);
+            energy_end(energy_id);
+            if (times[v][iter] < best[v]) {
+                best[v] = times[v][iter];
+            }
+        }
+
+        memset(&r, 0, sizeof(r));
+        r.kernel = "chain";
+        r.variant = names[v];
+        r.working_set = 3.0 * n * elem_size;
+        r.bytes = words[v] * n * elem_size;
+        r.flops = 3.0 * n;
+        r.rate = r.bytes / best[v] / gb;
+        r.unit = "GB/s";
+        r.times = times[v];
+        r.ntimes = ITERATIONS;
+        report_add(&r);
+    }
+
+    ok = verify_results(vk, c_chain, c_fused, n, 1e-9) &&
+         verify_results(vk, c_chain, c_tiled, n, 1e-9);
+    printf("Chain verification: %s\n", ok ? "PASSED" : "FAILED");
+    report_param_str("chain_verification", ok ? "passed" : "failed");
+
+    printf("\n           Best time   Moved GB/s  Unfused-equivalent GB/s  GFLOP/s  Speedup\n");
+    for (int v = 0; v < 3; v++) {
+        printf("  %-9s %9.6f  %10.2f  %23.2f  %7.2f  %6.2fx\n", labels[v], best[v],
+               words[v] * n * elem_size / best[v] / gb, 6.0 * n * elem_size / best[v] / gb,
+               3.0 * n / best[v] * 1e-9, best[0] / best[v]);
+    }
+    printf("\nSustained bandwidth moved (median, %.0f%% CI of the median):\n",
+           STATS_CONFIDENCE * 100.0);
+    for (int v = 0; v < 3; v++) {
+        print_sustained(labels[v], times[v], words[v] * n * elem_size);
+    }
+    return ok;
 }
 
 int main(int argc, char *argv[]) {
-    double *a, *b, *c_serial, *c_parallel;
+    void *a, *b, *c_serial, *c_parallel, *c_taskloop;
     double start_time, end_time;
-    double serial_time, parallel_time;
-    double min_serial_time = 1e9, min_parallel_time = 1e9;
+    double serial_time, parallel_time, taskloop_time;
+    double min_serial_time = 1e9, min_parallel_time = 1e9, min_taskloop_time = 1e9;
+    double serial_times[ITERATIONS], parallel_times[ITERATIONS];
+    double taskloop_times[ITERATIONS];
     size_t n = VECTOR_SIZE;
+    affinity_config bind = { BIND_NONE };
+    report_format out_format = REPORT_TEXT;
+    const char *out_path = NULL;
+    precision type = PREC_FP64;
+    schedule_config sched = { 0, SCHED_STATIC, 0 };
+    char sched_name[32];
+    const vector_kernels *vk;
+    size_t elem_size;
+    
+    parse_args(argc, argv, &type, &sched, &bind, &out_format, &out_path);
+    if (report_open("vector_add", out_format, out_path) != 0) {
+        return 1;
+    }
+    vk = vector_kernels_select(type);
+    if (vk == NULL) {
+        fprintf(stderr, "Type %s is not built in\n", precision_name(type));
+        return 1;
+    }
+    elem_size = precision_size(type);
+    schedule_apply(&sched);
+    schedule_name(sched_name, sizeof(sched_name));
     
     printf("========================================\n");
     printf("OpenMP Vector Addition Benchmark\n");
@@ -65,42 +362,81 @@ int main(int argc, char *argv[]) {
             printf("Number of threads: %d\n", omp_get_num_threads());
         }
     }
+    // Before the binding, so the sampling thread is not pinned with the master
+    if (energy_open() != 0) {
+        return 1;
+    }
+    if (affinity_apply(&bind) != 0) {
+        return 1;
+    }
+    printf("Thread binding: %s\n", affinity_name(&bind));
+    affinity_report(stdout);
+    if (counters_open() != 0) {
+        return 1;
+    }
+    printf("Timer: %s (resolution %.1f ns)\n", timer_name(), timer_resolution() * 1e9);
+    printf("Schedule: %s; taskloop grain size: ", sched_name);
+    if (taskloop_grainsize > 0) {
+        printf("%ld elements\n", taskloop_grainsize);
+    } else {
+        printf("runtime default\n");
+    }
     
     printf("Vector size: %zu elements\n", n);
-    printf("Memory per vector: %.2f MB\n", (n * sizeof(double)) / (1024.0 * 1024.0));
-    printf("Total memory: %.2f MB\n", (3 * n * sizeof(double)) / (1024.0 * 1024.0));
+    printf("Element type: %s (%zu bytes)\n", precision_name(type), elem_size);
+    printf("Memory per vector: %.2f MB\n", (n * elem_size) / (1024.0 * 1024.0));
+    printf("Total memory: %.2f MB\n", (3 * n * elem_size) / (1024.0 * 1024.0));
     printf("Iterations: %d\n\n", ITERATIONS);
     
+    report_param_int("vector_size", (long long)n);
+    report_param_str("type", precision_name(type));
+    report_param_int("iterations", ITERATIONS);
+    report_param_str("binding", affinity_name(&bind));
+    report_param_str("schedule", sched_name);
+    report_param_int("grainsize", taskloop_grainsize);
+    if (run_fused) {
+        report_param_int("chain_tile", (long long)chain_tile);
+    }
+    
     // Allocate memory
-    a = (double *)malloc(n * sizeof(double));
-    b = (double *)malloc(n * sizeof(double));
-    c_serial = (double *)malloc(n * sizeof(double));
-    c_parallel = (double *)malloc(n * sizeof(double));
+    a = alloc_vector(n * elem_size);
+    b = alloc_vector(n * elem_size);
+    c_serial = alloc_vector(n * elem_size);
+    c_parallel = alloc_vector(n * elem_size);
+    c_taskloop = alloc_vector(n * elem_size);
     
-    if (!a || !b || !c_serial || !c_parallel) {
+    if (!a || !b || !c_serial || !c_parallel || !c_taskloop) {
         fprintf(stderr, "Memory allocation failed\n");
         return 1;
     }
     
     // Initialize vectors
     printf("Initializing vectors...\n");
-    #pragma omp parallel for
-    for (size_t i = 0; i < n; i++) {
-        a[i] = (double)i;
-        b[i] = (double)(n - i);
-    }
+    vk->init(a, b, n);
+    char page_text[96];
+    pages_describe(a, page_text, sizeof(page_text));
+    printf("Pages: %s requested, %s obtained\n", pages_name(pages), page_text);
+    report_param_str("pages", pages_name(pages));
+    report_param_str("pages_obtained", page_text);
     
     // Warm-up run
     printf("Performing warm-up run...\n");
-    vector_add_parallel(a, b, c_parallel, n);
+    vk->parallel(a, b, c_parallel, n);
     
     // Serial execution
     printf("\nRunning serial version...\n");
+    int serial_region = counters_region("serial");
+    int serial_energy = energy_vector_region("serial", 3.0 * n * elem_size);
     for (int iter = 0; iter < ITERATIONS; iter++) {
+        energy_begin(serial_energy);
+        counters_begin(serial_region);
         start_time = get_time();
-        vector_add_serial(a, b, c_serial, n);
+        vk->serial(a, b, c_serial, n);
         end_time = get_time();
+        counters_end(serial_region);
+        energy_end(serial_energy);
         serial_time = end_time - start_time;
+        serial_times[iter] = serial_time;
         
         if (serial_time < min_serial_time) {
             min_serial_time = serial_time;
@@ -111,11 +447,18 @@ int main(int argc, char *argv[]) {
     
     // Parallel execution
     printf("\nRunning parallel version...\n");
+    int parallel_region = counters_region("parallel");
+    int parallel_energy = energy_vector_region("parallel", 3.0 * n * elem_size);
     for (int iter = 0; iter < ITERATIONS; iter++) {
+        energy_begin(parallel_energy);
+        counters_begin(parallel_region);
         start_time = get_time();
-        vector_add_parallel(a, b, c_parallel, n);
+        vk->parallel(a, b, c_parallel, n);
         end_time = get_time();
+        counters_end(parallel_region);
+        energy_end(parallel_energy);
         parallel_time = end_time - start_time;
+        parallel_times[iter] = parallel_time;
         
         if (parallel_time < min_parallel_time) {
             min_parallel_time = parallel_time;
@@ -124,13 +467,46 @@ int main(int argc, char *argv[]) {
         printf("  Iteration %2d: %.6f seconds\n", iter + 1, parallel_time);
     }
     
+    // Parallel execution with taskloop
+    printf("\nRunning taskloop version...\n");
+    int taskloop_region = counters_region("taskloop");
+    int taskloop_energy = energy_vector_region("taskloop", 3.0 * n * elem_size);
+    for (int iter = 0; iter < ITERATIONS; iter++) {
+        energy_begin(taskloop_energy);
+        counters_begin(taskloop_region);
+        start_time = get_time();
+        vk->taskloop(a, b, c_taskloop, n, taskloop_grainsize);
+        end_time = get_time();
+        counters_end(taskloop_region);
+        energy_end(taskloop_energy);
+        taskloop_time = end_time - start_time;
+        taskloop_times[iter] = taskloop_time;
+        
+        if (taskloop_time < min_taskloop_time) {
+            min_taskloop_time = taskloop_time;
+        }
+        
+        printf("  Iteration %2d: %.6f seconds\n", iter + 1, taskloop_time);
+    }
+    
+    report_vector("serial", serial_times, min_serial_time, n, elem_size);
+    report_vector("parallel", parallel_times, min_parallel_time, n, elem_size);
+    report_vector("taskloop", taskloop_times, min_taskloop_time, n, elem_size);
+    
     // Verify correctness
     printf("\nVerifying results...\n");
-    if (verify_results(c_serial, c_parallel, n, 1e-9)) {
+    if (verify_results(vk, c_serial, c_parallel, n, 1e-9) &&
+        verify_results(vk, c_serial, c_taskloop, n, 1e-9)) {
         printf("Verification: PASSED\n");
+        report_param_str("verification", "passed");
     } else {
         printf("Verification: FAILED\n");
-        free(a); free(b); free(c_serial); free(c_parallel);
+        report_param_str("verification", "failed");
+        counters_close();
+        energy_close();
+        report_end();
+        pages_free(a); pages_free(b); pages_free(c_serial); pages_free(c_parallel);
+        pages_free(c_taskloop);
         return 1;
     }
     
@@ -141,26 +517,57 @@ int main(int argc, char *argv[]) {
     
     printf("Best serial time:   %.6f seconds\n", min_serial_time);
     printf("Best parallel time: %.6f seconds\n", min_parallel_time);
-    printf("Speedup:            %.2fx\n", min_serial_time / min_parallel_time);
+    printf("Best taskloop time: %.6f seconds\n", min_taskloop_time);
+    printf("Speedup:            %.2fx (taskloop %.2fx)\n", min_serial_time / min_parallel_time,
+           min_serial_time / min_taskloop_time);
     printf("Efficiency:         %.2f%%\n", 
            (min_serial_time / min_parallel_time) / omp_get_max_threads() * 100.0);
     
     // Calculate bandwidth (3 arrays accessed: 2 reads + 1 write)
-    double bytes_transferred = 3.0 * n * sizeof(double);
+    double bytes_transferred = 3.0 * n * elem_size;
     double serial_bandwidth = bytes_transferred / min_serial_time / (1024.0 * 1024.0 * 1024.0);
     double parallel_bandwidth = bytes_transferred / min_parallel_time / (1024.0 * 1024.0 * 1024.0);
+    double taskloop_bandwidth = bytes_transferred / min_taskloop_time / (1024.0 * 1024.0 * 1024.0);
     
     printf("\nMemory Bandwidth:\n");
     printf("  Serial:   %.2f GB/s\n", serial_bandwidth);
     printf("  Parallel: %.2f GB/s\n", parallel_bandwidth);
+    printf("  Taskloop: %.2f GB/s\n", taskloop_bandwidth);
+    
+    printf("\nSustained Bandwidth (median, %.0f%% CI of the median):\n",
+           STATS_CONFIDENCE * 100.0);
+    print_sustained("Serial:", serial_times, bytes_transferred);
+    print_sustained("Parallel:", parallel_times, bytes_transferred);
+    print_sustained("Taskloop:", taskloop_times, bytes_transferred);
     
     printf("\n========================================\n");
     
+    int chain_ok = 1;
+    if (run_fused) {
+        chain_ok = run_chain(vk, a, b, c_serial, c_parallel, c_taskloop, n, elem_size);
+        printf("\n========================================\n");
+    }
+    
+    if (counters_enabled()) {
+        printf("\n");
+        counters_report(stdout);
+        printf("\n========================================\n");
+    }
+    counters_close();
+    if (energy_enabled()) {
+        printf("\n");
+        energy_report(stdout);
+        printf("\n========================================\n");
+    }
+    energy_close();
+    report_end();
+    
     // Clean up
-    free(a);
-    free(b);
-    free(c_serial);
-    free(c_parallel);
+    pages_free(a);
+    pages_free(b);
+    pages_free(c_serial);
+    pages_free(c_parallel);
+    pages_free(c_taskloop);
     
-    return 0;
+    return chain_ok ? 0 : 1;
 }
@@ -0,0 +1,158 @@
+/*
+ * Vector addition kernels for every element type; see vector_kernels.h.
+ */
+
+#include <math.h>
+#include "vector_kernels.h"
+
+// Initialize with integers up to 256 so that a, b and their sum are exact
+// in every type, bf16 included.
+// Serial vector addition, for verification.
+// Parallel vector addition using OpenMP (schedule from --schedule).
+// Parallel vector addition with omp taskloop: one thread creates tasks of
+// grainsize elements (the runtime chooses if 0) and the team executes them.
+// The add+axpy chain c = a + b; c = s * c + a as two parallel passes, as
+// two library calls would run it: 6 words of traffic for 3 FLOPs.
+// The same chain fused into one pass, which reads a and b once and writes
+// c once: 3 words for the same 3 FLOPs.  The sum is still rounded to T, so
+// the result matches the unfused chain.
+// The chain tiled: each chunk of tile elements runs both passes before the
+// next, so c is re-read from cache; memory sees the fused 3 words while
+// the cache serves the unfused 6.
+// Count elements of c1 and c2 further apart than tolerance, and the first
+// such index, in one parallel pass.
+#define VECTOR_KERNELS(TAG, ID, T, A, LOAD, STORE)                            \
+static void init_##TAG(void *a, void *b, size_t n) {                          \
+    T *pa = a, *pb = b;                                                       \
+    _Pragma("omp parallel for")                                               \
+    for (size_t i = 0; i < n; i++) {                                          \
+        pa[i] = STORE((A)(i % 256));                                          \
+        pb[i] = STORE((A)(256 - i % 256));                                    \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+void vector_add_serial_##TAG(const void *a, const void *b, void *c, size_t n) { \
+    const T *pa = a, *pb = b;                                                 \
+    T *pc = c;                                                                \
+    for (size_t i = 0; i < n; i++) {                                          \
+        pc[i] = STORE(LOAD(pa[i]) + LOAD(pb[i]));                             \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+void vector_add_parallel_##TAG(const void *a, const void *b, void *c, size_t n) { \
+    const T *pa = a, *pb = b;                                                 \
+    T *pc = c;                                                                \
+    _Pragma("omp parallel for schedule(runtime)")                             \
+    for (size_t i = 0; i < n; i++) {                                          \
+        pc[i] = STORE(LOAD(pa[i]) + LOAD(pb[i]));                             \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+void vector_add_taskloop_##TAG(const void *a, const void *b, void *c, size_t n, \
+                               long grainsize) {                              \
+    const T *pa = a, *pb = b;                                                 \
+    T *pc = c;                                                                \
+    _Pragma("omp parallel")                                                   \
+    _Pragma("omp single")                                                     \
+    {                                                                         \
+        if (grainsize > 0) {                                                  \
+            _Pragma("omp taskloop grainsize(grainsize)")                      \
+            for (size_t i = 0; i < n; i++) {                                  \
+                pc[i] = STORE(LOAD(pa[i]) + LOAD(pb[i]));                     \
+            }                                                                 \
+        } else {                                                              \
+            _Pragma("omp taskloop")                                           \
+            for (size_t i = 0; i < n; i++) {                                  \
+                pc[i] = STORE(LOAD(pa[i]) + LOAD(pb[i]));                     \
+            }                                                                 \
+        }                                                                     \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+void vector_chain_unfused_##TAG(const void *a, const void *b, void *c,        \
+                                double scalar, size_t n) {                    \
+    const T *pa = a, *pb = b;                                                 \
+    T *pc = c;                                                                \
+    A s = LOAD(STORE((A)scalar));                                             \
+    _Pragma("omp parallel for schedule(runtime)")                             \
+    for (size_t i = 0; i < n; i++) {                                          \
+        pc[i] = STORE(LOAD(pa[i]) + LOAD(pb[i]));                             \
+    }                                                                         \
+    _Pragma("omp parallel for schedule(runtime)")                             \
+    for (size_t i = 0; i < n; i++) {                                          \
+        pc[i] = STORE(s * LOAD(pc[i]) + LOAD(pa[i]));                         \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+void vector_chain_fused_##TAG(const void *a, const void *b, void *c,          \
+                              double scalar, size_t n) {                      \
+    const T *pa = a, *pb = b;                                                 \
+    T *pc = c;                                                                \
+    A s = LOAD(STORE((A)scalar));                                             \
+    _Pragma("omp parallel for schedule(runtime)")                             \
+    for (size_t i = 0; i < n; i++) {                                          \
+        A sum = LOAD(STORE(LOAD(pa[i]) + LOAD(pb[i])));                       \
+        pc[i] = STORE(s * sum + LOAD(pa[i]));                                 \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+void vector_chain_tiled_##TAG(const void *a, const void *b, void *c,          \
+                              double scalar, size_t n, size_t tile) {         \
+    const T *pa = a, *pb = b;                                                 \
+    T *pc = c;                                                                \
+    A s = LOAD(STORE((A)scalar));                                             \
+    size_t tiles = (n + tile - 1) / tile;                                     \
+    _Pragma("omp parallel for schedule(runtime)")                             \
+    for (size_t t = 0; t < tiles; t++) {                                      \
+        size_t lo = t * tile, hi = lo + tile < n ? lo + tile : n;             \
+        for (size_t i = lo; i < hi; i++) {                                    \
+            pc[i] = STORE(LOAD(pa[i]) + LOAD(pb[i]));                         \
+        }                                                                     \
+        for (size_t i = lo; i < hi; i++) {                                    \
+            pc[i] = STORE(s * LOAD(pc[i]) + LOAD(pa[i]));                     \
+        }                                                                     \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static double get_##TAG(const void *x, size_t i) {                            \
+    return (double)LOAD(((const T *)x)[i]);                                   \
+}                                                                             \
+                                                                              \
+static size_t compare_##TAG(const void *c1, const void *c2, size_t n,         \
+                            double tolerance, size_t *first) {                \
+    const T *p1 = c1, *p2 = c2;                                               \
+    size_t bad = 0, lowest = n;                                               \
+    _Pragma("omp parallel for reduction(+:bad) reduction(min:lowest)")        \
+    for (size_t i = 0; i < n; i++) {                                          \
+        if (fabs((double)LOAD(p1[i]) - (double)LOAD(p2[i])) > tolerance) {    \
+            bad++;                                                            \
+            lowest = i < lowest ? i : lowest;                                 \
+        }                                                                     \
+    }                                                                         \
+    *first = lowest;                                                          \
+    return bad;                                                               \
+}                                                                             \
+                                                                              \
+static const vector_kernels kernels_##TAG = {                                 \
+    ID, init_##TAG, vector_add_serial_##TAG, vector_add_parallel_##TAG,       \
+    vector_add_taskloop_##TAG, vector_chain_unfused_##TAG,                    \
+    vector_chain_fused_##TAG, vector_chain_tiled_##TAG, get_##TAG,            \
+    compare_##TAG                                                             \
+};
+
+PRECISION_FOR_EACH(VECTOR_KERNELS)
+
+#define VECTOR_ENTRY(TAG, ID, T, A, LOAD, STORE) &kernels_##TAG,
+
+static const vector_kernels *const all_kernels[] = {
+    PRECISION_FOR_EACH(VECTOR_ENTRY)
+};
+
+const vector_kernels *vector_kernels_select(precision type) {
+    for (size_t i = 0; i < sizeof(all_kernels) / sizeof(all_kernels[0]); i++) {
+        if (all_kernels[i]->type == type) {
+            return all_kernels[i];
+        }
+    }
+    return NULL;
+}
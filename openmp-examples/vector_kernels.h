@@ -0,0 +1,34 @@
+/*
+ * Vector addition kernels, shared by vector_add.c and the bench driver
+ *
+ * One set per element type in common/precision.h; --type selects the set
+ * at run time.
+ */
+
+#ifndef VECTOR_KERNELS_H
+#define VECTOR_KERNELS_H
+
+#include <stddef.h>
+#include "precision.h"
+
+// The kernels for one element type
+typedef struct {
+    precision type;
+    void (*init)(void *a, void *b, size_t n);
+    void (*serial)(const void *a, const void *b, void *c, size_t n);
+    void (*parallel)(const void *a, const void *b, void *c, size_t n);
+    void (*taskloop)(const void *a, const void *b, void *c, size_t n, long grainsize);
+    // c = s * (a + b) + a: unfused, fused and tiled (see vector_kernels.c)
+    void (*chain)(const void *a, const void *b, void *c, double scalar, size_t n);
+    void (*fused)(const void *a, const void *b, void *c, double scalar, size_t n);
+    void (*tiled)(const void *a, const void *b, void *c, double scalar, size_t n,
+                  size_t tile);
+    double (*get)(const void *x, size_t i);
+    size_t (*compare)(const void *c1, const void *c2, size_t n, double tolerance,
+                      size_t *first);
+} vector_kernels;
+
+// Returns NULL if type is not built in
+const vector_kernels *vector_kernels_select(precision type);
+
+#endif
@@ -0,0 +1,524 @@
+/*
+ * Strided and gather/scatter bandwidth benchmark.
+ *
+ * The STREAM kernels are unit-stride.  This program times the access
+ * patterns of indirect and non-unit-stride codes on the same kind of
+ * arrays:
+ *
+ *   strided-S   a[j] = b[j * S]       for each S in --strides
+ *   gather      a[j] = b[idx[j]]
+ *   scatter     a[idx[j]] = b[j]
+ *
+ * idx[] is a random permutation of 0..N-1 (--index random, the default)
+ * or the identity (--index linear); the linear index isolates the cost of
+ * the indexed instructions from that of the scattered addresses.
+ *
+ * Each kernel is timed with every kernel set in gather_kernels.h: "scalar"
+ * (vectorization disabled), "auto" (the same loops as the compiler
+ * vectorizes them) and, with "make RVV=1", the RVV strided and indexed
+ * loads and stores.  Two rates are reported:
+ *
+ *   Effective  bytes of the elements the kernel uses (8 per load or
+ *              store, plus 8 per index)
+ *   Raw        bytes of the cache lines it touches: a whole line for each
+ *              strided access of at least a line apart and for each
+ *              random-index access, assuming no line is reused while it
+ *              is cached (true once the arrays exceed the last-level cache)
+ *
+ * The ratio of the two is the fraction of the memory traffic that is
+ * useful.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <unistd.h>
+#include "gather_kernels.h"
+#include "affinity.h"
+#include "timer.h"
+#include "report.h"
+#include "stats.h"
+#include "pages.h"
+#include "schedule.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifndef GATHER_ARRAY_SIZE
+#   define GATHER_ARRAY_SIZE 10000000
+#endif
+
+#ifndef NTIMES
+#   define NTIMES 10
+#endif
+
+#if NTIMES < 2
+#   error "need NTIMES >= 2"
+#endif
+
+#define GATHER_MAX_STRIDES 16
+#define GATHER_SEED 0x9e3779b97f4a7c15ULL
+
+#ifndef STREAM_RVV_LMUL
+#   define STREAM_RVV_LMUL 4
+#endif
+
+enum { KERNEL_STRIDED, KERNEL_GATHER, KERNEL_SCATTER };
+
+static size_t array_size = GATHER_ARRAY_SIZE;
+static size_t strides[GATHER_MAX_STRIDES] = {1, 2, 4, 8, 16};
+static int nstrides = 5;
+static int random_index = 1;
+static page_mode pages = PAGES_DEFAULT;
+static size_t line_size = 64;
+static affinity_config bind_cfg = { BIND_NONE };
+static report_format out_format = REPORT_TEXT;
+static const char *out_path = NULL;
+#ifdef STREAM_RVV
+static int rvv_lmul = STREAM_RVV_LMUL;
+#endif
+
+static double *a, *b;
+static uint64_t *idx;
+static int failures = 0;
+
+/*
+ * Reference loops.  "scalar" is compiled with vectorization disabled so it
+ * is the baseline for the vector sets; "auto" is the same source left to
+ * the vectorizer (which may or may not use gather instructions).  GCC
+ * takes that per function, clang per loop.
+ */
+#if defined(__clang__)
+#define SCALAR_ATTR
+#define SCALAR_LOOP _Pragma("clang loop vectorize(disable) interleave(disable)")
+#elif defined(__GNUC__)
+#define SCALAR_ATTR __attribute__((optimize("no-tree-vectorize")))
+#define SCALAR_LOOP
+#else
+#define SCALAR_ATTR
+#define SCALAR_LOOP
+#endif
+
+#define GATHER_C_KERNELS(NAME, ATTR, LOOP)                                    \
+ATTR static void strided_##NAME(double *restrict a, const double *restrict b, \
+                                size_t stride, size_t n)                      \
+{                                                                             \
+    size_t j;                                                                 \
+    LOOP                                                                      \
+    for (j = 0; j < n; j++)                                                   \
+        a[j] = b[j * stride];                                                 \
+}                                                                             \
+                                                                              \
+ATTR static void gather_##NAME(double *restrict a, const double *restrict b,  \
+                               const uint64_t *restrict idx, size_t n)        \
+{                                                                             \
+    size_t j;                                                                 \
+    LOOP                                                                      \
+    for (j = 0; j < n; j++)                                                   \
+        a[j] = b[idx[j]];                                                     \
+}                                                                             \
+                                                                              \
+ATTR static void scatter_##NAME(double *restrict a, const double *restrict b, \
+                                const uint64_t *restrict idx, size_t n)       \
+{                                                                             \
+    size_t j;                                                                 \
+    LOOP                                                                      \
+    for (j = 0; j < n; j++)                                                   \
+        a[idx[j]] = b[j];                                                     \
+}                                                                             \
+                                                                              \
+static const gather_kernels kernels_##NAME = {                                \
+    #NAME, strided_##NAME, gather_##NAME, scatter_##NAME                      \
+};
+
+GATHER_C_KERNELS(scalar, SCALAR_ATTR, SCALAR_LOOP)
+GATHER_C_KERNELS(auto, , )
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  -n, --size N           elements per array (default %llu)\n",
+            (unsigned long long) GATHER_ARRAY_SIZE);
+    fprintf(stderr, "  -s, --strides LIST     strides of the strided kernel in elements\n");
+    fprintf(stderr, "                         (default 1,2,4,8,16)\n");
+    fprintf(stderr, "  -i, --index PATTERN    gather/scatter index: random (a permutation)\n");
+    fprintf(stderr, "                         or linear (the identity) (default random)\n");
+    fprintf(stderr, "      --pages MODE       pages of the arrays: default, 4k, 2m (THP) or 1g\n");
+    fprintf(stderr, "                         (hugetlbfs); see common/pages.h (default default)\n");
+    fprintf(stderr, "  -H, --hugepages        same as --pages 2m\n");
+#ifdef STREAM_RVV
+    fprintf(stderr, "  -l, --lmul N           LMUL of the RVV kernels: 1, 2, 4 or 8 (default %d)\n",
+            STREAM_RVV_LMUL);
+#endif
+    fprintf(stderr, "  -b, --bind SPEC        pin threads: none, compact, spread or a CPU list\n");
+    fprintf(stderr, "                         such as 0,2,4-7 (default none)\n");
+    fprintf(stderr, "  -t, --timer NAME       monotonic-raw, monotonic, gettimeofday, rdtime or\n");
+    fprintf(stderr, "                         rdcycle (default monotonic-raw)\n");
+    fprintf(stderr, "  -f, --format FMT       also write a text, json or csv record (default text)\n");
+    fprintf(stderr, "      --output FILE      write the record to FILE instead of stdout\n");
+    fprintf(stderr, "  -h, --help             show this message\n");
+}
+
+static int parse_strides(const char *arg)
+{
+    const char *p = arg;
+    char *end;
+    long v;
+
+    nstrides = 0;
+    for (;;) {
+        errno = 0;
+        v = strtol(p, &end, 10);
+        if (errno != 0 || end == p || v < 1 || nstrides == GATHER_MAX_STRIDES)
+            return -1;
+        strides[nstrides++] = (size_t) v;
+        if (*end == '\0')
+            return 0;
+        if (*end != ',')
+            return -1;
+        p = end + 1;
+    }
+}
+
+static void parse_args(int argc, char *argv[])
+{
+    static const struct option long_options[] = {
+        {"size",      required_argument, NULL, 'n'},
+        {"strides",   required_argument, NULL, 's'},
+        {"index",     required_argument, NULL, 'i'},
+        {"hugepages", no_argument,       NULL, 'H'},
+        {"pages",     required_argument, NULL, 'G'},
+        {"lmul",      required_argument, NULL, 'l'},
+        {"bind",      required_argument, NULL, 'b'},
+        {"timer",     required_argument, NULL, 't'},
+        {"format",    required_argument, NULL, 'f'},
+        {"output",    required_argument, NULL, 'O'},
+        {"help",      no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    char *end;
+    long long v;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "n:s:i:Hl:b:t:f:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'n':
+            errno = 0;
+            v = strtoll(optarg, &end, 10);
+            if (errno != 0 || end == optarg || *end != '\0' || v < 1) {
+                fprintf(stderr, "Invalid array size: %s\n", optarg);
+                exit(1);
+            }
+            array_size = (size_t) v;
+            break;
+        case 's':
+            if (parse_strides(optarg) != 0) {
+                fprintf(stderr, "Invalid stride list: %s (up to %d positive strides)\n",
+                        optarg, GATHER_MAX_STRIDES);
+                exit(1);
+            }
+            break;
+        case 'i':
+            if (strcmp(optarg, "random") == 0) {
+                random_index = 1;
+            } else if (strcmp(optarg, "linear") == 0) {
+                random_index = 0;
+            } else {
+                fprintf(stderr, "Unknown index pattern: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'H':
+            pages = PAGES_2M;
+            break;
+        case 'G':
+            if (pages_parse(optarg, &pages) != 0) {
+                fprintf(stderr, "Invalid pages: %s (default, 4k, 2m or 1g)\n", optarg);
+                exit(1);
+            }
+            break;
+#ifdef STREAM_RVV
+        case 'l':
+            rvv_lmul = atoi(optarg);
+            break;
+#endif
+        case 'b':
+            if (affinity_parse(optarg, &bind_cfg) != 0) {
+                fprintf(stderr, "Invalid binding: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 't':
+            if (timer_select(optarg) != 0)
+                exit(1);
+            break;
+        case 'f':
+            if (report_parse_format(optarg, &out_format) != 0) {
+                fprintf(stderr, "Unknown format: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'O':
+            out_path = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+}
+
+static void *alloc_array(size_t len)
+{
+    void *p = pages_alloc(len, pages);
+
+    if (p == NULL)
+        exit(1);
+    return p;
+}
+
+/* xorshift64*, fixed seed so every run uses the same permutation */
+static uint64_t next_random(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545f4914f6cdd1dULL;
+}
+
+/*
+ * Fill the arrays with the same static schedule as the kernels so the
+ * pages are first touched by the threads that use them, then shuffle the
+ * index serially.  A permutation keeps the scatter free of races.
+ */
+static void init_arrays(void)
+{
+    uint64_t state = GATHER_SEED, t;
+    size_t j, k;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (j = 0; j < array_size; j++) {
+        a[j] = 0.0;
+        b[j] = (double) j;
+        idx[j] = j;
+    }
+    if (!random_index)
+        return;
+    for (j = array_size - 1; j > 0; j--) {
+        k = (size_t) (next_random(&state) % (j + 1));
+        t = idx[j];
+        idx[j] = idx[k];
+        idx[k] = t;
+    }
+}
+
+static size_t accesses(int kernel, size_t stride)
+{
+    return kernel == KERNEL_STRIDED ? array_size / stride : array_size;
+}
+
+static double run_once(const gather_kernels *kern, int kernel, size_t stride)
+{
+    size_t n = accesses(kernel, stride);
+    double t = timer_seconds();
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        size_t lo, hi;
+
+        schedule_slice(n, &lo, &hi);
+        switch (kernel) {
+        case KERNEL_STRIDED: kern->strided(a + lo, b + lo * stride, stride, hi - lo); break;
+        case KERNEL_GATHER:  kern->gather(a + lo, b, idx + lo, hi - lo); break;
+        case KERNEL_SCATTER: kern->scatter(a, b + lo, idx + lo, hi - lo); break;
+        }
+    }
+    return timer_seconds() - t;
+}
+
+/* b[i] == i, so every result element names the source element it holds */
+static int check(int kernel, size_t stride)
+{
+    size_t n = accesses(kernel, stride), j, bad = 0;
+
+    for (j = 0; j < n; j++) {
+        switch (kernel) {
+        case KERNEL_STRIDED: bad += a[j] != (double) (j * stride); break;
+        case KERNEL_GATHER:  bad += a[j] != (double) idx[j]; break;
+        case KERNEL_SCATTER: bad += a[idx[j]] != (double) j; break;
+        }
+    }
+    return bad == 0;
+}
+
+/* Bytes of the elements used and of the cache lines touched (see top) */
+static void traffic(int kernel, size_t stride, double *effective, double *raw)
+{
+    double n = (double) accesses(kernel, stride), w = sizeof(double);
+    double spread = stride * w < line_size ? stride * w : line_size;
+
+    switch (kernel) {
+    case KERNEL_STRIDED:
+        *effective = 2.0 * w * n;
+        *raw = w * n + spread * n;
+        break;
+    default:
+        *effective = 3.0 * w * n;
+        *raw = 2.0 * w * n + (random_index ? (double) line_size : w) * n;
+        break;
+    }
+}
+
+static void run_kernel(const gather_kernels *kern, int kernel, size_t stride)
+{
+    double times[NTIMES], best, effective, raw;
+    stats_summary st;
+    report_result r;
+    char name[32];
+    int k, ok;
+
+    memset(a, 0, array_size * sizeof(*a));
+    for (k = 0; k < NTIMES; k++)
+        times[k] = run_once(kern, kernel, stride);
+    ok = check(kernel, stride);
+    failures += !ok;
+
+    /* note -- skip first iteration, as stream.c does */
+    best = times[1];
+    for (k = 2; k < NTIMES; k++)
+        best = (best < times[k]) ? best : times[k];
+    stats_summarize(times + 1, NTIMES - 1, &st);
+    traffic(kernel, stride, &effective, &raw);
+
+    if (kernel == KERNEL_STRIDED)
+        snprintf(name, sizeof(name), "strided-%zu", stride);
+    else
+        snprintf(name, sizeof(name), "%s", kernel == KERNEL_GATHER ? "gather" : "scatter");
+    printf("%-12s %12zu %14.1f %12.1f %12.1f %11.6f  %s\n", name, accesses(kernel, stride),
+           1.0E-06 * effective / best, 1.0E-06 * raw / best,
+           1.0E-06 * effective / st.median, best, ok ? "ok" : "FAILED");
+
+    memset(&r, 0, sizeof(r));
+    r.kernel = name;
+    r.variant = kern->name;
+    r.working_set = (kernel == KERNEL_STRIDED ? 2.0 : 3.0) * sizeof(double) * (double) array_size;
+    r.bytes = effective;
+    r.actual_bytes = raw;
+    r.rate = 1.0E-06 * effective / best;
+    r.unit = "MB/s";
+    r.times = times + 1;
+    r.ntimes = NTIMES - 1;
+    report_add(&r);
+}
+
+static void run_set(const gather_kernels *kern)
+{
+    int s;
+
+    printf("%s kernels\n", kern->name);
+    printf("Kernel           Accesses Effective MB/s     Raw MB/s  Median MB/s    Min time\n");
+    for (s = 0; s < nstrides; s++)
+        run_kernel(kern, KERNEL_STRIDED, strides[s]);
+    run_kernel(kern, KERNEL_GATHER, 0);
+    run_kernel(kern, KERNEL_SCATTER, 0);
+    printf("-------------------------------------------------------------\n");
+}
+
+int main(int argc, char *argv[])
+{
+    long l;
+    int s;
+    char page_text[96];
+#ifdef STREAM_RVV
+    const gather_kernels *rvv;
+#endif
+
+    parse_args(argc, argv);
+    if (report_open("gather", out_format, out_path) != 0)
+        exit(1);
+#ifdef STREAM_RVV
+    rvv = gather_rvv_select(rvv_lmul);
+    if (rvv == NULL) {
+        fprintf(stderr, "Unsupported LMUL: %d (expected 1, 2, 4 or 8)\n", rvv_lmul);
+        exit(1);
+    }
+#endif
+    for (s = 0; s < nstrides; s++) {
+        if (strides[s] > array_size) {
+            fprintf(stderr, "Stride %zu exceeds the array size\n", strides[s]);
+            exit(1);
+        }
+    }
+#ifdef _SC_LEVEL1_DCACHE_LINESIZE
+    l = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+    if (l > 0)
+        line_size = (size_t) l;
+#else
+    (void) l;
+#endif
+
+    a = alloc_array(array_size * sizeof(*a));
+    b = alloc_array(array_size * sizeof(*b));
+    idx = alloc_array(array_size * sizeof(*idx));
+
+    printf("-------------------------------------------------------------\n");
+    printf("Strided and gather/scatter bandwidth\n");
+    printf("-------------------------------------------------------------\n");
+    printf("Array size = %zu (elements), %.1f MiB per array, index %s.\n", array_size,
+           array_size * sizeof(double) / 1024.0 / 1024.0, random_index ? "random" : "linear");
+    printf("Arrays aligned to %lu bytes, %s pages requested.\n",
+           (unsigned long) PAGES_ALIGN, pages_name(pages));
+    printf("Cache line = %zu bytes.  Effective MB/s counts the elements used,\n", line_size);
+    printf(" Raw MB/s the cache lines touched.  Each kernel is executed %d times;\n", NTIMES);
+    printf(" the best and median exclude the first iteration.\n");
+#ifdef _OPENMP
+    printf("Number of Threads = %d\n", omp_get_max_threads());
+#endif
+    if (affinity_apply(&bind_cfg) != 0)
+        exit(1);
+    printf("Thread binding = %s\n", affinity_name(&bind_cfg));
+    affinity_report(stdout);
+    printf("-------------------------------------------------------------\n");
+
+    report_param_int("array_size", (long long) array_size);
+    report_param_str("index", random_index ? "random" : "linear");
+    report_param_int("line_size", (long long) line_size);
+    report_param_int("ntimes", NTIMES);
+    report_param_str("pages", pages_name(pages));
+    report_param_str("binding", affinity_name(&bind_cfg));
+#ifdef STREAM_RVV
+    report_param_int("lmul", rvv_lmul);
+#endif
+
+    init_arrays();
+    pages_describe(a, page_text, sizeof(page_text));
+    printf("Pages obtained = %s.\n", page_text);
+    printf("-------------------------------------------------------------\n");
+    report_param_str("pages_obtained", page_text);
+    run_set(&kernels_scalar);
+    run_set(&kernels_auto);
+#ifdef STREAM_RVV
+    run_set(rvv);
+#endif
+
+    if (failures == 0)
+        printf("Solution Validates\n");
+    else
+        printf("Failed Validation on %d kernel%s\n", failures, failures > 1 ? "s" : "");
+
+    pages_free(idx);
+    pages_free(b);
+    pages_free(a);
+    report_end();
+    return failures == 0 ? 0 : 1;
+}
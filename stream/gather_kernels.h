@@ -0,0 +1,34 @@
+/*-----------------------------------------------------------------------*/
+/* Kernel sets for the strided and gather/scatter benchmark (gather.c)   */
+/*                                                                       */
+/* Each set implements the three access patterns on one contiguous      */
+/* slice of the index space; gather.c splits the work between threads.   */
+/*                                                                       */
+/*   strided   a[j] = b[j * stride]                                      */
+/*   gather    a[j] = b[idx[j]]                                          */
+/*   scatter   a[idx[j]] = b[j]                                          */
+/*                                                                       */
+/*   gather.c      "scalar" (vectorization disabled) and "auto" (the     */
+/*                 same loops, vectorized as the compiler sees fit)      */
+/*   gather_rvv.c  RVV 1.0 strided and indexed loads/stores (vlse64,     */
+/*                 vluxei64, vsuxei64), one set per LMUL; built with     */
+/*                 "make RVV=1"                                          */
+/*-----------------------------------------------------------------------*/
+
+#ifndef GATHER_KERNELS_H
+#define GATHER_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    const char *name;
+    void (*strided)(double *a, const double *b, size_t stride, size_t n);
+    void (*gather)(double *a, const double *b, const uint64_t *idx, size_t n);
+    void (*scatter)(double *a, const double *b, const uint64_t *idx, size_t n);
+} gather_kernels;
+
+/* Returns NULL if lmul is not 1, 2, 4 or 8 */
+const gather_kernels *gather_rvv_select(int lmul);
+
+#endif
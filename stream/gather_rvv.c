@@ -0,0 +1,75 @@
+/*-----------------------------------------------------------------------*/
+/* RISC-V Vector (RVV 1.0) strided and indexed kernels for gather.c      */
+/*                                                                       */
+/* Built only with "make RVV=1", which adds -march=rv64gcv.  The indexed */
+/* forms take byte offsets, so the element indices are shifted left by   */
+/* 3 in a register before each vluxei64/vsuxei64.  The unordered forms   */
+/* are used: no two lanes of a scatter write the same element.           */
+/*-----------------------------------------------------------------------*/
+
+#include "gather_kernels.h"
+
+#ifndef __riscv_vector
+#   error "gather_rvv.c requires a compiler targeting the RISC-V V extension"
+#endif
+
+#include <riscv_vector.h>
+
+#define GATHER_RVV_KERNELS(LMUL)                                              \
+static void strided_m##LMUL(double *restrict a, const double *restrict b,     \
+                            size_t stride, size_t n)                          \
+{                                                                             \
+    ptrdiff_t bstride = (ptrdiff_t) (stride * sizeof(double));                \
+    size_t vl;                                                                \
+    for (; n > 0; n -= vl, a += vl, b += vl * stride) {                       \
+        vl = __riscv_vsetvl_e64m##LMUL(n);                                    \
+        vfloat64m##LMUL##_t vb = __riscv_vlse64_v_f64m##LMUL(b, bstride, vl); \
+        __riscv_vse64_v_f64m##LMUL(a, vb, vl);                                \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static void gather_m##LMUL(double *restrict a, const double *restrict b,      \
+                           const uint64_t *restrict idx, size_t n)            \
+{                                                                             \
+    size_t vl;                                                                \
+    for (; n > 0; n -= vl, a += vl, idx += vl) {                              \
+        vl = __riscv_vsetvl_e64m##LMUL(n);                                    \
+        vuint64m##LMUL##_t vi = __riscv_vle64_v_u64m##LMUL(idx, vl);          \
+        vi = __riscv_vsll_vx_u64m##LMUL(vi, 3, vl);                           \
+        __riscv_vse64_v_f64m##LMUL(a,                                         \
+            __riscv_vluxei64_v_f64m##LMUL(b, vi, vl), vl);                    \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static void scatter_m##LMUL(double *restrict a, const double *restrict b,     \
+                            const uint64_t *restrict idx, size_t n)           \
+{                                                                             \
+    size_t vl;                                                                \
+    for (; n > 0; n -= vl, b += vl, idx += vl) {                              \
+        vl = __riscv_vsetvl_e64m##LMUL(n);                                    \
+        vuint64m##LMUL##_t vi = __riscv_vle64_v_u64m##LMUL(idx, vl);          \
+        vi = __riscv_vsll_vx_u64m##LMUL(vi, 3, vl);                           \
+        __riscv_vsuxei64_v_f64m##LMUL(a, vi,                                  \
+            __riscv_vle64_v_f64m##LMUL(b, vl), vl);                           \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static const gather_kernels kernels_m##LMUL = {                               \
+    "rvv-m" #LMUL, strided_m##LMUL, gather_m##LMUL, scatter_m##LMUL           \
+};
+
+GATHER_RVV_KERNELS(1)
+GATHER_RVV_KERNELS(2)
+GATHER_RVV_KERNELS(4)
+GATHER_RVV_KERNELS(8)
+
+const gather_kernels *gather_rvv_select(int lmul)
+{
+    switch (lmul) {
+    case 1: return &kernels_m1;
+    case 2: return &kernels_m2;
+    case 4: return &kernels_m4;
+    case 8: return &kernels_m8;
+    default: return NULL;
+    }
+}
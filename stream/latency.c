@@ -0,0 +1,811 @@
+/*
+ * Memory latency benchmark (pointer chasing).
+ *
+ * STREAM measures throughput with perfectly sequential access.  This
+ * program measures load-to-use latency instead: every load's address
+ * comes from the previous load, so neither the out-of-order window nor
+ * the prefetchers can overlap them.
+ *
+ * The working set is divided into --stride byte lines and the lines are
+ * linked in a random order into a single cycle (a shuffled visiting order
+ * with the last line pointing back to the first), so every line is visited
+ * once per lap and the next address is unpredictable.  The buffer is swept
+ * from --sweep MIN to MAX; the latency steps up as each cache level and the
+ * TLB reach are exceeded.
+ *
+ * With --chains N the same cycle is walked by 1, 2, 4 ... N independent
+ * pointers started evenly spaced around it.  The time per load drops with
+ * the number of chains until the core runs out of outstanding misses; the
+ * ratio to the single-chain latency is the memory-level parallelism (MLP).
+ *
+ * --loaded N measures latency under contention instead (an OpenMP build,
+ * make openmp): thread 0 chases one chain through a working set of the
+ * --sweep maximum while N more threads run STREAM Triad on arrays of their
+ * own.  After every --load-chunk elements each load thread spins for a
+ * delay, so the delays of --delays step the injected bandwidth from full
+ * down to nearly idle; the latency against the bandwidth actually
+ * achieved is the loaded-latency curve.  An unloaded measurement comes
+ * first as the baseline.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <math.h>
+#include "affinity.h"
+#include "timer.h"
+#include "report.h"
+#include "stats.h"
+#include "pages.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifndef LAT_NTIMES
+#   define LAT_NTIMES 5
+#endif
+
+#if LAT_NTIMES < 2
+#   error "need LAT_NTIMES >= 2"
+#endif
+
+/* Most independent chains walked at once; must be a power of two */
+#define LAT_MAX_CHAINS 16
+
+#define LAT_SEED 0x9e3779b97f4a7c15ULL
+
+/* Most --delays values, and the Triad scalar of the load threads */
+#define LAT_MAX_DELAYS 32
+#define LOAD_SCALAR 3.0
+
+static double sweep_min = 4.0 * 1024;
+static double sweep_max = 256.0 * 1024 * 1024;
+static int sweep_steps = 2;
+static double min_time = 0.05;
+static size_t stride = 64;
+static int max_chains = 1;
+static page_mode pages = PAGES_DEFAULT;
+static double freq_ghz = 0;
+static affinity_config bind_cfg = { BIND_NONE };
+static report_format out_format = REPORT_TEXT;
+static const char *out_path = NULL;
+
+/* --loaded: load threads, bytes of their three arrays, delays per chunk */
+static int load_threads = 0;
+static double load_size = 96.0 * 1024 * 1024;
+static size_t load_chunk = 4096;
+static long load_delays[LAT_MAX_DELAYS] = {0, 64, 256, 1024, 4096, 16384, 65536};
+static int load_ndelays = 7;
+
+static char *buf;
+static size_t *order;
+
+#ifdef _OPENMP
+/* Arrays of load thread i, and the flag that stops the load threads */
+static double **load_a, **load_b, **load_c;
+static volatile int load_stop;
+#endif
+
+/* Keeps the final pointers live so the chase cannot be optimised away */
+static void *volatile sink;
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  -S, --sweep MIN:MAX    working-set range in bytes (default 4K:256M)\n");
+    fprintf(stderr, "      --sweep-steps N    sizes per doubling of the working set (default 2)\n");
+    fprintf(stderr, "      --min-time SEC     minimum duration of each timed sample\n");
+    fprintf(stderr, "                         (default 0.05)\n");
+    fprintf(stderr, "  -s, --stride BYTES     distance between chased pointers, at least one\n");
+    fprintf(stderr, "                         cache line (default 64)\n");
+    fprintf(stderr, "  -k, --chains N         also walk 2, 4 ... N independent chains to\n");
+    fprintf(stderr, "                         measure memory-level parallelism (N a power of\n");
+    fprintf(stderr, "                         two up to %d, default 1)\n", LAT_MAX_CHAINS);
+    fprintf(stderr, "  -L, --loaded N         latency under load: chase one chain through the\n");
+    fprintf(stderr, "                         --sweep maximum while N threads run Triad\n");
+    fprintf(stderr, "                         (OpenMP builds only; default 0, the sweep)\n");
+    fprintf(stderr, "      --load-size BYTES  Triad arrays of each load thread, all three\n");
+    fprintf(stderr, "                         (default 96M)\n");
+    fprintf(stderr, "      --load-chunk N     Triad elements between delays (default %zu)\n",
+            load_chunk);
+    fprintf(stderr, "      --delays LIST      spin iterations after each chunk, one loaded\n");
+    fprintf(stderr, "                         measurement per value (default\n");
+    fprintf(stderr, "                         0,64,256,1024,4096,16384,65536)\n");
+    fprintf(stderr, "      --pages MODE       pages of the buffer and load arrays: default, 4k,\n");
+    fprintf(stderr, "                         2m (THP) or 1g (hugetlbfs); see common/pages.h\n");
+    fprintf(stderr, "                         (default default)\n");
+    fprintf(stderr, "  -H, --hugepages        same as --pages 2m\n");
+    fprintf(stderr, "      --freq GHZ         core frequency for latency in cycles\n");
+    fprintf(stderr, "                         (default: cpufreq maximum, if available)\n");
+    fprintf(stderr, "  -b, --bind SPEC        pin the thread: none, compact, spread or a CPU\n");
+    fprintf(stderr, "                         list such as 3 (default none)\n");
+    fprintf(stderr, "  -t, --timer NAME       monotonic-raw, monotonic, gettimeofday, rdtime or\n");
+    fprintf(stderr, "                         rdcycle (default monotonic-raw)\n");
+    fprintf(stderr, "  -f, --format FMT       also write a text, json or csv record (default text)\n");
+    fprintf(stderr, "      --output FILE      write the record to FILE instead of stdout\n");
+    fprintf(stderr, "  -h, --help             show this message\n");
+}
+
+/* Parse a byte count with an optional binary K, M or G suffix */
+static int parse_bytes(const char *arg, char **end, double *value)
+{
+    double v = strtod(arg, end);
+
+    if (*end == arg || v <= 0)
+        return -1;
+    switch (**end) {
+    case 'K': case 'k': v *= 1024.0; (*end)++; break;
+    case 'M': case 'm': v *= 1024.0 * 1024.0; (*end)++; break;
+    case 'G': case 'g': v *= 1024.0 * 1024.0 * 1024.0; (*end)++; break;
+    }
+    *value = v;
+    return 0;
+}
+
+static int parse_range(const char *arg, double *lo, double *hi)
+{
+    char *end;
+
+    if (parse_bytes(arg, &end, lo) != 0 || *end != ':')
+        return -1;
+    if (parse_bytes(end + 1, &end, hi) != 0 || *end != '\0' || *hi < *lo)
+        return -1;
+    return 0;
+}
+
+/* Comma-separated list of non-negative delays */
+static int parse_delays(const char *arg)
+{
+    const char *p = arg;
+    char *end;
+    long v;
+
+    load_ndelays = 0;
+    for (;;) {
+        v = strtol(p, &end, 10);
+        if (end == p || v < 0 || load_ndelays == LAT_MAX_DELAYS)
+            return -1;
+        load_delays[load_ndelays++] = v;
+        if (*end == '\0')
+            return 0;
+        if (*end != ',')
+            return -1;
+        p = end + 1;
+    }
+}
+
+static void parse_args(int argc, char *argv[])
+{
+    static const struct option long_options[] = {
+        {"sweep",       required_argument, NULL, 'S'},
+        {"sweep-steps", required_argument, NULL, 'P'},
+        {"min-time",    required_argument, NULL, 'T'},
+        {"stride",    required_argument, NULL, 's'},
+        {"chains",    required_argument, NULL, 'k'},
+        {"loaded",     required_argument, NULL, 'L'},
+        {"load-size",  required_argument, NULL, 'Z'},
+        {"load-chunk", required_argument, NULL, 'C'},
+        {"delays",     required_argument, NULL, 'D'},
+        {"hugepages", no_argument,       NULL, 'H'},
+        {"pages",     required_argument, NULL, 'G'},
+        {"freq",      required_argument, NULL, 'F'},
+        {"bind",      required_argument, NULL, 'b'},
+        {"timer",     required_argument, NULL, 't'},
+        {"format",    required_argument, NULL, 'f'},
+        {"output",    required_argument, NULL, 'O'},
+        {"help",      no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    double v;
+    char *end;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "S:s:k:L:Hb:t:f:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'S':
+            if (parse_range(optarg, &sweep_min, &sweep_max) != 0) {
+                fprintf(stderr, "Invalid sweep range: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'P':
+            sweep_steps = atoi(optarg);
+            if (sweep_steps < 1) {
+                fprintf(stderr, "Invalid sweep steps: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'T':
+            min_time = atof(optarg);
+            if (min_time <= 0) {
+                fprintf(stderr, "Invalid minimum time: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 's':
+            if (parse_bytes(optarg, &end, &v) != 0 || *end != '\0' ||
+                v < sizeof(void *) || (size_t) v % sizeof(void *) != 0) {
+                fprintf(stderr, "Invalid stride: %s (must be a multiple of %zu bytes)\n",
+                        optarg, sizeof(void *));
+                exit(1);
+            }
+            stride = (size_t) v;
+            break;
+        case 'k':
+            max_chains = atoi(optarg);
+            if (max_chains < 1 || max_chains > LAT_MAX_CHAINS ||
+                (max_chains & (max_chains - 1)) != 0) {
+                fprintf(stderr, "Invalid chain count: %s (must be a power of two up to %d)\n",
+                        optarg, LAT_MAX_CHAINS);
+                exit(1);
+            }
+            break;
+        case 'L':
+            load_threads = atoi(optarg);
+            if (load_threads < 1) {
+                fprintf(stderr, "Invalid load thread count: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'Z':
+            if (parse_bytes(optarg, &end, &load_size) != 0 || *end != '\0' ||
+                load_size < 3.0 * sizeof(double)) {
+                fprintf(stderr, "Invalid load size: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'C':
+            v = atof(optarg);
+            if (v < 1) {
+                fprintf(stderr, "Invalid load chunk: %s\n", optarg);
+                exit(1);
+            }
+            load_chunk = (size_t) v;
+            break;
+        case 'D':
+            if (parse_delays(optarg) != 0) {
+                fprintf(stderr, "Invalid delays: %s (up to %d non-negative counts)\n",
+                        optarg, LAT_MAX_DELAYS);
+                exit(1);
+            }
+            break;
+        case 'H':
+            pages = PAGES_2M;
+            break;
+        case 'G':
+            if (pages_parse(optarg, &pages) != 0) {
+                fprintf(stderr, "Invalid pages: %s (default, 4k, 2m or 1g)\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'F':
+            freq_ghz = strtod(optarg, &end);
+            if (end == optarg || *end != '\0' || freq_ghz <= 0) {
+                fprintf(stderr, "Invalid frequency: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'b':
+            if (affinity_parse(optarg, &bind_cfg) != 0) {
+                fprintf(stderr, "Invalid binding: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 't':
+            if (timer_select(optarg) != 0)
+                exit(1);
+            break;
+        case 'f':
+            if (report_parse_format(optarg, &out_format) != 0) {
+                fprintf(stderr, "Unknown format: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'O':
+            out_path = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+}
+
+/* Maximum CPU frequency in GHz from cpufreq, or 0 if it is not exposed */
+static double detect_freq_ghz(void)
+{
+    FILE *f = fopen("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq", "r");
+    long khz = 0;
+
+    if (f != NULL) {
+        if (fscanf(f, "%ld", &khz) != 1)
+            khz = 0;
+        fclose(f);
+    }
+    return khz / 1e6;
+}
+
+/* xorshift64*, fixed seed so every run chases the same permutation */
+static uint64_t next_random(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545f4914f6cdd1dULL;
+}
+
+/*
+ * Link the first n lines of buf into one random cycle.  order[] receives
+ * the visiting order, so order[i * n / chains] are evenly spaced starting
+ * points for the chains.
+ */
+static void build_cycle(size_t n)
+{
+    uint64_t state = LAT_SEED;
+    size_t i, j, t;
+
+    for (i = 0; i < n; i++)
+        order[i] = i;
+    for (i = n - 1; i > 0; i--) {
+        j = (size_t) (next_random(&state) % (i + 1));
+        t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    for (i = 0; i < n; i++)
+        *(void **) (buf + order[i] * stride) = buf + order[(i + 1) % n] * stride;
+}
+
+/*
+ * One chase loop per chain count.  With N constant the inner loop is
+ * unrolled and p[] lives in registers, so the N loads of each step are
+ * independent of one another but each depends on the previous step.
+ */
+#define CHASE_KERNEL(N)                                         \
+static void chase##N(void **start, long steps)                  \
+{                                                               \
+    void *p[N];                                                 \
+    long s;                                                     \
+    int c;                                                      \
+                                                                \
+    for (c = 0; c < N; c++)                                     \
+        p[c] = start[c];                                        \
+    for (s = 0; s < steps; s++)                                 \
+        for (c = 0; c < N; c++)                                 \
+            p[c] = *(void **) p[c];                             \
+    for (c = 0; c < N; c++)                                     \
+        sink = p[c];                                            \
+}
+
+CHASE_KERNEL(1)
+CHASE_KERNEL(2)
+CHASE_KERNEL(4)
+CHASE_KERNEL(8)
+CHASE_KERNEL(16)
+
+static void chase(int chains, void **start, long steps)
+{
+    switch (chains) {
+    case 1:  chase1(start, steps); break;
+    case 2:  chase2(start, steps); break;
+    case 4:  chase4(start, steps); break;
+    case 8:  chase8(start, steps); break;
+    default: chase16(start, steps); break;
+    }
+}
+
+static double time_chase(int chains, void **start, long steps)
+{
+    double t = timer_seconds();
+
+    chase(chains, start, steps);
+    return timer_seconds() - t;
+}
+
+/*
+ * Best time per load in seconds over LAT_NTIMES samples of at least
+ * min_time each; the per-sample times go to samples[].
+ */
+static double measure(size_t n, int chains, long *steps_out, double *samples)
+{
+    void *start[LAT_MAX_CHAINS];
+    long steps = (long) (n / chains) + 1;
+    double t, best;
+    int c, s;
+
+    for (c = 0; c < chains; c++)
+        start[c] = buf + order[(size_t) c * n / chains] * stride;
+
+    /* One untimed lap warms the caches and TLB, then double until
+     * min_time; the lap that reaches it is the first sample */
+    chase(chains, start, steps);
+    while ((t = time_chase(chains, start, steps)) < min_time && steps < (1L << 40))
+        steps *= 2;
+    best = samples[0] = t;
+    for (s = 1; s < LAT_NTIMES; s++) {
+        t = samples[s] = time_chase(chains, start, steps);
+        best = (best < t) ? best : t;
+    }
+    *steps_out = steps;
+    return best / ((double) steps * chains);
+}
+
+static void format_bytes(double v, char *text, size_t len)
+{
+    static const char *units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    int u = 0;
+
+    while (v >= 1024.0 && u < 4) {
+        v /= 1024.0;
+        u++;
+    }
+    snprintf(text, len, "%.1f %s", v, units[u]);
+}
+
+static void print_header(void)
+{
+    int k;
+
+    printf("Working set     Lines  Latency ns");
+    if (freq_ghz > 0)
+        printf("  Cycles");
+    for (k = 2; k <= max_chains; k *= 2)
+        printf("  %2d-chain ns", k);
+    if (max_chains > 1)
+        printf("    MLP");
+    printf("\n");
+}
+
+static void run_sweep(void)
+{
+    double ws, factor = pow(2.0, 1.0 / sweep_steps), lat, ns_one = 0, ns = 0;
+    double samples[LAT_NTIMES];
+    report_result r;
+    size_t n, prev = 0, max_lines = (size_t) (sweep_max / stride);
+    long steps;
+    int k;
+    char text[32], variant[32];
+
+    print_header();
+    /* 1e-9 slack so rounding in the geometric steps cannot drop the last size */
+    for (ws = sweep_min; ws <= sweep_max * (1.0 + 1e-9); ws *= factor) {
+        n = (size_t) (ws / stride);
+        if (n < 2 || n == prev || n < (size_t) max_chains)
+            continue;
+        if (n > max_lines)
+            n = max_lines;
+        prev = n;
+        build_cycle(n);
+
+        format_bytes((double) n * stride, text, sizeof(text));
+        printf("%-12s %8zu", text, n);
+        for (k = 1; k <= max_chains; k *= 2) {
+            lat = measure(n, k, &steps, samples);
+            ns = lat * 1e9;
+            if (k == 1) {
+                ns_one = ns;
+                printf("  %10.2f", ns);
+                if (freq_ghz > 0)
+                    printf("  %6.1f", ns * freq_ghz);
+            } else {
+                printf("  %11.2f", ns);
+            }
+            fflush(stdout);
+
+            snprintf(variant, sizeof(variant), "%d chain%s", k, k > 1 ? "s" : "");
+            memset(&r, 0, sizeof(r));
+            r.kernel = "chase";
+            r.variant = variant;
+            r.working_set = (double) n * stride;
+            r.bytes = (double) steps * k * sizeof(void *);
+            r.rate = ns;
+            r.unit = "ns/load";
+            r.times = samples;
+            r.ntimes = LAT_NTIMES;
+            report_add(&r);
+        }
+        if (max_chains > 1)
+            printf("  %5.2f", ns_one / ns);
+        printf("\n");
+    }
+}
+
+#ifdef _OPENMP
+/*
+ * Triad over the arrays of load thread i, load_chunk elements at a time
+ * with delay empty iterations after each chunk, until load_stop is set.
+ * Returns the bytes moved, counted as in STREAM (three words per element).
+ */
+static double load_triad(int i, long delay)
+{
+    double *a = load_a[i], *b = load_b[i], *c = load_c[i], bytes = 0;
+    size_t len = (size_t) (load_size / (3 * sizeof(double))), lo = 0, hi, j;
+    long d;
+    int stop = 0;
+
+    while (!stop) {
+        hi = lo + load_chunk < len ? lo + load_chunk : len;
+        for (j = lo; j < hi; j++)
+            a[j] = b[j] + LOAD_SCALAR * c[j];
+        bytes += 3.0 * sizeof(double) * (double) (hi - lo);
+        lo = hi < len ? hi : 0;
+        /* The empty asm keeps the delay loop from being removed */
+        for (d = 0; d < delay; d++)
+            __asm__ volatile ("" ::: "memory");
+#pragma omp atomic read
+        stop = load_stop;
+    }
+    return bytes;
+}
+
+/*
+ * Allocate the load arrays; pages_alloc() leaves them untouched, so each
+ * is first touched, and placed, by the thread using it
+ */
+static void alloc_load(void)
+{
+    size_t len = (size_t) (load_size / (3 * sizeof(double))), j;
+    int i;
+
+    load_a = calloc(load_threads, sizeof(*load_a));
+    load_b = calloc(load_threads, sizeof(*load_b));
+    load_c = calloc(load_threads, sizeof(*load_c));
+    if (load_a == NULL || load_b == NULL || load_c == NULL) {
+        fprintf(stderr, "Failed to allocate the load arrays\n");
+        exit(1);
+    }
+    for (i = 0; i < load_threads; i++) {
+        load_a[i] = pages_alloc(len * sizeof(double), pages);
+        load_b[i] = pages_alloc(len * sizeof(double), pages);
+        load_c[i] = pages_alloc(len * sizeof(double), pages);
+        if (load_a[i] == NULL || load_b[i] == NULL || load_c[i] == NULL)
+            exit(1);
+    }
+#pragma omp parallel private(i, j)
+    {
+        i = omp_get_thread_num() - 1;
+        if (i >= 0) {
+            for (j = 0; j < len; j++) {
+                load_a[i][j] = 0.0;
+                load_b[i][j] = 1.0;
+                load_c[i][j] = 2.0;
+            }
+        }
+    }
+}
+
+static void free_load(void)
+{
+    int i;
+
+    for (i = 0; i < load_threads; i++) {
+        pages_free(load_a[i]);
+        pages_free(load_b[i]);
+        pages_free(load_c[i]);
+    }
+    free(load_a);
+    free(load_b);
+    free(load_c);
+}
+
+/*
+ * One loaded measurement: thread 0 runs measure() on the n-line cycle
+ * while the others run load_triad() until it is done.  Returns the best
+ * time per load and sets *gbs to the summed bandwidth of the load threads.
+ */
+static double measure_loaded(size_t n, long delay, double *gbs, long *steps, double *samples)
+{
+    double lat = 0, rate = 0;
+
+#pragma omp atomic write
+    load_stop = 0;
+#pragma omp parallel reduction(+:rate)
+    {
+        double t, bytes;
+
+        if (omp_get_thread_num() == 0) {
+            lat = measure(n, 1, steps, samples);
+#pragma omp atomic write
+            load_stop = 1;
+        } else {
+            t = timer_seconds();
+            bytes = load_triad(omp_get_thread_num() - 1, delay);
+            rate += bytes / (timer_seconds() - t);
+        }
+    }
+    *gbs = rate * 1e-9;
+    return lat;
+}
+
+static void add_loaded(const char *kernel, const char *variant, double ws, double bytes,
+                       double rate, const char *unit, const double *times, int ntimes)
+{
+    report_result r;
+
+    memset(&r, 0, sizeof(r));
+    r.kernel = kernel;
+    r.variant = variant;
+    r.working_set = ws;
+    r.bytes = bytes;
+    r.rate = rate;
+    r.unit = unit;
+    r.times = times;
+    r.ntimes = ntimes;
+    report_add(&r);
+}
+
+/*
+ * The loaded-latency curve: the unloaded latency, then one row per delay
+ * with the load bandwidth achieved and the median and best latency under
+ * it.  The median is the headline figure, as contention widens the spread.
+ */
+static void run_loaded(void)
+{
+    size_t n = (size_t) (sweep_max / stride);
+    double samples[LAT_NTIMES], gbs, best, median, idle = 0;
+    stats_summary st;
+    long steps;
+    int d;
+    char variant[32];
+
+    build_cycle(n);
+    printf("Load threads  Delay  Load GB/s  Median ns   Best ns");
+    if (freq_ghz > 0)
+        printf("  Cycles");
+    printf("  vs idle\n");
+    for (d = -1; d < load_ndelays; d++) {
+        if (d < 0) {
+            best = measure(n, 1, &steps, samples);
+            gbs = 0;
+        } else {
+            best = measure_loaded(n, load_delays[d], &gbs, &steps, samples);
+        }
+        stats_summarize(samples, LAT_NTIMES, &st);
+        median = st.median / (double) steps * 1e9;
+        if (d < 0)
+            idle = median;
+        if (d < 0)
+            printf("%12s  %5s", "idle", "-");
+        else
+            printf("%12d  %5ld", load_threads, load_delays[d]);
+        printf("  %9.2f  %9.2f  %8.2f", gbs, median, best * 1e9);
+        if (freq_ghz > 0)
+            printf("  %6.1f", median * freq_ghz);
+        printf("  %6.2fx\n", median / idle);
+        fflush(stdout);
+
+        if (d < 0)
+            snprintf(variant, sizeof(variant), "idle");
+        else
+            snprintf(variant, sizeof(variant), "delay %ld", load_delays[d]);
+        add_loaded("loaded-chase", variant, (double) n * stride, (double) steps * sizeof(void *),
+                   median, "ns/load", samples, LAT_NTIMES);
+        if (d >= 0)
+            add_loaded("loaded-triad", variant, load_size * load_threads, 0, gbs, "GB/s",
+                       NULL, 0);
+    }
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    size_t len;
+    char page_text[96];
+
+    parse_args(argc, argv);
+    if (report_open("latency", out_format, out_path) != 0)
+        exit(1);
+    if (sweep_max < 2.0 * stride * max_chains) {
+        fprintf(stderr, "Sweep range too small: need at least %zu bytes\n",
+                2 * stride * max_chains);
+        exit(1);
+    }
+    if (load_threads > 0) {
+#ifndef _OPENMP
+        fprintf(stderr, "--loaded needs an OpenMP build (make openmp)\n");
+        exit(1);
+#else
+        if (max_chains > 1) {
+            fprintf(stderr, "--loaded chases a single chain; drop --chains\n");
+            exit(1);
+        }
+        omp_set_num_threads(load_threads + 1);
+#endif
+    }
+    if (freq_ghz == 0)
+        freq_ghz = detect_freq_ghz();
+
+    len = (size_t) (sweep_max / stride) * stride;
+    buf = pages_alloc(len, pages);
+    if (buf == NULL)
+        exit(1);
+    order = malloc(len / stride * sizeof(*order));
+    if (order == NULL) {
+        fprintf(stderr, "Failed to allocate the visiting order\n");
+        exit(1);
+    }
+
+    printf("-------------------------------------------------------------\n");
+    printf("Memory latency (pointer chase)%s\n", load_threads > 0 ? " under load" : "");
+    printf("-------------------------------------------------------------\n");
+    if (load_threads > 0) {
+        printf("Working set = %.0f bytes (the --sweep maximum), one chain.\n",
+               (double) (len / stride) * stride);
+        printf("Load = %d thread%s of Triad on %.1f MiB each, %zu elements between\n",
+               load_threads, load_threads > 1 ? "s" : "", load_size / (1024.0 * 1024.0),
+               load_chunk);
+        printf(" delays; bandwidth counts 3 words per element as in STREAM.\n");
+    } else {
+        printf("Working-set sweep from %.0f to %.0f bytes, %d sizes per doubling.\n",
+               sweep_min, sweep_max, sweep_steps);
+    }
+    printf("Stride = %zu bytes, random cyclic permutation, up to %d chain%s.\n",
+           stride, max_chains, max_chains > 1 ? "s" : "");
+    printf("Buffer aligned to %lu bytes, %s pages requested.\n",
+           (unsigned long) PAGES_ALIGN, pages_name(pages));
+    printf("Best of %d samples of at least %g s each, timer %s.\n",
+           LAT_NTIMES, min_time, timer_name());
+    if (freq_ghz > 0)
+        printf("Core frequency: %.2f GHz\n", freq_ghz);
+    else
+        printf("Core frequency: unknown (pass --freq GHZ for latency in cycles)\n");
+
+    if (affinity_apply(&bind_cfg) != 0)
+        exit(1);
+    printf("Thread binding = %s\n", affinity_name(&bind_cfg));
+    affinity_report(stdout);
+#ifdef _OPENMP
+    if (load_threads > 0)
+        alloc_load();
+#endif
+    printf("-------------------------------------------------------------\n");
+
+    report_param_num("sweep_min_bytes", sweep_min);
+    report_param_num("sweep_max_bytes", sweep_max);
+    report_param_int("sweep_steps", sweep_steps);
+    report_param_num("min_time", min_time);
+    report_param_int("stride", (long long) stride);
+    report_param_int("max_chains", max_chains);
+    report_param_int("ntimes", LAT_NTIMES);
+    report_param_str("pages", pages_name(pages));
+    report_param_num("freq_ghz", freq_ghz);
+    report_param_str("binding", affinity_name(&bind_cfg));
+    if (load_threads > 0) {
+        report_param_int("load_threads", load_threads);
+        report_param_num("load_size_bytes", load_size);
+        report_param_int("load_chunk", (long long) load_chunk);
+    }
+
+#ifdef _OPENMP
+    if (load_threads > 0) {
+        run_loaded();
+        free_load();
+        printf("-------------------------------------------------------------\n");
+        printf("Load GB/s is the Triad bandwidth of the load threads during the\n");
+        printf("measurement; vs idle is the median latency over the unloaded one.\n");
+    } else
+#endif
+    {
+        run_sweep();
+        printf("-------------------------------------------------------------\n");
+        if (max_chains > 1)
+            printf("MLP = single-chain latency / time per load with %d chains.\n",
+                   max_chains);
+    }
+
+    /* The largest working set has touched the whole buffer by now */
+    pages_describe(buf, page_text, sizeof(page_text));
+    printf("Pages obtained = %s.\n", page_text);
+    report_param_str("pages_obtained", page_text);
+
+    free(order);
+    pages_free(buf);
+    report_end();
+    return 0;
+}
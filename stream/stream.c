@@ -40,11 +40,24 @@
 /*-----------------------------------------------------------------------*/
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
 #include <unistd.h>
 #include <math.h>
 #include <float.h>
 #include <limits.h>
-#include <sys/time.h>
+#include "stream_kernels.h"
+#include "affinity.h"
+#include "timer.h"
+#include "report.h"
+#include "stats.h"
+#include "counters.h"
+#include "energy.h"
+#include "tune.h"
+#include "pages.h"
+#include "schedule.h"
 
 #ifndef STREAM_ARRAY_SIZE
 #   define STREAM_ARRAY_SIZE 10000000
@@ -54,61 +67,1228 @@
 #   define NTIMES 10
 #endif
 
+/*
+ * Upper bound on iterations with adaptive repetition (--ci).  The kernels
+ * grow the values by 15x per iteration, so much beyond this the validation
+ * values would overflow.
+ */
+#ifndef STREAM_MAX_ITER
+#   define STREAM_MAX_ITER 200
+#endif
+
+#if NTIMES < 2 || STREAM_MAX_ITER < NTIMES
+#   error "need 2 <= NTIMES <= STREAM_MAX_ITER"
+#endif
+
 #ifndef OFFSET
 #   define OFFSET 0
 #endif
 
+/*
+ * Elements per tile of the tiled fused pass (--tile).  The three tiles of
+ * a, b and c take 192 KiB in fp64, which an L2 cache holds.
+ */
+#ifndef STREAM_TILE
+#   define STREAM_TILE 8192
+#endif
+
+/*
+ * The element type is chosen at run time with --type; STREAM_TYPE only
+ * selects the default (fp32 if it is float, fp64 otherwise).
+ */
 #ifndef STREAM_TYPE
 #   define STREAM_TYPE double
 #endif
 
-static STREAM_TYPE a[STREAM_ARRAY_SIZE+OFFSET],
-                   b[STREAM_ARRAY_SIZE+OFFSET],
-                   c[STREAM_ARRAY_SIZE+OFFSET];
+/*
+ * Arrays are allocated at run time so that the size and offset can be
+ * changed with --size/--offset without rebuilding.  STREAM_ARRAY_SIZE and
+ * OFFSET only provide the defaults.  Allocations come from pages.h,
+ * aligned to PAGES_ALIGN bytes (a 2 MiB hugepage) and backed by the page
+ * size of --pages.
+ */
+
+static char *a, *b, *c;
+static void *a_base, *b_base, *c_base;
+
+static precision elem_type = sizeof(STREAM_TYPE) == 4 ? PREC_FP32 : PREC_FP64;
+static const stream_type_kernels *elem;
+static size_t elem_size;
+
+/*
+ * Per-type run parameters.  fp64 and fp32 use the STREAM scalar, for
+ * which the values grow 15x per iteration; that limits fp32 to 30
+ * iterations.  fp16 and bf16 could not hold even NTIMES such iterations,
+ * so they use sqrt(2)-1, for which an iteration maps the values onto
+ * themselves.  epsilon is the validation threshold: the STREAM values for
+ * fp64 and fp32 and 16 units of roundoff for the 16-bit types.
+ */
+static const struct {
+    double scalar;
+    double epsilon;
+    int max_iter;
+} type_params[] = {
+    [PREC_FP64] = { 3.0, 1.e-13, STREAM_MAX_ITER },
+    [PREC_FP32] = { 3.0, 1.e-6, 30 },
+    [PREC_FP16] = { 0.41421356237309505, 16.0 / 2048, STREAM_MAX_ITER },
+    [PREC_BF16] = { 0.41421356237309505, 16.0 / 256, STREAM_MAX_ITER },
+};
+
+static ssize_t stream_array_size = STREAM_ARRAY_SIZE;
+static ssize_t array_offset = OFFSET;
+static page_mode pages = PAGES_DEFAULT;
 
 static double avgtime[4] = {0}, maxtime[4] = {0}, mintime[4] = {FLT_MAX,FLT_MAX,FLT_MAX,FLT_MAX};
 
 static char *label[4] = {"Copy:      ", "Scale:     ", "Add:       ", "Triad:     "};
+static const char *kernel_name[4] = {"Copy", "Scale", "Add", "Triad"};
 
-static double bytes[4] = {
-    2 * sizeof(STREAM_TYPE) * STREAM_ARRAY_SIZE,
-    2 * sizeof(STREAM_TYPE) * STREAM_ARRAY_SIZE,
-    3 * sizeof(STREAM_TYPE) * STREAM_ARRAY_SIZE,
-    3 * sizeof(STREAM_TYPE) * STREAM_ARRAY_SIZE
-};
+/*
+ * bytes[] is the traffic the kernels ask for (the STREAM convention).
+ * wa_bytes[] adds the write-allocate read of each destination line that
+ * ordinary stores cause; it is the "actual" traffic for --store normal,
+ * while the other store modes avoid that read and move bytes[].
+ */
+static double bytes[4], wa_bytes[4];
+static int store_mode = STORE_NORMAL;
+static affinity_config bind_cfg = { BIND_NONE };
+
+/* --sweep: working-set range in bytes (all three arrays), points per
+ * doubling of the size, and the minimum duration of one timed sample */
+static double sweep_min = 0, sweep_max = 0;
+static int sweep_steps = 2;
+static double sweep_min_time = 0.05;
+
+/*
+ * --ci/--max-iter: with ci_target > 0 the kernels run at least NTIMES
+ * times and then until the confidence interval of every kernel's median
+ * time is within +/- ci_target of the median, or max_iter iterations.
+ * ntimes is the number of iterations the last pass actually ran.
+ */
+static double ci_target = 0;
+static int max_iter = STREAM_MAX_ITER;
+static int ntimes = NTIMES;
+
+/*
+ * --persistent: one parallel region spans all iterations and each thread
+ * times its own slice between two barriers.  times[][] then holds the
+ * slowest thread's slice; slice_min[][] the fastest one and sync_time[][]
+ * what the barriers add on top of the slowest slice.
+ */
+static int persistent = 0;
+static double slice_min[4][STREAM_MAX_ITER], sync_time[4][STREAM_MAX_ITER];
+
+/*
+ * --fused: after the four kernels, time whole iterations two more ways.
+ * "pass" runs all four kernels per element in one loop, which reads a and
+ * writes a, b and c: 4 words per element instead of the 10 of the
+ * separate kernels, for the same 4 FLOPs.  "tiled" runs the four kernels
+ * one tile of fused_tile elements at a time, so the tile stays in cache
+ * between kernels; memory then sees the traffic of the one-pass loop
+ * while the cache still serves all 10 words.
+ */
+static int fused = 0;
+static ssize_t fused_tile = STREAM_TILE;
+
+/*
+ * --autotune/--profile (tune.h): the tile of the tiled pass and, in RVV
+ * builds, the LMUL of the intrinsic kernels come from the per-host tuning
+ * profile unless --tile or --lmul is given; --autotune searches them
+ * before the main loop and stores the winners.
+ */
+static int autotune = 0;
+static tune_strategy tune_kind = TUNE_HALVING;
+static int tile_given = 0, lmul_given = 0;
+static const char *tuning = "defaults";
+
+/* --format/--output: machine-readable record, see report.h */
+static report_format out_format = REPORT_TEXT;
+static const char *out_path = NULL;
 
 extern double mysecond();
 extern void checkSTREAMresults();
 
 #ifdef _OPENMP
 extern int omp_get_num_threads();
+extern int omp_get_thread_num();
+extern int omp_get_max_threads();
+#endif
+
+#ifdef STREAM_RVV
+#ifndef STREAM_RVV_LMUL
+#   define STREAM_RVV_LMUL 4
+#endif
+static int rvv_lmul = STREAM_RVV_LMUL;
+#endif
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  -n, --size N           elements per array (default %llu)\n",
+            (unsigned long long) STREAM_ARRAY_SIZE);
+    fprintf(stderr, "  -o, --offset N         offset of each array in elements (default %d)\n", OFFSET);
+    fprintf(stderr, "      --pages MODE       pages of the arrays: default, 4k, 2m (THP) or 1g\n");
+    fprintf(stderr, "                         (hugetlbfs); see common/pages.h (default default)\n");
+    fprintf(stderr, "  -H, --hugepages        same as --pages 2m\n");
+    fprintf(stderr, "      --type TYPE        element type: %s (default %s)\n",
+            precision_list(), precision_name(elem_type));
+    fprintf(stderr, "  -b, --bind SPEC        pin threads: none, compact, spread or a CPU list\n");
+    fprintf(stderr, "                         such as 0,2,4-7 (default none)\n");
+    fprintf(stderr, "  -t, --timer NAME       monotonic-raw, monotonic, gettimeofday, rdtime or\n");
+    fprintf(stderr, "                         rdcycle (default monotonic-raw)\n");
+    fprintf(stderr, "  -s, --store MODE       store mode: normal, nt (x86 streaming stores) or\n");
+    fprintf(stderr, "                         cbo-zero (RISC-V Zicboz prefill) (default normal)\n");
+#ifdef STREAM_RVV
+    fprintf(stderr, "  -l, --lmul N           LMUL of the RVV kernels: 1, 2, 4 or 8 (default %d)\n",
+            STREAM_RVV_LMUL);
+#endif
+    fprintf(stderr, "  -S, --sweep MIN:MAX    instead of one run, sweep the working set of all\n");
+    fprintf(stderr, "                         three arrays from MIN to MAX bytes (e.g. 4K:4G)\n");
+    fprintf(stderr, "      --sweep-steps N    sizes per doubling of the working set (default 2)\n");
+    fprintf(stderr, "      --min-time SEC     minimum duration of each timed sample in the\n");
+    fprintf(stderr, "                         sweep (default 0.05)\n");
+    fprintf(stderr, "      --persistent       time each thread's slice inside one parallel\n");
+    fprintf(stderr, "                         region for all iterations, instead of a region\n");
+    fprintf(stderr, "                         per kernel, and report the barrier overhead\n");
+    fprintf(stderr, "      --fused            also time each iteration fused into one pass and\n");
+    fprintf(stderr, "                         tiled so each tile stays in cache across kernels\n");
+    fprintf(stderr, "      --tile N           elements per tile of the tiled pass (default %d)\n",
+            STREAM_TILE);
+    fprintf(stderr, "      --autotune[=SEARCH] search the tile size%s by grid or halving\n",
+#ifdef STREAM_RVV
+            " and LMUL"
+#else
+            ""
+#endif
+            );
+    fprintf(stderr, "                         (default halving), store the winners in the\n");
+    fprintf(stderr, "                         tuning profile and run with them\n");
+    fprintf(stderr, "      --profile FILE     tuning profile to load at startup and --autotune\n");
+    fprintf(stderr, "                         into, or none (default $BENCH_TUNE_PROFILE or\n");
+    fprintf(stderr, "                         ~/.config/riscv-hpc-bench/tune.profile)\n");
+    fprintf(stderr, "  -c, --ci FRAC          repeat until the %.0f%% CI of each median time is\n",
+            STATS_CONFIDENCE * 100.0);
+    fprintf(stderr, "                         within +/- FRAC of it, e.g. 0.01 (default off)\n");
+    fprintf(stderr, "      --max-iter N       iteration limit for --ci (default and maximum %d)\n",
+            STREAM_MAX_ITER);
+    fprintf(stderr, "      --counters LIST    count hardware events per kernel and thread:\n");
+    fprintf(stderr, "                         default or a list such as cycles,instructions,\n");
+    fprintf(stderr, "                         cache-misses,llc-load-misses,raw:0xCODE\n");
+    fprintf(stderr, "      --energy[=LIST]    joules, watts and MB/s per watt of each kernel from\n");
+    fprintf(stderr, "                         auto, rapl, hwmon or sensor paths, interval=MS\n");
+    fprintf(stderr, "                         (default auto; see common/energy.h)\n");
+    fprintf(stderr, "  -f, --format FMT       also write a text, json or csv record (default text)\n");
+    fprintf(stderr, "      --output FILE      write the record to FILE instead of stdout\n");
+    fprintf(stderr, "  -h, --help             show this message\n");
+}
+
+static int parse_count(const char *arg, ssize_t *value)
+{
+    char *end;
+    long long v;
+
+    errno = 0;
+    v = strtoll(arg, &end, 10);
+    if (errno != 0 || end == arg || *end != '\0' || v < 0)
+        return -1;
+    *value = (ssize_t) v;
+    return 0;
+}
+
+/* Parse a byte count with an optional binary K, M or G suffix */
+static int parse_bytes(const char *arg, char **end, double *value)
+{
+    double v = strtod(arg, end);
+
+    if (*end == arg || v <= 0)
+        return -1;
+    switch (**end) {
+    case 'K': case 'k': v *= 1024.0; (*end)++; break;
+    case 'M': case 'm': v *= 1024.0 * 1024.0; (*end)++; break;
+    case 'G': case 'g': v *= 1024.0 * 1024.0 * 1024.0; (*end)++; break;
+    }
+    *value = v;
+    return 0;
+}
+
+static int parse_range(const char *arg, double *lo, double *hi)
+{
+    char *end;
+
+    if (parse_bytes(arg, &end, lo) != 0 || *end != ':')
+        return -1;
+    if (parse_bytes(end + 1, &end, hi) != 0 || *end != '\0' || *hi < *lo)
+        return -1;
+    return 0;
+}
+
+static void parse_args(int argc, char *argv[])
+{
+    static const struct option long_options[] = {
+        {"size",      required_argument, NULL, 'n'},
+        {"offset",    required_argument, NULL, 'o'},
+        {"hugepages", no_argument,       NULL, 'H'},
+        {"pages",     required_argument, NULL, 'G'},
+        {"type",      required_argument, NULL, 'y'},
+        {"bind",      required_argument, NULL, 'b'},
+        {"timer",     required_argument, NULL, 't'},
+        {"store",     required_argument, NULL, 's'},
+        {"lmul",      required_argument, NULL, 'l'},
+        {"sweep",       required_argument, NULL, 'S'},
+        {"sweep-steps", required_argument, NULL, 'P'},
+        {"min-time",    required_argument, NULL, 'T'},
+        {"persistent",  no_argument,       NULL, 'R'},
+        {"fused",       no_argument,       NULL, 'F'},
+        {"tile",        required_argument, NULL, 'L'},
+        {"autotune",    optional_argument, NULL, 'A'},
+        {"profile",     required_argument, NULL, 'p'},
+        {"ci",        required_argument, NULL, 'c'},
+        {"max-iter",  required_argument, NULL, 'M'},
+        {"counters",  required_argument, NULL, 'e'},
+        {"energy",    optional_argument, NULL, 'E'},
+        {"format",    required_argument, NULL, 'f'},
+        {"output",    required_argument, NULL, 'O'},
+        {"help",      no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "n:o:Hb:t:s:l:S:c:f:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'n':
+            if (parse_count(optarg, &stream_array_size) != 0 || stream_array_size == 0) {
+                fprintf(stderr, "Invalid array size: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'o':
+            if (parse_count(optarg, &array_offset) != 0) {
+                fprintf(stderr, "Invalid offset: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'H':
+            pages = PAGES_2M;
+            break;
+        case 'G':
+            if (pages_parse(optarg, &pages) != 0) {
+                fprintf(stderr, "Invalid pages: %s (default, 4k, 2m or 1g)\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'y':
+            if (precision_parse(optarg, &elem_type) != 0)
+                exit(1);
+            break;
+        case 'b':
+            if (affinity_parse(optarg, &bind_cfg) != 0) {
+                fprintf(stderr, "Invalid binding: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 't':
+            if (timer_select(optarg) != 0)
+                exit(1);
+            break;
+        case 's':
+            if (stream_store_parse(optarg, &store_mode) != 0) {
+                fprintf(stderr, "Unknown store mode: %s\n", optarg);
+                exit(1);
+            }
+            break;
+#ifdef STREAM_RVV
+        case 'l':
+            rvv_lmul = atoi(optarg);
+            lmul_given = 1;
+            break;
+#endif
+        case 'S':
+            if (parse_range(optarg, &sweep_min, &sweep_max) != 0) {
+                fprintf(stderr, "Invalid sweep range: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'P':
+            sweep_steps = atoi(optarg);
+            if (sweep_steps < 1) {
+                fprintf(stderr, "Invalid sweep steps: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'T':
+            sweep_min_time = atof(optarg);
+            if (sweep_min_time <= 0) {
+                fprintf(stderr, "Invalid minimum time: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'R':
+            persistent = 1;
+            break;
+        case 'F':
+            fused = 1;
+            break;
+        case 'L':
+            if (parse_count(optarg, &fused_tile) != 0 || fused_tile == 0) {
+                fprintf(stderr, "Invalid tile size: %s\n", optarg);
+                exit(1);
+            }
+            tile_given = 1;
+            break;
+        case 'A':
+            autotune = 1;
+            if (optarg != NULL && tune_parse_strategy(optarg, &tune_kind) != 0) {
+                fprintf(stderr, "Unknown search: %s (grid or halving)\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'p':
+            tune_set_profile(optarg);
+            break;
+        case 'c':
+            ci_target = atof(optarg);
+            if (ci_target <= 0) {
+                fprintf(stderr, "Invalid confidence interval width: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'M':
+            max_iter = atoi(optarg);
+            if (max_iter < NTIMES || max_iter > STREAM_MAX_ITER) {
+                fprintf(stderr, "Invalid iteration limit: %s (must be %d to %d)\n",
+                        optarg, NTIMES, STREAM_MAX_ITER);
+                exit(1);
+            }
+            break;
+        case 'e':
+            if (counters_parse(optarg) != 0) {
+                fprintf(stderr, "Invalid counter list: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'E':
+            if (energy_parse(optarg != NULL ? optarg : "auto") != 0) {
+                fprintf(stderr, "Invalid energy sensor list: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'f':
+            if (report_parse_format(optarg, &out_format) != 0) {
+                fprintf(stderr, "Unknown format: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'O':
+            out_path = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+}
+
+/*
+ * Allocate one array of n elements starting array_offset elements past a
+ * PAGES_ALIGN boundary.  The pages are deliberately not touched here: the
+ * parallel initialisation loop in main() faults them in with the same
+ * static schedule as the kernels, so on NUMA systems each thread's slice
+ * lands on the node it runs on.
+ */
+static char *alloc_array(void **base, ssize_t n)
+{
+    size_t len = (size_t) (n + array_offset) * elem_size;
+
+    *base = pages_alloc(len, pages);
+    if (*base == NULL)
+        exit(1);
+    return (char *) *base + array_offset * elem_size;
+}
+
+/*
+ * The kernel sets in stream_kernels.h work on one contiguous slice per
+ * thread, from schedule_slice(), so each thread streams through the pages
+ * it first-touched during initialisation.  Signed, as the array size is.
+ */
+static void thread_range(ssize_t n, ssize_t *lo, ssize_t *hi)
+{
+    size_t l, h;
+
+    schedule_slice((size_t) n, &l, &h);
+    *lo = (ssize_t) l;
+    *hi = (ssize_t) h;
+}
+
+/* Set the first n elements of the arrays, split as in the kernels */
+static void fill_arrays(ssize_t n, double va, double vb, double vc)
+{
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        ssize_t lo, hi;
+        size_t o;
+
+        thread_range(n, &lo, &hi);
+        o = (size_t) lo * elem_size;
+        elem->fill(a + o, va, hi - lo);
+        elem->fill(b + o, vb, hi - lo);
+        elem->fill(c + o, vc, hi - lo);
+    }
+}
+
+/*
+ * One kernel on elements [lo, hi): with a double-precision kernel set from
+ * stream_kernels.h, or with the element type's reference loops if kern is
+ * NULL.
+ */
+static void run_slice(int kernel, const stream_kernels *kern, ssize_t lo, ssize_t hi)
+{
+    double scalar = type_params[elem_type].scalar;
+    size_t o = (size_t) lo * elem_size, n = hi - lo;
+    double *da = (double *) a, *db = (double *) b, *dc = (double *) c;
+
+    if (kern != NULL) {
+        switch (kernel) {
+        case 0: kern->copy(dc+lo, da+lo, n); break;
+        case 1: kern->scale(db+lo, dc+lo, scalar, n); break;
+        case 2: kern->add(dc+lo, da+lo, db+lo, n); break;
+        case 3: kern->triad(da+lo, db+lo, dc+lo, scalar, n); break;
+        }
+        return;
+    }
+    switch (kernel) {
+    case 0: elem->copy(c+o, a+o, n); break;
+    case 1: elem->scale(b+o, c+o, scalar, n); break;
+    case 2: elem->add(c+o, a+o, b+o, n); break;
+    case 3: elem->triad(a+o, b+o, c+o, scalar, n); break;
+    }
+}
+
+/* Reset to the state checkSTREAMresults() expects before the main loop:
+ * the initial values with a[] already doubled by the timer test */
+static void reset_arrays(void)
+{
+    fill_arrays(stream_array_size, 2.0, 2.0, 0.0);
+}
+
+/*
+ * Whether to run another iteration after k: always up to NTIMES, then
+ * with --ci until every kernel's interval (excluding the first iteration)
+ * is tight enough.
+ */
+static int keep_iterating(int k, double times[4][STREAM_MAX_ITER])
+{
+    stats_summary st;
+    int j;
+
+    if (k < NTIMES)
+        return 1;
+    if (ci_target <= 0 || k >= max_iter)
+        return 0;
+    for (j=0; j<4; j++) {
+        stats_summarize(times[j] + 1, k - 1, &st);
+        if (!stats_converged(&st, ci_target))
+            return 1;
+    }
+    return 0;
+}
+
+/*
+ * Counter and energy regions of the four kernels in one pass, e.g.
+ * "autovec:Copy"; the energy efficiency counts bytes[] like Best Rate.
+ */
+static void counter_regions(const char *variant, int ids[4], int energy_ids[4])
+{
+    char name[48];
+    int j;
+
+    for (j=0; j<4; j++) {
+        snprintf(name, sizeof(name), "%s:%s", variant, kernel_name[j]);
+        ids[j] = counters_region(name);
+        energy_ids[j] = energy_region(name);
+        energy_work(energy_ids[j], 1.0E-06 * bytes[j], "MB/s");
+    }
+}
+
+static void run_kernels(const stream_kernels *kern, const char *variant,
+                        double times[4][STREAM_MAX_ITER])
+{
+    int j, k, ids[4], energy_ids[4];
+
+    counter_regions(variant, ids, energy_ids);
+    for (k=0; keep_iterating(k, times); k++)
+    {
+        for (j=0; j<4; j++) {
+            energy_begin(energy_ids[j]);
+            counters_begin(ids[j]);
+            times[j][k] = mysecond();
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+            {
+                ssize_t lo, hi;
+                thread_range(stream_array_size, &lo, &hi);
+                run_slice(j, kern, lo, hi);
+            }
+            times[j][k] = mysecond() - times[j][k];
+            counters_end(ids[j]);
+            energy_end(energy_ids[j]);
+        }
+    }
+    ntimes = k;
+}
+
+/*
+ * run_kernels() with a single parallel region.  The master decides
+ * whether to iterate again, and the barrier that follows publishes that
+ * decision and the previous iteration's times to all threads.  A kernel
+ * starts and ends with a barrier, so each thread's slice is timed
+ * without the fork/join of a new region.
+ */
+static void run_kernels_persistent(const stream_kernels *kern, const char *variant,
+                                   double times[4][STREAM_MAX_ITER])
+{
+    int ids[4], energy_ids[4], go = 1, iterations = 0, nt = 1;
+    double *slice;
+
+    counter_regions(variant, ids, energy_ids);
+#ifdef _OPENMP
+    nt = omp_get_max_threads();
+#endif
+    if ((slice = malloc(nt * sizeof(double))) == NULL) {
+        fprintf(stderr, "Failed to allocate the per-thread times\n");
+        exit(1);
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        ssize_t lo, hi;
+        double t0, start = 0;
+        int j, k, t = 0;
+
+#ifdef _OPENMP
+        t = omp_get_thread_num();
+#endif
+        thread_range(stream_array_size, &lo, &hi);
+        for (k=0; ; k++) {
+#ifdef _OPENMP
+#pragma omp master
+#endif
+            go = keep_iterating(k, times);
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+            if (!go)
+                break;
+            for (j=0; j<4; j++) {
+#ifdef _OPENMP
+#pragma omp master
+#endif
+                {
+                    energy_begin(energy_ids[j]);
+                    counters_begin(ids[j]);
+                    start = mysecond();
+                }
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+                t0 = mysecond();
+                run_slice(j, kern, lo, hi);
+                slice[t] = mysecond() - t0;
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp master
+#endif
+                {
+                    double region = mysecond() - start, lo_t = slice[0], hi_t = slice[0];
+                    int i, n = 1;
+
+#ifdef _OPENMP
+                    n = omp_get_num_threads();
+#endif
+                    counters_end(ids[j]);
+                    energy_end(energy_ids[j]);
+                    for (i = 1; i < n; i++) {
+                        lo_t = slice[i] < lo_t ? slice[i] : lo_t;
+                        hi_t = slice[i] > hi_t ? slice[i] : hi_t;
+                    }
+                    times[j][k] = hi_t;
+                    slice_min[j][k] = lo_t;
+                    sync_time[j][k] = region - hi_t;
+                }
+            }
+        }
+#ifdef _OPENMP
+#pragma omp master
+#endif
+        iterations = k;
+    }
+    ntimes = iterations;
+    free(slice);
+}
+
+/* Median fastest and slowest slice and barrier overhead per kernel, from
+ * the last run_kernels_persistent() */
+static void summarize_persistent(const char *variant, double times[4][STREAM_MAX_ITER])
+{
+    stats_summary lo, hi, sync;
+    char name[48];
+    int j;
+
+    printf("Persistent region, median over iterations of the per-thread slices:\n");
+    printf("Function    Slowest (us) Fastest (us) Imbalance  Barriers (us)  MB/s with barriers\n");
+    for (j=0; j<4; j++) {
+        stats_summarize(times[j] + 1, ntimes - 1, &hi);
+        stats_summarize(slice_min[j] + 1, ntimes - 1, &lo);
+        stats_summarize(sync_time[j] + 1, ntimes - 1, &sync);
+        printf("%s%12.2f %12.2f %8.2f%%  %13.2f  %18.1f\n", label[j],
+               1.0E6 * hi.median, 1.0E6 * lo.median,
+               100.0 * (hi.median - lo.median) / hi.median, 1.0E6 * sync.median,
+               1.0E-06 * bytes[j] / (hi.median + sync.median));
+        snprintf(name, sizeof(name), "%s_%s_barrier_us", variant, kernel_name[j]);
+        report_param_num(name, 1.0E6 * sync.median);
+    }
+    printf("-------------------------------------------------------------\n");
+}
+
+/*
+ * --fused: ntimes iterations of the four kernels as one pass per element
+ * or tile by tile, timed per iteration, so the arrays end in the state
+ * checkSTREAMresults() expects of the separate kernels.
+ */
+static void fused_iteration(int tiled)
+{
+    double scalar = type_params[elem_type].scalar;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        ssize_t lo, hi, t, end;
+        size_t o;
+        int j;
+
+        thread_range(stream_array_size, &lo, &hi);
+        if (!tiled) {
+            o = (size_t) lo * elem_size;
+            elem->fused(a + o, b + o, c + o, scalar, hi - lo);
+        } else {
+            for (t = lo; t < hi; t += fused_tile) {
+                end = t + fused_tile < hi ? t + fused_tile : hi;
+                for (j=0; j<4; j++)
+                    run_slice(j, NULL, t, end);
+            }
+        }
+    }
+}
+
+static void run_fused(int tiled, double *times)
+{
+    const char *name = tiled ? "fused:tiled" : "fused:pass";
+    int k, id = counters_region(name), energy_id = energy_region(name);
+
+    /* The 4 words per element that memory must move, as in Best Rate */
+    energy_work(energy_id, 1.0E-06 * 4 * elem_size * (double) stream_array_size, "MB/s");
+    for (k=0; k<ntimes; k++) {
+        energy_begin(energy_id);
+        counters_begin(id);
+        times[k] = mysecond();
+        fused_iteration(tiled);
+        times[k] = mysecond() - times[k];
+        counters_end(id);
+        energy_end(energy_id);
+    }
+}
+
+/*
+ * Rates of the fused passes.  Best Rate counts the 4 words per element
+ * that memory must move and Actual adds the write-allocate reads of b and
+ * c.  Unfused MB/s is the rate at which the separate kernels, 10 words
+ * per element, would have to run to finish an iteration as fast, and
+ * Speedup compares with the sum of their best times, unfused_time.
+ */
+static void summarize_fused(double times[2][STREAM_MAX_ITER], double unfused_time)
+{
+    static const char *fused_label[2] = {"Fused:     ", "Tiled:     "};
+    static const char *fused_variant[2] = {"pass", "tiled"};
+    double n = (double) stream_array_size, best[2], fbytes = 4 * elem_size * n;
+    double favg, fmax;
+    report_result r;
+    stats_summary st;
+    int j, k;
+
+    printf("Fused iterations (one pass per element, and tiles of %lld elements)\n",
+           (long long) fused_tile);
+    printf("Function    Best Rate MB/s  Avg time     Min time     Max time     Actual MB/s\n");
+    for (j=0; j<2; j++) {
+        favg = 0;
+        fmax = 0;
+        best[j] = FLT_MAX;
+        for (k=1; k<ntimes; k++) {
+            favg += times[j][k];
+            best[j] = (best[j] < times[j][k]) ? best[j] : times[j][k];
+            fmax = (fmax > times[j][k]) ? fmax : times[j][k];
+        }
+        favg /= (double) (ntimes - 1);
+        printf("%s%12.1f  %11.6f  %11.6f  %11.6f  %12.1f\n", fused_label[j],
+               1.0E-06 * fbytes / best[j], favg, best[j], fmax,
+               1.0E-06 * 6 * elem_size * n / best[j]);
+
+        memset(&r, 0, sizeof(r));
+        r.kernel = "Fused";
+        r.variant = fused_variant[j];
+        r.working_set = 3.0 * elem_size * n;
+        r.bytes = fbytes;
+        r.actual_bytes = 6 * elem_size * n;
+        r.flops = 4 * n;
+        r.rate = 1.0E-06 * fbytes / best[j];
+        r.unit = "MB/s";
+        r.times = times[j] + 1;
+        r.ntimes = ntimes - 1;
+        report_add(&r);
+    }
+    printf("Function    Median MB/s   Unfused MB/s      GFLOP/s      Speedup\n");
+    for (j=0; j<2; j++) {
+        stats_summarize(times[j] + 1, ntimes - 1, &st);
+        printf("%s%12.1f  %13.1f  %11.3f  %10.2fx\n", fused_label[j],
+               1.0E-06 * fbytes / st.median,
+               1.0E-06 * 10 * elem_size * n / best[j],
+               1.0E-09 * 4 * n / best[j],
+               unfused_time / best[j]);
+    }
+    printf("Separate kernels: %.3f GFLOP/s (4 FLOPs per element in %.6f s).\n",
+           1.0E-09 * 4 * n / unfused_time, unfused_time);
+    printf("-------------------------------------------------------------\n");
+}
+
+/* The main timed pass, with a region per kernel or with --persistent */
+static void timed_pass(const stream_kernels *kern, const char *variant,
+                       double times[4][STREAM_MAX_ITER])
+{
+    if (persistent)
+        run_kernels_persistent(kern, variant, times);
+    else
+        run_kernels(kern, variant, times);
+}
+
+/*
+ * Cache-hierarchy sweep.  Each point runs the four kernels on the first n
+ * elements of the arrays.  A sample repeats one kernel reps times inside a
+ * single parallel region, with reps doubled until a sample lasts at least
+ * sweep_min_time, so small working sets are timed as accurately as large
+ * ones.  Repeating a single kernel is idempotent, so the values stay
+ * bounded however many repetitions a point needs.
+ */
+static double time_reps(int kernel, const stream_kernels *kern, ssize_t n, long reps)
+{
+    double t = mysecond();
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        ssize_t lo, hi;
+        long r;
+
+        thread_range(n, &lo, &hi);
+        for (r = 0; r < reps; r++) {
+            run_slice(kernel, kern, lo, hi);
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+        }
+    }
+    return mysecond() - t;
+}
+
+static void format_bytes(double v, char *buf, size_t len)
+{
+    static const char *units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    int u = 0;
+
+    while (v >= 1024.0 && u < 4) {
+        v /= 1024.0;
+        u++;
+    }
+    snprintf(buf, len, "%.1f %s", v, units[u]);
+}
+
+/*
+ * Tuning profile entries; the tile is per element type and size class,
+ * the largest power of two up to the array size, as --autotune leaves out
+ * tiles beyond the array
+ */
+static long long size_class(void)
+{
+    long long c = 1;
+
+    while (c <= (long long) stream_array_size / 2)
+        c *= 2;
+    return c;
+}
+
+static void tile_key(char *buf, size_t len)
+{
+    snprintf(buf, len, "stream.%s.n%lld.tile", precision_name(elem_type), size_class());
+}
+
+static void load_profile(void)
+{
+    char key[64], value[64];
+    long long v;
+
+    tile_key(key, sizeof(key));
+    if (!tile_given && tune_get(key, value, sizeof(value)) == 0 &&
+        sscanf(value, "%lld", &v) == 1 && v > 0) {
+        fused_tile = (ssize_t) v;
+        tuning = "profile";
+    }
+#ifdef STREAM_RVV
+    if (!lmul_given && tune_get("stream.rvv.lmul", value, sizeof(value)) == 0 &&
+        stream_rvv_select(atoi(value)) != NULL) {
+        rvv_lmul = atoi(value);
+        tuning = "profile";
+    }
+#endif
+}
+
+/* Search spaces of --autotune */
+static const ssize_t tune_tiles[] = {1024, 2048, 4096, 8192, 16384, 32768, 65536, 131072};
+#define TUNE_NTILES ((int) (sizeof(tune_tiles) / sizeof(tune_tiles[0])))
+#ifdef STREAM_RVV
+static const int tune_lmuls[] = {1, 2, 4, 8};
+#endif
+
+/* One tiled fused iteration with tile tune_tiles[i] */
+static double tune_tile_run(int i, void *ctx)
+{
+    double t;
+
+    (void) ctx;
+    fused_tile = tune_tiles[i];
+    t = mysecond();
+    fused_iteration(1);
+    return mysecond() - t;
+}
+
+#ifdef STREAM_RVV
+/* The four RVV kernels once each with LMUL tune_lmuls[i] */
+static double tune_lmul_run(int i, void *ctx)
+{
+    const stream_kernels *kern = stream_rvv_select(tune_lmuls[i]);
+    double t = 0;
+    int k;
+
+    (void) ctx;
+    for (k=0; k<4; k++)
+        t += time_reps(k, kern, stream_array_size, 1);
+    return t;
+}
 #endif
 
-int main()
+static void print_candidate(const char *label, double best, int runs, double bytes,
+                            int winner)
+{
+    printf("  %-12s %11.1f MB/s  %.6f s  (%d run%s)%s\n", label, 1.0E-06 * bytes / best,
+           best, runs, runs > 1 ? "s" : "", winner ? "  <- best" : "");
+}
+
+/*
+ * --autotune: search the tile of the tiled pass (rated by its 4 words per
+ * element, as in summarize_fused) and, for fp64 in RVV builds, the LMUL of
+ * the four intrinsic kernels (10 words per element over their summed
+ * times), and store the winners.  Leaves the arrays to reset_arrays()
+ * and the kernel table of the new LMUL to the caller.
+ */
+static void run_autotune(void)
+{
+    double best[TUNE_NTILES], n = (double) stream_array_size;
+    int runs[TUNE_NTILES], ncand = 0, w, k, stored;
+    char key[64], value[64], label[32];
+
+    while (ncand < TUNE_NTILES && (ncand == 0 || tune_tiles[ncand] <= stream_array_size))
+        ncand++;
+    printf("Autotuning the tile of the tiled pass (%s search, %d candidates)\n",
+           tune_strategy_name(tune_kind), ncand);
+    w = tune_search(tune_kind, ncand, tune_tile_run, NULL, best, runs);
+    for (k=0; k<ncand; k++) {
+        snprintf(label, sizeof(label), "tile %lld", (long long) tune_tiles[k]);
+        print_candidate(label, best[k], runs[k], 4 * elem_size * n, k == w);
+    }
+    fused_tile = tune_tiles[w];
+    tile_key(key, sizeof(key));
+    snprintf(value, sizeof(value), "%lld", (long long) fused_tile);
+    stored = tune_put(key, value) == 0;
+#ifdef STREAM_RVV
+    if (elem_type == PREC_FP64) {
+        printf("Autotuning the LMUL of the RVV kernels (%s search, 4 candidates)\n",
+               tune_strategy_name(tune_kind));
+        w = tune_search(tune_kind, 4, tune_lmul_run, NULL, best, runs);
+        for (k=0; k<4; k++) {
+            snprintf(label, sizeof(label), "LMUL %d", tune_lmuls[k]);
+            print_candidate(label, best[k], runs[k], 10 * elem_size * n, k == w);
+        }
+        rvv_lmul = tune_lmuls[w];
+        snprintf(value, sizeof(value), "%d", rvv_lmul);
+        stored = tune_put("stream.rvv.lmul", value) == 0 && stored;
+    }
+#endif
+    if (tune_profile() != NULL && stored)
+        printf("Stored in %s for %s, %lld-%lld elements\n", tune_profile(), tune_host(),
+               size_class(), 2 * size_class() - 1);
+    else
+        printf("Not stored (--profile none or write error)\n");
+    printf("-------------------------------------------------------------\n");
+}
+
+static void run_sweep(const stream_kernels *kern)
+{
+    static const int words[4] = {2, 2, 3, 3};
+    double ws, factor = pow(2.0, 1.0 / sweep_steps), t, best, rate[4];
+    double samples[NTIMES];
+    report_result r;
+    ssize_t n, prev = 0;
+    long reps;
+    int k, s;
+    char buf[32];
+
+    printf("Working-set sweep from %.0f to %.0f bytes, %d sizes per doubling,\n",
+           sweep_min, sweep_max, sweep_steps);
+    printf(" best of %d samples of at least %g s each (%s kernels).\n",
+           NTIMES, sweep_min_time, kern != NULL ? kern->name : "reference");
+    printf("Working set   Elements       Copy MB/s   Scale MB/s     Add MB/s   Triad MB/s\n");
+
+    /* 1e-9 slack so rounding in the geometric steps cannot drop the last size */
+    for (ws = sweep_min; ws <= sweep_max * (1.0 + 1e-9); ws *= factor) {
+        n = (ssize_t) (ws / (3.0 * elem_size));
+        if (n < 1 || n == prev)
+            continue;
+        if (n > stream_array_size)
+            n = stream_array_size;
+        prev = n;
+        /* Fresh arrays per size: the split of n elements differs from the
+         * one that first-touched the previous arrays, so on NUMA systems
+         * threads would otherwise stream from other nodes' pages */
+        pages_free(a_base);
+        pages_free(b_base);
+        pages_free(c_base);
+        a = alloc_array(&a_base, n);
+        b = alloc_array(&b_base, n);
+        c = alloc_array(&c_base, n);
+        fill_arrays(n, 1.0, 2.0, 0.0);
+
+        for (k=0; k<4; k++) {
+            reps = 1;
+            while ((t = time_reps(k, kern, n, reps)) < sweep_min_time && reps < LONG_MAX / 2)
+                reps *= 2;
+            best = samples[0] = t / reps;
+            for (s=1; s<NTIMES; s++) {
+                t = samples[s] = time_reps(k, kern, n, reps) / reps;
+                best = (best < t) ? best : t;
+            }
+            rate[k] = 1.0E-06 * words[k] * elem_size * (double) n / best;
+
+            memset(&r, 0, sizeof(r));
+            r.kernel = kernel_name[k];
+            r.variant = kern != NULL ? kern->name : "reference";
+            r.working_set = 3.0 * elem_size * (double) n;
+            r.bytes = words[k] * elem_size * (double) n;
+            r.rate = rate[k];
+            r.unit = "MB/s";
+            r.times = samples;
+            r.ntimes = NTIMES;
+            report_add(&r);
+        }
+
+        format_bytes(3.0 * elem_size * (double) n, buf, sizeof(buf));
+        printf("%-12s %10lld  %12.1f %12.1f %12.1f %12.1f\n", buf, (long long) n,
+               rate[0], rate[1], rate[2], rate[3]);
+    }
+    printf("-------------------------------------------------------------\n");
+}
+
+static void summarize(const char *title, const char *variant, double times[4][STREAM_MAX_ITER],
+                      const double *actual)
+{
+    int j, k;
+    report_result r;
+    stats_summary st;
+
+    for (j=0; j<4; j++) {
+        avgtime[j] = 0;
+        maxtime[j] = 0;
+        mintime[j] = FLT_MAX;
+    }
+
+    for (k=1; k<ntimes; k++) /* note -- skip first iteration */
+    {
+        for (j=0; j<4; j++)
+        {
+            avgtime[j] = avgtime[j] + times[j][k];
+            mintime[j] = (mintime[j] < times[j][k]) ? mintime[j] : times[j][k];
+            maxtime[j] = (maxtime[j] > times[j][k]) ? maxtime[j] : times[j][k];
+        }
+    }
+
+    printf("%s\n", title);
+    printf("Function    Best Rate MB/s  Avg time     Min time     Max time     Actual MB/s\n");
+    for (j=0; j<4; j++) {
+        avgtime[j] = avgtime[j]/(double)(ntimes-1);
+
+        printf("%s%12.1f  %11.6f  %11.6f  %11.6f  %12.1f\n", label[j],
+               1.0E-06 * bytes[j]/mintime[j],
+               avgtime[j],
+               mintime[j],
+               maxtime[j],
+               1.0E-06 * actual[j]/mintime[j]);
+
+        memset(&r, 0, sizeof(r));
+        r.kernel = kernel_name[j];
+        r.variant = variant;
+        r.working_set = 3.0 * elem_size * (double) stream_array_size;
+        r.bytes = bytes[j];
+        r.actual_bytes = actual[j];
+        r.rate = 1.0E-06 * bytes[j]/mintime[j];
+        r.unit = "MB/s";
+        r.times = times[j] + 1;
+        r.ntimes = ntimes - 1;
+        report_add(&r);
+    }
+
+    /* Sustained bandwidth: rates at the median and percentile times, so
+     * p5 MB/s comes from the 95th percentile time */
+    printf("%d iterations.  Median and %.0f%% CI of the median, p5/p95, relative\n",
+           ntimes, STATS_CONFIDENCE * 100.0);
+    printf("standard deviation of the rate and iterations beyond %.1f scaled MADs:\n", STATS_OUTLIER_K);
+    printf("Function    Median MB/s        CI low      CI high      p5 MB/s     p95 MB/s   Stddev  Outliers\n");
+    for (j=0; j<4; j++) {
+        stats_summarize(times[j] + 1, ntimes - 1, &st);
+        printf("%s%12.1f  %12.1f %12.1f %12.1f %12.1f  %6.2f%%  %8d\n", label[j],
+               1.0E-06 * bytes[j]/st.median,
+               1.0E-06 * bytes[j]/st.ci_hi,
+               1.0E-06 * bytes[j]/st.ci_lo,
+               1.0E-06 * bytes[j]/st.p95,
+               1.0E-06 * bytes[j]/st.p5,
+               100.0 * st.stddev / st.mean, st.outliers);
+    }
+    printf("-------------------------------------------------------------\n");
+}
+
+int main(int argc, char *argv[])
 {
     int quantum, checktick();
     int BytesPerWord;
+#ifdef _OPENMP
     int k;
+#endif
     ssize_t j;
-    STREAM_TYPE scalar;
-    double t, times[4][NTIMES];
+    double t, times[4][STREAM_MAX_ITER], unfused_time = 0;
+    const stream_kernels *store = NULL;
+    char title[80], page_text[96];
+#ifdef STREAM_RVV
+    const stream_kernels *rvv;
+    char rvv_variant[16];
+#endif
+
+    parse_args(argc, argv);
+    if (report_open("stream", out_format, out_path) != 0)
+        exit(1);
+    elem = stream_type_select(elem_type);
+    if (elem == NULL) {
+        fprintf(stderr, "Type %s is not built in\n", precision_name(elem_type));
+        exit(1);
+    }
+    elem_size = precision_size(elem_type);
+    if (NTIMES > type_params[elem_type].max_iter) {
+        fprintf(stderr, "NTIMES=%d overflows %s (at most %d iterations)\n",
+                NTIMES, precision_name(elem_type), type_params[elem_type].max_iter);
+        exit(1);
+    }
+    if (max_iter > type_params[elem_type].max_iter)
+        max_iter = type_params[elem_type].max_iter;
+    if (sweep_max > 0) {
+        stream_array_size = (ssize_t) (sweep_max / (3.0 * elem_size));
+        if (stream_array_size < 1) {
+            fprintf(stderr, "Sweep range too small: need at least %zu bytes\n",
+                    3 * elem_size);
+            exit(1);
+        }
+    }
+    if (store_mode != STORE_NORMAL && elem_type != PREC_FP64) {
+        fprintf(stderr, "Store mode %s is only implemented for fp64\n",
+                stream_store_name(store_mode));
+        exit(1);
+    }
+    if (store_mode != STORE_NORMAL && (store = stream_store_select(store_mode)) == NULL)
+        exit(1);
+    if (autotune && sweep_max > 0) {
+        fprintf(stderr, "--autotune cannot be combined with --sweep\n");
+        exit(1);
+    }
+    /* Labels the run by where its parameters came from, profile first */
+    if (autotune)
+        tuning = "autotune";
+    else
+        load_profile();
+    if (!autotune && strcmp(tuning, "defaults") == 0 && (tile_given || lmul_given))
+        tuning = "command line";
+    if (fused && (store != NULL || sweep_max > 0)) {
+        fprintf(stderr, "--fused runs the reference loops; it needs --store normal and no --sweep\n");
+        exit(1);
+    }
+#ifdef STREAM_RVV
+    rvv = stream_rvv_select(rvv_lmul);
+    if (rvv == NULL) {
+        fprintf(stderr, "Unsupported LMUL: %d (expected 1, 2, 4 or 8)\n", rvv_lmul);
+        exit(1);
+    }
+#endif
+
+    bytes[0] = 2 * elem_size * (double) stream_array_size;
+    bytes[1] = 2 * elem_size * (double) stream_array_size;
+    bytes[2] = 3 * elem_size * (double) stream_array_size;
+    bytes[3] = 3 * elem_size * (double) stream_array_size;
+    for (j=0; j<4; j++)
+        wa_bytes[j] = bytes[j] + elem_size * (double) stream_array_size;
 
     printf("-------------------------------------------------------------\n");
     printf("STREAM version 5.10\n");
     printf("-------------------------------------------------------------\n");
-    BytesPerWord = sizeof(STREAM_TYPE);
-    printf("This system uses %d bytes per array element.\n", BytesPerWord);
+    BytesPerWord = elem_size;
+    printf("This system uses %d bytes per array element (%s).\n", BytesPerWord,
+           precision_name(elem_type));
 
     printf("-------------------------------------------------------------\n");
-    printf("Array size = %llu (elements), Offset = %d (elements)\n", 
-           (unsigned long long) STREAM_ARRAY_SIZE, OFFSET);
+    printf("Array size = %llu (elements), Offset = %lld (elements)\n",
+           (unsigned long long) stream_array_size, (long long) array_offset);
     printf("Memory per array = %.1f MiB (= %.1f GiB).\n",
-           BytesPerWord * ((double) STREAM_ARRAY_SIZE / 1024.0/1024.0),
-           BytesPerWord * ((double) STREAM_ARRAY_SIZE / 1024.0/1024.0/1024.0));
+           BytesPerWord * ((double) stream_array_size / 1024.0/1024.0),
+           BytesPerWord * ((double) stream_array_size / 1024.0/1024.0/1024.0));
     printf("Total memory required = %.1f MiB (= %.1f GiB).\n",
-           (3.0 * BytesPerWord) * ((double) STREAM_ARRAY_SIZE / 1024.0/1024.0),
-           (3.0 * BytesPerWord) * ((double) STREAM_ARRAY_SIZE / 1024.0/1024.0/1024.0));
-    printf("Each kernel will be executed %d times.\n", NTIMES);
+           (3.0 * BytesPerWord) * ((double) stream_array_size / 1024.0/1024.0),
+           (3.0 * BytesPerWord) * ((double) stream_array_size / 1024.0/1024.0/1024.0));
+    printf("Arrays aligned to %lu bytes, %s pages requested.\n",
+           (unsigned long) PAGES_ALIGN, pages_name(pages));
+    printf("Store mode = %s", stream_store_name(store_mode));
+    if (store_mode == STORE_CBO_ZERO)
+        printf(" (%zu-byte blocks)", stream_store_block());
+    printf(".\n");
+    printf(" Best Rate counts the bytes each kernel reads and writes; Actual\n");
+    printf(" also counts the write-allocate read of the destination, which\n");
+    printf(" the nt and cbo-zero store modes avoid.\n");
+    if (ci_target > 0) {
+        printf("Each kernel will be executed %d to %d times, until the %.0f%% CI\n",
+               NTIMES, max_iter, STATS_CONFIDENCE * 100.0);
+        printf(" of its median time is within +/- %g%%.\n", ci_target * 100.0);
+    } else {
+        printf("Each kernel will be executed %d times.\n", NTIMES);
+    }
     printf(" The *best* time for each kernel (excluding the first iteration)\n");
     printf(" will be used to compute the reported bandwidth.\n");
 
@@ -132,36 +1312,74 @@ int main()
     printf("Number of Threads counted = %i\n", k);
 #endif
 
-    /* Initialize arrays */
-    printf("-------------------------------------------------------------\n");
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-    for (j=0; j<STREAM_ARRAY_SIZE; j++) {
-        a[j] = 1.0;
-        b[j] = 2.0;
-        c[j] = 0.0;
+    /* Before the binding, so the sampling thread is not pinned with the master */
+    if (energy_open() != 0)
+        exit(1);
+    if (affinity_apply(&bind_cfg) != 0)
+        exit(1);
+    printf("Thread binding = %s\n", affinity_name(&bind_cfg));
+    affinity_report(stdout);
+    if (counters_open() != 0)
+        exit(1);
+
+    report_param_int("array_size", stream_array_size);
+    report_param_int("offset", array_offset);
+    report_param_str("type", precision_name(elem_type));
+    report_param_int("bytes_per_element", elem_size);
+    report_param_int("ntimes", NTIMES);
+    report_param_str("timing", persistent ? "persistent" : "region per kernel");
+    if (ci_target > 0) {
+        report_param_num("ci_target", ci_target);
+        report_param_int("max_iter", max_iter);
     }
+    report_param_str("pages", pages_name(pages));
+    report_param_str("store", stream_store_name(store_mode));
+    report_param_str("binding", affinity_name(&bind_cfg));
+    if (sweep_max > 0) {
+        report_param_num("sweep_min_bytes", sweep_min);
+        report_param_num("sweep_max_bytes", sweep_max);
+        report_param_int("sweep_steps", sweep_steps);
+        report_param_num("sweep_min_time", sweep_min_time);
+    }
+
+    a = alloc_array(&a_base, stream_array_size);
+    b = alloc_array(&b_base, stream_array_size);
+    c = alloc_array(&c_base, stream_array_size);
+
+    /* Initialize arrays - this is the first touch, so it must use the
+     * same schedule as the kernels below */
+    printf("-------------------------------------------------------------\n");
+    fill_arrays(stream_array_size, 1.0, 2.0, 0.0);
+    pages_describe(a_base, page_text, sizeof(page_text));
+    printf("Pages obtained = %s.\n", page_text);
+    report_param_str("pages_obtained", page_text);
 
     printf("-------------------------------------------------------------\n");
 
-    if ((quantum = checktick()) >= 1)
-        printf("Your clock granularity/precision appears to be %d microseconds.\n", quantum);
-    else {
-        printf("Your clock granularity appears to be less than one microsecond.\n");
+    printf("Timer = %s", timer_name());
+    if (timer_frequency() > 0.0)
+        printf(" (calibrated at %.3f MHz)", timer_frequency() * 1.0E-6);
+    printf(".\n");
+    if ((quantum = checktick()) < 1)
         quantum = 1;
-    }
+    printf("Your clock granularity/precision appears to be %d nanoseconds.\n", quantum);
 
     t = mysecond();
 #ifdef _OPENMP
-#pragma omp parallel for
+#pragma omp parallel
 #endif
-    for (j = 0; j < STREAM_ARRAY_SIZE; j++)
-        a[j] = 2.0E0 * a[j];
-    t = 1.0E6 * (mysecond() - t);
+    {
+        ssize_t lo, hi;
+        size_t o;
+
+        thread_range(stream_array_size, &lo, &hi);
+        o = (size_t) lo * elem_size;
+        elem->scale(a + o, a + o, 2.0E0, hi - lo);
+    }
+    t = 1.0E9 * (mysecond() - t);
 
-    printf("Each test below will take on the order of %d microseconds.\n", (int) t);
-    printf("   (= %d clock ticks)\n", (int) (t/quantum));
+    printf("Each test below will take on the order of %.0f microseconds.\n", t * 1.0E-3);
+    printf("   (= %.0f clock ticks)\n", t/quantum);
     printf("Increase the size of the arrays if this shows that\n");
     printf("you are not getting at least 20 clock ticks per test.\n");
 
@@ -172,211 +1390,218 @@ int main()
     printf("precision of your system timer.\n");
     printf("-------------------------------------------------------------\n");
 
-    /* Main loop - repeat test cases NTIMES times */
-    scalar = 3.0;
-    for (k=0; k<NTIMES; k++)
-    {
-        times[0][k] = mysecond();
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-        for (j=0; j<STREAM_ARRAY_SIZE; j++)
-            c[j] = a[j];
-        times[0][k] = mysecond() - times[0][k];
+    if (sweep_max > 0) {
+        run_sweep(store);
+        report_end();
+        pages_free(a_base);
+        pages_free(b_base);
+        pages_free(c_base);
+        return 0;
+    }
 
-        times[1][k] = mysecond();
-#ifdef _OPENMP
-#pragma omp parallel for
+    if (autotune) {
+        run_autotune();
+        reset_arrays();
+#ifdef STREAM_RVV
+        rvv = stream_rvv_select(rvv_lmul);
 #endif
-        for (j=0; j<STREAM_ARRAY_SIZE; j++)
-            b[j] = scalar*c[j];
-        times[1][k] = mysecond() - times[1][k];
-
-        times[2][k] = mysecond();
-#ifdef _OPENMP
-#pragma omp parallel for
+    }
+    printf("Tuning = %s", tuning);
+    if (fused)
+        printf(", tile %lld", (long long) fused_tile);
+#ifdef STREAM_RVV
+    printf(", LMUL %d", rvv_lmul);
 #endif
-        for (j=0; j<STREAM_ARRAY_SIZE; j++)
-            c[j] = a[j]+b[j];
-        times[2][k] = mysecond() - times[2][k];
-
-        times[3][k] = mysecond();
-#ifdef _OPENMP
-#pragma omp parallel for
+    printf(".\n");
+    printf("-------------------------------------------------------------\n");
+    report_param_str("tuning", tuning);
+    if (fused)
+        report_param_int("fused_tile", fused_tile);
+#ifdef STREAM_RVV
+    report_param_int("lmul", rvv_lmul);
 #endif
-        for (j=0; j<STREAM_ARRAY_SIZE; j++)
-            a[j] = b[j]+scalar*c[j];
-        times[3][k] = mysecond() - times[3][k];
+
+    /* Main loop - repeat test cases NTIMES times (or more with --ci) */
+    if (store != NULL) {
+        timed_pass(store, store->name, times);
+        snprintf(title, sizeof(title), "Kernels with %s stores%s", store->name,
+                 persistent ? " (persistent region)" : "");
+        summarize(title, store->name, times, bytes);
+        if (persistent)
+            summarize_persistent(store->name, times);
+    } else {
+        timed_pass(NULL, "autovec", times);
+        summarize(persistent ? "Auto-vectorized kernels (persistent region)"
+                             : "Auto-vectorized kernels", "autovec", times, wa_bytes);
+        if (persistent)
+            summarize_persistent("autovec", times);
     }
+    checkSTREAMresults();
+    printf("-------------------------------------------------------------\n");
 
-    /* Summarize results */
-    for (k=1; k<NTIMES; k++) /* note -- skip first iteration */
-    {
+    if (fused) {
         for (j=0; j<4; j++)
-        {
-            avgtime[j] = avgtime[j] + times[j][k];
-            mintime[j] = (mintime[j] < times[j][k]) ? mintime[j] : times[j][k];
-            maxtime[j] = (maxtime[j] > times[j][k]) ? maxtime[j] : times[j][k];
+            unfused_time += mintime[j];
+        /* times[0..1] are free again once the kernels are summarized */
+        for (j=0; j<2; j++) {
+            reset_arrays();
+            run_fused((int) j, times[j]);
+            checkSTREAMresults();
         }
+        summarize_fused(times, unfused_time);
     }
 
-    printf("Function    Best Rate MB/s  Avg time     Min time     Max time\n");
-    for (j=0; j<4; j++) {
-        avgtime[j] = avgtime[j]/(double)(NTIMES-1);
-
-        printf("%s%12.1f  %11.6f  %11.6f  %11.6f\n", label[j],
-               1.0E-06 * bytes[j]/mintime[j],
-               avgtime[j],
-               mintime[j],
-               maxtime[j]);
+#ifdef STREAM_RVV
+    /* Rerun from the same starting values so the results validate against
+     * the same expected values as the auto-vectorized pass */
+    if (elem_type == PREC_FP64) {
+        reset_arrays();
+        snprintf(rvv_variant, sizeof(rvv_variant), "rvv-%s", rvv->name);
+        timed_pass(rvv, rvv_variant, times);
+        snprintf(title, sizeof(title), "RVV intrinsic kernels (LMUL=%s, VLMAX=%zu)%s",
+                 rvv->name, stream_rvv_vlmax(rvv_lmul), persistent ? ", persistent" : "");
+        summarize(title, rvv_variant, times, wa_bytes);
+        if (persistent)
+            summarize_persistent(rvv_variant, times);
+        checkSTREAMresults();
+    } else {
+        printf("RVV intrinsic kernels are fp64 only; skipped for %s.\n",
+               precision_name(elem_type));
     }
     printf("-------------------------------------------------------------\n");
+#endif
 
-    checkSTREAMresults();
-    printf("-------------------------------------------------------------\n");
+    if (counters_enabled()) {
+        counters_report(stdout);
+        printf("-------------------------------------------------------------\n");
+    }
+    counters_close();
+    if (energy_enabled()) {
+        energy_report(stdout);
+        printf("-------------------------------------------------------------\n");
+    }
+    energy_close();
+    report_end();
+    pages_free(a_base);
+    pages_free(b_base);
+    pages_free(c_base);
 
     return 0;
 }
 
 #define M 20
 
+/* Granularity of mysecond() in nanoseconds: the smallest non-zero step
+ * seen over M consecutive changes of the timer */
 int checktick()
 {
     int i, minDelta, Delta;
-    double t1, t2, timesfound[M];
+    double t1, t2;
 
+    minDelta = INT_MAX;
     for (i = 0; i < M; i++) {
         t1 = mysecond();
-        while (((t2=mysecond()) - t1) < 1.0E-6)
+        while ((t2=mysecond()) == t1)
             ;
-        timesfound[i] = t1 = t2;
-    }
-
-    minDelta = 1000000;
-    for (i = 1; i < M; i++) {
-        Delta = (int)(1.0E6 * (timesfound[i]-timesfound[i-1]));
+        Delta = (int)(1.0E9 * (t2 - t1));
         minDelta = (minDelta < Delta) ? minDelta : Delta;
     }
 
     return(minDelta);
 }
 
+/* All timing goes through the shared timer layer; --timer selects it */
 double mysecond()
 {
-    struct timeval tp;
-    struct timezone tzp;
-    int i;
-
-    i = gettimeofday(&tp,&tzp);
-    return ((double) tp.tv_sec + (double) tp.tv_usec * 1.e-6);
+    return timer_seconds();
 }
 
 #ifndef abs
 #define abs(a) ((a) >= 0 ? (a) : -(a))
 #endif
 
+/* Print the failure for one array, and with VERBOSE its first elements
+ * outside the tolerance; returns 1 if the average error is too large */
+static int reportArrayErrors(char name, const char *x, double expected, double avgErr,
+                             size_t nerr, double epsilon)
+{
+    if (abs(avgErr/expected) <= epsilon) {
+        return 0;
+    }
+    printf("Failed Validation on array %c[], AvgRelAbsErr > epsilon (%e)\n", name, epsilon);
+    printf("     Expected Value: %e, AvgAbsErr: %e, AvgRelAbsErr: %e\n",
+           expected, avgErr, abs(avgErr)/expected);
+#ifdef VERBOSE
+    {
+        ssize_t j;
+        size_t shown = 0;
+        for (j=0; j<stream_array_size && shown<10; j++) {
+            double v = elem->get(x, j);
+            if (abs(v/expected-1.0) > epsilon) {
+                shown++;
+                printf("         array %c: index: %ld, expected: %e, observed: %e, relative error: %e\n",
+                       name, j, expected, v, abs((expected-v)/avgErr));
+            }
+        }
+    }
+#else
+    (void) x;
+#endif
+    printf("     For array %c[], %zu errors were found.\n", name, nerr);
+    return 1;
+}
+
 void checkSTREAMresults()
 {
-    STREAM_TYPE aj,bj,cj,scalar;
-    STREAM_TYPE aSumErr,bSumErr,cSumErr;
-    STREAM_TYPE aAvgErr,bAvgErr,cAvgErr;
+    double aj,bj,cj,scalar;
+    double aSumErr,bSumErr,cSumErr;
+    double aAvgErr,bAvgErr,cAvgErr;
+    size_t aBad,bBad,cBad;
+    char *ea,*eb,*ec;
     double epsilon;
-    ssize_t j;
-    int k,ierr,err;
+    int k,err;
 
-    aj = 1.0;
-    bj = 2.0;
-    cj = 0.0;
+    /* Replay the kernels on a single element so the expected values are
+     * rounded exactly as the arrays were */
+    if ((ea = malloc(3 * elem_size)) == NULL) {
+        printf("Failed to allocate the validation scratch space\n");
+        return;
+    }
+    eb = ea + elem_size;
+    ec = eb + elem_size;
+    elem->fill(ea, 1.0, 1);
+    elem->fill(eb, 2.0, 1);
+    elem->fill(ec, 0.0, 1);
 
-    aj = 2.0E0 * aj;
+    elem->scale(ea, ea, 2.0E0, 1);
 
-    scalar = 3.0;
-    for (k=0; k<NTIMES; k++)
+    scalar = type_params[elem_type].scalar;
+    for (k=0; k<ntimes; k++)
     {
-        cj = aj;
-        bj = scalar*cj;
-        cj = aj+bj;
-        aj = bj+scalar*cj;
-    }
-
-    aSumErr = 0.0;
-    bSumErr = 0.0;
-    cSumErr = 0.0;
-    for (j=0; j<STREAM_ARRAY_SIZE; j++) {
-        aSumErr += abs(a[j] - aj);
-        bSumErr += abs(b[j] - bj);
-        cSumErr += abs(c[j] - cj);
+        elem->copy(ec, ea, 1);
+        elem->scale(eb, ec, scalar, 1);
+        elem->add(ec, ea, eb, 1);
+        elem->triad(ea, eb, ec, scalar, 1);
     }
-    aAvgErr = aSumErr / (STREAM_TYPE) STREAM_ARRAY_SIZE;
-    bAvgErr = bSumErr / (STREAM_TYPE) STREAM_ARRAY_SIZE;
-    cAvgErr = cSumErr / (STREAM_TYPE) STREAM_ARRAY_SIZE;
+    aj = elem->get(ea, 0);
+    bj = elem->get(eb, 0);
+    cj = elem->get(ec, 0);
+    free(ea);
 
-    if (sizeof(STREAM_TYPE) == 4) {
-        epsilon = 1.e-6;
-    }
-    else if (sizeof(STREAM_TYPE) == 8) {
-        epsilon = 1.e-13;
-    }
-    else {
-        printf("WEIRD: sizeof(STREAM_TYPE) = %lu\n", sizeof(STREAM_TYPE));
-        epsilon = 1.e-6;
-    }
+    /* One parallel pass per array gives both the average error and the
+     * number of elements outside the tolerance */
+    epsilon = type_params[elem_type].epsilon;
+    elem->check(a, aj, epsilon, stream_array_size, &aSumErr, &aBad);
+    elem->check(b, bj, epsilon, stream_array_size, &bSumErr, &bBad);
+    elem->check(c, cj, epsilon, stream_array_size, &cSumErr, &cBad);
+    aAvgErr = aSumErr / (double) stream_array_size;
+    bAvgErr = bSumErr / (double) stream_array_size;
+    cAvgErr = cSumErr / (double) stream_array_size;
 
     err = 0;
-    if (abs(aAvgErr/aj) > epsilon) {
-        err++;
-        printf("Failed Validation on array a[], AvgRelAbsErr > epsilon (%e)\n", epsilon);
-        printf("     Expected Value: %e, AvgAbsErr: %e, AvgRelAbsErr: %e\n", aj, aAvgErr, abs(aAvgErr)/aj);
-        ierr = 0;
-        for (j=0; j<STREAM_ARRAY_SIZE; j++) {
-            if (abs(a[j]/aj-1.0) > epsilon) {
-                ierr++;
-#ifdef VERBOSE
-                if (ierr < 10) {
-                    printf("         array a: index: %ld, expected: %e, observed: %e, relative error: %e\n",
-                           j, aj, a[j], abs((aj-a[j])/aAvgErr));
-                }
-#endif
-            }
-        }
-        printf("     For array a[], %d errors were found.\n", ierr);
-    }
-    if (abs(bAvgErr/bj) > epsilon) {
-        err++;
-        printf("Failed Validation on array b[], AvgRelAbsErr > epsilon (%e)\n", epsilon);
-        printf("     Expected Value: %e, AvgAbsErr: %e, AvgRelAbsErr: %e\n", bj, bAvgErr, abs(bAvgErr)/bj);
-        ierr = 0;
-        for (j=0; j<STREAM_ARRAY_SIZE; j++) {
-            if (abs(b[j]/bj-1.0) > epsilon) {
-                ierr++;
-#ifdef VERBOSE
-                if (ierr < 10) {
-                    printf("         array b: index: %ld, expected: %e, observed: %e, relative error: %e\n",
-                           j, bj, b[j], abs((bj-b[j])/bAvgErr));
-                }
-#endif
-            }
-        }
-        printf("     For array b[], %d errors were found.\n", ierr);
-    }
-    if (abs(cAvgErr/cj) > epsilon) {
-        err++;
-        printf("Failed Validation on array c[], AvgRelAbsErr > epsilon (%e)\n", epsilon);
-        printf("     Expected Value: %e, AvgAbsErr: %e, AvgRelAbsErr: %e\n", cj, cAvgErr, abs(cAvgErr)/cj);
-        ierr = 0;
-        for (j=0; j<STREAM_ARRAY_SIZE; j++) {
-            if (abs(c[j]/cj-1.0) > epsilon) {
-                ierr++;
-#ifdef VERBOSE
-                if (ierr < 10) {
-                    printf("         array c: index: %ld, expected: %e, observed: %e, relative error: %e\n",
-                           j, cj, c[j], abs((cj-c[j])/cAvgErr));
-                }
-#endif
-            }
-        }
-        printf("     For array c[], %d errors were found.\n", ierr);
-    }
+    err += reportArrayErrors('a', a, aj, aAvgErr, aBad, epsilon);
+    err += reportArrayErrors('b', b, bj, bAvgErr, bBad, epsilon);
+    err += reportArrayErrors('c', c, cj, cAvgErr, cBad, epsilon);
     if (err == 0) {
         printf("Solution Validates: avg error less than %e on all three arrays\n", epsilon);
     }
@@ -0,0 +1,83 @@
+/*-----------------------------------------------------------------------*/
+/* Alternative STREAM kernel sets                                        */
+/*                                                                       */
+/* The reference kernels are the plain loops in stream.c.  The sets      */
+/* declared here implement the same four operations on one contiguous    */
+/* slice per thread and are timed by the same loop in stream.c.          */
+/*                                                                       */
+/*   stream_rvv.c    RISC-V Vector (RVV 1.0) intrinsics, one set per     */
+/*                   LMUL (1, 2, 4, 8); built with "make RVV=1"          */
+/*   stream_store.c  non-temporal / cache-bypassing stores               */
+/*                                                                       */
+/* These sets are double precision.  stream_types.c generates the        */
+/* reference loops once per element type in common/precision.h; they    */
+/* work on untyped slices and are what --type fp32/fp16/bf16 runs.       */
+/*-----------------------------------------------------------------------*/
+
+#ifndef STREAM_KERNELS_H
+#define STREAM_KERNELS_H
+
+#include <stddef.h>
+#include "precision.h"
+
+typedef struct {
+    const char *name;
+    void (*copy)(double *c, const double *a, size_t n);
+    void (*scale)(double *b, const double *c, double scalar, size_t n);
+    void (*add)(double *c, const double *a, const double *b, size_t n);
+    void (*triad)(double *a, const double *b, const double *c, double scalar, size_t n);
+} stream_kernels;
+
+/* Returns NULL if lmul is not 1, 2, 4 or 8 */
+const stream_kernels *stream_rvv_select(int lmul);
+size_t stream_rvv_vlmax(int lmul);
+
+/*
+ * Store modes.  STORE_NORMAL is the reference kernels in stream.c and has
+ * no kernel set; the hardware reads every destination line before writing
+ * it (write-allocate).  The other modes avoid that read:
+ *
+ *   STORE_NT        x86 streaming stores (_mm_stream_pd), built on SSE2
+ *   STORE_CBO_ZERO  RISC-V Zicboz: each destination cache block is zeroed
+ *                   with cbo.zero before it is written
+ */
+enum {
+    STORE_NORMAL,
+    STORE_NT,
+    STORE_CBO_ZERO
+};
+
+/* Returns 0 and sets *mode, or -1 if name is not a known store mode */
+int stream_store_parse(const char *name, int *mode);
+const char *stream_store_name(int mode);
+
+/* Returns NULL and prints the reason if mode is not available here */
+const stream_kernels *stream_store_select(int mode);
+
+/* Zicboz block size in bytes once cbo-zero has been selected, else 0 */
+size_t stream_store_block(void);
+
+/*
+ * Reference loops for one element type.  Pointers are to the first element
+ * of a slice of n elements; scalars are rounded to the element type.
+ */
+typedef struct {
+    precision type;
+    void (*fill)(void *x, double value, size_t n);
+    void (*copy)(void *c, const void *a, size_t n);
+    void (*scale)(void *b, const void *c, double scalar, size_t n);
+    void (*add)(void *c, const void *a, const void *b, size_t n);
+    void (*triad)(void *a, const void *b, const void *c, double scalar, size_t n);
+    /* One STREAM iteration (copy, scale, add, triad) in a single pass */
+    void (*fused)(void *a, void *b, void *c, double scalar, size_t n);
+    double (*get)(const void *x, size_t j);
+    /* Sum of |x[j] - expected| and the number of elements whose relative
+     * error exceeds epsilon, in one OpenMP-parallel pass */
+    void (*check)(const void *x, double expected, double epsilon, size_t n,
+                  double *sum_err, size_t *nerr);
+} stream_type_kernels;
+
+/* Returns NULL if type is not built in */
+const stream_type_kernels *stream_type_select(precision type);
+
+#endif
@@ -0,0 +1,397 @@
+/*
+ * MPI+OpenMP hybrid STREAM.
+ *
+ * Every rank runs the four STREAM kernels on its own arrays of --size
+ * elements with its OpenMP threads, so the problem grows with the number
+ * of ranks (weak scaling).  Each kernel starts with an MPI_Barrier and is
+ * timed on every rank from the barrier to the end of its parallel region.
+ * The rank clocks are not assumed to be synchronized, so the cluster time
+ * of one kernel is the slowest rank's duration; the aggregated bandwidth
+ * is the bytes of all ranks over that time.  Reported are:
+ *
+ *   per rank     each rank's best rate, with its host, to spot slow nodes
+ *   per node     the aggregate divided by the number of nodes (ranks that
+ *                share memory, from MPI_Comm_split_type)
+ *   aggregate    the cluster bandwidth
+ *
+ * Sweeping ranks per node and nodes shows where the memory bandwidth of
+ * a node saturates and whether the aggregate keeps scaling with nodes.
+ * The kernels are the reference loops of stream_types.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <float.h>
+#include <getopt.h>
+#include <mpi.h>
+#include "stream_kernels.h"
+#include "affinity.h"
+#include "timer.h"
+#include "report.h"
+#include "stats.h"
+#include "precision.h"
+#include "pages.h"
+#include "schedule.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifndef STREAM_ARRAY_SIZE
+#   define STREAM_ARRAY_SIZE 10000000
+#endif
+
+#ifndef NTIMES
+#   define NTIMES 10
+#endif
+
+#if NTIMES < 2 || NTIMES > 30
+#   error "need 2 <= NTIMES <= 30"
+#endif
+
+/* Scalar and validation threshold per type, as in stream.c (the STREAM
+ * scalar would overflow the 16-bit types within NTIMES iterations) */
+static const struct {
+    double scalar;
+    double epsilon;
+} type_params[] = {
+    [PREC_FP64] = { 3.0, 1.e-13 },
+    [PREC_FP32] = { 3.0, 1.e-6 },
+    [PREC_FP16] = { 0.41421356237309505, 16.0 / 2048 },
+    [PREC_BF16] = { 0.41421356237309505, 16.0 / 256 },
+};
+
+static const char *kernel_name[4] = {"Copy", "Scale", "Add", "Triad"};
+static const int words[4] = {2, 2, 3, 3};
+
+static size_t array_size = STREAM_ARRAY_SIZE;
+static precision elem_type = PREC_FP64;
+static page_mode pages = PAGES_DEFAULT;
+static affinity_config bind_cfg = { BIND_NONE };
+static report_format out_format = REPORT_TEXT;
+static const char *out_path = NULL;
+
+static const stream_type_kernels *elem;
+static size_t elem_size;
+static char *a, *b, *c;
+static int rank = 0, nranks = 1;
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: mpirun [mpi options] %s [options]\n", prog);
+    fprintf(stderr, "  -n, --size N           elements per array on each rank (default %llu)\n",
+            (unsigned long long) STREAM_ARRAY_SIZE);
+    fprintf(stderr, "      --type TYPE        element type: %s (default fp64)\n",
+            precision_list());
+    fprintf(stderr, "      --pages MODE       pages of the arrays: default, 4k, 2m (THP) or 1g\n");
+    fprintf(stderr, "                         (hugetlbfs); see common/pages.h (default default)\n");
+    fprintf(stderr, "  -b, --bind SPEC        pin each rank's threads: none, compact, spread\n");
+    fprintf(stderr, "                         or a CPU list (default none)\n");
+    fprintf(stderr, "  -t, --timer NAME       monotonic-raw, monotonic, gettimeofday, rdtime or\n");
+    fprintf(stderr, "                         rdcycle (default monotonic-raw)\n");
+    fprintf(stderr, "  -f, --format FMT       also write a text, json or csv record (default text)\n");
+    fprintf(stderr, "      --output FILE      write the record to FILE instead of stdout\n");
+    fprintf(stderr, "  -h, --help             show this message\n");
+}
+
+/* Every rank parses the same arguments, so any of them may abort */
+static void parse_args(int argc, char *argv[])
+{
+    static const struct option long_options[] = {
+        {"size",      required_argument, NULL, 'n'},
+        {"type",      required_argument, NULL, 'y'},
+        {"pages",     required_argument, NULL, 'G'},
+        {"bind",      required_argument, NULL, 'b'},
+        {"timer",     required_argument, NULL, 't'},
+        {"format",    required_argument, NULL, 'f'},
+        {"output",    required_argument, NULL, 'O'},
+        {"help",      no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    char *end;
+    long long v;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "n:b:t:f:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'n':
+            errno = 0;
+            v = strtoll(optarg, &end, 10);
+            if (errno != 0 || end == optarg || *end != '\0' || v < 1) {
+                fprintf(stderr, "Invalid array size: %s\n", optarg);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            array_size = (size_t) v;
+            break;
+        case 'y':
+            if (precision_parse(optarg, &elem_type) != 0)
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            break;
+        case 'G':
+            if (pages_parse(optarg, &pages) != 0) {
+                fprintf(stderr, "Invalid pages: %s (default, 4k, 2m or 1g)\n", optarg);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            break;
+        case 'b':
+            if (affinity_parse(optarg, &bind_cfg) != 0) {
+                fprintf(stderr, "Invalid binding: %s\n", optarg);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            break;
+        case 't':
+            if (timer_select(optarg) != 0)
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            break;
+        case 'f':
+            if (report_parse_format(optarg, &out_format) != 0) {
+                fprintf(stderr, "Unknown format: %s\n", optarg);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            break;
+        case 'O':
+            out_path = optarg;
+            break;
+        case 'h':
+            if (rank == 0)
+                usage(argv[0]);
+            MPI_Finalize();
+            exit(0);
+        default:
+            if (rank == 0)
+                usage(argv[0]);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+}
+
+static char *alloc_array(void)
+{
+    void *p = pages_alloc(array_size * elem_size, pages);
+
+    if (p == NULL) {
+        fprintf(stderr, "Rank %d: failed to allocate %zu bytes\n", rank,
+                array_size * elem_size);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    return p;
+}
+
+/* In the kernels' slices, so each thread streams through the pages it
+ * first-touched */
+static void fill_arrays(double va, double vb, double vc)
+{
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        size_t lo, hi, o;
+
+        schedule_slice(array_size, &lo, &hi);
+        o = lo * elem_size;
+        elem->fill(a + o, va, hi - lo);
+        elem->fill(b + o, vb, hi - lo);
+        elem->fill(c + o, vc, hi - lo);
+    }
+}
+
+static void run_kernel(int kernel, double scalar)
+{
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        size_t lo, hi, o, n;
+
+        schedule_slice(array_size, &lo, &hi);
+        o = lo * elem_size;
+        n = hi - lo;
+        switch (kernel) {
+        case 0: elem->copy(c + o, a + o, n); break;
+        case 1: elem->scale(b + o, c + o, scalar, n); break;
+        case 2: elem->add(c + o, a + o, b + o, n); break;
+        case 3: elem->triad(a + o, b + o, c + o, scalar, n); break;
+        }
+    }
+}
+
+/* Number of elements of the three arrays outside the tolerance, after
+ * NTIMES iterations from a = 1, b = 2, c = 0 */
+static size_t check_results(double scalar)
+{
+    double aj = 1.0, bj = 2.0, cj = 0.0, err;
+    double eps = type_params[elem_type].epsilon;
+    size_t bad = 0, nerr;
+    int k;
+
+    for (k = 0; k < NTIMES; k++) {
+        cj = aj;
+        bj = scalar * cj;
+        cj = aj + bj;
+        aj = bj + scalar * cj;
+    }
+    elem->check(a, aj, eps, array_size, &err, &nerr);
+    bad += nerr;
+    elem->check(b, bj, eps, array_size, &err, &nerr);
+    bad += nerr;
+    elem->check(c, cj, eps, array_size, &err, &nerr);
+    bad += nerr;
+    return bad;
+}
+
+int main(int argc, char *argv[])
+{
+    double times[4][NTIMES], cluster[4][NTIMES], best[4], rank_rate[4];
+    double *all_rates = NULL, scalar, t, per_rank_bytes[4];
+    char host[MPI_MAX_PROCESSOR_NAME], *hosts = NULL, page_text[96];
+    int provided, hostlen, nodes, node_rank, threads = 1, j, k, r;
+    unsigned long long bad, total_bad = 0;
+    MPI_Comm node_comm;
+    report_result res;
+
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nranks);
+    parse_args(argc, argv);
+
+    /* Only rank 0 writes the record; the others keep it disabled */
+    if (report_open("stream_mpi", rank == 0 ? out_format : REPORT_TEXT, out_path) != 0)
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    elem = stream_type_select(elem_type);
+    if (elem == NULL) {
+        if (rank == 0)
+            fprintf(stderr, "Type %s is not built in\n", precision_name(elem_type));
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    elem_size = precision_size(elem_type);
+    scalar = type_params[elem_type].scalar;
+
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+    MPI_Comm_rank(node_comm, &node_rank);
+    k = node_rank == 0;
+    MPI_Allreduce(&k, &nodes, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Get_processor_name(host, &hostlen);
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    if (affinity_apply(&bind_cfg) != 0)
+        MPI_Abort(MPI_COMM_WORLD, 1);
+
+    if (rank == 0) {
+        printf("-------------------------------------------------------------\n");
+        printf("STREAM MPI+OpenMP hybrid\n");
+        printf("-------------------------------------------------------------\n");
+        printf("Ranks = %d on %d node(s), %d thread(s) per rank\n", nranks, nodes, threads);
+        printf("Array size = %zu elements of %s per rank, %.1f MiB per rank\n",
+               array_size, precision_name(elem_type),
+               3.0 * elem_size * array_size / 1024.0 / 1024.0);
+        printf("Thread binding = %s, timer = %s\n", affinity_name(&bind_cfg), timer_name());
+        printf("Each kernel starts with MPI_Barrier; the cluster time is the\n");
+        printf(" slowest rank's, best of %d iterations (excluding the first).\n", NTIMES);
+        printf("-------------------------------------------------------------\n");
+    }
+    report_param_int("ranks", nranks);
+    report_param_int("nodes", nodes);
+    report_param_int("threads_per_rank", threads);
+    report_param_int("array_size_per_rank", (long long) array_size);
+    report_param_str("type", precision_name(elem_type));
+    report_param_int("ntimes", NTIMES);
+    report_param_str("binding", affinity_name(&bind_cfg));
+    report_param_str("pages", pages_name(pages));
+
+    a = alloc_array();
+    b = alloc_array();
+    c = alloc_array();
+    fill_arrays(1.0, 2.0, 0.0);
+    /* Rank 0's pages stand for all ranks */
+    pages_describe(a, page_text, sizeof(page_text));
+    if (rank == 0)
+        printf("Pages = %s requested, %s obtained on rank 0\n", pages_name(pages), page_text);
+    report_param_str("pages_obtained", page_text);
+
+    for (k = 0; k < NTIMES; k++) {
+        for (j = 0; j < 4; j++) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            t = timer_seconds();
+            run_kernel(j, scalar);
+            times[j][k] = timer_seconds() - t;
+        }
+    }
+    MPI_Reduce(times, cluster, 4 * NTIMES, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    bad = check_results(scalar);
+    MPI_Reduce(&bad, &total_bad, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    /* Each rank's best rate per kernel, and its host, to rank 0 */
+    for (j = 0; j < 4; j++) {
+        per_rank_bytes[j] = (double) words[j] * elem_size * array_size;
+        best[j] = FLT_MAX;
+        for (k = 1; k < NTIMES; k++)
+            best[j] = times[j][k] < best[j] ? times[j][k] : best[j];
+        rank_rate[j] = 1.0E-06 * per_rank_bytes[j] / best[j];
+    }
+    if (rank == 0) {
+        all_rates = malloc(4 * sizeof(double) * nranks);
+        hosts = malloc((size_t) MPI_MAX_PROCESSOR_NAME * nranks);
+        if (all_rates == NULL || hosts == NULL) {
+            fprintf(stderr, "Failed to allocate the per-rank results\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    MPI_Gather(rank_rate, 4, MPI_DOUBLE, all_rates, 4, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Gather(host, MPI_MAX_PROCESSOR_NAME, MPI_CHAR, hosts, MPI_MAX_PROCESSOR_NAME,
+               MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        printf("Per-rank best rate (MB/s):\n");
+        printf("Rank  Host                   Copy       Scale         Add       Triad\n");
+        for (r = 0; r < nranks; r++)
+            printf("%4d  %-16.16s %11.1f %11.1f %11.1f %11.1f\n", r,
+                   hosts + (size_t) r * MPI_MAX_PROCESSOR_NAME, all_rates[4 * r],
+                   all_rates[4 * r + 1], all_rates[4 * r + 2], all_rates[4 * r + 3]);
+        printf("-------------------------------------------------------------\n");
+        printf("Aggregate over %d ranks (slowest rank per iteration):\n", nranks);
+        printf("Function    Best Rate MB/s  Per node MB/s  Per rank MB/s  Median MB/s\n");
+        for (j = 0; j < 4; j++) {
+            double total = per_rank_bytes[j] * nranks, min = FLT_MAX;
+            stats_summary st;
+
+            for (k = 1; k < NTIMES; k++)
+                min = cluster[j][k] < min ? cluster[j][k] : min;
+            stats_summarize(cluster[j] + 1, NTIMES - 1, &st);
+            printf("%-10s %15.1f %14.1f %14.1f %12.1f\n", kernel_name[j],
+                   1.0E-06 * total / min, 1.0E-06 * total / min / nodes,
+                   1.0E-06 * total / min / nranks, 1.0E-06 * total / st.median);
+
+            memset(&res, 0, sizeof(res));
+            res.kernel = kernel_name[j];
+            res.variant = "aggregate";
+            res.working_set = 3.0 * elem_size * array_size * nranks;
+            res.bytes = total;
+            res.rate = 1.0E-06 * total / min;
+            res.unit = "MB/s";
+            res.times = cluster[j] + 1;
+            res.ntimes = NTIMES - 1;
+            report_add(&res);
+        }
+        printf("-------------------------------------------------------------\n");
+        if (total_bad == 0)
+            printf("Solution Validates on all %d ranks\n", nranks);
+        else
+            printf("Failed Validation: %llu elements out of tolerance\n", total_bad);
+        report_param_str("validation", total_bad == 0 ? "passed" : "failed");
+        printf("-------------------------------------------------------------\n");
+        free(all_rates);
+        free(hosts);
+    }
+
+    report_end();
+    pages_free(a);
+    pages_free(b);
+    pages_free(c);
+    MPI_Comm_free(&node_comm);
+    MPI_Finalize();
+    return total_bad == 0 || rank != 0 ? 0 : 1;
+}
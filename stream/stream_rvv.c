@@ -0,0 +1,96 @@
+/*-----------------------------------------------------------------------*/
+/* RISC-V Vector (RVV 1.0) intrinsic kernels for STREAM                  */
+/*                                                                       */
+/* Built only with "make RVV=1", which adds -march=rv64gcv.  The kernels */
+/* are written against the ratified intrinsic API (__riscv_ prefix).     */
+/*-----------------------------------------------------------------------*/
+
+#include "stream_kernels.h"
+
+#ifndef __riscv_vector
+#   error "stream_rvv.c requires a compiler targeting the RISC-V V extension"
+#endif
+
+#include <riscv_vector.h>
+
+#define STREAM_RVV_KERNELS(LMUL)                                              \
+static void copy_m##LMUL(double *restrict c, const double *restrict a,        \
+                         size_t n)                                            \
+{                                                                             \
+    size_t vl;                                                                \
+    for (; n > 0; n -= vl, a += vl, c += vl) {                                \
+        vl = __riscv_vsetvl_e64m##LMUL(n);                                    \
+        vfloat64m##LMUL##_t va = __riscv_vle64_v_f64m##LMUL(a, vl);           \
+        __riscv_vse64_v_f64m##LMUL(c, va, vl);                                \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static void scale_m##LMUL(double *restrict b, const double *restrict c,       \
+                          double scalar, size_t n)                            \
+{                                                                             \
+    size_t vl;                                                                \
+    for (; n > 0; n -= vl, c += vl, b += vl) {                                \
+        vl = __riscv_vsetvl_e64m##LMUL(n);                                    \
+        vfloat64m##LMUL##_t vc = __riscv_vle64_v_f64m##LMUL(c, vl);           \
+        __riscv_vse64_v_f64m##LMUL(b,                                         \
+            __riscv_vfmul_vf_f64m##LMUL(vc, scalar, vl), vl);                 \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static void add_m##LMUL(double *restrict c, const double *restrict a,         \
+                        const double *restrict b, size_t n)                   \
+{                                                                             \
+    size_t vl;                                                                \
+    for (; n > 0; n -= vl, a += vl, b += vl, c += vl) {                       \
+        vl = __riscv_vsetvl_e64m##LMUL(n);                                    \
+        vfloat64m##LMUL##_t va = __riscv_vle64_v_f64m##LMUL(a, vl);           \
+        vfloat64m##LMUL##_t vb = __riscv_vle64_v_f64m##LMUL(b, vl);           \
+        __riscv_vse64_v_f64m##LMUL(c,                                         \
+            __riscv_vfadd_vv_f64m##LMUL(va, vb, vl), vl);                     \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static void triad_m##LMUL(double *restrict a, const double *restrict b,       \
+                          const double *restrict c, double scalar, size_t n)  \
+{                                                                             \
+    size_t vl;                                                                \
+    for (; n > 0; n -= vl, a += vl, b += vl, c += vl) {                       \
+        vl = __riscv_vsetvl_e64m##LMUL(n);                                    \
+        vfloat64m##LMUL##_t vb = __riscv_vle64_v_f64m##LMUL(b, vl);           \
+        vfloat64m##LMUL##_t vc = __riscv_vle64_v_f64m##LMUL(c, vl);           \
+        /* vb += scalar * vc */                                               \
+        __riscv_vse64_v_f64m##LMUL(a,                                         \
+            __riscv_vfmacc_vf_f64m##LMUL(vb, scalar, vc, vl), vl);            \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static const stream_kernels kernels_m##LMUL = {                               \
+    "m" #LMUL, copy_m##LMUL, scale_m##LMUL, add_m##LMUL, triad_m##LMUL        \
+};
+
+STREAM_RVV_KERNELS(1)
+STREAM_RVV_KERNELS(2)
+STREAM_RVV_KERNELS(4)
+STREAM_RVV_KERNELS(8)
+
+const stream_kernels *stream_rvv_select(int lmul)
+{
+    switch (lmul) {
+    case 1: return &kernels_m1;
+    case 2: return &kernels_m2;
+    case 4: return &kernels_m4;
+    case 8: return &kernels_m8;
+    default: return NULL;
+    }
+}
+
+size_t stream_rvv_vlmax(int lmul)
+{
+    switch (lmul) {
+    case 1: return __riscv_vsetvlmax_e64m1();
+    case 2: return __riscv_vsetvlmax_e64m2();
+    case 4: return __riscv_vsetvlmax_e64m4();
+    case 8: return __riscv_vsetvlmax_e64m8();
+    default: return 0;
+    }
+}
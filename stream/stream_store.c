@@ -0,0 +1,217 @@
+/*-----------------------------------------------------------------------*/
+/* Non-temporal / cache-bypassing store kernels for STREAM               */
+/*                                                                       */
+/* With ordinary stores every destination line is first read into the   */
+/* cache (write-allocate), so Copy and Scale really move three arrays    */
+/* and Add and Triad four.  These kernels avoid that read:               */
+/*                                                                       */
+/*   nt        x86 streaming stores, which bypass the cache hierarchy    */
+/*   cbo-zero  RISC-V Zicboz: cbo.zero allocates each destination block  */
+/*             already zeroed, so the following stores need no read     */
+/*                                                                       */
+/* Both only operate on whole, aligned units inside a thread's slice;    */
+/* the ragged ends use ordinary stores so we never touch a neighbouring  */
+/* thread's data.                                                        */
+/*-----------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "stream_kernels.h"
+
+#if defined(__riscv) && defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const char *store_names[] = {"normal", "nt", "cbo-zero"};
+
+int stream_store_parse(const char *name, int *mode)
+{
+    int i;
+
+    for (i = 0; i < (int) (sizeof(store_names) / sizeof(store_names[0])); i++) {
+        if (strcmp(name, store_names[i]) == 0) {
+            *mode = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *stream_store_name(int mode)
+{
+    return store_names[mode];
+}
+
+/* The operations, written once for the scalar peel and tail loops */
+#define COPY_OP(i)   c[i] = a[i]
+#define SCALE_OP(i)  b[i] = scalar * c[i]
+#define ADD_OP(i)    c[i] = a[i] + b[i]
+#define TRIAD_OP(i)  a[i] = b[i] + scalar * c[i]
+
+#if defined(__SSE2__)
+
+#define COPY_VEC(i)  _mm_loadu_pd(a + i)
+#define SCALE_VEC(i) _mm_mul_pd(vs, _mm_loadu_pd(c + i))
+#define ADD_VEC(i)   _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i))
+#define TRIAD_VEC(i) _mm_add_pd(_mm_loadu_pd(b + i), _mm_mul_pd(vs, _mm_loadu_pd(c + i)))
+
+/* _mm_stream_pd needs a 16-byte aligned destination; the sfence orders
+ * the weakly-ordered streaming stores before the region's barrier */
+#define NT_LOOP(dst, OP, VEC)                                        \
+    size_t j = 0;                                                    \
+    for (; j < n && ((uintptr_t) (dst + j) & 15) != 0; j++)          \
+        OP(j);                                                       \
+    for (; j + 2 <= n; j += 2)                                       \
+        _mm_stream_pd(dst + j, VEC(j));                              \
+    for (; j < n; j++)                                               \
+        OP(j);                                                       \
+    _mm_sfence()
+
+static void copy_nt(double *restrict c, const double *restrict a, size_t n)
+{
+    NT_LOOP(c, COPY_OP, COPY_VEC);
+}
+
+static void scale_nt(double *restrict b, const double *restrict c, double scalar, size_t n)
+{
+    __m128d vs = _mm_set1_pd(scalar);
+    NT_LOOP(b, SCALE_OP, SCALE_VEC);
+}
+
+static void add_nt(double *restrict c, const double *restrict a, const double *restrict b, size_t n)
+{
+    NT_LOOP(c, ADD_OP, ADD_VEC);
+}
+
+static void triad_nt(double *restrict a, const double *restrict b, const double *restrict c,
+                     double scalar, size_t n)
+{
+    __m128d vs = _mm_set1_pd(scalar);
+    NT_LOOP(a, TRIAD_OP, TRIAD_VEC);
+}
+
+static const stream_kernels kernels_nt = {
+    "nt", copy_nt, scale_nt, add_nt, triad_nt
+};
+
+#endif /* __SSE2__ */
+
+#if defined(__riscv) && defined(__linux__)
+
+/* riscv_hwprobe(2), declared here so we do not depend on new kernel headers */
+#ifndef __NR_riscv_hwprobe
+#   define __NR_riscv_hwprobe 258
+#endif
+#define HWPROBE_KEY_IMA_EXT_0          4
+#define HWPROBE_EXT_ZICBOZ             (1ULL << 6)
+#define HWPROBE_KEY_ZICBOZ_BLOCK_SIZE  6
+
+struct hwprobe_pair {
+    int64_t key;
+    uint64_t value;
+};
+
+static size_t cbo_block;
+
+/* Returns the Zicboz block size in bytes, or 0 if cbo.zero is unavailable */
+static size_t probe_cbo_block(void)
+{
+    struct hwprobe_pair p[2] = {
+        {HWPROBE_KEY_IMA_EXT_0, 0},
+        {HWPROBE_KEY_ZICBOZ_BLOCK_SIZE, 0}
+    };
+
+    if (syscall(__NR_riscv_hwprobe, p, 2, 0, NULL, 0) != 0)
+        return 0;
+    if (p[0].key < 0 || !(p[0].value & HWPROBE_EXT_ZICBOZ) || p[1].key < 0)
+        return 0;
+    return (size_t) p[1].value;
+}
+
+/* cbo.zero 0(rs1), encoded directly so no Zicboz-aware assembler is needed */
+static inline void cbo_zero(void *p)
+{
+    __asm__ volatile (".insn i 0x0f, 2, x0, %0, 4" : : "r" (p) : "memory");
+}
+
+#define CBO_LOOP(dst, OP)                                                   \
+    size_t j = 0, i, blk = cbo_block / sizeof(double);                      \
+    for (; j < n && ((uintptr_t) (dst + j) & (cbo_block - 1)) != 0; j++)     \
+        OP(j);                                                              \
+    for (; j + blk <= n; j += blk) {                                        \
+        cbo_zero(dst + j);                                                  \
+        for (i = j; i < j + blk; i++)                                       \
+            OP(i);                                                          \
+    }                                                                       \
+    for (; j < n; j++)                                                      \
+        OP(j)
+
+static void copy_cbo(double *restrict c, const double *restrict a, size_t n)
+{
+    CBO_LOOP(c, COPY_OP);
+}
+
+static void scale_cbo(double *restrict b, const double *restrict c, double scalar, size_t n)
+{
+    CBO_LOOP(b, SCALE_OP);
+}
+
+static void add_cbo(double *restrict c, const double *restrict a, const double *restrict b, size_t n)
+{
+    CBO_LOOP(c, ADD_OP);
+}
+
+static void triad_cbo(double *restrict a, const double *restrict b, const double *restrict c,
+                      double scalar, size_t n)
+{
+    CBO_LOOP(a, TRIAD_OP);
+}
+
+static const stream_kernels kernels_cbo = {
+    "cbo-zero", copy_cbo, scale_cbo, add_cbo, triad_cbo
+};
+
+#endif /* __riscv && __linux__ */
+
+const stream_kernels *stream_store_select(int mode)
+{
+    switch (mode) {
+    case STORE_NT:
+#if defined(__SSE2__)
+        return &kernels_nt;
+#else
+        fprintf(stderr, "Store mode nt needs x86 SSE2 streaming stores\n");
+        return NULL;
+#endif
+    case STORE_CBO_ZERO:
+#if defined(__riscv) && defined(__linux__)
+        cbo_block = probe_cbo_block();
+        if (cbo_block == 0 || (cbo_block & (cbo_block - 1)) != 0
+            || cbo_block < sizeof(double)) {
+            fprintf(stderr, "Store mode cbo-zero needs Zicboz (not reported by riscv_hwprobe)\n");
+            return NULL;
+        }
+        return &kernels_cbo;
+#else
+        fprintf(stderr, "Store mode cbo-zero needs RISC-V Zicboz\n");
+        return NULL;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+size_t stream_store_block(void)
+{
+#if defined(__riscv) && defined(__linux__)
+    return cbo_block;
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,128 @@
+/*-----------------------------------------------------------------------*/
+/* STREAM reference loops, generated once per element type               */
+/*                                                                       */
+/* Each operation loads its inputs into the arithmetic type of the       */
+/* element type and rounds the result back on store, so fp16 and bf16    */
+/* round after every operation as a native implementation would.  The    */
+/* pointers are not restrict: the compiler vectorizes the loops behind a */
+/* run-time overlap check, as it did the loops over the global arrays.   */
+/*-----------------------------------------------------------------------*/
+
+#include <math.h>
+#include "stream_kernels.h"
+
+#ifdef _OPENMP
+#define STREAM_CHECK_PARALLEL _Pragma("omp parallel for reduction(+:sum, bad)")
+#else
+#define STREAM_CHECK_PARALLEL
+#endif
+
+#define STREAM_TYPE_KERNELS(TAG, ID, T, A, LOAD, STORE)                       \
+static void fill_##TAG(void *x, double value, size_t n)                       \
+{                                                                             \
+    T *px = x, v = STORE((A) value);                                          \
+    size_t j;                                                                 \
+    for (j = 0; j < n; j++)                                                   \
+        px[j] = v;                                                            \
+}                                                                             \
+                                                                              \
+static void copy_##TAG(void *c, const void *a, size_t n)                      \
+{                                                                             \
+    T *pc = c;                                                                \
+    const T *pa = a;                                                          \
+    size_t j;                                                                 \
+    for (j = 0; j < n; j++)                                                   \
+        pc[j] = pa[j];                                                        \
+}                                                                             \
+                                                                              \
+static void scale_##TAG(void *b, const void *c, double scalar, size_t n)      \
+{                                                                             \
+    T *pb = b;                                                                \
+    const T *pc = c;                                                          \
+    A s = LOAD(STORE((A) scalar));                                            \
+    size_t j;                                                                 \
+    for (j = 0; j < n; j++)                                                   \
+        pb[j] = STORE(s * LOAD(pc[j]));                                       \
+}                                                                             \
+                                                                              \
+static void add_##TAG(void *c, const void *a, const void *b, size_t n)        \
+{                                                                             \
+    T *pc = c;                                                                \
+    const T *pa = a, *pb = b;                                                 \
+    size_t j;                                                                 \
+    for (j = 0; j < n; j++)                                                   \
+        pc[j] = STORE(LOAD(pa[j]) + LOAD(pb[j]));                             \
+}                                                                             \
+                                                                              \
+static void triad_##TAG(void *a, const void *b, const void *c, double scalar, \
+                        size_t n)                                             \
+{                                                                             \
+    T *pa = a;                                                                \
+    const T *pb = b, *pc = c;                                                 \
+    A s = LOAD(STORE((A) scalar));                                            \
+    size_t j;                                                                 \
+    for (j = 0; j < n; j++)                                                   \
+        pa[j] = STORE(LOAD(pb[j]) + s * LOAD(pc[j]));                         \
+}                                                                             \
+                                                                              \
+/* All four kernels in one pass: c = a; b = s*c; c = a + b; a = b + s*c,      \
+ * each value rounded to T as the separate kernels round it */                \
+static void fused_##TAG(void *a, void *b, void *c, double scalar, size_t n)   \
+{                                                                             \
+    T *pa = a, *pb = b, *pc = c;                                              \
+    A s = LOAD(STORE((A) scalar));                                            \
+    size_t j;                                                                 \
+    for (j = 0; j < n; j++) {                                                 \
+        A aj = LOAD(pa[j]);                                                   \
+        A bj = LOAD(STORE(s * aj));                                           \
+        A cj = LOAD(STORE(aj + bj));                                          \
+        pb[j] = STORE(bj);                                                    \
+        pc[j] = STORE(cj);                                                    \
+        pa[j] = STORE(bj + s * cj);                                           \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static double get_##TAG(const void *x, size_t j)                              \
+{                                                                             \
+    return (double) LOAD(((const T *) x)[j]);                                 \
+}                                                                             \
+                                                                              \
+static void check_##TAG(const void *x, double expected, double epsilon,       \
+                        size_t n, double *sum_err, size_t *nerr)              \
+{                                                                             \
+    const T *px = x;                                                          \
+    double sum = 0.0, limit = epsilon * fabs(expected);                       \
+    size_t bad = 0, j;                                                        \
+    STREAM_CHECK_PARALLEL                                                     \
+    for (j = 0; j < n; j++) {                                                 \
+        double d = fabs((double) LOAD(px[j]) - expected);                     \
+        sum += d;                                                             \
+        bad += d > limit;                                                     \
+    }                                                                         \
+    *sum_err = sum;                                                           \
+    *nerr = bad;                                                              \
+}                                                                             \
+                                                                              \
+static const stream_type_kernels kernels_##TAG = {                            \
+    ID, fill_##TAG, copy_##TAG, scale_##TAG, add_##TAG, triad_##TAG,          \
+    fused_##TAG, get_##TAG, check_##TAG                                       \
+};
+
+PRECISION_FOR_EACH(STREAM_TYPE_KERNELS)
+
+#define STREAM_TYPE_ENTRY(TAG, ID, T, A, LOAD, STORE) &kernels_##TAG,
+
+static const stream_type_kernels *const all_kernels[] = {
+    PRECISION_FOR_EACH(STREAM_TYPE_ENTRY)
+};
+
+const stream_type_kernels *stream_type_select(precision type)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(all_kernels) / sizeof(all_kernels[0]); i++) {
+        if (all_kernels[i]->type == type)
+            return all_kernels[i];
+    }
+    return NULL;
+}
@@ -0,0 +1,350 @@
+#!/bin/bash
+
+# Compiler-flag and toolchain matrix
+#
+# Builds the benchmarks once per combination of compiler, optimisation
+# level, -march and extra flags (see tools/compiler_flags.md), into
+# separately named binaries, runs each one and ranks the combinations.
+#
+# A combination is named COMPILER-OPT-ARCH[-EXTRA][-pgo], for example
+# gcc-O3-rv64gcv-unroll+lto.  EXTRA is one of
+#   none          nothing added
+#   unroll        -funroll-loops
+#   lto           -flto
+#   unroll+lto    both
+# and --pgo adds a profile-guided build of every combination: it is built
+# with profiling, trained by one run of the benchmark with the same
+# arguments, and rebuilt with the profile.
+#
+# Writes into the output directory:
+#   bin/NAME/               the binaries of each combination
+#   records/BENCH.NAME.rN.csv  the --format csv record of every run
+#   logs/                   build, training and run output
+#   matrix.csv              the records of this run's benchmarks and
+#                           combinations in one CSV
+#   ranking.txt             the ranked comparison printed at the end
+#
+# Every throughput result (kernel, variant and working set of a record) is
+# compared with the best combination for it; a combination's score for a
+# benchmark is the geometric mean of those fractions, and its overall
+# score the geometric mean over the benchmarks.  Combinations whose build
+# fails, or whose runs fail or do not verify, are listed but not ranked.
+#
+# Example:
+#   tools/flag_matrix.sh -c gcc,clang -O O2,O3,Ofast -m rv64gc,rv64gcv \
+#       -x none,unroll+lto --pgo -B stream,matmul,vector_add
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+COMPILERS=gcc,clang
+OPTS=O2,O3,Ofast
+ARCHS=rv64gc,rv64gcv
+EXTRAS=none,unroll,lto
+PGO=0
+BENCHMARKS=stream,matmul
+MATRIX_SIZE=512
+REPS=3
+BIND=none
+OUT=flag-matrix
+BUILD=1
+declare -A ARGS
+
+usage() {
+    echo "Usage: $0 [options]"
+    echo "  -c, --compilers LIST   toolchains, e.g. gcc,clang,gcc-13 (default $COMPILERS;"
+    echo "                         those not installed are skipped)"
+    echo "  -O, --opt LIST         optimisation levels (default $OPTS)"
+    echo "  -m, --march LIST       -march values, e.g. native (default $ARCHS)"
+    echo "  -x, --extras LIST      none, unroll, lto, unroll+lto (default $EXTRAS)"
+    echo "  -p, --pgo              also build every combination with PGO"
+    echo "  -B, --benchmarks LIST  from stream,gather,vector_add,matmul,peak_flops"
+    echo "                         (default $BENCHMARKS)"
+    echo "  -a, --args BENCH=ARGS  extra arguments for one benchmark's runs,"
+    echo "                         e.g. -a 'stream=--size 20000000'"
+    echo "  -n, --matrix-size N    matmul size (default $MATRIX_SIZE)"
+    echo "  -r, --reps N           runs per binary (default $REPS)"
+    echo "  -b, --bind SPEC        thread binding passed to every benchmark (default $BIND)"
+    echo "  -o, --output DIR       output directory (default $OUT)"
+    echo "      --no-build         rank the records already in the output directory"
+    echo "  -h, --help             show this message"
+}
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        -c|--compilers) COMPILERS=$2; shift ;;
+        -O|--opt) OPTS=$2; shift ;;
+        -m|--march) ARCHS=$2; shift ;;
+        -x|--extras) EXTRAS=$2; shift ;;
+        -p|--pgo) PGO=1 ;;
+        -B|--benchmarks) BENCHMARKS=$2; shift ;;
+        -a|--args)
+            case "$2" in
+                ?*=*) ARGS[${2%%=*}]=${2#*=} ;;
+                *) echo "Invalid arguments: $2 (expected BENCH=ARGS)" >&2; exit 1 ;;
+            esac
+            shift ;;
+        -n|--matrix-size) MATRIX_SIZE=$2; shift ;;
+        -r|--reps) REPS=$2; shift ;;
+        -b|--bind) BIND=$2; shift ;;
+        -o|--output) OUT=$2; shift ;;
+        --no-build) BUILD=0 ;;
+        -h|--help) usage; exit 0 ;;
+        *) usage >&2; exit 1 ;;
+    esac
+    shift
+done
+
+# Source directory of each benchmark; all are built by a target of the
+# same name
+bench_dir() {
+    case "$1" in
+        stream|gather) echo "$ROOT/stream" ;;
+        vector_add|matmul|peak_flops) echo "$ROOT/openmp-examples" ;;
+        *) return 1 ;;
+    esac
+}
+
+for b in ${BENCHMARKS//,/ }; do
+    if ! bench_dir "$b" > /dev/null; then
+        echo "Unknown benchmark: $b" >&2
+        exit 1
+    fi
+done
+for x in ${EXTRAS//,/ }; do
+    case "$x" in
+        none|unroll|lto|unroll+lto) ;;
+        *) echo "Unknown extra flags: $x (expected none, unroll, lto or unroll+lto)" >&2; exit 1 ;;
+    esac
+done
+
+mkdir -p "$OUT/bin" "$OUT/records" "$OUT/logs"
+OUT=$(cd "$OUT" && pwd)
+
+# Combinations in matrix order: NAME COMPILER FLAGS PGO
+combos=()
+for cc in ${COMPILERS//,/ }; do
+    if ! command -v "$cc" > /dev/null; then
+        echo "Skipping $cc: not installed" >&2
+        continue
+    fi
+    for o in ${OPTS//,/ }; do
+        for m in ${ARCHS//,/ }; do
+            for x in ${EXTRAS//,/ }; do
+                flags="-${o#-} -march=$m"
+                case "$x" in
+                    unroll) flags="$flags -funroll-loops" ;;
+                    lto) flags="$flags -flto" ;;
+                    unroll+lto) flags="$flags -funroll-loops -flto" ;;
+                esac
+                name="$cc-${o#-}-$m"
+                [ "$x" = none ] || name="$name-$x"
+                combos+=("$name|$cc|$flags|0")
+                [ "$PGO" = 0 ] || combos+=("$name-pgo|$cc|$flags|1")
+            done
+        done
+    done
+done
+if [ ${#combos[@]} = 0 ]; then
+    echo "No combination to build" >&2
+    exit 1
+fi
+
+# make the benchmark with CC=$2 CFLAGS=$3 and the matching C++ compiler
+# for matmul's C++ kernels (gcc-13 -> g++-13, clang -> clang++); the binary
+# stays in its source directory
+build_one() {
+    local b=$1 cc=$2 flags=$3 log=$4 cxx
+    cxx=${cc/clang/clang++}
+    cxx=${cxx/gcc/g++}
+    make -B -C "$(bench_dir "$b")" "$b" CC="$cc" CXX="$cxx" CFLAGS="$flags -fopenmp" \
+        MATRIX_SIZE="$MATRIX_SIZE" >> "$log" 2>&1
+}
+
+# Run a benchmark binary; fails if it exits non-zero or reports a failed
+# verification
+run_one() {
+    local bin=$1 b=$2 log=$3 csv=$4
+    # shellcheck disable=SC2086
+    "$bin" --bind "$BIND" ${ARGS[$b]} --format csv --output "$csv" > "$log" 2>&1 &&
+        ! grep -Eq "FAILED|Failed Validation" "$log"
+}
+
+[ "$BUILD" = 0 ] || : > "$OUT/failed.txt"
+for c in "${combos[@]}"; do
+    [ "$BUILD" = 1 ] || break
+    IFS='|' read -r name cc flags pgo <<< "$c"
+    echo "Building and running $name ($cc $flags)..."
+    mkdir -p "$OUT/bin/$name" "$OUT/logs/$name"
+    rm -f "$OUT"/records/*."$name".r*.csv
+    log="$OUT/logs/$name/build.log"
+    : > "$log"
+    for b in ${BENCHMARKS//,/ }; do
+        dir=$(bench_dir "$b")
+        if [ "$pgo" = 1 ]; then
+            prof="$OUT/logs/$name/$b.profile"
+            rm -rf "$prof"
+            mkdir -p "$prof"
+            if "$cc" --version | grep -qi clang; then
+                gen="-fprofile-generate=$prof"
+                use="-fprofile-use=$prof/default.profdata"
+            else
+                gen="-fprofile-generate=$prof -fprofile-update=atomic"
+                use="-fprofile-use=$prof -fprofile-correction -Wno-missing-profile"
+            fi
+            if ! build_one "$b" "$cc" "$flags $gen" "$log" ||
+               ! run_one "$dir/$b" "$b" "$OUT/logs/$name/$b.train.log" /dev/null; then
+                echo "  $b: profiling build or training run failed" >&2
+                echo "$name $b build" >> "$OUT/failed.txt"
+                continue
+            fi
+            if "$cc" --version | grep -qi clang &&
+               ! llvm-profdata merge -output="$prof/default.profdata" "$prof"/*.profraw >> "$log" 2>&1; then
+                echo "  $b: llvm-profdata merge failed" >&2
+                echo "$name $b build" >> "$OUT/failed.txt"
+                continue
+            fi
+            flags_b="$flags $use"
+        else
+            flags_b=$flags
+        fi
+        if ! build_one "$b" "$cc" "$flags_b" "$log"; then
+            echo "  $b: build failed, see $log" >&2
+            echo "$name $b build" >> "$OUT/failed.txt"
+            continue
+        fi
+        mv "$dir/$b" "$OUT/bin/$name/$b"
+        for r in $(seq 1 "$REPS"); do
+            if ! run_one "$OUT/bin/$name/$b" "$b" "$OUT/logs/$name/$b.r$r.log" \
+                    "$OUT/records/$b.$name.r$r.csv"; then
+                echo "  $b run $r failed, see $OUT/logs/$name/$b.r$r.log" >&2
+                echo "$name $b run" >> "$OUT/failed.txt"
+                rm -f "$OUT/records/$b.$name.r$r.csv"
+            fi
+        done
+    done
+done
+
+# Only the records of the current benchmarks and combinations: a reused
+# output directory may hold others, which would leave every current
+# combination missing a benchmark and the ranking empty
+records=()
+shopt -s nullglob
+for c in "${combos[@]}"; do
+    for b in ${BENCHMARKS//,/ }; do
+        records+=("$OUT/records/$b.${c%%|*}".r*.csv)
+    done
+done
+shopt -u nullglob
+if [ ${#records[@]} = 0 ]; then
+    echo "No results to rank" >&2
+    exit 1
+fi
+awk 'FNR > 1 || NR == 1' "${records[@]}" > "$OUT/matrix.csv"
+
+# Rank the combinations from the records.  Fields are looked up by header
+# name; quoted fields may contain commas.
+names=
+for c in "${combos[@]}"; do names="$names ${c%%|*}"; done
+awk -v names="$names" -v failed="$OUT/failed.txt" '
+function csv_split(line, f,    n, i, c, q, field) {
+    n = 0; field = ""; q = 0
+    for (i = 1; i <= length(line); i++) {
+        c = substr(line, i, 1)
+        if (q) {
+            if (c == "\"") {
+                if (substr(line, i + 1, 1) == "\"") { field = field c; i++ }
+                else q = 0
+            } else field = field c
+        } else if (c == "\"") q = 1
+        else if (c == ",") { f[++n] = field; field = "" }
+        else field = field c
+    }
+    f[++n] = field
+    return n
+}
+BEGIN {
+    nn = split(names, order, " ")
+    while ((getline line < failed) > 0) {
+        split(line, w, " ")
+        bad[w[1]] = bad[w[1]] (bad[w[1]] == "" ? "" : ", ") w[2] " " w[3]
+    }
+}
+FNR == 1 {
+    delete col
+    n = csv_split($0, h)
+    for (i = 1; i <= n; i++) col[h[i]] = i
+    # records/BENCH.NAME.rN.csv
+    base = FILENAME; sub(/.*\//, "", base)
+    split(base, p, ".")
+    bench = p[1]; name = p[2]
+    benches[bench] = 1
+    flagsof[name] = ""
+    next
+}
+{
+    csv_split($0, f)
+    # Throughput only: latencies and overheads rank the other way
+    unit = f[col["unit"]]
+    if (unit !~ /\/s$|FLOPS$/ || f[col["rate"]] + 0 <= 0) next
+    if (flagsof[name] == "") {
+        flagsof[name] = f[col["flags"]]
+        compilerof[name] = f[col["compiler"]]
+    }
+    key = bench SUBSEP f[col["kernel"]] " " f[col["variant"]] " " f[col["working_set_bytes"]]
+    rate = f[col["rate"]] + 0
+    if (rate > best[key, name]) best[key, name] = rate
+    if (rate > top[key]) top[key] = rate
+    keys[key] = 1
+}
+END {
+    # Per benchmark: geometric mean of rate / best rate over its results
+    for (key in keys) {
+        split(key, kp, SUBSEP)
+        for (i = 1; i <= nn; i++) {
+            nm = order[i]
+            if (!((key, nm) in best)) { missing[kp[1], nm] = 1; continue }
+            lsum[kp[1], nm] += log(best[key, nm] / top[key])
+            cnt[kp[1], nm]++
+        }
+    }
+    nb = 0
+    for (b in benches) blist[++nb] = b
+    for (i = 2; i <= nb; i++)
+        for (j = i; j > 1 && blist[j - 1] > blist[j]; j--) { t = blist[j]; blist[j] = blist[j - 1]; blist[j - 1] = t }
+    nr = 0
+    for (i = 1; i <= nn; i++) {
+        nm = order[i]
+        ok = (bad[nm] == "")
+        s = 0
+        for (j = 1; j <= nb; j++) {
+            b = blist[j]
+            if (cnt[b, nm] == 0 || ((b, nm) in missing)) { ok = 0; continue }
+            score[b, nm] = exp(lsum[b, nm] / cnt[b, nm])
+            s += log(score[b, nm])
+        }
+        if (ok) { ranked[++nr] = nm; total[nm] = exp(s / nb) }
+    }
+    for (i = 2; i <= nr; i++)
+        for (j = i; j > 1 && total[ranked[j - 1]] < total[ranked[j]]; j--) {
+            t = ranked[j]; ranked[j] = ranked[j - 1]; ranked[j - 1] = t
+        }
+
+    printf "Score: geometric mean of rate / best rate over every result (100 = best\n"
+    printf "everywhere); per benchmark, then over the benchmarks.\n\n"
+    printf "%4s  %-32s %7s", "Rank", "Combination", "Score"
+    for (j = 1; j <= nb; j++) printf " %10s", blist[j]
+    printf "  %s\n", "Speedup vs last"
+    for (i = 1; i <= nr; i++) {
+        nm = ranked[i]
+        printf "%4d  %-32s %7.1f", i, nm, 100 * total[nm]
+        for (j = 1; j <= nb; j++) printf " %10.1f", 100 * score[blist[j], nm]
+        printf "  %.2fx\n", total[nm] / total[ranked[nr]]
+    }
+    for (i = 1; i <= nn; i++) {
+        nm = order[i]
+        if (bad[nm] != "") printf "   -  %-32s failed: %s\n", nm, bad[nm]
+    }
+    if (nr > 0)
+        printf "\nBest: %s\n  %s\n  %s\n", ranked[1], compilerof[ranked[1]], flagsof[ranked[1]]
+}' "${records[@]}" | tee "$OUT/ranking.txt"
@@ -0,0 +1,257 @@
+#!/bin/bash
+
+# Roofline generator
+#
+# Measures the ceilings of the roofline on this machine and places the
+# OpenMP kernels under them:
+#   - memory ceilings per cache level from the STREAM Triad working-set
+#     sweep (stream --sweep)
+#   - the compute ceiling from the best fp64 configuration of the FMA-chain
+#     benchmark (peak_flops)
+#   - matmul variants and vector_add as points, from the FLOPs, bytes and
+#     best times in their --format csv records
+#
+# Writes into the output directory:
+#   *.csv, *.log     raw records and text output of every run
+#   roofline.dat     ceilings and kernel points (gnuplot-friendly columns)
+#   roofline.svg     log-log roofline plot
+#
+# Thread count and placement follow OMP_NUM_THREADS and --bind, e.g.
+#   OMP_NUM_THREADS=4 tools/roofline.sh --bind compact
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+OUT=roofline
+SWEEP=4K:1G
+MATRIX_SIZE=1024
+BIND=none
+BUILD=1
+# A bandwidth drop of more than this fraction starts a new cache level
+DROP=0.3
+
+usage() {
+    echo "Usage: $0 [options]"
+    echo "  -o, --output DIR       output directory (default $OUT)"
+    echo "  -s, --sweep MIN:MAX    STREAM working-set range (default $SWEEP)"
+    echo "  -n, --matrix-size N    matmul size (default $MATRIX_SIZE)"
+    echo "  -b, --bind SPEC        thread binding passed to every benchmark (default $BIND)"
+    echo "  -d, --drop FRAC        bandwidth drop that separates cache levels (default $DROP)"
+    echo "      --no-build         use the binaries already built"
+    echo "  -h, --help             show this message"
+}
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        -o|--output) OUT=$2; shift ;;
+        -s|--sweep) SWEEP=$2; shift ;;
+        -n|--matrix-size) MATRIX_SIZE=$2; shift ;;
+        -b|--bind) BIND=$2; shift ;;
+        -d|--drop) DROP=$2; shift ;;
+        --no-build) BUILD=0 ;;
+        -h|--help) usage; exit 0 ;;
+        *) usage >&2; exit 1 ;;
+    esac
+    shift
+done
+
+mkdir -p "$OUT"
+
+if [ "$BUILD" = 1 ]; then
+    echo "Building benchmarks..."
+    make -C "$ROOT/stream" clean > /dev/null
+    make -C "$ROOT/stream" openmp > "$OUT/build.log"
+    make -C "$ROOT/openmp-examples" clean > /dev/null
+    make -C "$ROOT/openmp-examples" MATRIX_SIZE="$MATRIX_SIZE" \
+        vector_add matmul peak_flops >> "$OUT/build.log"
+fi
+
+echo "Running STREAM working-set sweep ($SWEEP)..."
+"$ROOT/stream/stream" --sweep "$SWEEP" --bind "$BIND" \
+    --format csv --output "$OUT/stream.csv" > "$OUT/stream.log"
+
+echo "Running peak FLOPS kernel..."
+"$ROOT/openmp-examples/peak_flops" --bind "$BIND" \
+    --format csv --output "$OUT/peak_flops.csv" > "$OUT/peak_flops.log"
+
+echo "Running matmul ($MATRIX_SIZE x $MATRIX_SIZE)..."
+"$ROOT/openmp-examples/matmul" --bind "$BIND" \
+    --format csv --output "$OUT/matmul.csv" > "$OUT/matmul.log"
+
+echo "Running vector_add..."
+"$ROOT/openmp-examples/vector_add" --bind "$BIND" \
+    --format csv --output "$OUT/vector_add.csv" > "$OUT/vector_add.log"
+
+# CSV records (see common/report.h) to roofline.dat.  Fields are looked
+# up by header name; quoted fields may contain commas.
+awk -v drop="$DROP" '
+function csv_split(line, f,    n, i, c, q, field) {
+    n = 0; field = ""; q = 0
+    for (i = 1; i <= length(line); i++) {
+        c = substr(line, i, 1)
+        if (q) {
+            if (c == "\"") {
+                if (substr(line, i + 1, 1) == "\"") { field = field c; i++ }
+                else q = 0
+            } else field = field c
+        } else if (c == "\"") q = 1
+        else if (c == ",") { f[++n] = field; field = "" }
+        else field = field c
+    }
+    f[++n] = field
+    return n
+}
+function median(v, lo, hi,    i, j, t, n, s) {
+    n = 0
+    for (i = lo; i <= hi; i++) s[++n] = v[i]
+    for (i = 2; i <= n; i++)
+        for (j = i; j > 1 && s[j - 1] > s[j]; j--) { t = s[j]; s[j] = s[j - 1]; s[j - 1] = t }
+    return (n % 2) ? s[(n + 1) / 2] : (s[n / 2] + s[n / 2 + 1]) / 2
+}
+FNR == 1 {
+    delete col
+    n = csv_split($0, h)
+    for (i = 1; i <= n; i++) col[h[i]] = i
+    next
+}
+{
+    csv_split($0, f)
+    bench = f[col["benchmark"]]
+    kernel = f[col["kernel"]]
+    variant = f[col["variant"]]
+    if (host == "") { host = f[col["host"]]; cpu = f[col["cpu"]] }
+    if (bench == "stream" && kernel == "Triad") {
+        ns++
+        ws[ns] = f[col["working_set_bytes"]]
+        bw[ns] = f[col["rate"]] / 1000.0        # MB/s to GB/s
+    } else if (bench == "peak_flops" && kernel ~ /fp64/ && f[col["rate"]] + 0 > peak + 0) {
+        # best double-precision configuration, normally vector on all cores
+        peak = f[col["rate"]]
+        peak_name = kernel
+    } else if (bench == "matmul" || bench == "vector_add") {
+        flops = f[col["flops"]]; bytes = f[col["bytes"]]; t = f[col["min_time"]]
+        if (flops > 0 && bytes > 0 && t > 0) {
+            np++
+            pname[np] = bench ":" kernel (variant != "" ? " (" variant ")" : "")
+            pai[np] = flops / bytes
+            pgf[np] = flops / t / 1e9
+        }
+    }
+}
+END {
+    if (ns == 0 || peak == "") {
+        print "roofline: missing STREAM sweep or peak FLOPS results" > "/dev/stderr"
+        exit 1
+    }
+    # Split the sweep into levels wherever bandwidth falls by more than
+    # drop below the best of the current level
+    nl = 1; first[1] = 1; best = bw[1]
+    for (i = 2; i <= ns; i++) {
+        if (bw[i] < (1 - drop) * best) {
+            last[nl] = i - 1
+            first[++nl] = i
+            best = bw[i]
+        } else if (bw[i] > best) {
+            best = bw[i]
+        }
+    }
+    last[nl] = ns
+
+    printf "# Roofline of %s (%s)\n", host, cpu
+    printf "# memory <level> <GB/s> <min working set bytes> <max working set bytes>\n"
+    for (l = 1; l <= nl; l++) {
+        name = (l == nl) ? (nl == 1 ? "memory" : "DRAM") : "L" l
+        printf "memory %s %.2f %.0f %.0f\n", name, median(bw, first[l], last[l]), ws[first[l]], ws[last[l]]
+    }
+    printf "# compute <name> <GFLOPS>\n"
+    printf "compute %s %.2f\n", peak_name, peak
+    printf "# kernel <AI FLOP/byte> <GFLOPS> <name>\n"
+    for (i = 1; i <= np; i++)
+        printf "kernel %.4g %.3f %s\n", pai[i], pgf[i], pname[i]
+}' "$OUT/stream.csv" "$OUT/peak_flops.csv" "$OUT/matmul.csv" "$OUT/vector_add.csv" \
+    > "$OUT/roofline.dat"
+
+# Summary: ridge points and where each kernel sits under the DRAM roof
+awk '
+$1 == "memory" { nm++; mname[nm] = $2; mbw[nm] = $3 }
+$1 == "compute" { cname = $2; peak = $3 }
+$1 == "kernel" {
+    nk++; kai[nk] = $2; kgf[nk] = $3; kname[nk] = $4
+    for (i = 5; i <= NF; i++) kname[nk] = kname[nk] " " $i
+}
+END {
+    printf "Compute ceiling: %.2f GFLOPS (%s)\n", peak, cname
+    for (i = 1; i <= nm; i++)
+        printf "Memory ceiling %-6s %8.2f GB/s, ridge at %.2f FLOP/B\n", mname[i], mbw[i], peak / mbw[i]
+    dram = mbw[nm]
+    for (i = 1; i <= nk; i++) {
+        roof = (dram * kai[i] < peak) ? dram * kai[i] : peak
+        printf "  %-32s AI %8.3f FLOP/B  %8.2f GFLOPS  %5.1f%% of roof (%s-bound)\n", \
+            kname[i], kai[i], kgf[i], 100 * kgf[i] / roof, (dram * kai[i] < peak) ? "memory" : "compute"
+    }
+}' "$OUT/roofline.dat"
+
+# roofline.dat to a log-log SVG: x is arithmetic intensity in powers of
+# two, y is GFLOPS in powers of ten
+awk '
+function lg(x) { return log(x) / log(10) }
+function px(x) { return L + (lg(x) - lg(xmin)) / (lg(xmax) - lg(xmin)) * W }
+function py(y) { return T + H - (lg(y) - lg(ymin)) / (lg(ymax) - lg(ymin)) * H }
+function pow10_below(y,    e) { e = int(lg(y)); if (10 ^ e > y) e--; return 10 ^ e }
+function pow10_above(y,    e) { e = int(lg(y)); if (10 ^ e < y) e++; return 10 ^ e }
+$1 == "memory" { nm++; mname[nm] = $2; mbw[nm] = $3 }
+$1 == "compute" { cname = $2; peak = $3 }
+$1 == "kernel" {
+    nk++; kai[nk] = $2; kgf[nk] = $3; kname[nk] = $4
+    for (i = 5; i <= NF; i++) kname[nk] = kname[nk] " " $i
+}
+$1 == "#" && title == "" { title = substr($0, 3) }
+END {
+    L = 80; T = 40; W = 720; H = 480
+    xmin = 1 / 64; xmax = 64
+    for (i = 1; i <= nk; i++) {
+        while (kai[i] < xmin * 2) xmin /= 2
+        while (kai[i] > xmax / 2) xmax *= 2
+    }
+    ymin = mbw[nm] * xmin; top = 1
+    for (i = 1; i <= nk; i++) if (kgf[i] < ymin) ymin = kgf[i]
+    for (i = 2; i <= nm; i++) if (mbw[i] > mbw[top]) top = i
+    ymin = pow10_below(ymin)
+    ymax = pow10_above(peak * 2)
+
+    printf "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\" font-family=\"sans-serif\" font-size=\"12\">\n", L + W + 40, T + H + 60
+    printf "<rect width=\"100%%\" height=\"100%%\" fill=\"white\"/>\n"
+    printf "<text x=\"%d\" y=\"20\" font-size=\"14\">%s</text>\n", L, title
+    for (x = xmin; x <= xmax * 1.0001; x *= 2) {
+        printf "<line x1=\"%.1f\" y1=\"%d\" x2=\"%.1f\" y2=\"%d\" stroke=\"#ddd\"/>\n", px(x), T, px(x), T + H
+        printf "<text x=\"%.1f\" y=\"%d\" text-anchor=\"middle\">%s</text>\n", px(x), T + H + 16, \
+            (x < 1) ? sprintf("1/%d", 1 / x + 0.5) : sprintf("%g", x)
+    }
+    for (y = ymin; y <= ymax * 1.0001; y *= 10) {
+        printf "<line x1=\"%d\" y1=\"%.1f\" x2=\"%d\" y2=\"%.1f\" stroke=\"#ddd\"/>\n", L, py(y), L + W, py(y)
+        printf "<text x=\"%d\" y=\"%.1f\" text-anchor=\"end\">%g</text>\n", L - 6, py(y) + 4, y
+    }
+    printf "<rect x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\" fill=\"none\" stroke=\"black\"/>\n", L, T, W, H
+    printf "<text x=\"%d\" y=\"%d\" text-anchor=\"middle\">Arithmetic intensity (FLOP/byte)</text>\n", L + W / 2, T + H + 40
+    printf "<text transform=\"translate(20,%d) rotate(-90)\" text-anchor=\"middle\">GFLOPS</text>\n", T + H / 2
+
+    # Memory ceilings up to their ridge point, then the compute ceiling
+    # from the leftmost ridge
+    for (i = 1; i <= nm; i++) {
+        x0 = xmin; y0 = mbw[i] * x0
+        if (y0 < ymin) { y0 = ymin; x0 = ymin / mbw[i] }
+        x1 = peak / mbw[i]; if (x1 > xmax) x1 = xmax
+        printf "<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" stroke=\"#1f77b4\" stroke-width=\"2\"/>\n", px(x0), py(y0), px(x1), py(mbw[i] * x1)
+        printf "<text x=\"%.1f\" y=\"%.1f\" fill=\"#1f77b4\">%s %.1f GB/s</text>\n", px(x0) + 4, py(y0) - 6, mname[i], mbw[i]
+    }
+    printf "<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" stroke=\"#d62728\" stroke-width=\"2\"/>\n", px(peak / mbw[top]), py(peak), px(xmax), py(peak)
+    printf "<text x=\"%.1f\" y=\"%.1f\" text-anchor=\"end\" fill=\"#d62728\">%s %.1f GFLOPS</text>\n", px(xmax) - 4, py(peak) - 6, cname, peak
+
+    for (i = 1; i <= nk; i++) {
+        printf "<circle cx=\"%.1f\" cy=\"%.1f\" r=\"4\" fill=\"#2ca02c\"/>\n", px(kai[i]), py(kgf[i])
+        printf "<text x=\"%.1f\" y=\"%.1f\" font-size=\"10\">%s</text>\n", px(kai[i]) + 6, py(kgf[i]) + 4 + 11 * ((i % 3) - 1), kname[i]
+    }
+    printf "</svg>\n"
+}' "$OUT/roofline.dat" > "$OUT/roofline.svg"
+
+echo "Wrote $OUT/roofline.dat and $OUT/roofline.svg"